@@ -11,6 +11,7 @@
 #include "Error.h"
 #include "InputFiles.h"
 #include "Symbols.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Object/COFF.h"
 #include "llvm/Support/COFF.h"
 #include "llvm/Support/Debug.h"
@@ -38,6 +39,13 @@ SectionChunk::SectionChunk(ObjectFile *F, const coff_section *H)
 
   // Only COMDAT sections are subject of dead-stripping.
   Live = !isCOMDAT();
+
+  // Hash the contents now. Files are parsed on worker threads, so by
+  // the time anyone wants a hash it is already there.
+  if (hasData()) {
+    ArrayRef<uint8_t> A = getContents();
+    ContentHash = hash_combine_range(A.begin(), A.end());
+  }
 }
 
 static void add16(uint8_t *P, int16_t V) { write16le(P, read16le(P) + V); }
@@ -124,6 +132,40 @@ void SectionChunk::applyRelARM(uint8_t *Off, uint16_t Type, Defined *Sym,
   }
 }
 
+Defined *SectionChunk::getRelocTarget(const coff_relocation &Rel) const {
+  SymbolBody *Body = File->getSymbolBody(Rel.SymbolTableIndex)->repl();
+  return cast<Defined>(Body);
+}
+
+// Applies all relocations of an AMD64 section. The common case by far
+// is a run of consecutive IMAGE_REL_AMD64_ADDR64 or ADDR32NB fixups
+// (vtables, jump tables, RTTI data); relocations are stored in
+// ascending address order, so such runs are contiguous. They are
+// peeled into tight loops that do nothing but look up, add and store,
+// which keeps the per-relocation type dispatch out of the hot path.
+void SectionChunk::applyRelocsX64(uint8_t *Base) const {
+  for (auto I = Relocs.begin(), E = Relocs.end(); I != E;) {
+    if (I->Type == IMAGE_REL_AMD64_ADDR64) {
+      do {
+        add64(Base + I->VirtualAddress,
+              getRelocTarget(*I)->getRVA() + Config->ImageBase);
+        ++I;
+      } while (I != E && I->Type == IMAGE_REL_AMD64_ADDR64);
+      continue;
+    }
+    if (I->Type == IMAGE_REL_AMD64_ADDR32NB) {
+      do {
+        add32(Base + I->VirtualAddress, getRelocTarget(*I)->getRVA());
+        ++I;
+      } while (I != E && I->Type == IMAGE_REL_AMD64_ADDR32NB);
+      continue;
+    }
+    applyRelX64(Base + I->VirtualAddress, I->Type, getRelocTarget(*I),
+                RVA + I->VirtualAddress);
+    ++I;
+  }
+}
+
 void SectionChunk::writeTo(uint8_t *Buf) const {
   if (!hasData())
     return;
@@ -131,25 +173,25 @@ void SectionChunk::writeTo(uint8_t *Buf) const {
   ArrayRef<uint8_t> A = getContents();
   memcpy(Buf + OutputSectionOff, A.data(), A.size());
 
-  // Apply relocations.
-  for (const coff_relocation &Rel : Relocs) {
-    uint8_t *Off = Buf + OutputSectionOff + Rel.VirtualAddress;
-    SymbolBody *Body = File->getSymbolBody(Rel.SymbolTableIndex)->repl();
-    Defined *Sym = cast<Defined>(Body);
-    uint64_t P = RVA + Rel.VirtualAddress;
-    switch (Config->Machine) {
-    case AMD64:
-      applyRelX64(Off, Rel.Type, Sym, P);
-      break;
-    case I386:
-      applyRelX86(Off, Rel.Type, Sym, P);
-      break;
-    case ARMNT:
-      applyRelARM(Off, Rel.Type, Sym, P);
-      break;
-    default:
-      llvm_unreachable("unknown machine type");
-    }
+  // Apply relocations. The machine type is the same for every
+  // relocation, so dispatch on it once instead of per fixup.
+  uint8_t *Base = Buf + OutputSectionOff;
+  switch (Config->Machine) {
+  case AMD64:
+    applyRelocsX64(Base);
+    break;
+  case I386:
+    for (const coff_relocation &Rel : Relocs)
+      applyRelX86(Base + Rel.VirtualAddress, Rel.Type, getRelocTarget(Rel),
+                  RVA + Rel.VirtualAddress);
+    break;
+  case ARMNT:
+    for (const coff_relocation &Rel : Relocs)
+      applyRelARM(Base + Rel.VirtualAddress, Rel.Type, getRelocTarget(Rel),
+                  RVA + Rel.VirtualAddress);
+    break;
+  default:
+    llvm_unreachable("unknown machine type");
   }
 }
 
@@ -230,6 +272,64 @@ void SectionChunk::replace(SectionChunk *Other) {
   Other->Live = false;
 }
 
+// Entry point to read-only data deduplication (/opt:lldstrdedup).
+//
+// ICF only folds COMDAT sections with external symbols, so string
+// literals that the compiler emitted as plain read-only data survive
+// once per object file even when their contents are identical. This
+// pass buckets relocation-free read-only chunks by the content hash
+// computed at parse time and folds exact duplicates the same way ICF
+// does: the duplicate's Repl pointer is redirected to the survivor,
+// so relocations against symbols in a folded chunk resolve into the
+// survivor at write time. Folding merges the addresses of distinct
+// objects, which is why this is opt-in rather than on by default.
+void dedupStrings(const std::vector<Chunk *> &Chunks) {
+  std::vector<SectionChunk *> Candidates;
+  for (Chunk *C : Chunks) {
+    auto *SC = dyn_cast<SectionChunk>(C);
+    if (!SC || !SC->isLive() || !SC->hasData())
+      continue;
+    // Only relocation-free, non-writable, non-executable data can be
+    // merged by contents alone; sections with relocations or
+    // associative children are ICF's business.
+    uint32_t Perms = SC->getPermissions();
+    if ((Perms & (IMAGE_SCN_MEM_WRITE | IMAGE_SCN_MEM_EXECUTE)) ||
+        SC->NumRelocs != 0 || !SC->children().empty())
+      continue;
+    Candidates.push_back(SC);
+  }
+
+  // Sort duplicates next to each other. The sort is stable so that
+  // within a bucket chunks keep input order, making the survivor (the
+  // first chunk of each bucket) deterministic.
+  std::stable_sort(Candidates.begin(), Candidates.end(),
+                   [](SectionChunk *A, SectionChunk *B) {
+                     return A->ContentHash < B->ContentHash;
+                   });
+
+  for (auto It = Candidates.begin(), End = Candidates.end(); It != End;) {
+    SectionChunk *Head = *It;
+    auto Bound = std::find_if(It + 1, End, [&](SectionChunk *SC) {
+      return SC->ContentHash != Head->ContentHash;
+    });
+    // A hash bucket may still mix distinct contents, so group by real
+    // equality within it. A folded chunk is skipped as a group head.
+    while (It != Bound) {
+      SectionChunk *H = *It++;
+      if (!H->isLive())
+        continue;
+      for (auto I = It; I != Bound; ++I) {
+        SectionChunk *SC = *I;
+        if (SC->isLive() && H->getAlign() == SC->getAlign() &&
+            H->getPermissions() == SC->getPermissions() &&
+            H->getContents() == SC->getContents())
+          H->replace(SC);
+      }
+    }
+    It = Bound;
+  }
+}
+
 CommonChunk::CommonChunk(const COFFSymbolRef S) : Sym(S) {
   // Common symbols are aligned on natural boundaries up to 32 bytes.
   // This is what MSVC link.exe does.
@@ -304,22 +404,27 @@ void SEHTableChunk::writeTo(uint8_t *Buf) const {
 
 // Windows-specific.
 // This class represents a block in .reloc section.
-BaserelChunk::BaserelChunk(uint32_t Page, Baserel *Begin, Baserel *End) {
+BaserelChunk::BaserelChunk(uint32_t Page, const Baserel *Begin,
+                           const Baserel *End)
+    : Page(Page), Rels(Begin, End) {}
+
+size_t BaserelChunk::getSize() const {
   // Block header consists of 4 byte page RVA and 4 byte block size.
   // Each entry is 2 byte. Last entry may be padding.
-  Data.resize(alignTo((End - Begin) * 2 + 8, 4));
-  uint8_t *P = Data.data();
+  return alignTo(Rels.size() * 2 + 8, 4);
+}
+
+void BaserelChunk::writeTo(uint8_t *Buf) const {
+  uint8_t *P = Buf + OutputSectionOff;
   write32le(P, Page);
-  write32le(P + 4, Data.size());
+  write32le(P + 4, getSize());
   P += 8;
-  for (Baserel *I = Begin; I != End; ++I) {
-    write16le(P, (I->Type << 12) | (I->RVA - Page));
+  for (const Baserel &B : Rels) {
+    write16le(P, (B.Type << 12) | (B.RVA - Page));
     P += 2;
   }
-}
-
-void BaserelChunk::writeTo(uint8_t *Buf) const {
-  memcpy(Buf + OutputSectionOff, Data.data(), Data.size());
+  if (Rels.size() % 2)
+    write16le(P, 0);
 }
 
 uint8_t Baserel::getDefaultType() {
@@ -67,6 +67,7 @@ public:
   uint32_t getAlign() const { return Align; }
   void setRVA(uint64_t V) { RVA = V; }
   void setOutputSectionOff(uint64_t V) { OutputSectionOff = V; }
+  uint64_t getOutputSectionOff() const { return OutputSectionOff; }
 
   // Returns true if this has non-zero data. BSS chunks return
   // false. If false is returned, the space occupied by this chunk
@@ -149,6 +150,7 @@ public:
   void applyRelX64(uint8_t *Off, uint16_t Type, Defined *Sym, uint64_t P) const;
   void applyRelX86(uint8_t *Off, uint16_t Type, Defined *Sym, uint64_t P) const;
   void applyRelARM(uint8_t *Off, uint16_t Type, Defined *Sym, uint64_t P) const;
+  void applyRelocsX64(uint8_t *Base) const;
 
   // Called if the garbage collector decides to not include this chunk
   // in a final output. It's supposed to print out a log message to stdout.
@@ -160,13 +162,14 @@ public:
 
   StringRef getDebugName() override;
   void setSymbol(DefinedRegular *S) { if (!Sym) Sym = S; }
+  DefinedRegular *getSymbol() const { return Sym; }
 
-  // Used by the garbage collector.
+  // Used by the garbage collector. Marking returns true only for the
+  // caller that flipped the section from dead to live, so concurrent
+  // markers can race on a chunk and exactly one of them takes
+  // responsibility for visiting its successors.
   bool isLive() { return !Config->DoGC || Live; }
-  void markLive() {
-    assert(!isLive() && "Cannot mark an already live section!");
-    Live = true;
-  }
+  bool markLive() { return !Live.exchange(true); }
 
   // Allow iteration over the bodies of this chunk's relocated symbols.
   llvm::iterator_range<symbol_iterator> symbols() const {
@@ -187,7 +190,17 @@ public:
   // Auxiliary Format 5: Section Definitions. Used for ICF.
   uint32_t Checksum = 0;
 
+  // A hash of the section contents, computed once at parse time.
+  // ICF uses it both to bucket sections and as a cheap inequality
+  // test before comparing contents byte by byte. It is also a
+  // suitable cache key for recognizing unchanged sections across
+  // links. Zero for sections without data.
+  uint64_t ContentHash = 0;
+
 private:
+  // Returns the final symbol a relocation refers to.
+  Defined *getRelocTarget(const coff_relocation &Rel) const;
+
   // A file this chunk was created from.
   ObjectFile *File;
 
@@ -198,7 +211,7 @@ private:
   size_t NumRelocs;
 
   // Used by the garbage collector.
-  bool Live;
+  std::atomic<bool> Live;
 
   // Used for ICF (Identical COMDAT Folding)
   void replace(SectionChunk *Other);
@@ -308,12 +321,16 @@ private:
 // See the PE/COFF spec 5.6 for details.
 class BaserelChunk : public Chunk {
 public:
-  BaserelChunk(uint32_t Page, Baserel *Begin, Baserel *End);
-  size_t getSize() const override { return Data.size(); }
+  BaserelChunk(uint32_t Page, const Baserel *Begin, const Baserel *End);
+  size_t getSize() const override;
   void writeTo(uint8_t *Buf) const override;
 
 private:
-  std::vector<uint8_t> Data;
+  // The entries are packed into the output buffer by writeTo, which
+  // the writer runs in parallel over chunks. Rels points into the
+  // writer-owned relocation arrays, which stay live until then.
+  uint32_t Page;
+  ArrayRef<Baserel> Rels;
 };
 
 class Baserel {
@@ -30,6 +30,7 @@ class Undefined;
 
 // Short aliases.
 static const auto AMD64 = llvm::COFF::IMAGE_FILE_MACHINE_AMD64;
+static const auto ARM64 = llvm::COFF::IMAGE_FILE_MACHINE_ARM64;
 static const auto ARMNT = llvm::COFF::IMAGE_FILE_MACHINE_ARMNT;
 static const auto I386 = llvm::COFF::IMAGE_FILE_MACHINE_I386;
 
@@ -68,17 +69,23 @@ struct Configuration {
 
   llvm::COFF::MachineTypes Machine = IMAGE_FILE_MACHINE_UNKNOWN;
   bool Verbose = false;
+  bool ShowTimes = false;
   WindowsSubsystem Subsystem = llvm::COFF::IMAGE_SUBSYSTEM_UNKNOWN;
   Undefined *Entry = nullptr;
   bool NoEntry = false;
   std::string OutputFile;
   bool DoGC = true;
   bool DoICF = true;
+  bool DoStringDedup = false;
   bool Relocatable = true;
   bool Force = false;
   bool Debug = false;
+  bool DefCache = false;
   bool WriteSymtab = true;
 
+  // Used for /lldmap. If set, a symbol map is written there.
+  StringRef MapFile;
+
   // Symbols in this set are considered as live by the garbage collector.
   std::set<Undefined *> GCRoot;
 
@@ -106,6 +113,11 @@ struct Configuration {
   // Used for /merge:from=to (e.g. /merge:.rdata=.text)
   std::map<StringRef, StringRef> Merge;
 
+  // Used for /order. Contains negative priorities, so that symbols
+  // that are not in the map (priority 0) are laid out after all
+  // listed ones.
+  std::map<StringRef, int> Order;
+
   // Used for /section=.name,{DEKPRSW} to set section attributes.
   std::map<StringRef, uint32_t> Section;
 
@@ -141,6 +153,16 @@ struct Configuration {
   bool TerminalServerAware = true;
   bool LargeAddressAware = false;
   bool HighEntropyVA = false;
+
+  // Used for /release. If true, the writer computes and sets the PE
+  // header checksum.
+  bool Release = false;
+
+  // Used for /incremental. If true, the writer compares the new image
+  // against the existing output file and leaves the file untouched
+  // when the two are identical, so no-op relinks do not change its
+  // timestamp.
+  bool Incremental = false;
 };
 
 extern Configuration *Config;
@@ -20,6 +20,7 @@
 
 #include "Chunks.h"
 #include "DLL.h"
+#include "lld/Core/Parallel.h"
 #include "llvm/Object/COFF.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Path.h"
@@ -136,15 +137,21 @@ binImports(const std::vector<DefinedImportData *> &Imports) {
     M[Sym->getDLLName().lower()].push_back(Sym);
 
   std::vector<std::vector<DefinedImportData *>> V;
-  for (auto &P : M) {
-    // Sort symbols by name for each group.
-    std::vector<DefinedImportData *> &Syms = P.second;
-    std::sort(Syms.begin(), Syms.end(),
-              [](DefinedImportData *A, DefinedImportData *B) {
-                return A->getName() < B->getName();
-              });
-    V.push_back(std::move(Syms));
-  }
+  for (auto &P : M)
+    V.push_back(std::move(P.second));
+
+  // Sort symbols by name for each group. The groups are independent,
+  // so they can be sorted in parallel. Names are unique within a
+  // group, so the result does not depend on how ties would be broken.
+  parallel_for_each(V.begin(), V.end(),
+                    [](std::vector<DefinedImportData *> &Syms) {
+                      std::sort(Syms.begin(), Syms.end(),
+                                [](DefinedImportData *A,
+                                   DefinedImportData *B) {
+                                  return A->getName() < B->getName();
+                                });
+                    },
+                    1);
   return V;
 }
 
@@ -476,46 +483,73 @@ void DelayLoadContents::create(Defined *H) {
   Helper = H;
   std::vector<std::vector<DefinedImportData *>> V = binImports(Imports);
 
-  // Create .didat contents for each DLL.
-  for (std::vector<DefinedImportData *> &Syms : V) {
-    StringRef Name = Syms[0]->getDLLName();
-
-    // Create the delay import table header.
+  // Create the DLL name strings and pre-size the chunk arrays. Each
+  // DLL's tables then occupy a known disjoint slice, so the chunks
+  // for different DLLs can be generated in parallel below without
+  // any allocation or locking on the shared vectors.
+  std::vector<size_t> AddrBase(V.size()), HintBase(V.size());
+  size_t NumSyms = 0;
+  size_t NumHints = 0;
+  for (size_t I = 0, E = V.size(); I != E; ++I) {
+    StringRef Name = V[I][0]->getDLLName();
     if (!DLLNames.count(Name))
       DLLNames[Name] = make_unique<StringChunk>(Name);
-    auto Dir = make_unique<DelayDirectoryChunk>(DLLNames[Name].get());
-
-    size_t Base = Addresses.size();
-    for (DefinedImportData *S : Syms) {
-      Chunk *T = newThunkChunk(S, Dir.get());
-      auto A = make_unique<DelayAddressChunk>(T);
-      Addresses.push_back(std::move(A));
-      Thunks.push_back(std::unique_ptr<Chunk>(T));
-      StringRef ExtName = S->getExternalName();
-      if (ExtName.empty()) {
-        Names.push_back(make_unique<OrdinalOnlyChunk>(S->getOrdinal()));
-      } else {
-        auto C = make_unique<HintNameChunk>(ExtName, 0);
-        Names.push_back(make_unique<LookupChunk>(C.get()));
-        HintNames.push_back(std::move(C));
-      }
-    }
-    // Terminate with null values.
-    Addresses.push_back(make_unique<NullChunk>(8));
-    Names.push_back(make_unique<NullChunk>(8));
-
-    for (int I = 0, E = Syms.size(); I < E; ++I)
-      Syms[I]->setLocation(Addresses[Base + I].get());
-    auto *MH = new NullChunk(8);
-    MH->setAlign(8);
-    ModuleHandles.push_back(std::unique_ptr<Chunk>(MH));
-
-    // Fill the delay import table header fields.
-    Dir->ModuleHandle = MH;
-    Dir->AddressTab = Addresses[Base].get();
-    Dir->NameTab = Names[Base].get();
-    Dirs.push_back(std::move(Dir));
+    // Each DLL is followed by one null terminator chunk, hence + I.
+    AddrBase[I] = NumSyms + I;
+    HintBase[I] = NumHints;
+    NumSyms += V[I].size();
+    for (DefinedImportData *S : V[I])
+      if (!S->getExternalName().empty())
+        ++NumHints;
   }
+  Dirs.resize(V.size());
+  ModuleHandles.resize(V.size());
+  Addresses.resize(NumSyms + V.size());
+  Names.resize(NumSyms + V.size());
+  HintNames.resize(NumHints);
+  Thunks.resize(NumSyms);
+
+  // Create .didat contents for each DLL.
+  parallel_for_each(
+      V.begin(), V.end(), [&](std::vector<DefinedImportData *> &Syms) {
+        size_t I = &Syms - &V[0];
+        StringRef Name = Syms[0]->getDLLName();
+
+        // Create the delay import table header.
+        auto Dir =
+            make_unique<DelayDirectoryChunk>(DLLNames.find(Name)->second.get());
+
+        size_t Base = AddrBase[I];
+        size_t HintOff = HintBase[I];
+        for (size_t J = 0, E = Syms.size(); J != E; ++J) {
+          DefinedImportData *S = Syms[J];
+          Chunk *T = newThunkChunk(S, Dir.get());
+          Addresses[Base + J] = make_unique<DelayAddressChunk>(T);
+          Thunks[Base - I + J] = std::unique_ptr<Chunk>(T);
+          StringRef ExtName = S->getExternalName();
+          if (ExtName.empty()) {
+            Names[Base + J] = make_unique<OrdinalOnlyChunk>(S->getOrdinal());
+          } else {
+            auto C = make_unique<HintNameChunk>(ExtName, 0);
+            Names[Base + J] = make_unique<LookupChunk>(C.get());
+            HintNames[HintOff++] = std::move(C);
+          }
+          S->setLocation(Addresses[Base + J].get());
+        }
+        // Terminate with null values.
+        Addresses[Base + Syms.size()] = make_unique<NullChunk>(8);
+        Names[Base + Syms.size()] = make_unique<NullChunk>(8);
+
+        auto *MH = new NullChunk(8);
+        MH->setAlign(8);
+        ModuleHandles[I] = std::unique_ptr<Chunk>(MH);
+
+        // Fill the delay import table header fields.
+        Dir->ModuleHandle = MH;
+        Dir->AddressTab = Addresses[Base].get();
+        Dir->NameTab = Names[Base].get();
+        Dirs[I] = std::move(Dir);
+      });
   // Add null terminator.
   Dirs.push_back(
       make_unique<NullChunk>(sizeof(delay_import_directory_table_entry)));
@@ -13,7 +13,9 @@
 #include "InputFiles.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
+#include "Timer.h"
 #include "Writer.h"
+#include "lld/Core/PageAdvise.h"
 #include "lld/Driver/Driver.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/LibDriver/LibDriver.h"
@@ -26,7 +28,10 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <climits>
+#include <future>
 #include <memory>
+#include <mutex>
 
 using namespace llvm;
 using namespace llvm::COFF;
@@ -42,6 +47,12 @@ Configuration *Config;
 LinkerDriver *Driver;
 
 bool link(llvm::ArrayRef<const char *> Args) {
+  // This port keeps per-link state in globals, so only one link can be
+  // in flight in a process. Embedders may call this from several
+  // threads; serialize them here.
+  static std::mutex Mu;
+  std::lock_guard<std::mutex> Lock(Mu);
+
   Configuration C;
   LinkerDriver D;
   Config = &C;
@@ -66,6 +77,10 @@ MemoryBufferRef LinkerDriver::openFile(StringRef Path) {
   std::unique_ptr<MemoryBuffer> &MB = *MBOrErr;
   MemoryBufferRef MBRef = MB->getMemBufferRef();
   OwningMBs.push_back(std::move(MB)); // take ownership
+
+  // Every opened file is parsed promptly, so start readahead now
+  // instead of faulting pages in one at a time.
+  adviseBuffer(MBRef, PageAdvice::WillNeed);
   return MBRef;
 }
 
@@ -88,6 +103,13 @@ static bool isDecorated(StringRef Sym) {
 // Parses .drectve section contents and returns a list of files
 // specified by /defaultlib.
 void LinkerDriver::parseDirectives(StringRef S) {
+  // Applying a directive string is idempotent: /defaultlib dedups
+  // through VisitedFiles, duplicate /export options collapse in
+  // fixupExports, and the rest fill maps or sets. So a string we have
+  // already seen can be skipped without tokenizing it again.
+  if (!VisitedDirectives.insert(S).second)
+    return;
+
   llvm::opt::InputArgList Args = Parser.parse(S);
 
   for (auto *Arg : Args) {
@@ -242,6 +264,35 @@ WindowsSubsystem LinkerDriver::inferSubsystem() {
   return IMAGE_SUBSYSTEM_UNKNOWN;
 }
 
+// Parses a file given to /order. Such a file contains one symbol name
+// per line; everything after ';' is a comment. The listed functions
+// are laid out at the beginning of their output section in the order
+// in which they appear, so that hot startup code lands on contiguous
+// pages.
+void LinkerDriver::parseOrderFile(StringRef Arg) {
+  // For some reason, the MSVC linker requires the filename to be
+  // preceded by '@'.
+  if (!Arg.startswith("@"))
+    error("malformed /order option: '@' missing");
+  MemoryBufferRef MB = openFile(Arg.substr(1));
+
+  // Assign negative priorities in the order of appearance, so that
+  // symbols that are not listed (priority 0) sort after all listed
+  // ones while keeping their original relative order.
+  int Prio = INT_MIN;
+  SmallVector<StringRef, 0> Lines;
+  MB.getBuffer().split(Lines, '\n');
+  for (StringRef Line : Lines) {
+    StringRef Sym = Line.split(';').first.trim();
+    if (Sym.empty())
+      continue;
+    if (Config->Machine == I386 && !isDecorated(Sym))
+      Sym = Alloc.save("_" + Sym);
+    if (Config->Order.count(Sym) == 0)
+      Config->Order[Sym] = Prio++;
+  }
+}
+
 static uint64_t getDefaultImageBase() {
   if (Config->is64())
     return Config->DLL ? 0x180000000 : 0x140000000;
@@ -291,6 +342,10 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
   if (Args.hasArg(OPT_verbose))
     Config->Verbose = true;
 
+  // Handle /time
+  if (Args.hasArg(OPT_time))
+    Config->ShowTimes = true;
+
   // Handle /force or /force:unresolved
   if (Args.hasArg(OPT_force) || Args.hasArg(OPT_force_unresolved))
     Config->Force = true;
@@ -299,6 +354,10 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
   if (Args.hasArg(OPT_debug))
     Config->Debug = true;
 
+  // Handle /defcache
+  if (Args.hasArg(OPT_defcache))
+    Config->DefCache = true;
+
   // Handle /noentry
   if (Args.hasArg(OPT_noentry)) {
     if (!Args.hasArg(OPT_dll))
@@ -385,6 +444,10 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
         Config->DoICF = false;
         continue;
       }
+      if (S == "lldstrdedup") {
+        Config->DoStringDedup = true;
+        continue;
+      }
       if (StringRef(S).startswith("lldlto=")) {
         StringRef OptLevel = StringRef(S).substr(7);
         if (OptLevel.getAsInteger(10, Config->LTOOptLevel) ||
@@ -436,6 +499,12 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
     Config->ManifestInput.push_back(Arg->getValue());
 
   // Handle miscellaneous boolean flags.
+  if (Args.hasArg(OPT_incremental))
+    Config->Incremental = true;
+  if (Args.hasArg(OPT_incremental_no))
+    Config->Incremental = false;
+  if (Args.hasArg(OPT_release))
+    Config->Release = true;
   if (Args.hasArg(OPT_allowbind_no))
     Config->AllowBind = false;
   if (Args.hasArg(OPT_allowisolation_no))
@@ -462,15 +531,16 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
   for (StringRef Path : Paths)
     MBs.push_back(openFile(Path));
 
-  // Windows specific -- Create a resource file containing a manifest file.
-  if (Config->Manifest == Configuration::Embed) {
-    std::unique_ptr<MemoryBuffer> MB = createManifestRes();
-    MBs.push_back(MB->getMemBufferRef());
-    OwningMBs.push_back(std::move(MB)); // take ownership
-  }
+  // Windows specific -- Create a resource file containing a manifest
+  // file. Merging user manifests may shell out to mt.exe, so run this
+  // on a background task; the result is picked up below when resource
+  // files are converted, overlapping with symbol resolution.
+  std::future<std::unique_ptr<MemoryBuffer>> ManifestRes;
+  if (Config->Manifest == Configuration::Embed)
+    ManifestRes = std::async(std::launch::async, &createManifestRes);
 
   // Windows specific -- Input files can be Windows resource files (.res files).
-  // We invoke cvtres.exe to convert resource files to a regular COFF file
+  // We convert resource files to a regular COFF file in memory
   // then link the result file normally.
   std::vector<MemoryBufferRef> Resources;
   auto NotResource = [](MemoryBufferRef MB) {
@@ -484,9 +554,11 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
 
   // Read all input files given via the command line. Note that step()
   // doesn't read files that are specified by directive sections.
+  ScopedTimer ReadTimer("Input File Reading");
   for (MemoryBufferRef MB : MBs)
     Symtab.addFile(createFile(MB));
   Symtab.step();
+  ReadTimer.stop();
 
   // Determine machine type and check if all object files are
   // for the same CPU type. Note that this needs to be done before
@@ -508,7 +580,16 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
     Config->Machine = AMD64;
   }
 
+  // Handle /order. This needs to be done after the machine type is
+  // known because symbol names in an order file are undecorated.
+  if (auto *Arg = Args.getLastArg(OPT_order))
+    parseOrderFile(Arg->getValue());
+
   // Windows specific -- Convert Windows resource files to a COFF file.
+  if (ManifestRes.valid()) {
+    OwningMBs.push_back(ManifestRes.get()); // take ownership
+    Resources.push_back(OwningMBs.back()->getMemBufferRef());
+  }
   if (!Resources.empty()) {
     std::unique_ptr<MemoryBuffer> MB = convertResToCOFF(Resources);
     Symtab.addFile(createFile(MB->getMemBufferRef()));
@@ -586,7 +667,10 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
   Symtab.addAbsolute(mangle("__guard_fids_count"), 0);
   Symtab.addAbsolute(mangle("__guard_flags"), 0x100);
 
-  // Read as much files as we can from directives sections.
+  // Read as much files as we can from directives sections. Directive
+  // parsing and the lazy-object loads it triggers happen within this
+  // phase, so they are accounted to it.
+  ScopedTimer ResolveTimer("Symbol Resolution");
   Symtab.run();
 
   // Resolve auxiliary symbols until we get a convergence.
@@ -636,6 +720,7 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
 
   // Make sure we have resolved all symbols.
   Symtab.reportRemainingUndefines(/*Resolve=*/true);
+  ResolveTimer.stop();
 
   // Windows specific -- if no /subsystem is given, we need to infer
   // that from entry point name.
@@ -668,24 +753,36 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
     createPDB(Arg->getValue());
 
   // Identify unreferenced COMDAT sections.
-  if (Config->DoGC)
+  if (Config->DoGC) {
+    ScopedTimer T("MarkLive");
     markLive(Symtab.getChunks());
+  }
 
   // Identify identical COMDAT sections to merge them.
-  if (Config->DoICF)
+  if (Config->DoICF) {
+    ScopedTimer T("ICF");
     doICF(Symtab.getChunks());
+  }
+
+  // Merge identical read-only data chunks.
+  if (Config->DoStringDedup) {
+    ScopedTimer T("String Dedup");
+    dedupStrings(Symtab.getChunks());
+  }
+
+  // A symbol map file containing symbol VAs and their names is
+  // created by the writer, overlapped with the section writes.
+  if (auto *Arg = Args.getLastArg(OPT_lldmap))
+    Config->MapFile = Arg->getValue();
 
   // Write the result.
-  writeResult(&Symtab);
-
-  // Create a symbol map file containing symbol VAs and their names
-  // to help debugging.
-  if (auto *Arg = Args.getLastArg(OPT_lldmap)) {
-    std::error_code EC;
-    llvm::raw_fd_ostream Out(Arg->getValue(), EC, OpenFlags::F_Text);
-    error(EC, "Could not create the symbol map");
-    Symtab.printMap(Out);
+  {
+    ScopedTimer T("Output Writing");
+    writeResult(&Symtab);
   }
+
+  printTimes();
+
   // Call exit to avoid calling destructors.
   exit(0);
 }
@@ -15,6 +15,7 @@
 #include "lld/Core/LLVM.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Object/COFF.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
@@ -40,6 +41,9 @@ void markLive(const std::vector<Chunk *> &Chunks);
 // Implemented in ICF.cpp.
 void doICF(const std::vector<Chunk *> &Chunks);
 
+// Implemented in Chunks.cpp.
+void dedupStrings(const std::vector<Chunk *> &Chunks);
+
 class ArgParser {
 public:
   ArgParser() : Alloc(AllocAux) {}
@@ -91,9 +95,17 @@ private:
   std::vector<StringRef> SearchPaths;
   std::set<std::string> VisitedFiles;
 
+  // Directive strings that have already been applied. Objects from
+  // the same library tend to carry byte-identical .drectve contents,
+  // so this saves re-parsing the same string thousands of times.
+  llvm::StringSet<> VisitedDirectives;
+
   Undefined *addUndefined(StringRef Sym);
   StringRef mangle(StringRef Sym);
 
+  // Parses a symbol list file for /order.
+  void parseOrderFile(StringRef Arg);
+
   // Windows specific -- "main" is not the only main function in Windows.
   // You can choose one from these four -- {w,}{WinMain,main}.
   // There are four different entry point functions for them,
@@ -156,8 +168,8 @@ void assignExportOrdinals();
 // incompatible objects.
 void checkFailIfMismatch(StringRef Arg);
 
-// Convert Windows resource files (.res files) to a .obj file
-// using cvtres.exe.
+// Convert Windows resource files (.res files) to a COFF object file
+// in memory. Implemented in WindowsResource.cpp.
 std::unique_ptr<MemoryBuffer>
 convertResToCOFF(const std::vector<MemoryBufferRef> &MBs);
 
@@ -17,6 +17,7 @@
 #include "Driver.h"
 #include "Error.h"
 #include "Symbols.h"
+#include "lld/Core/Parallel.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Object/Archive.h"
@@ -26,6 +27,7 @@
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/Option.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/FileUtilities.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
@@ -35,6 +37,7 @@
 
 using namespace llvm::COFF;
 using namespace llvm;
+using namespace llvm::support::endian;
 using llvm::cl::ExpandResponseFiles;
 using llvm::cl::TokenizeWindowsCommandLine;
 using llvm::sys::Process;
@@ -261,36 +264,10 @@ void parseManifestUAC(StringRef Arg) {
   }
 }
 
-// Quote each line with "". Existing double-quote is converted
-// to two double-quotes.
-static void quoteAndPrint(raw_ostream &Out, StringRef S) {
-  while (!S.empty()) {
-    StringRef Line;
-    std::tie(Line, S) = S.split("\n");
-    if (Line.empty())
-      continue;
-    Out << '\"';
-    for (int I = 0, E = Line.size(); I != E; ++I) {
-      if (Line[I] == '\"') {
-        Out << "\"\"";
-      } else {
-        Out << Line[I];
-      }
-    }
-    Out << "\"\n";
-  }
-}
-
-// Create the default manifest file as a temporary file.
+// Create the default manifest XML as a string.
 static std::string createDefaultXml() {
-  // Create a temporary file.
-  SmallString<128> Path;
-  std::error_code EC = sys::fs::createTemporaryFile("tmp", "manifest", Path);
-  error(EC, "cannot create a temporary file");
-
-  // Open the temporary file for writing.
-  llvm::raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
-  error(EC, Twine("failed to open ") + Path);
+  std::string Ret;
+  llvm::raw_string_ostream OS(Ret);
 
   // Emit the XML. Note that we do *not* verify that the XML attributes are
   // syntactically correct. This is intentional for link.exe compatibility.
@@ -315,8 +292,8 @@ static std::string createDefaultXml() {
     }
   }
   OS << "</assembly>\n";
-  OS.close();
-  return StringRef(Path);
+  OS.flush();
+  return Ret;
 }
 
 static std::string readFile(StringRef Path) {
@@ -327,19 +304,27 @@ static std::string readFile(StringRef Path) {
 }
 
 static std::string createManifestXml() {
-  // Create the default manifest file.
-  std::string Path1 = createDefaultXml();
+  std::string Default = createDefaultXml();
   if (Config->ManifestInput.empty())
-    return readFile(Path1);
+    return Default;
 
   // If manifest files are supplied by the user using /MANIFESTINPUT
-  // option, we need to merge them with the default manifest.
-  SmallString<128> Path2;
-  std::error_code EC = sys::fs::createTemporaryFile("tmp", "manifest", Path2);
+  // option, we need to merge them with the default manifest. Merging
+  // XML is still mt.exe's job, so write the default manifest out for
+  // it; this is the only remaining reason to touch the disk here.
+  SmallString<128> Path1, Path2;
+  std::error_code EC = sys::fs::createTemporaryFile("tmp", "manifest", Path1);
+  error(EC, "cannot create a temporary file");
+  EC = sys::fs::createTemporaryFile("tmp", "manifest", Path2);
   error(EC, "cannot create a temporary file");
   FileRemover Remover1(Path1);
   FileRemover Remover2(Path2);
 
+  llvm::raw_fd_ostream OS(Path1, EC, sys::fs::F_Text);
+  error(EC, Twine("failed to open ") + Path1);
+  OS << Default;
+  OS.close();
+
   Executor E("mt.exe");
   E.add("/manifest");
   E.add(Path1);
@@ -353,43 +338,35 @@ static std::string createManifestXml() {
   return readFile(Path2);
 }
 
-// Create a resource file containing a manifest XML.
+// Create an in-memory resource file (.res format) containing a
+// manifest XML, the way rc.exe would.
 std::unique_ptr<MemoryBuffer> createManifestRes() {
-  // Create a temporary file for the resource script file.
-  SmallString<128> RCPath;
-  std::error_code EC = sys::fs::createTemporaryFile("tmp", "rc", RCPath);
-  error(EC, "cannot create a temporary file");
-  FileRemover RCRemover(RCPath);
-
-  // Open the temporary file for writing.
-  llvm::raw_fd_ostream Out(RCPath, EC, sys::fs::F_Text);
-  error(EC, Twine("failed to open ") + RCPath);
-
-  // Write resource script to the RC file.
-  Out << "#define LANG_ENGLISH 9\n"
-      << "#define SUBLANG_DEFAULT 1\n"
-      << "#define APP_MANIFEST " << Config->ManifestID << "\n"
-      << "#define RT_MANIFEST 24\n"
-      << "LANGUAGE LANG_ENGLISH, SUBLANG_DEFAULT\n"
-      << "APP_MANIFEST RT_MANIFEST {\n";
-  quoteAndPrint(Out, createManifestXml());
-  Out << "}\n";
-  Out.close();
-
-  // Create output resource file.
-  SmallString<128> ResPath;
-  EC = sys::fs::createTemporaryFile("tmp", "res", ResPath);
-  error(EC, "cannot create a temporary file");
-
-  Executor E("rc.exe");
-  E.add("/fo");
-  E.add(ResPath.str());
-  E.add("/nologo");
-  E.add(RCPath.str());
-  E.run();
-  ErrorOr<std::unique_ptr<MemoryBuffer>> Ret = MemoryBuffer::getFile(ResPath);
-  error(Ret, Twine("Could not open ") + ResPath);
-  return std::move(*Ret);
+  std::string Manifest = createManifestXml();
+
+  // A .res file is a sequence of 4-byte aligned resource entries,
+  // starting with an empty sentinel entry. Ours carries one real
+  // entry: an RT_MANIFEST resource with ordinal type and name.
+  std::vector<uint8_t> V(32 + 32 + alignTo(Manifest.size(), 4));
+  uint8_t *P = V.data();
+
+  // The sentinel: no data, a 32-byte header, type and name 0.
+  write32le(P + 4, 32);
+  write16le(P + 8, 0xffff);
+  write16le(P + 12, 0xffff);
+
+  uint8_t *E = P + 32;
+  write32le(E, Manifest.size());           // DataSize
+  write32le(E + 4, 32);                    // HeaderSize
+  write16le(E + 8, 0xffff);                // Type is an ordinal:
+  write16le(E + 10, 24);                   // RT_MANIFEST
+  write16le(E + 12, 0xffff);               // Name is an ordinal:
+  write16le(E + 14, Config->ManifestID);
+  write16le(E + 20, 0x0030);               // MemoryFlags: MOVEABLE | PURE
+  write16le(E + 22, 0x0409);               // LanguageId: en-US
+  memcpy(E + 32, Manifest.data(), Manifest.size());
+
+  return MemoryBuffer::getMemBufferCopy(
+      StringRef(reinterpret_cast<char *>(P), V.size()), "<manifest>");
 }
 
 void createSideBySideManifest() {
@@ -518,11 +495,12 @@ void fixupExports() {
   }
   Config->Exports = std::move(V);
 
-  // Sort by name.
-  std::sort(Config->Exports.begin(), Config->Exports.end(),
-            [](const Export &A, const Export &B) {
-              return A.ExportName < B.ExportName;
-            });
+  // Sort by name. We just uniquefied the exports by name, so the
+  // comparison never sees ties and a non-stable sort is fine.
+  parallel_sort(Config->Exports.begin(), Config->Exports.end(),
+                [](const Export &A, const Export &B) {
+                  return A.ExportName < B.ExportName;
+                });
 }
 
 void assignExportOrdinals() {
@@ -549,29 +527,6 @@ void checkFailIfMismatch(StringRef Arg) {
   Config->MustMatch[K] = V;
 }
 
-// Convert Windows resource files (.res files) to a .obj file
-// using cvtres.exe.
-std::unique_ptr<MemoryBuffer>
-convertResToCOFF(const std::vector<MemoryBufferRef> &MBs) {
-  // Create an output file path.
-  SmallString<128> Path;
-  if (llvm::sys::fs::createTemporaryFile("resource", "obj", Path))
-    error("Could not create temporary file");
-
-  // Execute cvtres.exe.
-  Executor E("cvtres.exe");
-  E.add("/machine:" + machineToStr(Config->Machine));
-  E.add("/readonly");
-  E.add("/nologo");
-  E.add("/out:" + Path);
-  for (MemoryBufferRef MB : MBs)
-    E.add(MB.getBufferIdentifier());
-  E.run();
-  ErrorOr<std::unique_ptr<MemoryBuffer>> Ret = MemoryBuffer::getFile(Path);
-  error(Ret, Twine("Could not open ") + Path);
-  return std::move(*Ret);
-}
-
 static std::string writeToTempFile(StringRef Contents) {
   SmallString<128> Path;
   int FD;
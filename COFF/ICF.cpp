@@ -69,8 +69,9 @@ private:
   static uint64_t getHash(SectionChunk *C);
   static bool equalsConstant(const SectionChunk *A, const SectionChunk *B);
   static bool equalsVariable(const SectionChunk *A, const SectionChunk *B);
-  bool forEachGroup(std::vector<SectionChunk *> &Chunks, Comparator Eq);
-  bool segregate(ChunkIterator Begin, ChunkIterator End, Comparator Eq);
+  void forEachGroup(std::vector<SectionChunk *> &Chunks, Comparator Eq,
+                    bool Parallel);
+  void segregate(ChunkIterator Begin, ChunkIterator End, Comparator Eq);
 
   std::atomic<uint64_t> NextID = { 1 };
 };
@@ -86,20 +87,20 @@ uint64_t ICF::getHash(SectionChunk *C) {
                       C->NumRelocs,
                       C->getAlign(),
                       uint32_t(C->Header->SizeOfRawData),
-                      C->Checksum);
+                      C->Checksum, C->ContentHash);
 }
 
+// Note that this comparator must not read other chunks' group IDs:
+// that is what lets the first segregation round run groups in
+// parallel. Distinctions that depend on the targets' groups (and the
+// groups of associative children) are made by equalsVariable in the
+// iterative rounds that follow.
 bool ICF::equalsConstant(const SectionChunk *A, const SectionChunk *B) {
   if (A->AssocChildren.size() != B->AssocChildren.size() ||
       A->NumRelocs != B->NumRelocs) {
     return false;
   }
 
-  // Compare associative sections.
-  for (size_t I = 0, E = A->AssocChildren.size(); I != E; ++I)
-    if (A->AssocChildren[I]->GroupID != B->AssocChildren[I]->GroupID)
-      return false;
-
   // Compare relocations.
   auto Eq = [&](const coff_relocation &R1, const coff_relocation &R2) {
     if (R1.Type != R2.Type ||
@@ -112,8 +113,7 @@ bool ICF::equalsConstant(const SectionChunk *A, const SectionChunk *B) {
       return true;
     if (auto *D1 = dyn_cast<DefinedRegular>(B1))
       if (auto *D2 = dyn_cast<DefinedRegular>(B2))
-        return D1->getValue() == D2->getValue() &&
-               D1->getChunk()->GroupID == D2->getChunk()->GroupID;
+        return D1->getValue() == D2->getValue();
     return false;
   };
   if (!std::equal(A->Relocs.begin(), A->Relocs.end(), B->Relocs.begin(), Eq))
@@ -125,6 +125,9 @@ bool ICF::equalsConstant(const SectionChunk *A, const SectionChunk *B) {
          A->getAlign() == B->getAlign() &&
          A->Header->SizeOfRawData == B->Header->SizeOfRawData &&
          A->Checksum == B->Checksum &&
+         // Unequal hashes prove the contents differ without touching
+         // the section data; equal hashes still need the real compare.
+         A->ContentHash == B->ContentHash &&
          A->getContents() == B->getContents();
 }
 
@@ -148,34 +151,39 @@ bool ICF::equalsVariable(const SectionChunk *A, const SectionChunk *B) {
   return std::equal(A->Relocs.begin(), A->Relocs.end(), B->Relocs.begin(), Eq);
 }
 
-bool ICF::segregate(ChunkIterator Begin, ChunkIterator End, Comparator Eq) {
-  bool R = false;
+void ICF::segregate(ChunkIterator Begin, ChunkIterator End, Comparator Eq) {
   for (auto It = Begin;;) {
     SectionChunk *Head = *It;
     auto Bound = std::partition(It + 1, End, [&](SectionChunk *SC) {
       return Eq(Head, SC);
     });
     if (Bound == End)
-      return R;
+      return;
     uint64_t ID = NextID++;
     std::for_each(It, Bound, [&](SectionChunk *SC) { SC->GroupID = ID; });
     It = Bound;
-    R = true;
   }
 }
 
-bool ICF::forEachGroup(std::vector<SectionChunk *> &Chunks, Comparator Eq) {
-  bool R = false;
+// Iterates over all groups and segregates each of them. Groups are
+// disjoint ranges of Chunks, so with Parallel set they are compared on
+// the thread pool. That is only safe for comparators that do not read
+// other chunks' group IDs; new IDs come from an atomic counter, so
+// their values stay unique either way.
+void ICF::forEachGroup(std::vector<SectionChunk *> &Chunks, Comparator Eq,
+                       bool Parallel) {
+  TaskGroup Tg;
   for (auto It = Chunks.begin(), End = Chunks.end(); It != End;) {
     SectionChunk *Head = *It;
     auto Bound = std::find_if(It + 1, End, [&](SectionChunk *SC) {
       return SC->GroupID != Head->GroupID;
     });
-    if (segregate(It, Bound, Eq))
-      R = true;
+    if (Parallel)
+      Tg.spawn([=] { segregate(It, Bound, Eq); });
+    else
+      segregate(It, Bound, Eq);
     It = Bound;
   }
-  return R;
 }
 
 // Merge identical COMDAT sections.
@@ -209,12 +217,20 @@ void ICF::run(const std::vector<Chunk *> &Vec) {
               return A->GroupID < B->GroupID;
             });
 
-  // Split groups until we get a convergence.
+  // Split groups until we get a convergence. equalsConstant does not
+  // look at group IDs of other chunks, so the initial groups can be
+  // segregated in parallel.
   int Cnt = 1;
-  forEachGroup(Chunks, equalsConstant);
+  forEachGroup(Chunks, equalsConstant, /*Parallel=*/true);
 
   for (;;) {
-    if (!forEachGroup(Chunks, equalsVariable))
+    uint64_t ID = NextID;
+    // equalsVariable reads group IDs of relocation targets and
+    // associative children, which later groups in the same round may
+    // be reassigning, so these rounds stay serial to keep the result
+    // deterministic.
+    forEachGroup(Chunks, equalsVariable, /*Parallel=*/false);
+    if (ID == NextID)
       break;
     ++Cnt;
   }
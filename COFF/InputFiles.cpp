@@ -164,16 +164,33 @@ void ObjectFile::initializeSymbols() {
   SparseSymbolBodies.resize(NumSymbols);
   llvm::SmallVector<std::pair<Undefined *, uint32_t>, 8> WeakAliases;
   int32_t LastSectionNumber = 0;
-  for (uint32_t I = 0; I < NumSymbols; ++I) {
-    // Get a COFFSymbolRef object.
-    auto SymOrErr = COFFObj->getSymbol(I);
-    error(SymOrErr, Twine("broken object file: ") + getName());
 
-    COFFSymbolRef Sym = *SymOrErr;
+  // Walk the raw table with one pointer stride per record instead of
+  // going through getSymbol(), which re-checks the bounds and re-derives
+  // the record address on every call -- and was called a second time
+  // per symbol just to locate the aux records, which immediately follow
+  // the symbol and have the same entry size.
+  size_t EntrySize = COFFObj->getSymbolTableEntrySize();
+  const uint8_t *SymTab = nullptr;
+  if (NumSymbols) {
+    auto FirstOrErr = COFFObj->getSymbol(0);
+    error(FirstOrErr, Twine("broken object file: ") + getName());
+    SymTab = reinterpret_cast<const uint8_t *>(FirstOrErr->getRawPtr());
+  }
+
+  for (uint32_t I = 0; I < NumSymbols; ++I) {
+    const uint8_t *Rec = SymTab + I * EntrySize;
+    COFFSymbolRef Sym =
+        EntrySize == sizeof(coff_symbol16)
+            ? COFFSymbolRef(reinterpret_cast<const coff_symbol16 *>(Rec))
+            : COFFSymbolRef(reinterpret_cast<const coff_symbol32 *>(Rec));
 
     const void *AuxP = nullptr;
-    if (Sym.getNumberOfAuxSymbols())
-      AuxP = COFFObj->getSymbol(I + 1)->getRawPtr();
+    if (Sym.getNumberOfAuxSymbols()) {
+      if (I + Sym.getNumberOfAuxSymbols() >= NumSymbols)
+        error(Twine("broken object file: ") + getName());
+      AuxP = Rec + EntrySize;
+    }
     bool IsFirst = (LastSectionNumber != Sym.getSectionNumber());
 
     SymbolBody *Body = nullptr;
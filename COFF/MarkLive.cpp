@@ -9,52 +9,76 @@
 
 #include "Chunks.h"
 #include "Symbols.h"
+#include "lld/Core/Parallel.h"
 #include "llvm/ADT/STLExtras.h"
 #include <vector>
 
 namespace lld {
 namespace coff {
 
+// The number of chunks one task visits before spilling the rest of
+// its worklist back to the thread pool. Small enough to keep all
+// threads fed on bushy graphs, large enough that a task amortizes
+// its scheduling cost.
+static const size_t BatchSize = 256;
+
+// Visits every chunk reachable from Worklist and marks it live.
+// SectionChunk::markLive is an atomic test-and-set, so when several
+// tasks reach a chunk at the same time exactly one of them enqueues
+// it, and every chunk is visited once. A task that accumulates more
+// work than one batch hands the surplus back to the pool, which is
+// how the traversal spreads over threads.
+static void visit(TaskGroup &TG, std::vector<SectionChunk *> Worklist) {
+  while (!Worklist.empty()) {
+    if (Worklist.size() > BatchSize) {
+      std::vector<SectionChunk *> Spill(Worklist.begin() + BatchSize,
+                                        Worklist.end());
+      Worklist.resize(BatchSize);
+      TG.spawn([&TG, Spill] { visit(TG, Spill); });
+    }
+
+    SectionChunk *SC = Worklist.back();
+    Worklist.pop_back();
+    assert(SC->isLive() && "We mark as live when pushing onto the worklist!");
+
+    auto Enqueue = [&](SectionChunk *C) {
+      if (C->markLive())
+        Worklist.push_back(C);
+    };
+
+    // Mark all symbols listed in the relocation table for this section.
+    for (SymbolBody *S : SC->symbols())
+      if (auto *D = dyn_cast<DefinedRegular>(S->repl()))
+        Enqueue(D->getChunk());
+
+    // Mark associative sections if any.
+    for (SectionChunk *C : SC->children())
+      Enqueue(C);
+  }
+}
+
 // Set live bit on for each reachable chunk. Unmarked (unreachable)
 // COMDAT chunks will be ignored by Writer, so they will be excluded
 // from the final output.
 void markLive(const std::vector<Chunk *> &Chunks) {
-  // We build up a worklist of sections which have been marked as live. We only
-  // push into the worklist when we discover an unmarked section, and we mark
-  // as we push, so sections never appear twice in the list.
-  SmallVector<SectionChunk *, 256> Worklist;
+  std::vector<SectionChunk *> Roots;
 
   // COMDAT section chunks are dead by default. Add non-COMDAT chunks.
   for (Chunk *C : Chunks)
     if (auto *SC = dyn_cast<SectionChunk>(C))
       if (SC->isLive())
-        Worklist.push_back(SC);
-
-  auto Enqueue = [&](SectionChunk *C) {
-    if (C->isLive())
-      return;
-    C->markLive();
-    Worklist.push_back(C);
-  };
+        Roots.push_back(SC);
 
   // Add GC root chunks.
   for (Undefined *U : Config->GCRoot)
     if (auto *D = dyn_cast<DefinedRegular>(U->repl()))
-      Enqueue(D->getChunk());
-
-  while (!Worklist.empty()) {
-    SectionChunk *SC = Worklist.pop_back_val();
-    assert(SC->isLive() && "We mark as live when pushing onto the worklist!");
+      if (D->getChunk()->markLive())
+        Roots.push_back(D->getChunk());
 
-    // Mark all symbols listed in the relocation table for this section.
-    for (SymbolBody *S : SC->symbols())
-      if (auto *D = dyn_cast<DefinedRegular>(S->repl()))
-        Enqueue(D->getChunk());
-
-    // Mark associative sections if any.
-    for (SectionChunk *C : SC->children())
-      Enqueue(C);
-  }
+  // Propagate liveness from the roots in parallel. The TaskGroup
+  // destructor waits for the traversal to finish.
+  TaskGroup TG;
+  visit(TG, std::move(Roots));
 }
 
 }
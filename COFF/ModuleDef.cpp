@@ -18,8 +18,11 @@
 
 #include "Config.h"
 #include "Error.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/raw_ostream.h"
 #include <system_error>
@@ -54,6 +57,16 @@ struct Token {
   StringRef Value;
 };
 
+// Bits recording which non-export directives a .def file contained, so
+// that replaying a parse cache only overwrites the Config fields the
+// file actually set.
+enum {
+  SeenHeapsize = 1,
+  SeenOutput = 2, // NAME or LIBRARY
+  SeenStacksize = 4,
+  SeenVersion = 8,
+};
+
 static bool isDecorated(StringRef Sym) {
   return Sym.startswith("_") || Sym.startswith("@") || Sym.startswith("?");
 }
@@ -121,6 +134,9 @@ public:
     } while (Tok.K != Eof);
   }
 
+  // Which directives this file contained, as Seen* bits.
+  unsigned Seen = 0;
+
 private:
   void read() {
     if (Stack.empty()) {
@@ -161,20 +177,25 @@ private:
       }
     case KwHeapsize:
       parseNumbers(&Config->HeapReserve, &Config->HeapCommit);
+      Seen |= SeenHeapsize;
       return;
     case KwLibrary:
       parseName(&Config->OutputFile, &Config->ImageBase);
       if (!StringRef(Config->OutputFile).endswith_lower(".dll"))
         Config->OutputFile += ".dll";
+      Seen |= SeenOutput;
       return;
     case KwStacksize:
       parseNumbers(&Config->StackReserve, &Config->StackCommit);
+      Seen |= SeenStacksize;
       return;
     case KwName:
       parseName(&Config->OutputFile, &Config->ImageBase);
+      Seen |= SeenOutput;
       return;
     case KwVersion:
       parseVersion(&Config->MajorImageVersion, &Config->MinorImageVersion);
+      Seen |= SeenVersion;
       return;
     default:
       error(Twine("unknown directive: ") + Tok.Value);
@@ -281,10 +302,166 @@ private:
   StringSaver *Alloc;
 };
 
+// A parse cache is a sidecar file next to the .def file, in the same
+// spirit as the ELF archive index cache. It records everything a parse
+// writes to Config: the export list and whichever scalar directives
+// the file contained. The cache is keyed by the .def file's size and
+// modification time; any validation failure silently falls back to
+// parsing.
+struct DefCacheEntry {
+  uint32_t NameOff;
+  uint32_t NameLen;
+  uint32_t ExtNameOff;
+  uint32_t ExtNameLen;
+  uint16_t Ordinal;
+  uint16_t Flags; // bit 0 Noname, bit 1 Data, bit 2 Private
+};
+
 } // anonymous namespace
 
+static std::string getDefCachePath(StringRef DefPath) {
+  return (DefPath + ".lldef").str();
+}
+
+// Magic plus twelve uint64_t fields; see readDefCache.
+static const size_t DefCacheHdrSize = 104;
+
+// Keeps a loaded cache alive: exported names handed to Config point
+// into its buffer.
+static std::unique_ptr<MemoryBuffer> DefCache;
+
+static bool readDefCache(MemoryBufferRef MB) {
+  auto CacheOrErr =
+      MemoryBuffer::getFile(getDefCachePath(MB.getBufferIdentifier()), -1,
+                            /*RequiresNullTerminator=*/false);
+  if (!CacheOrErr)
+    return false;
+  std::unique_ptr<MemoryBuffer> Cache = std::move(*CacheOrErr);
+  StringRef Data = Cache->getBuffer();
+
+  sys::fs::file_status Status;
+  if (sys::fs::status(MB.getBufferIdentifier(), Status))
+    return false;
+
+  if (Data.size() < DefCacheHdrSize || !Data.startswith("llddefix"))
+    return false;
+  auto *Hdr = reinterpret_cast<const uint64_t *>(Data.data() + 8);
+  if (Hdr[0] != Status.getSize() ||
+      Hdr[1] != Status.getLastModificationTime().toEpochTime())
+    return false;
+  uint64_t NumExports = Hdr[2];
+  uint64_t Seen = Hdr[3];
+  uint64_t OutputFileLen = Hdr[11];
+
+  uint64_t EntriesSize = NumExports * sizeof(DefCacheEntry);
+  if (Data.size() - DefCacheHdrSize < EntriesSize ||
+      Data.size() - DefCacheHdrSize - EntriesSize < OutputFileLen)
+    return false;
+  auto *Entries =
+      reinterpret_cast<const DefCacheEntry *>(Data.data() + DefCacheHdrSize);
+  StringRef OutputFile =
+      Data.substr(DefCacheHdrSize + EntriesSize, OutputFileLen);
+  StringRef Names = Data.substr(DefCacheHdrSize + EntriesSize + OutputFileLen);
+
+  // Validate all records before mutating Config so that a truncated
+  // cache does not leave a half-applied parse behind.
+  for (uint64_t I = 0; I != NumExports; ++I) {
+    const DefCacheEntry &E = Entries[I];
+    if (uint64_t(E.NameOff) + E.NameLen > Names.size() ||
+        uint64_t(E.ExtNameOff) + E.ExtNameLen > Names.size())
+      return false;
+  }
+
+  if (Seen & SeenHeapsize) {
+    Config->HeapReserve = Hdr[4];
+    Config->HeapCommit = Hdr[5];
+  }
+  if (Seen & SeenStacksize) {
+    Config->StackReserve = Hdr[6];
+    Config->StackCommit = Hdr[7];
+  }
+  if (Seen & SeenOutput) {
+    Config->OutputFile = OutputFile;
+    Config->ImageBase = Hdr[8];
+  }
+  if (Seen & SeenVersion) {
+    Config->MajorImageVersion = Hdr[9];
+    Config->MinorImageVersion = Hdr[10];
+  }
+
+  for (uint64_t I = 0; I != NumExports; ++I) {
+    const DefCacheEntry &E = Entries[I];
+    Export Exp;
+    Exp.Name = Names.substr(E.NameOff, E.NameLen);
+    if (E.ExtNameLen)
+      Exp.ExtName = Names.substr(E.ExtNameOff, E.ExtNameLen);
+    Exp.Ordinal = E.Ordinal;
+    Exp.Noname = E.Flags & 1;
+    Exp.Data = E.Flags & 2;
+    Exp.Private = E.Flags & 4;
+    Config->Exports.push_back(Exp);
+  }
+
+  DefCache = std::move(Cache);
+  return true;
+}
+
+static void writeDefCache(MemoryBufferRef MB, unsigned Seen,
+                          size_t FirstExport) {
+  sys::fs::file_status Status;
+  if (sys::fs::status(MB.getBufferIdentifier(), Status))
+    return;
+
+  std::error_code EC;
+  raw_fd_ostream OS(getDefCachePath(MB.getBufferIdentifier()), EC,
+                    sys::fs::F_None);
+  if (EC)
+    return; // An unwritable directory is not an error; just skip the cache.
+
+  ArrayRef<Export> Exports =
+      makeArrayRef(Config->Exports).slice(FirstExport);
+
+  OS << "llddefix";
+  uint64_t Hdr[12] = {Status.getSize(),
+                      Status.getLastModificationTime().toEpochTime(),
+                      Exports.size(),
+                      Seen,
+                      Config->HeapReserve,
+                      Config->HeapCommit,
+                      Config->StackReserve,
+                      Config->StackCommit,
+                      Config->ImageBase,
+                      Config->MajorImageVersion,
+                      Config->MinorImageVersion,
+                      Config->OutputFile.size()};
+  OS.write(reinterpret_cast<char *>(Hdr), sizeof(Hdr));
+
+  uint32_t NameOff = 0;
+  for (const Export &E : Exports) {
+    DefCacheEntry Ent = {};
+    Ent.NameOff = NameOff;
+    Ent.NameLen = E.Name.size();
+    NameOff += Ent.NameLen;
+    Ent.ExtNameOff = NameOff;
+    Ent.ExtNameLen = E.ExtName.size();
+    NameOff += Ent.ExtNameLen;
+    Ent.Ordinal = E.Ordinal;
+    Ent.Flags = (E.Noname ? 1 : 0) | (E.Data ? 2 : 0) | (E.Private ? 4 : 0);
+    OS.write(reinterpret_cast<char *>(&Ent), sizeof(Ent));
+  }
+  OS << Config->OutputFile;
+  for (const Export &E : Exports)
+    OS << E.Name << E.ExtName;
+}
+
 void parseModuleDefs(MemoryBufferRef MB, StringSaver *Alloc) {
-  Parser(MB.getBuffer(), Alloc).parse();
+  if (Config->DefCache && readDefCache(MB))
+    return;
+  size_t FirstExport = Config->Exports.size();
+  Parser P(MB.getBuffer(), Alloc);
+  P.parse();
+  if (Config->DefCache)
+    writeDefCache(MB, P.Seen, FirstExport);
 }
 
 } // namespace coff
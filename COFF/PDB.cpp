@@ -6,55 +6,260 @@
 // License. See LICENSE.TXT for details.
 //
 //===----------------------------------------------------------------------===//
+//
+// A PDB is an MSF (multi-stream file) archive containing a fixed set
+// of streams. An MSF file is essentially a file system in a file;
+// each stream is stored as a sequence of fixed-size pages which do
+// not have to be contiguous, and a stream directory maps stream
+// numbers to page lists.
+//
+// What we write here is a structurally valid PDB whose fixed streams
+// (PDB info, TPI, DBI and IPI) are present but carry no type or
+// symbol records yet. Debuggers accept such a file as "no debug
+// info". Merging CodeView records from .debug$T and .debug$S sections
+// into the TPI and DBI streams is future work.
+//
+//===----------------------------------------------------------------------===//
 
+#include "Config.h"
 #include "Driver.h"
 #include "Error.h"
 #include "Symbols.h"
+#include "lld/Core/Parallel.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/FileOutputBuffer.h"
 #include <memory>
+#include <vector>
 
 using namespace llvm;
 using namespace llvm::support;
 using namespace llvm::support::endian;
+using namespace lld;
+using namespace lld::coff;
 
 const int PageSize = 4096;
 const uint8_t Magic[32] = "Microsoft C/C++ MSF 7.00\r\n\032DS\0\0";
 
 namespace {
-struct PDBHeader {
+struct SuperBlock {
   uint8_t Magic[32];
   ulittle32_t PageSize;
   ulittle32_t FpmPage;
   ulittle32_t PageCount;
-  ulittle32_t RootSize;
+  ulittle32_t DirectorySize;
   ulittle32_t Reserved;
-  ulittle32_t RootPointer;
+  // Page number of the page containing the page numbers
+  // of the directory pages.
+  ulittle32_t DirectoryMapAddr;
+};
+
+struct InfoStreamHeader {
+  ulittle32_t Version;
+  ulittle32_t Signature;
+  ulittle32_t Age;
+  uint8_t GUID[16];
+};
+
+struct TpiStreamHeader {
+  ulittle32_t Version;
+  ulittle32_t HeaderSize;
+  ulittle32_t TypeIndexBegin;
+  ulittle32_t TypeIndexEnd;
+  ulittle32_t TypeRecordBytes;
+  ulittle16_t HashStreamIndex;
+  ulittle16_t HashAuxStreamIndex;
+  ulittle32_t HashKeySize;
+  ulittle32_t NumHashBuckets;
+  little32_t HashValueBufferOffset;
+  ulittle32_t HashValueBufferLength;
+  little32_t IndexOffsetBufferOffset;
+  ulittle32_t IndexOffsetBufferLength;
+  little32_t HashAdjBufferOffset;
+  ulittle32_t HashAdjBufferLength;
+};
+
+struct DbiStreamHeader {
+  little32_t VersionSignature;
+  ulittle32_t VersionHeader;
+  ulittle32_t Age;
+  ulittle16_t GlobalSymbolStreamIndex;
+  ulittle16_t BuildNumber;
+  ulittle16_t PublicSymbolStreamIndex;
+  ulittle16_t PdbDllVersion;
+  ulittle16_t SymRecordStreamIndex;
+  ulittle16_t PdbDllRbld;
+  little32_t ModInfoSize;
+  little32_t SectionContributionSize;
+  little32_t SectionMapSize;
+  little32_t SourceInfoSize;
+  little32_t TypeServerSize;
+  ulittle32_t MFCTypeServerIndex;
+  little32_t OptionalDbgHeaderSize;
+  little32_t ECSubstreamSize;
+  ulittle16_t Flags;
+  ulittle16_t Machine;
+  ulittle32_t Padding;
+};
+
+// Writes an MSF file. Streams are added first; write() then assigns
+// pages to each stream, writes the bookkeeping pages and copies the
+// stream contents into place. Streams are independent of each other
+// once the layout is fixed, so their pages are written in parallel.
+class MSFWriter {
+public:
+  void addStream(std::vector<uint8_t> Data) {
+    Streams.push_back(std::move(Data));
+  }
+
+  void write(StringRef Path);
+
+private:
+  size_t getNumPages(size_t Bytes) { return (Bytes + PageSize - 1) / PageSize; }
+  std::vector<uint8_t> createDirectory(uint32_t FirstStreamPage);
+
+  std::vector<std::vector<uint8_t>> Streams;
 };
 }
 
-void lld::coff::createPDB(StringRef Path) {
-  // Create a file.
-  size_t FileSize = PageSize * 3;
+// The stream directory is a stream itself, containing the number of
+// streams, each stream's size in bytes and each stream's page list.
+std::vector<uint8_t> MSFWriter::createDirectory(uint32_t FirstStreamPage) {
+  std::vector<uint8_t> Dir;
+  auto Add = [&](uint32_t V) {
+    Dir.resize(Dir.size() + 4);
+    write32le(&Dir[Dir.size() - 4], V);
+  };
+  Add(Streams.size());
+  for (std::vector<uint8_t> &S : Streams)
+    Add(S.size());
+  uint32_t Page = FirstStreamPage;
+  for (std::vector<uint8_t> &S : Streams)
+    for (size_t I = 0, E = getNumPages(S.size()); I != E; ++I)
+      Add(Page++);
+  return Dir;
+}
+
+void MSFWriter::write(StringRef Path) {
+  // Fixed layout: page 0 is the superblock, pages 1 and 2 are the
+  // free page map, page 3 is the directory map. The directory pages
+  // follow, then the stream pages in stream order.
+  size_t DirSize = 4 + 4 * Streams.size();
+  size_t NumStreamPages = 0;
+  for (std::vector<uint8_t> &S : Streams)
+    NumStreamPages += getNumPages(S.size());
+  DirSize += 4 * NumStreamPages;
+
+  size_t NumDirPages = getNumPages(DirSize);
+  uint32_t FirstDirPage = 4;
+  uint32_t FirstStreamPage = FirstDirPage + NumDirPages;
+  size_t PageCount = FirstStreamPage + NumStreamPages;
+
   ErrorOr<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
-      FileOutputBuffer::create(Path, FileSize);
+      FileOutputBuffer::create(Path, PageCount * PageSize);
   error(BufferOrErr, Twine("failed to open ") + Path);
   std::unique_ptr<FileOutputBuffer> Buffer = std::move(*BufferOrErr);
-
-  // Write the file header.
   uint8_t *Buf = Buffer->getBufferStart();
-  auto *Hdr = reinterpret_cast<PDBHeader *>(Buf);
-  memcpy(Hdr->Magic, Magic, sizeof(Magic));
-  Hdr->PageSize = PageSize;
-  // I don't know what FpmPage field means, but it must not be 0.
-  Hdr->FpmPage = 1;
-  Hdr->PageCount = FileSize / PageSize;
-  // Root directory is empty, containing only the length field.
-  Hdr->RootSize = 4;
-  // Root directory is on page 1.
-  Hdr->RootPointer = 1;
-
-  // Write the root directory. Root stream is on page 2.
-  write32le(Buf + PageSize, 2);
+
+  // Write the superblock.
+  auto *SB = reinterpret_cast<SuperBlock *>(Buf);
+  memcpy(SB->Magic, Magic, sizeof(Magic));
+  SB->PageSize = PageSize;
+  SB->FpmPage = 1;
+  SB->PageCount = PageCount;
+  SB->DirectorySize = DirSize;
+  SB->DirectoryMapAddr = 3;
+
+  // Write the free page map. A set bit means the page is free;
+  // everything we allocated is in use, the rest of the bit space
+  // covers pages beyond the end of the file.
+  uint8_t *Fpm = Buf + PageSize;
+  memset(Fpm, 0xff, PageSize * 2);
+  for (size_t I = 0; I != PageCount; ++I)
+    Fpm[I / 8] &= ~(1 << (I % 8));
+
+  // Write the directory map and the directory.
+  std::vector<uint8_t> Dir = createDirectory(FirstStreamPage);
+  for (size_t I = 0; I != NumDirPages; ++I)
+    write32le(Buf + PageSize * 3 + I * 4, FirstDirPage + I);
+  memcpy(Buf + PageSize * FirstDirPage, Dir.data(), Dir.size());
+
+  // Write the streams. Each stream owns a disjoint page range, so
+  // they can be copied in parallel.
+  std::vector<std::pair<uint8_t *, std::vector<uint8_t> *>> Work;
+  uint8_t *P = Buf + PageSize * FirstStreamPage;
+  for (std::vector<uint8_t> &S : Streams) {
+    Work.push_back({P, &S});
+    P += PageSize * getNumPages(S.size());
+  }
+  parallel_for_each(Work.begin(), Work.end(),
+                    [](std::pair<uint8_t *, std::vector<uint8_t> *> &W) {
+                      memcpy(W.first, W.second->data(), W.second->size());
+                    },
+                    1);
+
   Buffer->commit();
 }
+
+template <class T> static std::vector<uint8_t> toBytes(const T &Hdr) {
+  std::vector<uint8_t> V(sizeof(T));
+  memcpy(V.data(), &Hdr, sizeof(T));
+  return V;
+}
+
+// The PDB info stream identifies the PDB and maps named streams to
+// stream numbers. We use a fixed signature and a zero GUID so that
+// the output is reproducible; we don't support incremental linking,
+// which is what the fields exist for.
+static std::vector<uint8_t> createInfoStream() {
+  InfoStreamHeader Hdr = {};
+  Hdr.Version = 20000404; // VC70
+  Hdr.Signature = 0;
+  Hdr.Age = 1;
+  std::vector<uint8_t> V = toBytes(Hdr);
+  // An empty named stream map: no string data, and a serialized hash
+  // table with zero size, zero capacity and empty bit vectors.
+  V.resize(V.size() + 24);
+  return V;
+}
+
+// The TPI stream holds the merged type records. The IPI stream has
+// the same layout. Both are empty for now.
+static std::vector<uint8_t> createTpiStream() {
+  TpiStreamHeader Hdr = {};
+  Hdr.Version = 20040203; // V80
+  Hdr.HeaderSize = sizeof(TpiStreamHeader);
+  // Type indices below 0x1000 denote built-in types.
+  Hdr.TypeIndexBegin = 0x1000;
+  Hdr.TypeIndexEnd = 0x1000;
+  Hdr.HashStreamIndex = 0xffff;
+  Hdr.HashAuxStreamIndex = 0xffff;
+  Hdr.HashKeySize = 4;
+  return toBytes(Hdr);
+}
+
+// The DBI stream describes modules, section contributions and the
+// symbol record streams. We emit just the header.
+static std::vector<uint8_t> createDbiStream() {
+  DbiStreamHeader Hdr = {};
+  Hdr.VersionSignature = -1;
+  Hdr.VersionHeader = 19990903; // V70
+  Hdr.Age = 1;
+  Hdr.GlobalSymbolStreamIndex = 0xffff;
+  Hdr.BuildNumber = 0x8000; // The high bit means the new format.
+  Hdr.PublicSymbolStreamIndex = 0xffff;
+  Hdr.SymRecordStreamIndex = 0xffff;
+  Hdr.Machine = Config->Machine;
+  return toBytes(Hdr);
+}
+
+void lld::coff::createPDB(StringRef Path) {
+  MSFWriter Msf;
+  // Stream 0 holds the previous directory for incremental updates,
+  // which we don't do, but the slot is fixed.
+  Msf.addStream({});
+  Msf.addStream(createInfoStream()); // Stream 1
+  Msf.addStream(createTpiStream());  // Stream 2
+  Msf.addStream(createDbiStream());  // Stream 3
+  Msf.addStream(createTpiStream());  // Stream 4 (IPI)
+  Msf.write(Path);
+}
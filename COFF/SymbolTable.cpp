@@ -13,6 +13,7 @@
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "lld/Core/Parallel.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/Support/Debug.h"
@@ -35,11 +36,31 @@ void SymbolTable::addFile(std::unique_ptr<InputFile> FileP) {
   Files.push_back(std::move(FileP));
   if (auto *F = dyn_cast<ArchiveFile>(File)) {
     ArchiveQueue.push_back(
-        std::async(Policy, [=]() { F->parse(); return F; }));
+        std::async(Policy, [=]() {
+          F->parse();
+          // Insert the lazy symbols right away, so table population
+          // overlaps the parsing of other archives. Which body
+          // survives a conflict is decided by readArchives on the
+          // main thread; big .libs carry tens of thousands of
+          // symbols, and hashing them here takes the work off the
+          // serial path.
+          for (Lazy &Sym : F->getLazySymbols())
+            insert(&Sym);
+          return F;
+        }));
     return;
   }
   ObjectQueue.push_back(
-      std::async(Policy, [=]() { File->parse(); return File; }));
+      std::async(Policy, [=]() {
+        File->parse();
+        // Insert the external symbols into the sharded table right
+        // away, so table population overlaps the parsing of other
+        // files. The actual resolution is left to readObjects.
+        for (SymbolBody *Sym : File->getSymbols())
+          if (Sym->isExternal())
+            insert(Sym);
+        return File;
+      }));
   if (auto *F = dyn_cast<ObjectFile>(File)) {
     ObjectFiles.push_back(F);
   } else if (auto *F = dyn_cast<BitcodeFile>(File)) {
@@ -120,38 +141,39 @@ bool SymbolTable::queueEmpty() {
 
 void SymbolTable::reportRemainingUndefines(bool Resolve) {
   llvm::SmallPtrSet<SymbolBody *, 8> Undefs;
-  for (auto &I : Symtab) {
-    Symbol *Sym = I.second;
-    auto *Undef = dyn_cast<Undefined>(Sym->Body);
-    if (!Undef)
-      continue;
-    StringRef Name = Undef->getName();
-    // A weak alias may have been resolved, so check for that.
-    if (Defined *D = Undef->getWeakAlias()) {
-      if (Resolve)
-        Sym->Body = D;
-      continue;
-    }
-    // If we can resolve a symbol by removing __imp_ prefix, do that.
-    // This odd rule is for compatibility with MSVC linker.
-    if (Name.startswith("__imp_")) {
-      Symbol *Imp = find(Name.substr(strlen("__imp_")));
-      if (Imp && isa<Defined>(Imp->Body)) {
-        if (!Resolve)
-          continue;
-        auto *D = cast<Defined>(Imp->Body);
-        auto *S = new (Alloc) DefinedLocalImport(Name, D);
-        LocalImportChunks.push_back(S->getChunk());
-        Sym->Body = S;
+  for (Shard &Sh : Shards)
+    for (auto &I : Sh.Map) {
+      Symbol *Sym = I.second;
+      auto *Undef = dyn_cast<Undefined>(Sym->Body);
+      if (!Undef)
+        continue;
+      StringRef Name = Undef->getName();
+      // A weak alias may have been resolved, so check for that.
+      if (Defined *D = Undef->getWeakAlias()) {
+        if (Resolve)
+          Sym->Body = D;
         continue;
       }
+      // If we can resolve a symbol by removing __imp_ prefix, do that.
+      // This odd rule is for compatibility with MSVC linker.
+      if (Name.startswith("__imp_")) {
+        Symbol *Imp = find(Name.substr(strlen("__imp_")));
+        if (Imp && isa<Defined>(Imp->Body)) {
+          if (!Resolve)
+            continue;
+          auto *D = cast<Defined>(Imp->Body);
+          auto *S = new (Alloc) DefinedLocalImport(Name, D);
+          LocalImportChunks.push_back(S->getChunk());
+          Sym->Body = S;
+          continue;
+        }
+      }
+      // Remaining undefined symbols are not fatal if /force is specified.
+      // They are replaced with dummy defined symbols.
+      if (Config->Force && Resolve)
+        Sym->Body = new (Alloc) DefinedAbsolute(Name, 0);
+      Undefs.insert(Sym->Body);
     }
-    // Remaining undefined symbols are not fatal if /force is specified.
-    // They are replaced with dummy defined symbols.
-    if (Config->Force && Resolve)
-      Sym->Body = new (Alloc) DefinedAbsolute(Name, 0);
-    Undefs.insert(Sym->Body);
-  }
   if (Undefs.empty())
     return;
   for (Undefined *U : Config->GCRoot)
@@ -168,7 +190,11 @@ void SymbolTable::reportRemainingUndefines(bool Resolve) {
 }
 
 void SymbolTable::addLazy(Lazy *New, std::vector<Symbol *> *Accum) {
-  Symbol *Sym = insert(New);
+  // The parse task already inserted New, so the backref is set and
+  // the table lookup can be skipped.
+  Symbol *Sym = New->symbol();
+  if (!Sym)
+    Sym = insert(New);
   if (Sym->Body == New)
     return;
   SymbolBody *Existing = Sym->Body;
@@ -184,9 +210,13 @@ void SymbolTable::addLazy(Lazy *New, std::vector<Symbol *> *Accum) {
 }
 
 void SymbolTable::addSymbol(SymbolBody *New) {
-  // Find an existing symbol or create and insert a new one.
+  // Find an existing symbol or create and insert a new one. Symbols
+  // coming from object files were already inserted by the parse task,
+  // so their backrefs are set and the table lookup can be skipped.
   assert(isa<Defined>(New) || isa<Undefined>(New));
-  Symbol *Sym = insert(New);
+  Symbol *Sym = New->symbol();
+  if (!Sym)
+    Sym = insert(New);
   if (Sym->Body == New)
     return;
   SymbolBody *Existing = Sym->Body;
@@ -217,14 +247,23 @@ void SymbolTable::addSymbol(SymbolBody *New) {
     Sym->Body = New;
 }
 
+// Maps a symbol name to the shard responsible for it. All accesses
+// for one name serialize on the same shard lock.
+SymbolTable::Shard &SymbolTable::getShard(StringRef Name) {
+  return Shards[llvm::HashString(Name) % NumShards];
+}
+
 Symbol *SymbolTable::insert(SymbolBody *New) {
-  Symbol *&Sym = Symtab[New->getName()];
+  Shard &Sh = getShard(New->getName());
+  std::lock_guard<std::mutex> Lock(Sh.Mutex);
+  Symbol *&Sym = Sh.Map[New->getName()];
   if (Sym) {
     New->setBackref(Sym);
     return Sym;
   }
-  Sym = new (Alloc) Symbol(New);
+  Sym = new (Sh.Alloc) Symbol(New);
   New->setBackref(Sym);
+  indexDecoratedName(New->getName());
   return Sym;
 }
 
@@ -252,8 +291,10 @@ std::vector<Chunk *> SymbolTable::getChunks() {
 }
 
 Symbol *SymbolTable::find(StringRef Name) {
-  auto It = Symtab.find(Name);
-  if (It == Symtab.end())
+  Shard &Sh = getShard(Name);
+  std::lock_guard<std::mutex> Lock(Sh.Mutex);
+  auto It = Sh.Map.find(Name);
+  if (It == Sh.Map.end())
     return nullptr;
   return It->second;
 }
@@ -264,13 +305,38 @@ Symbol *SymbolTable::findUnderscore(StringRef Name) {
   return find(Name);
 }
 
-StringRef SymbolTable::findByPrefix(StringRef Prefix) {
-  for (auto Pair : Symtab) {
-    StringRef Name = Pair.first;
-    if (Name.startswith(Prefix))
-      return Name;
+// findMangle maps an undecorated C name to a decorated stdcall,
+// fastcall or C++ function name by prefix. Instead of sweeping the
+// whole table for each query, we keep a side map from the prefix such
+// a query would use to the matching symbol name, and fill it in as
+// symbols are created. The prefix a name answers to is a pure function
+// of the name: "_foo@<n>" answers "_foo@" and "?foo@@Y<type>" answers
+// "?foo@@Y", both cut at the name's first '@'.
+void SymbolTable::indexDecoratedName(StringRef Name) {
+  size_t Pos = Name.find('@', 1);
+  if (Pos == StringRef::npos)
+    return;
+  StringRef Key;
+  if (Name.startswith("?")) {
+    if (!Name.substr(Pos).startswith("@@Y"))
+      return;
+    Key = Name.take_front(Pos + 3);
+  } else if (Name.startswith("_")) {
+    Key = Name.take_front(Pos + 1);
+  } else {
+    return;
   }
-  return "";
+  // Pick the smallest of the names answering to the same prefix so
+  // that the result does not depend on insertion order.
+  std::lock_guard<std::mutex> Lock(DecoratedMutex);
+  StringRef &Existing = DecoratedNames[Key];
+  if (Existing.empty() || Name < Existing)
+    Existing = Name;
+}
+
+StringRef SymbolTable::findDecorated(StringRef Prefix) {
+  std::lock_guard<std::mutex> Lock(DecoratedMutex);
+  return DecoratedNames.lookup(Prefix);
 }
 
 StringRef SymbolTable::findMangle(StringRef Name) {
@@ -278,15 +344,15 @@ StringRef SymbolTable::findMangle(StringRef Name) {
     if (!isa<Undefined>(Sym->Body))
       return Name;
   if (Config->Machine != I386)
-    return findByPrefix(("?" + Name + "@@Y").str());
+    return findDecorated(("?" + Name + "@@Y").str());
   if (!Name.startswith("_"))
     return "";
   // Search for x86 C function.
-  StringRef S = findByPrefix((Name + "@").str());
+  StringRef S = findDecorated((Name + "@").str());
   if (!S.empty())
     return S;
   // Search for x86 C++ non-member function.
-  return findByPrefix(("?" + Name.substr(1) + "@@Y").str());
+  return findDecorated(("?" + Name.substr(1) + "@@Y").str());
 }
 
 void SymbolTable::mangleMaybe(Undefined *U) {
@@ -437,10 +503,14 @@ std::vector<ObjectFile *> SymbolTable::createLTOObjects(LTOCodeGenerator *CG) {
     auto *ObjFile = new ObjectFile(MemoryBufferRef(Obj, "<LTO object>"));
     Files.emplace_back(ObjFile);
     ObjectFiles.push_back(ObjFile);
-    ObjFile->parse();
     ObjFiles.push_back(ObjFile);
   }
 
+  // With /opt:lldltojobs=N codegen produces N partition objects;
+  // parse them in parallel before resolving them serially.
+  parallel_for_each(ObjFiles.begin(), ObjFiles.end(),
+                    [](ObjectFile *File) { File->parse(); }, 1);
+
   return ObjFiles;
 }
 
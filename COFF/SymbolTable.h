@@ -22,6 +22,7 @@
 #endif
 
 #include <future>
+#include <mutex>
 
 namespace llvm {
 struct LTOCodeGenerator;
@@ -102,13 +103,32 @@ private:
   void addSymbol(SymbolBody *New);
   void addLazy(Lazy *New, std::vector<Symbol *> *Accum);
   Symbol *insert(SymbolBody *New);
-  StringRef findByPrefix(StringRef Prefix);
+  void indexDecoratedName(StringRef Name);
+  StringRef findDecorated(StringRef Prefix);
 
   void addMemberFile(Lazy *Body);
   void addCombinedLTOObject(ObjectFile *Obj);
   std::vector<ObjectFile *> createLTOObjects(llvm::LTOCodeGenerator *CG);
 
-  llvm::DenseMap<StringRef, Symbol *> Symtab;
+  // The symbol table is sharded by symbol name hash so that parse
+  // tasks can insert their symbols while other files are still being
+  // parsed. Each shard owns the allocator its Symbols come from, so
+  // insertion takes no lock but the shard's own. Resolution stays on
+  // the driver thread; compare() is antisymmetric, so the surviving
+  // body does not depend on the order the bodies were inserted in.
+  struct Shard {
+    llvm::DenseMap<StringRef, Symbol *> Map;
+    llvm::BumpPtrAllocator Alloc;
+    std::mutex Mutex;
+  };
+  enum { NumShards = 16 };
+  Shard Shards[NumShards];
+  Shard &getShard(StringRef Name);
+
+  // Maps the prefix a findMangle query would search for to the symbol
+  // name answering it. See indexDecoratedName.
+  llvm::DenseMap<StringRef, StringRef> DecoratedNames;
+  std::mutex DecoratedMutex;
 
   std::vector<std::unique_ptr<InputFile>> Files;
   std::vector<std::future<ArchiveFile *>> ArchiveQueue;
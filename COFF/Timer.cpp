@@ -0,0 +1,65 @@
+//===- Timer.cpp ----------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Timer.h"
+#include "Config.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace lld {
+namespace coff {
+
+namespace {
+struct Phase {
+  const char *Name;
+  unsigned Depth;
+  uint64_t DurUs;
+};
+}
+
+// Phases in the order their timers were started. Timers run on the
+// main thread only, so plain statics suffice.
+static std::vector<Phase> Phases;
+static unsigned Depth = 0;
+
+ScopedTimer::ScopedTimer(const char *Name)
+    : Index(size_t(-1)), Task(getDefaultDomain(), StringHandle(Name)) {
+  if (!Config->ShowTimes)
+    return;
+  Index = Phases.size();
+  Phases.push_back({Name, Depth++, 0});
+  Start = std::chrono::steady_clock::now();
+}
+
+void ScopedTimer::stop() {
+  Task.end();
+  if (Index == size_t(-1))
+    return;
+  Phases[Index].DurUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - Start)
+          .count();
+  --Depth;
+  Index = size_t(-1);
+}
+
+void printTimes() {
+  if (!Config->ShowTimes)
+    return;
+  for (Phase &P : Phases) {
+    outs() << format("%9.3f ms  ", P.DurUs / 1000.0);
+    outs().indent(P.Depth * 2) << P.Name << "\n";
+  }
+}
+
+} // namespace coff
+} // namespace lld
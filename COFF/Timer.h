@@ -0,0 +1,51 @@
+//===- Timer.h --------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// /time support. A ScopedTimer measures one linker phase; timers nest,
+// and printTimes writes an indented per-phase summary to stdout at the
+// end of the link, like link.exe /time. Every scope is also reported
+// to the lld instrumentation backend, so running with the LLD_TRACE
+// environment variable set produces chrome://tracing JSON with the
+// same phase names for build telemetry.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_COFF_TIMER_H
+#define LLD_COFF_TIMER_H
+
+#include "lld/Core/Instrumentation.h"
+#include <chrono>
+#include <cstddef>
+
+namespace lld {
+namespace coff {
+
+// Records the duration of a scope as a phase. Name must outlive the
+// link; in practice it is a string literal.
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const char *Name);
+  ~ScopedTimer() { stop(); }
+
+  // Prematurely end this phase.
+  void stop();
+
+private:
+  size_t Index;
+  std::chrono::steady_clock::time_point Start;
+  ScopedTask Task;
+};
+
+// Prints the recorded phase times to stdout. A no-op without /time.
+void printTimes();
+
+} // namespace coff
+} // namespace lld
+
+#endif
@@ -0,0 +1,399 @@
+//===- WindowsResource.cpp ------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file converts Windows resource files (.res files) to a COFF
+// object file in memory, which is what cvtres.exe does as a separate
+// process. A .res file is a flat list of resource entries; the PE
+// format wants them organized as a three-level directory tree (type,
+// name, language) in a .rsrc section. We parse the entries, build the
+// tree and emit an object with two sections: .rsrc$01 holds the
+// directory tables and .rsrc$02 the resource data. Each leaf's
+// data-entry record carries a relocation against a symbol in
+// .rsrc$02, so the data gets its final RVA when the object is linked
+// like any other input file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Config.h"
+#include "Driver.h"
+#include "Error.h"
+#include "llvm/Object/COFF.h"
+#include "llvm/Support/COFF.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MathExtras.h"
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::COFF;
+using namespace llvm::support::endian;
+
+namespace lld {
+namespace coff {
+namespace {
+
+// Uppercases a UTF-16 code unit the way resource names are compared.
+// Only ASCII needs folding; everything else compares by value.
+uint16_t foldCase(uint16_t C) {
+  return ('a' <= C && C <= 'z') ? C - 'a' + 'A' : C;
+}
+
+// A resource type or name: either a numeric ID or a UTF-16 string.
+struct ResName {
+  uint16_t ID = 0;
+  std::vector<uint16_t> Str;
+
+  bool isID() const { return Str.empty(); }
+
+  // Directories list named entries before ID entries; names compare
+  // case-insensitively.
+  bool operator<(const ResName &O) const {
+    if (isID() != O.isID())
+      return !isID();
+    if (isID())
+      return ID < O.ID;
+    size_t Len = std::min(Str.size(), O.Str.size());
+    for (size_t I = 0; I != Len; ++I)
+      if (foldCase(Str[I]) != foldCase(O.Str[I]))
+        return foldCase(Str[I]) < foldCase(O.Str[I]);
+    return Str.size() < O.Str.size();
+  }
+};
+
+typedef std::map<uint16_t, ArrayRef<uint8_t>> LangMap;
+typedef std::map<ResName, LangMap> NameMap;
+typedef std::map<ResName, NameMap> TypeMap;
+
+// Parses the entries of one .res file into a type/name/language tree.
+class ResParser {
+public:
+  explicit ResParser(MemoryBufferRef MB)
+      : Name(MB.getBufferIdentifier()),
+        Data(reinterpret_cast<const uint8_t *>(MB.getBufferStart()),
+             MB.getBufferSize()) {}
+
+  void parseInto(TypeMap &Map);
+
+private:
+  void require(size_t N) {
+    if (Data.size() - Pos < N)
+      error(Twine("broken resource file: ") + Name);
+  }
+
+  uint16_t read16() {
+    require(2);
+    uint16_t V = read16le(Data.data() + Pos);
+    Pos += 2;
+    return V;
+  }
+
+  uint32_t read32() {
+    require(4);
+    uint32_t V = read32le(Data.data() + Pos);
+    Pos += 4;
+    return V;
+  }
+
+  ResName readName();
+
+  StringRef Name;
+  ArrayRef<uint8_t> Data;
+  size_t Pos = 0;
+};
+
+ResName ResParser::readName() {
+  ResName R;
+  uint16_t First = read16();
+  if (First == 0xffff) {
+    R.ID = read16();
+    return R;
+  }
+  while (First) {
+    R.Str.push_back(First);
+    First = read16();
+  }
+  return R;
+}
+
+void ResParser::parseInto(TypeMap &Map) {
+  while (Pos < Data.size()) {
+    size_t Start = Pos;
+    uint32_t DataSize = read32();
+    uint32_t HeaderSize = read32();
+    ResName Type = readName();
+    ResName Name = readName();
+    Pos = alignTo(Pos, 4);
+    read32(); // DataVersion
+    read16(); // MemoryFlags
+    uint16_t Lang = read16();
+    read32(); // Version
+    read32(); // Characteristics
+
+    // The header size field is authoritative for where the data starts.
+    if (HeaderSize < Pos - Start || Start + HeaderSize > Data.size())
+      error(Twine("broken resource file: ") + this->Name);
+    Pos = Start + HeaderSize;
+    require(DataSize);
+    ArrayRef<uint8_t> D = Data.slice(Pos, DataSize);
+    Pos = alignTo(Pos + DataSize, 4);
+
+    // Each file starts with an empty sentinel entry; skip it.
+    if (DataSize == 0 && Type.isID() && Type.ID == 0)
+      continue;
+    if (!Map[Type][Name].insert(std::make_pair(Lang, D)).second)
+      error(Twine("duplicate resource: ") + this->Name);
+  }
+}
+
+// Emits the resource tree as a COFF object file.
+class ObjectWriter {
+public:
+  explicit ObjectWriter(const TypeMap &Map) : Map(Map) {}
+  std::unique_ptr<MemoryBuffer> write();
+
+private:
+  void layout();
+  void writeDirectories();
+  void writeDirectory(size_t Off, const std::vector<const ResName *> &Names,
+                      const std::vector<uint32_t> &Offsets, bool Subdir);
+  uint16_t getRelocType();
+
+  const TypeMap &Map;
+
+  // Offsets within .rsrc$01, assigned by layout().
+  std::vector<uint32_t> TypeDirOff;
+  std::vector<uint32_t> NameDirOff;
+  uint32_t DataEntryOff;
+  std::map<const ResName *, uint32_t> StrOff;
+
+  // Offset of each leaf's data within .rsrc$02, in tree order.
+  std::vector<uint32_t> DataOff;
+  uint32_t DataSize;
+
+  std::vector<uint8_t> Dir; // .rsrc$01 contents
+};
+
+void ObjectWriter::layout() {
+  // Directory tables come first: the root, then one directory per
+  // type, then one per (type, name). Data-entry records and name
+  // strings follow.
+  uint32_t Off = 16 + 8 * Map.size();
+  size_t NumLeaves = 0;
+  for (auto &T : Map) {
+    TypeDirOff.push_back(Off);
+    Off += 16 + 8 * T.second.size();
+  }
+  for (auto &T : Map)
+    for (auto &N : T.second) {
+      NameDirOff.push_back(Off);
+      Off += 16 + 8 * N.second.size();
+      NumLeaves += N.second.size();
+    }
+  DataEntryOff = Off;
+  Off += 16 * NumLeaves;
+  for (auto &T : Map) {
+    if (!T.first.isID()) {
+      StrOff[&T.first] = Off;
+      Off += 2 + 2 * T.first.Str.size();
+    }
+    for (auto &N : T.second)
+      if (!N.first.isID()) {
+        StrOff[&N.first] = Off;
+        Off += 2 + 2 * N.first.Str.size();
+      }
+  }
+  Dir.resize(alignTo(Off, 4));
+
+  uint32_t DOff = 0;
+  for (auto &T : Map)
+    for (auto &N : T.second)
+      for (auto &L : N.second) {
+        DOff = alignTo(DOff, 8);
+        DataOff.push_back(DOff);
+        DOff += L.second.size();
+      }
+  DataSize = DOff;
+}
+
+// Writes one IMAGE_RESOURCE_DIRECTORY and its entries.
+void ObjectWriter::writeDirectory(size_t Off,
+                                  const std::vector<const ResName *> &Names,
+                                  const std::vector<uint32_t> &Offsets,
+                                  bool Subdir) {
+  size_t NumNamed = 0;
+  for (const ResName *N : Names)
+    if (!N->isID())
+      ++NumNamed;
+  write16le(&Dir[Off + 12], NumNamed);
+  write16le(&Dir[Off + 14], Names.size() - NumNamed);
+  for (size_t I = 0, E = Names.size(); I != E; ++I) {
+    uint8_t *Ent = &Dir[Off + 16 + 8 * I];
+    if (Names[I]->isID())
+      write32le(Ent, Names[I]->ID);
+    else
+      write32le(Ent, StrOff[Names[I]] | 0x80000000);
+    write32le(Ent + 4, Subdir ? (Offsets[I] | 0x80000000) : Offsets[I]);
+  }
+}
+
+void ObjectWriter::writeDirectories() {
+  std::vector<const ResName *> Types;
+  std::vector<uint32_t> Offsets(TypeDirOff);
+  for (auto &T : Map)
+    Types.push_back(&T.first);
+  writeDirectory(0, Types, Offsets, true);
+
+  size_t TypeI = 0, NameI = 0, LeafI = 0;
+  for (auto &T : Map) {
+    std::vector<const ResName *> Names;
+    Offsets.clear();
+    for (auto &N : T.second) {
+      Names.push_back(&N.first);
+      Offsets.push_back(NameDirOff[NameI + Names.size() - 1]);
+    }
+    writeDirectory(TypeDirOff[TypeI++], Names, Offsets, true);
+
+    for (auto &N : T.second) {
+      // Language IDs are always ordinals.
+      std::vector<ResName> Langs(N.second.size());
+      std::vector<const ResName *> LangPtrs;
+      Offsets.clear();
+      size_t I = 0;
+      for (auto &L : N.second) {
+        Langs[I].ID = L.first;
+        LangPtrs.push_back(&Langs[I]);
+        Offsets.push_back(DataEntryOff + 16 * (LeafI + I));
+        ++I;
+      }
+      writeDirectory(NameDirOff[NameI++], LangPtrs, Offsets, false);
+      LeafI += N.second.size();
+    }
+  }
+
+  // Data-entry records. The RVA field is zero; a relocation fills it in.
+  LeafI = 0;
+  for (auto &T : Map)
+    for (auto &N : T.second)
+      for (auto &L : N.second)
+        write32le(&Dir[DataEntryOff + 16 * LeafI++ + 4], L.second.size());
+
+  // Name strings: a length-prefixed array of UTF-16 code units.
+  for (auto &P : StrOff) {
+    uint8_t *S = &Dir[P.second];
+    write16le(S, P.first->Str.size());
+    for (size_t I = 0, E = P.first->Str.size(); I != E; ++I)
+      write16le(S + 2 + 2 * I, P.first->Str[I]);
+  }
+}
+
+uint16_t ObjectWriter::getRelocType() {
+  switch (Config->Machine) {
+  case AMD64:
+    return IMAGE_REL_AMD64_ADDR32NB;
+  case I386:
+    return IMAGE_REL_I386_DIR32NB;
+  case ARMNT:
+    return IMAGE_REL_ARM_ADDR32NB;
+  default:
+    llvm_unreachable("unknown machine type");
+  }
+}
+
+std::unique_ptr<MemoryBuffer> ObjectWriter::write() {
+  layout();
+  writeDirectories();
+
+  size_t NumLeaves = DataOff.size();
+  if (NumLeaves > 0xffff)
+    error("too many resources");
+
+  // File layout: header, two section headers, .rsrc$01 contents and
+  // relocations, .rsrc$02 contents, symbol table, string table size.
+  size_t HdrSize = 20 + 2 * 40;
+  size_t Reloc01 = HdrSize + Dir.size();
+  size_t Raw02 = Reloc01 + 10 * NumLeaves;
+  size_t SymOff = Raw02 + DataSize;
+  std::vector<uint8_t> Buf(SymOff + 18 * NumLeaves + 4);
+  uint8_t *P = Buf.data();
+
+  // COFF file header.
+  write16le(P, Config->Machine);
+  write16le(P + 2, 2); // NumberOfSections
+  write32le(P + 8, SymOff);
+  write32le(P + 12, NumLeaves);
+
+  // Section headers.
+  auto WriteSec = [&](size_t I, StringRef Name, uint32_t Size, uint32_t Raw,
+                      uint32_t RelOff, uint16_t NumRel, uint32_t Align) {
+    uint8_t *S = P + 20 + 40 * I;
+    memcpy(S, Name.data(), Name.size());
+    write32le(S + 16, Size);    // SizeOfRawData
+    write32le(S + 20, Raw);     // PointerToRawData
+    write32le(S + 24, RelOff);  // PointerToRelocations
+    write16le(S + 32, NumRel);  // NumberOfRelocations
+    write32le(S + 36, IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ |
+                          Align);
+  };
+  WriteSec(0, ".rsrc$01", Dir.size(), HdrSize, Reloc01, NumLeaves,
+           IMAGE_SCN_ALIGN_4BYTES);
+  WriteSec(1, ".rsrc$02", DataSize, Raw02, 0, 0, IMAGE_SCN_ALIGN_8BYTES);
+
+  // .rsrc$01 contents, then one relocation per data-entry record.
+  memcpy(P + HdrSize, Dir.data(), Dir.size());
+  uint16_t RelType = getRelocType();
+  for (size_t I = 0; I != NumLeaves; ++I) {
+    uint8_t *R = P + Reloc01 + 10 * I;
+    write32le(R, DataEntryOff + 16 * I); // VirtualAddress
+    write32le(R + 4, I);                 // SymbolTableIndex
+    write16le(R + 8, RelType);
+  }
+
+  // .rsrc$02 contents.
+  size_t LeafI = 0;
+  for (auto &T : Map)
+    for (auto &N : T.second)
+      for (auto &L : N.second) {
+        memcpy(P + Raw02 + DataOff[LeafI++], L.second.data(),
+               L.second.size());
+      }
+
+  // One static symbol per leaf for the relocations to refer to.
+  for (size_t I = 0; I != NumLeaves; ++I) {
+    uint8_t *S = P + SymOff + 18 * I;
+    char Name[9];
+    snprintf(Name, sizeof(Name), "$R%06zX", I);
+    memcpy(S, Name, 8);
+    write32le(S + 8, DataOff[I]);
+    write16le(S + 12, 2);                 // SectionNumber: .rsrc$02
+    S[16] = IMAGE_SYM_CLASS_STATIC;
+  }
+
+  // An empty string table is just its size field.
+  write32le(P + SymOff + 18 * NumLeaves, 4);
+
+  return MemoryBuffer::getMemBufferCopy(
+      StringRef(reinterpret_cast<char *>(Buf.data()), Buf.size()),
+      "resource.obj");
+}
+
+} // anonymous namespace
+
+// Convert Windows resource files (.res files) to a COFF object file.
+std::unique_ptr<MemoryBuffer>
+convertResToCOFF(const std::vector<MemoryBufferRef> &MBs) {
+  TypeMap Map;
+  for (MemoryBufferRef MB : MBs)
+    ResParser(MB).parseInto(Map);
+  return ObjectWriter(Map).write();
+}
+
+} // namespace coff
+} // namespace lld
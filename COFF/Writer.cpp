@@ -13,6 +13,7 @@
 #include "InputFiles.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
+#include "Timer.h"
 #include "Writer.h"
 #include "lld/Core/Parallel.h"
 #include "llvm/ADT/DenseMap.h"
@@ -21,11 +22,15 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <map>
 #include <memory>
+#include <thread>
 #include <utility>
 
 using namespace llvm;
@@ -41,6 +46,75 @@ static const int SectorSize = 512;
 static const int DOSStubSize = 64;
 static const int NumberfOfDataDirectory = 16;
 
+namespace {
+// Builds the long-name string table with deduplication and tail
+// merging: a name identical to the tail of a name already in the
+// table shares its bytes, so the heavily repeated suffixes of
+// templated C++ names are stored once. All names are added up front;
+// finalize() lays the table out and getOffset() then returns the
+// final offsets.
+class StrtabBuilder {
+public:
+  void add(StringRef S) {
+    if (Offsets.insert(std::make_pair(S, 0)).second)
+      Strings.push_back(S);
+  }
+
+  void finalize();
+
+  // Returns the offset of S, including the 4 byte size field the
+  // string table starts with. Valid only after finalize().
+  size_t getOffset(StringRef S) const {
+    auto It = Offsets.find(S);
+    assert(It != Offsets.end() && "string is not in the table");
+    return It->second + 4;
+  }
+
+  bool empty() const { return Data.empty(); }
+  size_t size() const { return Data.size(); }
+  const char *data() const { return Data.data(); }
+
+private:
+  std::vector<StringRef> Strings;
+  llvm::DenseMap<StringRef, size_t> Offsets;
+  std::vector<char> Data;
+};
+} // anonymous namespace
+
+// Sorts reversed strings in descending lexicographic order, which
+// makes strings sharing a suffix adjacent, longest first.
+static bool compareBySuffix(StringRef A, StringRef B) {
+  size_t LA = A.size(), LB = B.size();
+  for (size_t I = 0, E = std::min(LA, LB); I != E; ++I) {
+    uint8_t CA = A[LA - I - 1], CB = B[LB - I - 1];
+    if (CA != CB)
+      return CA > CB;
+  }
+  return LA > LB;
+}
+
+void StrtabBuilder::finalize() {
+  // The entries are unique, so the comparator is a total order and
+  // the non-stable parallel sort gives a deterministic result.
+  parallel_sort(Strings.begin(), Strings.end(), compareBySuffix);
+  StringRef Previous;
+  size_t PreviousOff = 0;
+  for (StringRef S : Strings) {
+    // After the sort, the closest superstring that ends with S
+    // precedes it, so comparing with the last emitted entry finds
+    // every possible tail merge.
+    if (Previous.endswith(S)) {
+      Offsets[S] = PreviousOff + (Previous.size() - S.size());
+      continue;
+    }
+    PreviousOff = Data.size();
+    Previous = S;
+    Offsets[S] = PreviousOff;
+    Data.insert(Data.end(), S.begin(), S.end());
+    Data.push_back('\0');
+  }
+}
+
 namespace {
 // The writer writes a SymbolTable result to a file.
 class Writer {
@@ -58,14 +132,15 @@ private:
   void createSymbolAndStringTable();
   void openFile(StringRef OutputPath);
   template <typename PEHeaderTy> void writeHeader();
+  void writeSymbolAndStringTable();
   void fixSafeSEHSymbols();
   void setSectionPermissions();
   void writeSections();
   void sortExceptionTable();
+  void writeChecksum();
   void applyRelocations();
 
   llvm::Optional<coff_symbol16> createSymbol(Defined *D);
-  size_t addEntryToStringTable(StringRef Str);
 
   OutputSection *findSection(StringRef Name);
   OutputSection *createSection(StringRef Name);
@@ -77,11 +152,25 @@ private:
 
   SymbolTable *Symtab;
   std::unique_ptr<llvm::FileOutputBuffer> Buffer;
+
+  // The previous output file and the temporary path the new image is
+  // built under, for /incremental. Both are empty otherwise.
+  std::unique_ptr<MemoryBuffer> Previous;
+  std::string TempPath;
+
+  // File offset of the PE header checksum field. Set by writeHeader.
+  uint64_t ChecksumOff = 0;
   llvm::SpecificBumpPtrAllocator<OutputSection> CAlloc;
   llvm::SpecificBumpPtrAllocator<BaserelChunk> BAlloc;
+  // One vector of base relocations per output section. BaserelChunks
+  // point into these, so they must live until the sections are written.
+  std::vector<std::vector<Baserel>> BaserelVecs;
   std::vector<OutputSection *> OutputSections;
-  std::vector<char> Strtab;
-  std::vector<llvm::object::coff_symbol16> OutputSymtab;
+  StrtabBuilder Strtab;
+  // Defined symbols to be written to the output symbol table, in
+  // output order. Filled by createSymbolAndStringTable; the records
+  // are created by writeSymbolAndStringTable.
+  std::vector<Defined *> SymtabEntries;
   IdataContents Idata;
   DelayLoadContents DelayIdata;
   EdataContents Edata;
@@ -112,6 +201,7 @@ public:
   void setRVA(uint64_t);
   void setFileOffset(uint64_t);
   void addChunk(Chunk *C);
+  void assignOffsets();
   StringRef getName() { return Name; }
   std::vector<Chunk *> &getChunks() { return Chunks; }
   void addPermissions(uint32_t C);
@@ -164,14 +254,23 @@ void OutputSection::setFileOffset(uint64_t Off) {
 void OutputSection::addChunk(Chunk *C) {
   Chunks.push_back(C);
   C->setOutputSection(this);
-  uint64_t Off = Header.VirtualSize;
-  Off = alignTo(Off, C->getAlign());
-  C->setRVA(Off);
-  C->setOutputSectionOff(Off);
-  Off += C->getSize();
+}
+
+// Computes the offset of every chunk within the section by a prefix
+// sum over the chunk sizes and alignments. Sections are laid out
+// independently of each other, so assignAddresses runs this for all
+// sections on the thread pool before fixing up the section bases.
+void OutputSection::assignOffsets() {
+  uint64_t Off = 0;
+  for (Chunk *C : Chunks) {
+    Off = alignTo(Off, C->getAlign());
+    C->setRVA(Off);
+    C->setOutputSectionOff(Off);
+    Off += C->getSize();
+    if (C->hasData())
+      Header.SizeOfRawData = alignTo(Off, SectorSize);
+  }
   Header.VirtualSize = Off;
-  if (C->hasData())
-    Header.SizeOfRawData = alignTo(Off, SectorSize);
 }
 
 void OutputSection::addPermissions(uint32_t C) {
@@ -220,6 +319,7 @@ bool Defined::isExecutable() {
 
 // The main function of the writer.
 void Writer::run() {
+  ScopedTimer LayoutTimer("Layout");
   createSections();
   createMiscChunks();
   createImportTables();
@@ -230,6 +330,8 @@ void Writer::run() {
   removeEmptySections();
   setSectionPermissions();
   createSymbolAndStringTable();
+  LayoutTimer.stop();
+  ScopedTimer WriteTimer("Write");
   openFile(Config->OutputFile);
   if (Config->is64()) {
     writeHeader<pe32plus_header>();
@@ -237,9 +339,47 @@ void Writer::run() {
     writeHeader<pe32_header>();
   }
   fixSafeSEHSymbols();
-  writeSections();
+
+  // The symbol map depends only on the final layout, which no longer
+  // changes, so it is formatted and written on a helper thread while
+  // the section contents are streamed to the output buffer.
+  std::thread MapThread;
+  if (!Config->MapFile.empty())
+    MapThread = std::thread([this] {
+      std::error_code EC;
+      raw_fd_ostream OS(Config->MapFile, EC, sys::fs::F_Text);
+      error(EC, "Could not create the symbol map");
+      OS.SetBufferSize(1 << 20);
+      Symtab->printMap(OS);
+    });
+
+  {
+    // The symbol and string tables land past the last section and
+    // depend only on final RVAs, so they are emitted on a background
+    // task while the section contents are written.
+    TaskGroup Tg;
+    Tg.spawn([this] { writeSymbolAndStringTable(); });
+    writeSections();
+  }
   sortExceptionTable();
+  if (Config->Release)
+    writeChecksum();
+  if (MapThread.joinable())
+    MapThread.join();
+
+  // If an incremental link produced exactly the previous image, leave
+  // the existing file in place. Its timestamp does not change, so
+  // tools that compare timestamps will not re-run on the output.
+  // (The header contains no timestamp, so no-op relinks really are
+  // byte-identical.)
+  if (Previous && Previous->getBufferSize() == FileSize &&
+      memcmp(Previous->getBufferStart(), Buffer->getBufferStart(),
+             FileSize) == 0)
+    return;
   error(Buffer->commit(), "Failed to write the output file");
+  if (!TempPath.empty())
+    error(sys::fs::rename(TempPath, Config->OutputFile),
+          "Failed to write the output file");
 }
 
 static StringRef getOutputSection(StringRef Name) {
@@ -250,6 +390,26 @@ static StringRef getOutputSection(StringRef Name) {
   return It->second;
 }
 
+// Sort chunks by the symbol priorities given by /order. Chunks whose
+// symbols are not listed in the order file keep their relative order
+// and follow all listed ones, because unlisted symbols get priority 0
+// and the order file assigns only negative priorities.
+static void sortBySectionOrder(std::vector<Chunk *> &Chunks) {
+  auto GetPriority = [](const Chunk *C) {
+    if (auto *Sec = dyn_cast<SectionChunk>(C))
+      if (DefinedRegular *Sym = Sec->getSymbol()) {
+        auto It = Config->Order.find(Sym->getName());
+        if (It != Config->Order.end())
+          return It->second;
+      }
+    return 0;
+  };
+  std::stable_sort(Chunks.begin(), Chunks.end(),
+                   [&](const Chunk *A, const Chunk *B) {
+                     return GetPriority(A) < GetPriority(B);
+                   });
+}
+
 // Create output section objects and add them to OutputSections.
 void Writer::createSections() {
   // First, bin chunks by name.
@@ -264,6 +424,13 @@ void Writer::createSections() {
     Map[C->getSectionName()].push_back(C);
   }
 
+  // Process an /order option. Sorting is done per bin, so chunks from
+  // differently-named input sections (e.g. .text$mn and .text$yz)
+  // never mix even if their symbols are interleaved in the file.
+  if (!Config->Order.empty())
+    for (auto &Pair : Map)
+      sortBySectionOrder(Pair.second);
+
   // Then create an OutputSection for each section.
   // '$' and all following characters in input section names are
   // discarded when determining output section. So, .text$foo
@@ -373,14 +540,6 @@ void Writer::removeEmptySections() {
     Sec->SectionIndex = Idx++;
 }
 
-size_t Writer::addEntryToStringTable(StringRef Str) {
-  assert(Str.size() > COFF::NameSize);
-  size_t OffsetOfEntry = Strtab.size() + 4; // +4 for the size field
-  Strtab.insert(Strtab.end(), Str.begin(), Str.end());
-  Strtab.push_back('\0');
-  return OffsetOfEntry;
-}
-
 Optional<coff_symbol16> Writer::createSymbol(Defined *Def) {
   if (auto *D = dyn_cast<DefinedRegular>(Def))
     if (!D->getChunk()->isLive())
@@ -390,7 +549,7 @@ Optional<coff_symbol16> Writer::createSymbol(Defined *Def) {
   StringRef Name = Def->getName();
   if (Name.size() > COFF::NameSize) {
     Sym.Name.Offset.Zeroes = 0;
-    Sym.Name.Offset.Offset = addEntryToStringTable(Name);
+    Sym.Name.Offset.Offset = Strtab.getOffset(Name);
   } else {
     memset(Sym.Name.ShortName, 0, COFF::NameSize);
     memcpy(Sym.Name.ShortName, Name.data(), Name.size());
@@ -432,33 +591,49 @@ void Writer::createSymbolAndStringTable() {
   if (!Config->Debug || !Config->WriteSymtab)
     return;
 
+  // Gather the symbols to be written first, so every long name is
+  // known before the string table is laid out. Only the table sizes
+  // are computed here; the records themselves are created by
+  // writeSymbolAndStringTable, concurrent with the section writes.
+  for (lld::coff::ObjectFile *File : Symtab->ObjectFiles)
+    for (SymbolBody *B : File->getSymbols())
+      if (auto *D = dyn_cast<Defined>(B)) {
+        if (auto *DR = dyn_cast<DefinedRegular>(D))
+          if (!DR->getChunk()->isLive())
+            continue;
+        SymtabEntries.push_back(D);
+      }
+  for (ImportFile *File : Symtab->ImportFiles)
+    for (SymbolBody *B : File->getSymbols())
+      SymtabEntries.push_back(cast<Defined>(B));
+
   // Name field in the section table is 8 byte long. Longer names need
-  // to be written to the string table. First, construct string table.
+  // to be written to the string table, as do long symbol names.
   for (OutputSection *Sec : OutputSections) {
     StringRef Name = Sec->getName();
-    if (Name.size() <= COFF::NameSize)
-      continue;
-    Sec->setStringTableOff(addEntryToStringTable(Name));
+    if (Name.size() > COFF::NameSize)
+      Strtab.add(Name);
   }
+  for (Defined *D : SymtabEntries) {
+    StringRef Name = D->getName();
+    if (Name.size() > COFF::NameSize)
+      Strtab.add(Name);
+  }
+  Strtab.finalize();
 
-  for (lld::coff::ObjectFile *File : Symtab->ObjectFiles)
-    for (SymbolBody *B : File->getSymbols())
-      if (auto *D = dyn_cast<Defined>(B))
-        if (Optional<coff_symbol16> Sym = createSymbol(D))
-          OutputSymtab.push_back(*Sym);
-
-  for (ImportFile *File : Symtab->ImportFiles)
-    for (SymbolBody *B : File->getSymbols())
-      if (Optional<coff_symbol16> Sym = createSymbol(cast<Defined>(B)))
-        OutputSymtab.push_back(*Sym);
+  for (OutputSection *Sec : OutputSections) {
+    StringRef Name = Sec->getName();
+    if (Name.size() > COFF::NameSize)
+      Sec->setStringTableOff(Strtab.getOffset(Name));
+  }
 
   OutputSection *LastSection = OutputSections.back();
   // We position the symbol table to be adjacent to the end of the last section.
   uint64_t FileOff = LastSection->getFileOff() +
                      alignTo(LastSection->getRawSize(), SectorSize);
-  if (!OutputSymtab.empty()) {
+  if (!SymtabEntries.empty()) {
     PointerToSymbolTable = FileOff;
-    FileOff += OutputSymtab.size() * sizeof(coff_symbol16);
+    FileOff += SymtabEntries.size() * sizeof(coff_symbol16);
   }
   if (!Strtab.empty())
     FileOff += Strtab.size() + 4;
@@ -482,9 +657,16 @@ void Writer::assignAddresses() {
       OutputSections.begin(), OutputSections.end(), [](OutputSection *S) {
         return (S->getPermissions() & IMAGE_SCN_MEM_DISCARDABLE) == 0;
       });
+  // Lay out the chunks within each section in parallel. .reloc is laid
+  // out again below, once the base relocations (which depend on the
+  // final RVAs of the sections preceding it) have been added to it.
+  parallel_for_each(OutputSections.begin(), OutputSections.end(),
+                    [](OutputSection *Sec) { Sec->assignOffsets(); });
   for (OutputSection *Sec : OutputSections) {
-    if (Sec->getName() == ".reloc")
+    if (Sec->getName() == ".reloc") {
       addBaserels(Sec);
+      Sec->assignOffsets();
+    }
     Sec->setRVA(RVA);
     Sec->setFileOffset(FileSize);
     RVA += alignTo(Sec->getVirtualSize(), PageSize);
@@ -540,6 +722,10 @@ template <typename PEHeaderTy> void Writer::writeHeader() {
   PE->Subsystem = Config->Subsystem;
   PE->SizeOfImage = SizeOfImage;
   PE->SizeOfHeaders = SizeOfHeaders;
+  // Remember where the checksum field is; it is filled in by
+  // writeChecksum after the image is complete.
+  ChecksumOff = reinterpret_cast<uint8_t *>(&PE->CheckSum) -
+                Buffer->getBufferStart();
   if (!Config->NoEntry) {
     Defined *Entry = cast<Defined>(Config->Entry->repl());
     PE->AddressOfEntryPoint = Entry->getRVA();
@@ -632,31 +818,90 @@ template <typename PEHeaderTy> void Writer::writeHeader() {
     Buf += sizeof(coff_section);
   }
 
-  if (OutputSymtab.empty())
+  if (SymtabEntries.empty())
     return;
 
   COFF->PointerToSymbolTable = PointerToSymbolTable;
-  uint32_t NumberOfSymbols = OutputSymtab.size();
-  COFF->NumberOfSymbols = NumberOfSymbols;
+  COFF->NumberOfSymbols = SymtabEntries.size();
+}
+
+// Writes the output symbol table and the string table that follows
+// it. Both were laid out by createSymbolAndStringTable; the records
+// only need final RVAs, so this runs on a background task concurrent
+// with the section writes.
+void Writer::writeSymbolAndStringTable() {
+  if (SymtabEntries.empty())
+    return;
   auto *SymbolTable = reinterpret_cast<coff_symbol16 *>(
-      Buffer->getBufferStart() + COFF->PointerToSymbolTable);
-  for (size_t I = 0; I != NumberOfSymbols; ++I)
-    SymbolTable[I] = OutputSymtab[I];
+      Buffer->getBufferStart() + PointerToSymbolTable);
+  size_t I = 0;
+  for (Defined *D : SymtabEntries)
+    if (Optional<coff_symbol16> Sym = createSymbol(D))
+      SymbolTable[I++] = *Sym;
   // Create the string table, it follows immediately after the symbol table.
   // The first 4 bytes is length including itself.
-  Buf = reinterpret_cast<uint8_t *>(&SymbolTable[NumberOfSymbols]);
+  uint8_t *Buf =
+      reinterpret_cast<uint8_t *>(&SymbolTable[SymtabEntries.size()]);
   write32le(Buf, Strtab.size() + 4);
   if (!Strtab.empty())
     memcpy(Buf + 4, Strtab.data(), Strtab.size());
 }
 
 void Writer::openFile(StringRef Path) {
+  // For an incremental link, map the previous output so that the new
+  // image can be compared against it, and build the new image under a
+  // temporary name. FileOutputBuffer::create unlinks its destination,
+  // so the destination must be diverted to keep the old file alive.
+  if (Config->Incremental) {
+    auto MBOrErr = MemoryBuffer::getFile(Path);
+    if (MBOrErr) {
+      Previous = std::move(*MBOrErr);
+      TempPath = (Path + ".tmp").str();
+      Path = TempPath;
+    }
+  }
   ErrorOr<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
       FileOutputBuffer::create(Path, FileSize, FileOutputBuffer::F_executable);
   error(BufferOrErr, Twine("failed to open ") + Path);
   Buffer = std::move(*BufferOrErr);
 }
 
+// Sets the checksum field in the PE header for /release. The checksum
+// is the ones'-complement-style sum of the file taken as little-endian
+// 16-bit words (with the checksum field itself read as zero), folded
+// to 16 bits, plus the file size. Since word sums are associative, the
+// file is split into slices whose partial sums are computed in
+// parallel and folded at the end, so even on very large images this
+// pass does not add a single-threaded tail to the link.
+void Writer::writeChecksum() {
+  uint8_t *Buf = Buffer->getBufferStart();
+  write32le(Buf + ChecksumOff, 0);
+
+  // FileSize is a multiple of SectorSize, so there is no odd tail
+  // word. 64-bit partials cannot overflow: they accumulate at most
+  // 2^31 words of 16 bits each.
+  size_t NumWords = FileSize / 2;
+  size_t NumSlices = std::min<size_t>(NumWords, 256);
+  std::vector<uint64_t> Partials(NumSlices);
+  parallel_for_each(Partials.begin(), Partials.end(),
+                    [&](uint64_t &P) {
+                      size_t Idx = &P - &Partials[0];
+                      size_t End = NumWords * (Idx + 1) / NumSlices;
+                      uint64_t Sum = 0;
+                      for (size_t I = NumWords * Idx / NumSlices; I != End; ++I)
+                        Sum += read16le(Buf + I * 2);
+                      P = Sum;
+                    },
+                    1);
+
+  uint64_t Sum = 0;
+  for (uint64_t P : Partials)
+    Sum += P;
+  while (Sum >> 16)
+    Sum = (Sum & 0xffff) + (Sum >> 16);
+  write32le(Buf + ChecksumOff, Sum + FileSize);
+}
+
 void Writer::fixSafeSEHSymbols() {
   if (!SEHTable)
     return;
@@ -680,16 +925,44 @@ void Writer::writeSections() {
   uint8_t *Buf = Buffer->getBufferStart();
   for (OutputSection *Sec : OutputSections) {
     uint8_t *SecBuf = Buf + Sec->getFileOff();
+    TaskGroup Tg;
     // Fill gaps between functions in .text with INT3 instructions
     // instead of leaving as NUL bytes (which can be interpreted as
-    // ADD instructions).
-    if (Sec->getPermissions() & IMAGE_SCN_CNT_CODE)
-      memset(SecBuf, 0xCC, Sec->getRawSize());
+    // ADD instructions). Only the alignment gaps are filled, on a
+    // task running alongside the chunk writes below, rather than
+    // pre-filling the whole section and writing most bytes twice.
+    if (Sec->getPermissions() & IMAGE_SCN_CNT_CODE) {
+      std::vector<std::pair<uint64_t, uint64_t>> Gaps;
+      uint64_t Off = 0;
+      for (Chunk *C : Sec->getChunks()) {
+        if (!C->hasData())
+          continue;
+        if (C->getOutputSectionOff() > Off)
+          Gaps.emplace_back(Off, C->getOutputSectionOff() - Off);
+        Off = C->getOutputSectionOff() + C->getSize();
+      }
+      if (Sec->getRawSize() > Off)
+        Gaps.emplace_back(Off, Sec->getRawSize() - Off);
+      Tg.spawn([SecBuf, Gaps] {
+        for (const std::pair<uint64_t, uint64_t> &G : Gaps)
+          memset(SecBuf + G.first, 0xCC, G.second);
+      });
+    }
     parallel_for_each(Sec->getChunks().begin(), Sec->getChunks().end(),
-                      [&](Chunk *C) { C->writeTo(SecBuf); });
+                      [&](Chunk *C) { C->writeTo(SecBuf); }, 16);
   }
 }
 
+// On every machine we know, a function table entry starts with the RVA
+// of the function it describes, which is the sort key; the formats
+// differ only in the fields that follow it. The entry layout is the
+// whole per-machine descriptor the sort needs.
+template <class Entry> static void sortPdata(uint8_t *Begin, uint8_t *End) {
+  parallel_sort(
+      reinterpret_cast<Entry *>(Begin), reinterpret_cast<Entry *>(End),
+      [](const Entry &A, const Entry &B) { return A.Begin < B.Begin; });
+}
+
 // Sort .pdata section contents according to PE/COFF spec 5.5.
 void Writer::sortExceptionTable() {
   OutputSection *Sec = findSection(".pdata");
@@ -698,21 +971,19 @@ void Writer::sortExceptionTable() {
   // We assume .pdata contains function table entries only.
   uint8_t *Begin = Buffer->getBufferStart() + Sec->getFileOff();
   uint8_t *End = Begin + Sec->getVirtualSize();
-  if (Config->Machine == AMD64) {
-    struct Entry { ulittle32_t Begin, End, Unwind; };
-    parallel_sort(
-        (Entry *)Begin, (Entry *)End,
-        [](const Entry &A, const Entry &B) { return A.Begin < B.Begin; });
+  struct EntryX64 { ulittle32_t Begin, End, Unwind; };
+  struct EntryArm { ulittle32_t Begin, Unwind; };
+  switch (Config->Machine) {
+  case AMD64:
+    sortPdata<EntryX64>(Begin, End);
     return;
-  }
-  if (Config->Machine == ARMNT) {
-    struct Entry { ulittle32_t Begin, Unwind; };
-    parallel_sort(
-        (Entry *)Begin, (Entry *)End,
-        [](const Entry &A, const Entry &B) { return A.Begin < B.Begin; });
+  case ARMNT:
+  case ARM64:
+    sortPdata<EntryArm>(Begin, End);
     return;
+  default:
+    errs() << "warning: don't know how to handle .pdata.\n";
   }
-  errs() << "warning: don't know how to handle .pdata.\n";
 }
 
 OutputSection *Writer::findSection(StringRef Name) {
@@ -761,17 +1032,30 @@ OutputSection *Writer::createSection(StringRef Name) {
 
 // Dest is .reloc section. Add contents to that section.
 void Writer::addBaserels(OutputSection *Dest) {
-  std::vector<Baserel> V;
   for (OutputSection *Sec : OutputSections) {
     if (Sec == Dest)
       continue;
-    // Collect all locations for base relocations.
-    for (Chunk *C : Sec->getChunks())
-      C->getBaserels(&V);
-    // Add the addresses to .reloc section.
-    if (!V.empty())
-      addBaserelBlocks(Dest, V);
-    V.clear();
+    // Collect the base relocations of each chunk in parallel. Every
+    // chunk knows its own addresses, and chunks are laid out in
+    // ascending RVA order, so concatenating the per-chunk results in
+    // chunk order yields the page-sorted vector the block emission
+    // below expects.
+    std::vector<Chunk *> &Chunks = Sec->getChunks();
+    std::vector<std::vector<Baserel>> Tmp(Chunks.size());
+    parallel_for_each(Tmp.begin(), Tmp.end(),
+                      [&](std::vector<Baserel> &V) {
+                        Chunks[&V - &Tmp[0]]->getBaserels(&V);
+                      },
+                      64);
+    std::vector<Baserel> V;
+    for (std::vector<Baserel> &T : Tmp)
+      V.insert(V.end(), T.begin(), T.end());
+    if (V.empty())
+      continue;
+    // Add the addresses to .reloc section. The blocks reference the
+    // vector's elements, so give it a permanent home first.
+    BaserelVecs.push_back(std::move(V));
+    addBaserelBlocks(Dest, BaserelVecs.back());
   }
 }
 
@@ -31,7 +31,11 @@ enum ELFKind {
   ELF64BEKind
 };
 
-enum class BuildIdKind { None, Fnv1, Md5, Sha1, Hexstring };
+enum class BuildIdKind { None, Fnv1, Md5, Sha1, Hexstring, Tree };
+
+// How aggressive --icf should be. Safe folds only sections whose
+// addresses are provably not observed by the program.
+enum class IcfLevel { None, Safe, All };
 
 // This struct contains symbols version definition that
 // can be found in version script if it is used for link.
@@ -56,22 +60,31 @@ struct Configuration {
   llvm::StringRef Fini;
   llvm::StringRef Init;
   llvm::StringRef LtoAAPipeline;
+  llvm::StringRef LtoCacheDir;
   llvm::StringRef LtoNewPmPasses;
+  llvm::StringRef MapFile;
   llvm::StringRef OutputFile;
   llvm::StringRef SoName;
+  llvm::StringRef SplitDebugOutput;
+  llvm::StringRef StatsJsonFile;
   llvm::StringRef Sysroot;
+  llvm::StringRef TimeTraceFile;
   llvm::StringSet<> TraceSymbol;
   std::string RPath;
   std::vector<Version> SymbolVersions;
   std::vector<llvm::StringRef> DynamicList;
   std::vector<llvm::StringRef> SearchPaths;
+  std::vector<llvm::StringRef> SymbolOrderingFile;
   std::vector<llvm::StringRef> Undefined;
   std::vector<llvm::StringRef> VersionScriptGlobals;
   std::vector<uint8_t> BuildIdVector;
   bool AllowMultipleDefinition;
+  bool ArchiveCache;
   bool AsNeeded = false;
   bool Bsymbolic;
   bool BsymbolicFunctions;
+  bool CompressDebugSections = false;
+  bool Cref;
   bool Demangle = true;
   bool DisableVerify;
   bool DiscardAll;
@@ -81,13 +94,16 @@ struct Configuration {
   bool EnableNewDtags;
   bool ExportDynamic;
   bool GcSections;
+  bool GdbIndex;
   bool GnuHash = false;
-  bool ICF;
+  bool Incremental;
+  bool LazyDsoSymbols;
   bool Mips64EL = false;
   bool NoGnuUnique;
   bool NoUndefined;
   bool NoUndefinedVersion;
   bool NoinhibitExec;
+  bool PackDynRelocs = false;
   bool Pic;
   bool Pie;
   bool PrintGcSections;
@@ -96,10 +112,12 @@ struct Configuration {
   bool SaveTemps;
   bool Shared;
   bool Static = false;
+  bool Stats;
   bool StripAll;
   bool StripDebug;
   bool SysvHash = true;
   bool Threads;
+  bool ThreadsPin;
   bool Trace;
   bool Verbose;
   bool VersionScriptGlobalByDefault = true;
@@ -111,12 +129,17 @@ struct Configuration {
   bool ZOrigin;
   bool ZRelro;
   BuildIdKind BuildId = BuildIdKind::None;
+  IcfLevel ICF = IcfLevel::None;
   ELFKind EKind = ELFNoneKind;
   uint16_t EMachine = llvm::ELF::EM_NONE;
   uint64_t EntryAddr = -1;
   unsigned LtoJobs;
   unsigned LtoO;
   unsigned Optimize;
+  // Number of worker threads --threads=N requested, or 0 for automatic
+  // selection (one per core, unless the link is small enough that the
+  // driver keeps it serial).
+  unsigned ThreadCount;
 };
 
 // The only instance of Configuration struct.
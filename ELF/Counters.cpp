@@ -0,0 +1,95 @@
+//===- Counters.cpp -------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Counters.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+using namespace llvm;
+using namespace lld;
+using namespace lld::elf;
+
+// The head of the intrusive list of all counters. All counters are
+// globals below, but registration still takes a lock so that the list
+// stays well-formed if a future counter is instantiated lazily on a
+// worker thread, the way the memory arena counters can be.
+static Counter *Head;
+static std::mutex Mu;
+
+Counter::Counter(StringRef Name) : Name(Name) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  Next = Head;
+  Head = this;
+}
+
+uint64_t Counter::get() const {
+  uint64_t Sum = 0;
+  for (const Slot &S : Slots)
+    Sum += S.V.load(std::memory_order_relaxed);
+  return Sum;
+}
+
+unsigned Counter::slotIndex() {
+  static std::atomic<unsigned> NextIndex;
+  static LLVM_THREAD_LOCAL int Idx = -1;
+  if (Idx < 0)
+    Idx = NextIndex.fetch_add(1, std::memory_order_relaxed) % NumSlots;
+  return Idx;
+}
+
+namespace lld {
+namespace elf {
+namespace cnt {
+Counter RelocsScanned("relocations scanned");
+Counter SymbolsResolved("symbols resolved");
+Counter BytesMerged("mergeable bytes merged");
+Counter OffsetLookupHits("offset lookups (flattened map)");
+Counter OffsetLookupMisses("offset lookups (kind dispatch)");
+Counter IcfRounds("icf rounds");
+}
+}
+}
+
+// Counter rows sorted by name, largest counts are not more important
+// than small ones here (a zero icf round count next to billions of
+// relocations is itself informative), so alphabetical keeps the
+// report stable across runs and links.
+static std::vector<std::pair<StringRef, uint64_t>> collectCounters() {
+  std::vector<std::pair<StringRef, uint64_t>> V;
+  for (Counter *C = Head; C; C = C->Next)
+    if (uint64_t N = C->get())
+      V.push_back({C->Name, N});
+  std::sort(V.begin(), V.end(),
+            [](const std::pair<StringRef, uint64_t> &A,
+               const std::pair<StringRef, uint64_t> &B) {
+              return A.first < B.first;
+            });
+  return V;
+}
+
+void elf::printCounterStats() {
+  outs() << format("%12s  %s\n", "count", "quantity");
+  for (const std::pair<StringRef, uint64_t> &C : collectCounters())
+    outs() << format("%12llu  ", (unsigned long long)C.second) << C.first
+           << "\n";
+}
+
+void elf::appendCounterStatsJson(raw_ostream &OS, bool &NeedComma) {
+  // Counter names are fixed strings, so they need no escaping beyond
+  // what JSON always allows.
+  for (const std::pair<StringRef, uint64_t> &C : collectCounters()) {
+    if (NeedComma)
+      OS << ",";
+    NeedComma = true;
+    OS << "\n{\"name\":\"" << C.first << "\",\"count\":" << C.second << "}";
+  }
+}
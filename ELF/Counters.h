@@ -0,0 +1,88 @@
+//===- Counters.h -----------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Throughput counters for the hot loops. Phase timers say where the
+// time went; these say which quantity exploded -- relocations scanned,
+// symbols resolved, bytes merged -- when a customer link is slow and
+// the inputs cannot be reproduced. They are always compiled in: each
+// thread bumps its own cache-line-padded slot, so an increment is one
+// uncontended relaxed atomic add, and the slots are summed once at the
+// end of the link for --stats and -stats-json=.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_COUNTERS_H
+#define LLD_ELF_COUNTERS_H
+
+#include "lld/Core/LLVM.h"
+#include "llvm/Support/Compiler.h"
+#include <atomic>
+#include <cstdint>
+
+namespace lld {
+namespace elf {
+
+// One named quantity. Counters are defined as globals in Counters.cpp
+// and register themselves on an intrusive list the reporters walk,
+// like the memory arenas in Memory.h do.
+class Counter {
+public:
+  explicit Counter(StringRef Name);
+
+  void add(uint64_t N) {
+    Slots[slotIndex()].V.fetch_add(N, std::memory_order_relaxed);
+  }
+
+  // Sums the per-thread slots. Only meaningful once the counted work
+  // has finished.
+  uint64_t get() const;
+
+  StringRef Name;
+  Counter *Next = nullptr;
+
+private:
+  // Threads are assigned slots round-robin on first use, and each slot
+  // is padded to a cache line so two threads never write to the same
+  // one. A link uses far fewer threads than there are slots; if it
+  // ever does not, sharing a slot costs contention, not correctness.
+  enum { NumSlots = 64 };
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> V{0};
+  };
+  Slot Slots[NumSlots];
+
+  static unsigned slotIndex();
+};
+
+// The quantities we track.
+namespace cnt {
+extern Counter RelocsScanned;
+extern Counter SymbolsResolved;
+extern Counter BytesMerged;
+extern Counter OffsetLookupHits;
+extern Counter OffsetLookupMisses;
+extern Counter IcfRounds;
+}
+
+// Increment macros, cheap enough for the relocation scan and offset
+// lookup loops.
+#define LLD_COUNT(C) (lld::elf::cnt::C).add(1)
+#define LLD_COUNT_N(C, N) (lld::elf::cnt::C).add(N)
+
+// Prints the nonzero counters; called together with the memory report
+// when --stats is given.
+void printCounterStats();
+
+// Appends the nonzero counters as {"name":..., "count":...} objects to
+// an already-open JSON array for -stats-json=.
+void appendCounterStatsJson(llvm::raw_ostream &OS, bool &NeedComma);
+}
+}
+
+#endif
@@ -9,21 +9,33 @@
 
 #include "Driver.h"
 #include "Config.h"
+#include "Counters.h"
 #include "Error.h"
 #include "ICF.h"
 #include "InputFiles.h"
 #include "InputSection.h"
 #include "LinkerScript.h"
+#include "Memory.h"
 #include "SymbolListFile.h"
 #include "SymbolTable.h"
 #include "Target.h"
+#include "TimeTrace.h"
 #include "Writer.h"
+#include "lld/Core/PageAdvise.h"
+#include "lld/Core/Parallel.h"
 #include "lld/Driver/Driver.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/StringSaver.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstdlib>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 using namespace llvm;
@@ -38,6 +50,12 @@ Configuration *elf::Config;
 LinkerDriver *elf::Driver;
 
 bool elf::link(ArrayRef<const char *> Args, raw_ostream &Error) {
+  // This port keeps per-link state in globals, so only one link can be
+  // in flight in a process. Embedders may call this from several
+  // threads; serialize them here.
+  static std::mutex Mu;
+  std::lock_guard<std::mutex> Lock(Mu);
+
   HasError = false;
   ErrorOS = &Error;
 
@@ -123,10 +141,49 @@ void LinkerDriver::addFile(StringRef Path) {
     return;
   case file_magic::archive:
     if (WholeArchive) {
-      for (MemoryBufferRef MB : getArchiveMembers(MBRef))
-        Files.push_back(createObjectFile(MB, Path));
+      adviseBuffer(MBRef, PageAdvice::WillNeed);
+      std::vector<MemoryBufferRef> Members = getArchiveMembers(MBRef);
+
+      // Every member is about to be linked in, and constructing the
+      // InputFile objects already decodes the ELF header and section
+      // table of each one, so spread the members over the executor.
+      // Files is pre-sized and each task writes only its own slot,
+      // keeping the members in archive order. The heavy per-member
+      // parsing and the symbol table insertion are batched later by
+      // SymbolTable::addFiles, which pipelines them like any other
+      // input.
+      size_t Begin = Files.size();
+      Files.resize(Begin + Members.size());
+      auto CreateMember = [&](size_t I) {
+        Files[Begin + I] = createObjectFile(Members[I], Path);
+      };
+      if (Config->Threads) {
+        // createELFFile records the first ELF file seen for the output
+        // header, a write that must stay deterministic. Construct the
+        // first ELF member serially so the concurrent tasks only read
+        // the already-set pointer.
+        if (!Config->FirstElf)
+          for (size_t I = 0, E = Members.size(); I != E; ++I)
+            if (identify_magic(Members[I].getBuffer()) !=
+                file_magic::bitcode) {
+              CreateMember(I);
+              break;
+            }
+        TaskGroup TG;
+        for (size_t I = 0, E = Members.size(); I != E; ++I)
+          if (!Files[Begin + I])
+            TG.spawn([&, I] { CreateMember(I); });
+      } else {
+        for (size_t I = 0, E = Members.size(); I != E; ++I)
+          CreateMember(I);
+      }
       return;
     }
+    // Only the symbol index at the front of a lazy archive is read
+    // until members are actually loaded, so do not fault in the rest.
+    advisePages(MBRef.getBufferStart(),
+                std::min<size_t>(MBRef.getBufferSize(), 1 << 20),
+                PageAdvice::WillNeed);
     Files.push_back(make_unique<ArchiveFile>(MBRef));
     return;
   case file_magic::elf_shared_object:
@@ -134,9 +191,11 @@ void LinkerDriver::addFile(StringRef Path) {
       error("attempted static link of dynamic object " + Path);
       return;
     }
+    adviseBuffer(MBRef, PageAdvice::WillNeed);
     Files.push_back(createSharedFile(MBRef));
     return;
   default:
+    adviseBuffer(MBRef, PageAdvice::WillNeed);
     if (InLib)
       Files.push_back(make_unique<LazyObjectFile>(MBRef));
     else
@@ -144,8 +203,71 @@ void LinkerDriver::addFile(StringRef Path) {
   }
 }
 
+// Returns the buffer for a background open issued by
+// prefetchInputFiles, waiting for it if the open is still in flight,
+// or opens the file right here if it was not prefetched (linker-script
+// INPUT commands, --dynamic-list files and the like).
+ErrorOr<std::unique_ptr<MemoryBuffer>> LinkerDriver::openFile(StringRef Path) {
+  {
+    std::unique_lock<std::mutex> Lock(PrefetchMu);
+    auto It = Prefetched.find(Path);
+    if (It != Prefetched.end()) {
+      PrefetchedFile &P = It->second;
+      while (!P.Done)
+        PrefetchCond.wait(Lock);
+      // A prefetched buffer can be consumed only once. If the same
+      // file is named twice on the command line, the second reference
+      // finds a success entry holding a null buffer and opens the
+      // file again below.
+      if (!P.MB || *P.MB)
+        return std::move(P.MB);
+    }
+  }
+  return MemoryBuffer::getFile(Path);
+}
+
+// Issues a background open for each file the createFiles walk will
+// read, in command-line order. Libraries are resolved to paths here;
+// the later searchLibrary call in addLibrary repeats the search (the
+// directory metadata is warm by then) and finds the same file, and
+// missing libraries are also diagnosed there.
+void LinkerDriver::prefetchInputFiles(opt::InputArgList &Args, TaskGroup &TG) {
+  std::vector<std::string> Paths;
+  for (auto *Arg : Args) {
+    switch (Arg->getOption().getID()) {
+    case OPT_l: {
+      std::string Path = searchLibrary(Arg->getValue());
+      if (!Path.empty())
+        Paths.push_back(Path);
+      break;
+    }
+    case OPT_alias_script_T:
+    case OPT_INPUT:
+    case OPT_script:
+      Paths.push_back(Arg->getValue());
+      break;
+    }
+  }
+
+  for (const std::string &Path : Paths) {
+    auto It = Prefetched.insert(std::make_pair(Path, PrefetchedFile()));
+    if (!It.second)
+      continue; // Named twice; open once.
+    // StringMap rehashing moves buckets, not entries, so the pointer
+    // stays valid while tasks run.
+    PrefetchedFile *P = &It.first->second;
+    TG.spawn([=] {
+      auto MBOrErr = MemoryBuffer::getFile(Path);
+      std::lock_guard<std::mutex> Lock(PrefetchMu);
+      P->MB = std::move(MBOrErr);
+      P->Done = true;
+      PrefetchCond.notify_all();
+    });
+  }
+}
+
 Optional<MemoryBufferRef> LinkerDriver::readFile(StringRef Path) {
-  auto MBOrErr = MemoryBuffer::getFile(Path);
+  auto MBOrErr = openFile(Path);
   error(MBOrErr, "cannot open " + Path);
   if (HasError)
     return None;
@@ -211,7 +333,7 @@ static void checkOptions(opt::InputArgList &Args) {
       error("-r and -shared may not be used together");
     if (Config->GcSections)
       error("-r and --gc-sections may not be used together");
-    if (Config->ICF)
+    if (Config->ICF != IcfLevel::None)
       error("-r and --icf may not be used together");
     if (Config->Pie)
       error("-r and -pie may not be used together");
@@ -265,8 +387,11 @@ void LinkerDriver::main(ArrayRef<const char *> ArgsArr) {
     // if you are trying to understand the whole picture of the code.
     Cpio.reset(CpioFile::create(Path));
     if (Cpio) {
-      Cpio->append("response.txt", createResponseFile(Args));
-      Cpio->append("version.txt", getVersionString());
+      // Save the strings; the archive is written on a background
+      // thread, so members must stay live until the link ends.
+      StringSaver Saver(Alloc);
+      Cpio->append("response.txt", Saver.save(createResponseFile(Args)));
+      Cpio->append("version.txt", Saver.save(getVersionString()));
     }
   }
 
@@ -314,8 +439,10 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   }
 
   Config->AllowMultipleDefinition = Args.hasArg(OPT_allow_multiple_definition);
+  Config->ArchiveCache = Args.hasArg(OPT_archive_cache);
   Config->Bsymbolic = Args.hasArg(OPT_Bsymbolic);
   Config->BsymbolicFunctions = Args.hasArg(OPT_Bsymbolic_functions);
+  Config->Cref = Args.hasArg(OPT_cref);
   Config->Demangle = !Args.hasArg(OPT_no_demangle);
   Config->DisableVerify = Args.hasArg(OPT_disable_verify);
   Config->DiscardAll = Args.hasArg(OPT_discard_all);
@@ -325,7 +452,12 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->EnableNewDtags = !Args.hasArg(OPT_disable_new_dtags);
   Config->ExportDynamic = Args.hasArg(OPT_export_dynamic);
   Config->GcSections = Args.hasArg(OPT_gc_sections);
-  Config->ICF = Args.hasArg(OPT_icf);
+  Config->GdbIndex = Args.hasArg(OPT_gdb_index);
+  if (auto *Arg = Args.getLastArg(OPT_icf, OPT_icf_safe))
+    Config->ICF = Arg->getOption().getID() == OPT_icf ? IcfLevel::All
+                                                      : IcfLevel::Safe;
+  Config->Incremental = Args.hasArg(OPT_incremental);
+  Config->LazyDsoSymbols = Args.hasArg(OPT_lazy_dso_symbols);
   Config->NoGnuUnique = Args.hasArg(OPT_no_gnu_unique);
   Config->NoUndefined =
       Args.hasArg(OPT_no_undefined) || hasZOption(Args, "defs");
@@ -336,9 +468,17 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->Relocatable = Args.hasArg(OPT_relocatable);
   Config->SaveTemps = Args.hasArg(OPT_save_temps);
   Config->Shared = Args.hasArg(OPT_shared);
+  Config->Stats = Args.hasArg(OPT_stats);
   Config->StripAll = Args.hasArg(OPT_strip_all);
   Config->StripDebug = Args.hasArg(OPT_strip_debug);
-  Config->Threads = Args.hasArg(OPT_threads);
+  // --deterministic-parallel is --threads spelled as a promise: all of
+  // our threaded paths produce output byte-identical to a serial link
+  // (see the determinism contract in lld/Core/Parallel.h), and release
+  // builds that require reproducibility use this name to say they rely
+  // on it.
+  Config->Threads = Args.hasArg(OPT_threads) || Args.hasArg(OPT_threads_eq) ||
+                    Args.hasArg(OPT_deterministic_parallel);
+  Config->ThreadsPin = Args.hasArg(OPT_threads_pin);
   Config->Trace = Args.hasArg(OPT_trace);
   Config->Verbose = Args.hasArg(OPT_verbose);
   Config->WarnCommon = Args.hasArg(OPT_warn_common);
@@ -348,16 +488,39 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->Fini = getString(Args, OPT_fini, "_fini");
   Config->Init = getString(Args, OPT_init, "_init");
   Config->LtoAAPipeline = getString(Args, OPT_lto_aa_pipeline);
+  Config->LtoCacheDir = getString(Args, OPT_lto_cache_directory);
   Config->LtoNewPmPasses = getString(Args, OPT_lto_newpm_passes);
+  Config->MapFile = getString(Args, OPT_Map);
   Config->OutputFile = getString(Args, OPT_o);
   Config->SoName = getString(Args, OPT_soname);
+  Config->SplitDebugOutput = getString(Args, OPT_split_debug_output);
+  Config->StatsJsonFile = getString(Args, OPT_stats_json);
   Config->Sysroot = getString(Args, OPT_sysroot);
+  Config->TimeTraceFile = getString(Args, OPT_time_trace);
 
   Config->Optimize = getInteger(Args, OPT_O, 1);
   Config->LtoO = getInteger(Args, OPT_lto_O, 2);
   if (Config->LtoO > 3)
     error("invalid optimization level for LTO: " + getString(Args, OPT_lto_O));
-  Config->LtoJobs = getInteger(Args, OPT_lto_jobs, 1);
+
+  // 0 means choose automatically: one worker per core, unless the link
+  // is so small that the thread pool would cost more than it saves, in
+  // which case it stays serial (see LinkerDriver::link).
+  Config->ThreadCount = getInteger(Args, OPT_threads_eq, 0);
+  if (Args.hasArg(OPT_threads_eq) && Config->ThreadCount == 0)
+    error("number of threads must be > 0");
+  if (Config->ThreadCount == 1)
+    Config->Threads = false;
+
+  // The combined LTO module is partitioned across this many codegen
+  // threads. When -threads is in effect and no explicit count is
+  // given, use one partition per core like the rest of the link.
+  unsigned DefaultLtoJobs = 1;
+  if (Config->Threads)
+    DefaultLtoJobs = Config->ThreadCount
+                         ? Config->ThreadCount
+                         : std::max(1u, std::thread::hardware_concurrency());
+  Config->LtoJobs = getInteger(Args, OPT_lto_jobs, DefaultLtoJobs);
   if (Config->LtoJobs == 0)
     error("number of threads must be > 0");
 
@@ -389,6 +552,25 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
       error("unknown hash style: " + S);
   }
 
+  if (auto *Arg = Args.getLastArg(OPT_pack_dyn_relocs)) {
+    StringRef S = Arg->getValue();
+    if (S == "relr")
+      Config->PackDynRelocs = true;
+    else if (S != "none")
+      error("unknown --pack-dyn-relocs format: " + S);
+  }
+
+  if (auto *Arg = Args.getLastArg(OPT_compress_debug_sections)) {
+    StringRef S = Arg->getValue();
+    if (S == "zlib") {
+      if (!zlib::isAvailable())
+        error("build lld with zlib to enable --compress-debug-sections");
+      Config->CompressDebugSections = true;
+    } else if (S != "none") {
+      error("unknown --compress-debug-sections value: " + S);
+    }
+  }
+
   // Parse --build-id or --build-id=<style>.
   if (Args.hasArg(OPT_build_id))
     Config->BuildId = BuildIdKind::Fnv1;
@@ -398,6 +580,8 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
       Config->BuildId = BuildIdKind::Md5;
     } else if (S == "sha1") {
       Config->BuildId = BuildIdKind::Sha1;
+    } else if (S == "tree") {
+      Config->BuildId = BuildIdKind::Tree;
     } else if (S == "none") {
       Config->BuildId = BuildIdKind::None;
     } else if (S.startswith("0x")) {
@@ -418,6 +602,18 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   for (auto *Arg : Args.filtered(OPT_export_dynamic_symbol))
     Config->DynamicList.push_back(Arg->getValue());
 
+  // Parse a symbol ordering file: one symbol name per line.
+  if (auto *Arg = Args.getLastArg(OPT_symbol_ordering_file))
+    if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue())) {
+      SmallVector<StringRef, 0> Lines;
+      Buffer->getBuffer().split(Lines, '\n');
+      for (StringRef S : Lines) {
+        S = S.trim();
+        if (!S.empty())
+          Config->SymbolOrderingFile.push_back(S);
+      }
+    }
+
   if (auto *Arg = Args.getLastArg(OPT_version_script)) {
     if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
       parseVersionScript(*Buffer);
@@ -428,6 +624,15 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
 }
 
 void LinkerDriver::createFiles(opt::InputArgList &Args) {
+  // With thousands of inputs on a networked filesystem, opening them
+  // one at a time serializes seconds of metadata latency before any
+  // parsing starts. Issue all the opens in the background and let the
+  // walk below pick up each buffer as it becomes ready. The TaskGroup
+  // destructor waits for stray opens if an error stops the walk early.
+  TaskGroup TG;
+  if (Config->Threads)
+    prefetchInputFiles(Args, TG);
+
   for (auto *Arg : Args) {
     switch (Arg->getOption().getID()) {
     case OPT_l:
@@ -482,7 +687,52 @@ void LinkerDriver::createFiles(opt::InputArgList &Args) {
 
 // Do actual linking. Note that when this function is called,
 // all linker scripts have already been parsed.
+// -incremental makes a relink a no-op when nothing has changed. We
+// fingerprint the command line and the contents of every file we have
+// read; if the fingerprint matches the one recorded by the previous
+// successful run, the existing output is already correct and the link
+// is skipped. Patching individual chunks of the old output is not
+// attempted because any input change can move the final layout.
+static uint64_t getLinkFingerprint(opt::InputArgList &Args,
+                                   ArrayRef<std::unique_ptr<MemoryBuffer>> MBs) {
+  hash_code H = hash_value(StringRef("lld-incremental-1"));
+  for (auto *Arg : Args)
+    H = hash_combine(H, Arg->getAsString(Args));
+  for (const std::unique_ptr<MemoryBuffer> &MB : MBs)
+    H = hash_combine(H, StringRef(MB->getBufferIdentifier()),
+                     MB->getBuffer());
+  return H;
+}
+
+static std::string getFingerprintPath() {
+  return (Config->OutputFile + ".incremental").str();
+}
+
+// Returns true if the existing output is already up to date.
+static bool isOutputUpToDate(uint64_t Fingerprint) {
+  if (!fs::exists(Config->OutputFile))
+    return false;
+  auto MBOrErr = MemoryBuffer::getFile(getFingerprintPath());
+  if (!MBOrErr)
+    return false;
+  uint64_t Old;
+  if ((*MBOrErr)->getBuffer().trim().getAsInteger(16, Old))
+    return false;
+  return Old == Fingerprint;
+}
+
+static void writeFingerprint(uint64_t Fingerprint) {
+  std::error_code EC;
+  raw_fd_ostream OS(getFingerprintPath(), EC, fs::F_None);
+  if (EC) {
+    error(EC, "cannot write " + getFingerprintPath());
+    return;
+  }
+  OS << utohexstr(Fingerprint) << "\n";
+}
+
 template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
+  initTimeTrace();
   SymbolTable<ELFT> Symtab;
   elf::Symtab<ELFT>::X = &Symtab;
 
@@ -511,8 +761,37 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
       Config->EntrySym = Symtab.addUndefined(S);
   }
 
-  for (std::unique_ptr<InputFile> &F : Files)
-    Symtab.addFile(std::move(F));
+  // All input files have been read by now, so the fingerprint covers
+  // every byte that can affect the output.
+  uint64_t Fingerprint = 0;
+  if (Config->Incremental) {
+    Fingerprint = getLinkFingerprint(Args, OwningMBs);
+    if (isOutputUpToDate(Fingerprint))
+      return;
+  }
+
+  // Thousands of small links, as a test suite does, pay more for
+  // spinning up the thread pool than parallelism wins back, so unless a
+  // thread count was given explicitly, a link with only a few megabytes
+  // of input stays on the fast serial path.
+  if (Config->Threads && Config->ThreadCount == 0) {
+    uint64_t InputSize = 0;
+    for (std::unique_ptr<InputFile> &F : Files)
+      InputSize += F->MB.getBufferSize();
+    if (InputSize < 8 * 1024 * 1024)
+      Config->Threads = false;
+  }
+  // The pool is created lazily by the first parallel operation, which
+  // runs no earlier than the parallel parts of addFiles below.
+  if (Config->Threads && Config->ThreadCount)
+    setExecutorThreadCount(Config->ThreadCount);
+  if (Config->Threads && Config->ThreadsPin)
+    setExecutorPinThreads(true);
+
+  {
+    ScopedTimeTrace T("parse input files");
+    Symtab.addFiles(Files);
+  }
   if (HasError)
     return; // There were duplicate symbols or incompatible files
 
@@ -529,11 +808,42 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   for (auto *Arg : Args.filtered(OPT_wrap))
     Symtab.wrap(Arg->getValue());
 
+  // Every undefined symbol the link will ever see exists by now, so
+  // this is the point where -lazy-dso-symbols resolves them against
+  // the shared files' hash tables.
+  Symtab.resolveLazyDsoSymbols();
+
   // Write the result to the file.
-  if (Config->GcSections)
+  if (Config->GcSections) {
+    ScopedTimeTrace T("markLive");
     markLive<ELFT>();
-  if (Config->ICF)
+  }
+  if (Config->ICF != IcfLevel::None) {
+    ScopedTimeTrace T("ICF");
     doIcf<ELFT>();
+  }
+
+  // Inflate compressed input sections. Each one decompresses into its
+  // own buffer, so they are all independent and can run concurrently;
+  // with -gz-compiled objects this is a significant chunk of the link.
+  // Doing it here rather than at parse time means sections discarded
+  // by --gc-sections above are never inflated at all.
+  {
+    ScopedTimeTrace T("uncompress input sections");
+    std::vector<InputSectionBase<ELFT> *> Compressed;
+    for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F :
+         Symtab.getObjectFiles())
+      for (InputSectionBase<ELFT> *S : F->getSections())
+        if (S && S != &InputSection<ELFT>::Discarded && S->Live &&
+            S->Compressed)
+          Compressed.push_back(S);
+    if (Config->Threads)
+      parallel_for_each(Compressed.begin(), Compressed.end(),
+                        [](InputSectionBase<ELFT> *S) { S->uncompress(); }, 1);
+    else
+      for (InputSectionBase<ELFT> *S : Compressed)
+        S->uncompress();
+  }
 
   // MergeInputSection::splitIntoPieces needs to be called before
   // any call of MergeInputSection::getOffset. Do that.
@@ -542,11 +852,26 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
     for (InputSectionBase<ELFT> *S : F->getSections()) {
       if (!S || S == &InputSection<ELFT>::Discarded || !S->Live)
         continue;
-      if (S->Compressed)
-        S->uncompress();
       if (auto *MS = dyn_cast<MergeInputSection<ELFT>>(S))
         MS->splitIntoPieces();
     }
 
   writeResult<ELFT>(&Symtab);
+
+  if (Config->Stats || !Config->StatsJsonFile.empty()) {
+    Symtab.recordMemoryUsage();
+    if (Config->Stats) {
+      printMemoryStats();
+      printCounterStats();
+    }
+    if (!Config->StatsJsonFile.empty())
+      writeMemoryStatsJson(Config->StatsJsonFile);
+  }
+
+  // Record what this run was produced from so that the next
+  // -incremental link can be skipped if nothing changes.
+  if (Config->Incremental && !HasError)
+    writeFingerprint(Fingerprint);
+
+  writeTimeTrace();
 }
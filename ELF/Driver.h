@@ -13,12 +13,20 @@
 #include "SymbolTable.h"
 #include "lld/Core/LLVM.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Option/ArgList.h"
+#include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/raw_ostream.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace lld {
+class TaskGroup;
+
 namespace elf {
 
 extern class LinkerDriver *Driver;
@@ -36,6 +44,8 @@ public:
 private:
   std::vector<MemoryBufferRef> getArchiveMembers(MemoryBufferRef MB);
   llvm::Optional<MemoryBufferRef> readFile(StringRef Path);
+  llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> openFile(StringRef Path);
+  void prefetchInputFiles(llvm::opt::InputArgList &Args, TaskGroup &TG);
   void readConfigs(llvm::opt::InputArgList &Args);
   void createFiles(llvm::opt::InputArgList &Args);
   template <class ELFT> void link(llvm::opt::InputArgList &Args);
@@ -49,6 +59,20 @@ private:
   llvm::BumpPtrAllocator Alloc;
   std::vector<std::unique_ptr<InputFile>> Files;
   std::vector<std::unique_ptr<MemoryBuffer>> OwningMBs;
+
+  // Inputs named on the command line are opened and mmapped by
+  // background tasks (see prefetchInputFiles) so that per-file
+  // open/stat latency overlaps argument processing instead of
+  // serializing in front of it. openFile consumes the entry for its
+  // path, waiting if the open is still in flight.
+  struct PrefetchedFile {
+    PrefetchedFile() : MB(std::error_code()) {}
+    llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> MB;
+    bool Done = false;
+  };
+  llvm::StringMap<PrefetchedFile> Prefetched;
+  std::mutex PrefetchMu;
+  std::condition_variable PrefetchCond;
 };
 
 // Parses command line options.
@@ -84,14 +108,36 @@ enum {
 class CpioFile {
 public:
   static CpioFile *create(StringRef OutputPath);
+  ~CpioFile();
+
+  // Schedules a copy of Data into the archive. Members are written by
+  // a background thread so that archive I/O overlaps file parsing;
+  // Data must therefore stay live until the CpioFile is destroyed.
+  // Input buffers are owned by the driver for the whole link, so this
+  // holds for all callers.
   void append(StringRef Path, StringRef Data);
 
 private:
   CpioFile(std::unique_ptr<llvm::raw_fd_ostream> OS, StringRef Basename);
 
+  struct Member {
+    std::string Path;
+    StringRef Data;
+  };
+  void run();
+
   std::unique_ptr<llvm::raw_fd_ostream> OS;
   llvm::StringSet<> Seen;
   std::string Basename;
+
+  // Members are handed to the writer thread through a bounded queue,
+  // so a slow disk applies back-pressure to the driver instead of
+  // letting an unbounded backlog build up.
+  std::thread Writer;
+  std::mutex Mu;
+  std::condition_variable Cond;
+  std::deque<Member> Queue;
+  bool Done = false;
 };
 
 void printHelp(const char *Argv0);
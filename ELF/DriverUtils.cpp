@@ -128,7 +128,18 @@ std::string elf::relativeToRoot(StringRef Path) {
 }
 
 CpioFile::CpioFile(std::unique_ptr<llvm::raw_fd_ostream> OS, StringRef S)
-    : OS(std::move(OS)), Basename(S) {}
+    : OS(std::move(OS)), Basename(S) {
+  Writer = std::thread([this] { run(); });
+}
+
+CpioFile::~CpioFile() {
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Done = true;
+  }
+  Cond.notify_all();
+  Writer.join();
+}
 
 CpioFile *CpioFile::create(StringRef OutputPath) {
   std::string Path = (OutputPath + ".cpio").str();
@@ -159,6 +170,32 @@ static void writeMember(raw_fd_ostream &OS, StringRef Path, StringRef Data) {
   OS << Data;                            // c_filedata
 }
 
+// The body of the writer thread. Pops members in the order they were
+// appended and copies them to the archive, so the driver can go on
+// parsing while the previous input is still being written out.
+void CpioFile::run() {
+  for (;;) {
+    Member M;
+    {
+      std::unique_lock<std::mutex> Lock(Mu);
+      Cond.wait(Lock, [this] { return Done || !Queue.empty(); });
+      if (Queue.empty())
+        return;
+      M = std::move(Queue.front());
+      Queue.pop_front();
+    }
+    Cond.notify_all();
+
+    writeMember(*OS, M.Path, M.Data);
+
+    // Print the trailer and seek back.
+    // This way we have a valid archive if we crash.
+    uint64_t Pos = OS->tell();
+    writeMember(*OS, "TRAILER!!!", "");
+    OS->seek(Pos);
+  }
+}
+
 void CpioFile::append(StringRef Path, StringRef Data) {
   if (!Seen.insert(Path).second)
     return;
@@ -168,13 +205,16 @@ void CpioFile::append(StringRef Path, StringRef Data) {
   // (i.e. in that case we are creating baz.cpio.)
   SmallString<128> Fullpath;
   path::append(Fullpath, Basename, Path);
-  writeMember(*OS, Fullpath, Data);
 
-  // Print the trailer and seek back.
-  // This way we have a valid archive if we crash.
-  uint64_t Pos = OS->tell();
-  writeMember(*OS, "TRAILER!!!", "");
-  OS->seek(Pos);
+  Member M;
+  M.Path = Fullpath.str();
+  M.Data = Data;
+
+  std::unique_lock<std::mutex> Lock(Mu);
+  Cond.wait(Lock, [this] { return Queue.size() < 16; });
+  Queue.push_back(std::move(M));
+  Lock.unlock();
+  Cond.notify_all();
 }
 
 // Quote a given string if it contains a space character.
@@ -11,14 +11,51 @@
 #include "Config.h"
 
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <mutex>
+
 namespace lld {
 namespace elf {
 
 bool HasError;
 llvm::raw_ostream *ErrorOS;
 
+// The sink registry and the sinks' message buffers are serialized by
+// Mu: a task appends to its own sink while fatal() on another thread
+// may be draining every sink before exiting. Diagnostics are rare, so
+// the lock is never contended on a clean link.
+static std::mutex Mu;
+static std::vector<ErrorSink *> Sinks;
+static LLVM_THREAD_LOCAL ErrorSink *ActiveSink;
+
+ErrorSink::ErrorSink() {
+  std::lock_guard<std::mutex> Lock(Mu);
+  Sinks.push_back(this);
+}
+
+ScopedErrorSink::ScopedErrorSink(ErrorSink *S) : Prev(ActiveSink) {
+  ActiveSink = S;
+}
+
+ScopedErrorSink::~ScopedErrorSink() { ActiveSink = Prev; }
+
+// Caller must hold Mu. Message order is sink creation order, which
+// callers arrange to be input order.
+static void flushSinks() {
+  llvm::raw_ostream &OS = ErrorOS ? *ErrorOS : llvm::errs();
+  for (ErrorSink *S : Sinks)
+    for (const std::string &Msg : S->Messages)
+      OS << Msg << "\n";
+  Sinks.clear();
+}
+
+void reportCollectedErrors() {
+  std::lock_guard<std::mutex> Lock(Mu);
+  flushSinks();
+}
+
 void log(const Twine &Msg) {
   if (Config->Verbose)
     llvm::outs() << Msg << "\n";
@@ -27,6 +64,12 @@ void log(const Twine &Msg) {
 void warning(const Twine &Msg) { llvm::errs() << Msg << "\n"; }
 
 void error(const Twine &Msg) {
+  if (ActiveSink) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    ActiveSink->Messages.push_back(Msg.str());
+    HasError = true;
+    return;
+  }
   *ErrorOS << Msg << "\n";
   HasError = true;
 }
@@ -37,7 +80,17 @@ void error(std::error_code EC, const Twine &Prefix) {
 }
 
 void fatal(const Twine &Msg) {
-  llvm::errs() << Msg << "\n";
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (ActiveSink) {
+    // A hard error still has to end the link (there is no way to
+    // unwind the calling task), but drain every sink first so one
+    // badly broken input does not hide diagnostics already collected
+    // for the others.
+    ActiveSink->Messages.push_back(Msg.str());
+    flushSinks();
+  } else {
+    llvm::errs() << Msg << "\n";
+  }
   exit(1);
 }
 
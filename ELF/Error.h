@@ -12,6 +12,9 @@
 
 #include "lld/Core/LLVM.h"
 
+#include <string>
+#include <vector>
+
 namespace lld {
 namespace elf {
 
@@ -28,6 +31,39 @@ template <typename T> void error(const ErrorOr<T> &V, const Twine &Prefix) {
   error(V.getError(), Prefix);
 }
 
+// A buffer for diagnostics produced by one unit of parallel work.
+// While a sink is active on a thread, error() appends to the sink
+// instead of writing to ErrorOS, and fatal() drains every registered
+// sink before exiting. reportCollectedErrors() replays the buffered
+// messages in sink creation order, so creating one sink per input
+// file, in input order, yields the same diagnostic order as a fully
+// serial parse. A sink may be active on only one thread at a time and
+// must stay alive until reportCollectedErrors() runs.
+class ErrorSink {
+public:
+  ErrorSink();
+  ErrorSink(const ErrorSink &) = delete;
+  ErrorSink &operator=(const ErrorSink &) = delete;
+
+  std::vector<std::string> Messages;
+};
+
+// RAII helper that routes the current thread's diagnostics into a
+// sink for later replay. Restores the previous sink on destruction so
+// scopes nest and worker threads reused across tasks are left clean.
+class ScopedErrorSink {
+public:
+  explicit ScopedErrorSink(ErrorSink *S);
+  ~ScopedErrorSink();
+
+private:
+  ErrorSink *Prev;
+};
+
+// Prints all buffered messages in sink creation order and unregisters
+// the sinks.
+void reportCollectedErrors();
+
 LLVM_ATTRIBUTE_NORETURN void fatal(const Twine &Msg);
 LLVM_ATTRIBUTE_NORETURN void fatal(const Twine &Msg, const Twine &Prefix);
 
@@ -57,12 +57,17 @@
 
 #include "ICF.h"
 #include "Config.h"
+#include "Counters.h"
 #include "OutputSections.h"
 #include "SymbolTable.h"
+#include "Target.h"
 
+#include "lld/Core/Parallel.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/Object/ELF.h"
 #include "llvm/Support/ELF.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace lld;
@@ -86,18 +91,26 @@ public:
   void run();
 
 private:
-  uint64_t NextId = 1;
+  std::atomic<uint64_t> NextId{1};
+
+  // Sections that --icf=safe must not fold because the program may
+  // observe their address.
+  DenseSet<InputSectionBase<ELFT> *> AddressSig;
+
+  void computeAddressSignificance();
+  void markAddressTaken(SymbolBody &B);
+  template <class RelTy>
+  void scanRelocs(ObjectFile<ELFT> *F, ArrayRef<RelTy> Rels);
 
   static void setLive(SymbolTable<ELFT> *S);
   static uint64_t relSize(InputSection<ELFT> *S);
-  static uint64_t getHash(InputSection<ELFT> *S);
-  static bool isEligible(InputSectionBase<ELFT> *Sec);
   static std::vector<InputSection<ELFT> *> getSections();
 
   void segregate(InputSection<ELFT> **Begin, InputSection<ELFT> **End,
                  Comparator Eq);
 
-  void forEachGroup(std::vector<InputSection<ELFT> *> &V, Comparator Eq);
+  void forEachGroup(std::vector<InputSection<ELFT> *> &V, Comparator Eq,
+                    bool Parallel);
 
   template <class RelTy>
   static bool relocationEq(ArrayRef<RelTy> RA, ArrayRef<RelTy> RB);
@@ -118,16 +131,16 @@ private:
 
 // Returns a hash value for S. Note that the information about
 // relocation targets is not included in the hash value.
-template <class ELFT> uint64_t ICF<ELFT>::getHash(InputSection<ELFT> *S) {
+template <class ELFT> uint64_t elf::getIcfHash(InputSection<ELFT> *S) {
   uint64_t Flags = S->getSectionHdr()->sh_flags;
   uint64_t H = hash_combine(Flags, S->getSize());
-  for (const Elf_Shdr *Rel : S->RelocSections)
+  for (const typename ELFT::Shdr *Rel : S->RelocSections)
     H = hash_combine(H, (uint64_t)Rel->sh_size);
   return H;
 }
 
 // Returns true if Sec is subject of ICF.
-template <class ELFT> bool ICF<ELFT>::isEligible(InputSectionBase<ELFT> *Sec) {
+template <class ELFT> bool elf::isIcfCandidate(InputSectionBase<ELFT> *Sec) {
   if (!Sec || Sec == &InputSection<ELFT>::Discarded || !Sec->Live)
     return false;
   auto *S = dyn_cast<InputSection<ELFT>>(Sec);
@@ -141,7 +154,7 @@ template <class ELFT> bool ICF<ELFT>::isEligible(InputSectionBase<ELFT> *Sec) {
   if (Name == ".init" || Name == ".fini")
     return false;
 
-  const Elf_Shdr &H = *S->getSectionHdr();
+  const typename ELFT::Shdr &H = *S->getSectionHdr();
   return (H.sh_flags & SHF_ALLOC) && (~H.sh_flags & SHF_WRITE);
 }
 
@@ -151,11 +164,80 @@ std::vector<InputSection<ELFT> *> ICF<ELFT>::getSections() {
   for (const std::unique_ptr<ObjectFile<ELFT>> &F :
        Symtab<ELFT>::X->getObjectFiles())
     for (InputSectionBase<ELFT> *S : F->getSections())
-      if (isEligible(S))
+      if (isIcfCandidate<ELFT>(S))
         V.push_back(cast<InputSection<ELFT>>(S));
   return V;
 }
 
+// If the symbol resolves to a section of ours, the program may have a
+// pointer into that section, so safe mode must keep its address.
+template <class ELFT> void ICF<ELFT>::markAddressTaken(SymbolBody &B) {
+  if (auto *D = dyn_cast<DefinedRegular<ELFT>>(&B))
+    if (D->Section)
+      AddressSig.insert(D->Section);
+}
+
+template <class ELFT>
+template <class RelTy>
+void ICF<ELFT>::scanRelocs(ObjectFile<ELFT> *F, ArrayRef<RelTy> Rels) {
+  for (const RelTy &Rel : Rels)
+    if (!Target->isCallRel(Rel.getType(Config->Mips64EL)))
+      markAddressTaken(F->getRelocTargetSym(Rel));
+}
+
+// Computes the set of sections whose addresses may be observed by the
+// program, so that --icf=safe can fold everything else. A .addrsig
+// section, when the compiler emits one, gives us an exact per-object
+// list of address-taken symbols. For other objects we approximate:
+// every relocation that is not a plain function call counts as taking
+// the address of its target. That is conservative -- for example a
+// direct call to a local function is usually a PC-relative relocation
+// that is indistinguishable from address materialization -- but it is
+// never wrong.
+template <class ELFT> void ICF<ELFT>::computeAddressSignificance() {
+  // Exported symbols can be compared against function pointers from
+  // other modules, so their addresses are always significant.
+  for (Symbol *S : Symtab<ELFT>::X->getSymbols())
+    if (S->includeInDynsym())
+      markAddressTaken(*S->body());
+
+  for (const std::unique_ptr<ObjectFile<ELFT>> &F :
+       Symtab<ELFT>::X->getObjectFiles()) {
+    // .addrsig is a list of ULEB128-encoded symbol table indices.
+    if (const Elf_Shdr *Sec = F->AddrsigSec) {
+      ArrayRef<uint8_t> Data = check(F->getObj().getSectionContents(Sec));
+      ArrayRef<SymbolBody *> Bodies = F->getSymbols();
+      const uint8_t *Cur = Data.begin();
+      while (Cur != Data.end()) {
+        unsigned Size;
+        uint64_t SymIndex = decodeULEB128(Cur, &Size);
+        if (Size > (size_t)(Data.end() - Cur) || SymIndex >= Bodies.size())
+          fatal(getFilename(F.get()) + ": invalid .addrsig section");
+        Cur += Size;
+        markAddressTaken(*Bodies[SymIndex]);
+      }
+      continue;
+    }
+
+    for (InputSectionBase<ELFT> *Sec : F->getSections()) {
+      // Skip relocations from non-allocated sections: references from
+      // debug info are not visible to the program at run time. The
+      // same goes for .eh_frame (not an InputSection here), whose
+      // pointers to functions only drive unwinding.
+      auto *S = dyn_cast_or_null<InputSection<ELFT>>(Sec);
+      if (!S || S == &InputSection<ELFT>::Discarded ||
+          !(S->getSectionHdr()->sh_flags & SHF_ALLOC))
+        continue;
+      for (const Elf_Shdr *RelSec : S->RelocSections) {
+        if (RelSec->sh_type == SHT_RELA)
+          scanRelocs(F.get(), F->getObj().relas(RelSec));
+        else
+          scanRelocs(F.get(), F->getObj().rels(RelSec));
+      }
+    }
+  }
+}
+
 // All sections between Begin and End must have the same group ID before
 // you call this function. This function compare sections between Begin
 // and End using Eq and assign new group IDs for new groups.
@@ -179,15 +261,24 @@ void ICF<ELFT>::segregate(InputSection<ELFT> **Begin, InputSection<ELFT> **End,
   }
 }
 
+// Iterates over all groups and segregates each of them. Groups are
+// disjoint ranges of V, so with Parallel set they are compared on the
+// thread pool. That is only safe for comparators that do not read
+// other sections' group IDs; group IDs are allocated from an atomic
+// counter, so their values stay unique either way.
 template <class ELFT>
 void ICF<ELFT>::forEachGroup(std::vector<InputSection<ELFT> *> &V,
-                             Comparator Eq) {
+                             Comparator Eq, bool Parallel) {
+  TaskGroup Tg;
   for (InputSection<ELFT> **I = V.data(), **E = I + V.size(); I != E;) {
     InputSection<ELFT> *Head = *I;
     auto Bound = std::find_if(I + 1, E, [&](InputSection<ELFT> *S) {
       return S->GroupId != Head->GroupId;
     });
-    segregate(I, Bound, Eq);
+    if (Parallel)
+      Tg.spawn([=] { segregate(I, Bound, Eq); });
+    else
+      segregate(I, Bound, Eq);
     I = Bound;
   }
 }
@@ -294,29 +385,64 @@ template <class ELFT> void ICF<ELFT>::run() {
   // if two sections have the same ID, they are likely (but not
   // guaranteed) to have the same static contents in terms of ICF.
   std::vector<InputSection<ELFT> *> V = getSections();
-  for (InputSection<ELFT> *S : V)
-    // Set MSB on to avoid collisions with serial group IDs
-    S->GroupId = getHash(S) | (uint64_t(1) << 63);
+
+  // In safe mode, take sections whose addresses the program may
+  // observe out of the candidate list; everything that is left can be
+  // folded without breaking function pointer identity.
+  if (Config->ICF == IcfLevel::Safe) {
+    computeAddressSignificance();
+    V.erase(std::remove_if(V.begin(), V.end(),
+                           [&](InputSection<ELFT> *S) {
+                             if (!AddressSig.count(S))
+                               return false;
+                             // The fused GC sweep may have stored a
+                             // hash here. Sections outside the
+                             // candidate list must keep a group ID of
+                             // 0, or equalsVariable would take a hash
+                             // match between two unfolded sections for
+                             // an equivalence.
+                             S->GroupId = 0;
+                             return true;
+                           }),
+            V.end());
+  }
+
+  // Hash sections in parallel, as the COFF port does. Set MSB on to
+  // avoid collisions with serial group IDs. With --gc-sections the
+  // liveness sweep has already hashed each section as it claimed it,
+  // so this pass is not needed.
+  if (!Config->GcSections)
+    parallel_for_each(V.begin(), V.end(), [](InputSection<ELFT> *S) {
+      S->GroupId = getIcfHash<ELFT>(S) | (uint64_t(1) << 63);
+    });
 
   // From now on, sections in V are ordered so that sections in
-  // the same group are consecutive in the vector.
-  std::stable_sort(V.begin(), V.end(),
-                   [](InputSection<ELFT> *A, InputSection<ELFT> *B) {
-                     return A->GroupId < B->GroupId;
-                   });
+  // the same group are consecutive in the vector. Half the sections
+  // can share a hash on real inputs, so sort with the radix sort,
+  // which does not degrade on duplicate keys; it is stable, so the
+  // within-group order (and thus which section each group selects)
+  // is the same as before.
+  parallel_sort_by_key(V.begin(), V.end(),
+                       [](InputSection<ELFT> *S) { return S->GroupId; });
 
   // Compare static contents and assign unique IDs for each static content.
-  forEachGroup(V, equalsConstant);
+  // equalsConstant does not look at group IDs of other sections, so the
+  // groups can be segregated in parallel.
+  forEachGroup(V, equalsConstant, /*Parallel=*/true);
 
   // Split groups by comparing relocations until we get a convergence.
   int Cnt = 1;
   for (;;) {
     ++Cnt;
     uint64_t Id = NextId;
-    forEachGroup(V, equalsVariable);
+    // equalsVariable reads group IDs of relocation target sections,
+    // which later groups in the same round may be reassigning, so this
+    // round has to stay serial to remain deterministic.
+    forEachGroup(V, equalsVariable, /*Parallel=*/false);
     if (Id == NextId)
       break;
   }
+  LLD_COUNT_N(IcfRounds, Cnt);
   log("ICF needed " + Twine(Cnt) + " iterations.");
 
   // Merge sections in the same group.
@@ -339,6 +465,16 @@ template <class ELFT> void ICF<ELFT>::run() {
 // ICF entry point function.
 template <class ELFT> void elf::doIcf() { ICF<ELFT>().run(); }
 
+template bool elf::isIcfCandidate<ELF32LE>(InputSectionBase<ELF32LE> *);
+template bool elf::isIcfCandidate<ELF32BE>(InputSectionBase<ELF32BE> *);
+template bool elf::isIcfCandidate<ELF64LE>(InputSectionBase<ELF64LE> *);
+template bool elf::isIcfCandidate<ELF64BE>(InputSectionBase<ELF64BE> *);
+
+template uint64_t elf::getIcfHash<ELF32LE>(InputSection<ELF32LE> *);
+template uint64_t elf::getIcfHash<ELF32BE>(InputSection<ELF32BE> *);
+template uint64_t elf::getIcfHash<ELF64LE>(InputSection<ELF64LE> *);
+template uint64_t elf::getIcfHash<ELF64BE>(InputSection<ELF64BE> *);
+
 template void elf::doIcf<ELF32LE>();
 template void elf::doIcf<ELF32BE>();
 template void elf::doIcf<ELF64LE>();
@@ -12,6 +12,17 @@
 
 namespace lld {
 namespace elf {
+template <class ELFT> class InputSection;
+template <class ELFT> class InputSectionBase;
+
+// Returns true if Sec is a section ICF may fold. Exposed so that the
+// --gc-sections sweep can compute ICF group hashes for candidate
+// sections while it visits them.
+template <class ELFT> bool isIcfCandidate(InputSectionBase<ELFT> *Sec);
+
+// Returns the hash value ICF seeds its equivalence groups with.
+template <class ELFT> uint64_t getIcfHash(InputSection<ELFT> *S);
+
 template <class ELFT> void doIcf();
 }
 }
@@ -11,13 +11,17 @@
 #include "Driver.h"
 #include "Error.h"
 #include "InputSection.h"
+#include "Memory.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/Analysis.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -124,10 +128,124 @@ template <class ELFT> uint32_t elf::ObjectFile<ELFT>::getMipsGp0() const {
   return 0;
 }
 
+namespace {
+// The address entries of a relocatable object's .debug_line are
+// section relative and need relocating before lookups work. By
+// presenting each section's file offset as its load address we give
+// every section a distinct, non-overlapping range, so a section's
+// file offset plus an offset within the section identifies a line
+// table row unambiguously.
+class ObjectInfo : public LoadedObjectInfo {
+public:
+  uint64_t getSectionLoadAddress(const object::SectionRef &Sec) const override {
+    // SectionRef does not expose sh_offset, but the distance of the
+    // section contents from the start of the file is the same value.
+    StringRef Contents;
+    if (Sec.getContents(Contents))
+      return 0;
+    return Contents.data() - Sec.getObject()->getData().data();
+  }
+  std::unique_ptr<llvm::LoadedObjectInfo> clone() const override {
+    return std::unique_ptr<llvm::LoadedObjectInfo>();
+  }
+};
+}
+
+// Decodes the .debug_line section. Reached only when a diagnostic
+// needs a source location, so a clean link never pays for it.
+template <class ELFT> void elf::ObjectFile<ELFT>::initializeDwarfLine() {
+  std::unique_ptr<object::ObjectFile> Obj =
+      check(object::ObjectFile::createObjectFile(this->MB));
+  ObjectInfo ObjInfo;
+  DWARFContextInMemory Dwarf(*Obj, &ObjInfo);
+  DwarfLine.reset(new DWARFDebugLine(&Dwarf.getLineSection().Relocs));
+  DataExtractor LineData(Dwarf.getLineSection().Data,
+                         ELFT::TargetEndianness == support::little,
+                         ELFT::Is64Bits ? 8 : 4);
+  // A relocatable object carries a single compilation unit, whose
+  // line table is at offset 0 in .debug_line.
+  DwarfLine->getOrParseLineTable(LineData, 0);
+}
+
+template <class ELFT> void elf::ObjectFile<ELFT>::decodeDwarfLine() {
+  std::call_once(DwarfLineOnce, [this]() { initializeDwarfLine(); });
+}
+
+template <class ELFT>
+std::string elf::ObjectFile<ELFT>::getLineInfo(InputSectionBase<ELFT> *S,
+                                               uint64_t Offset) {
+  decodeDwarfLine();
+  const DWARFDebugLine::LineTable *Tbl = DwarfLine->getLineTable(0);
+  if (!Tbl)
+    return "";
+  // Build the address the same way ObjectInfo presents section load
+  // addresses: section file offset plus offset within the section.
+  DILineInfo Info;
+  Tbl->getFileLineInfoForAddress(
+      S->getSectionHdr()->sh_offset + Offset, nullptr,
+      DILineInfo::FileLineInfoKind::AbsoluteFilePath, Info);
+  if (Info.Line == 0)
+    return "";
+  return Info.FileName + ":" + std::to_string(Info.Line);
+}
+
 template <class ELFT>
-void elf::ObjectFile<ELFT>::parse(DenseSet<StringRef> &ComdatGroups) {
+void elf::ObjectFile<ELFT>::parse(ComdatGroupTable &ComdatGroups) {
   // Read section and symbol tables.
-  initializeSections(ComdatGroups);
+  claimGroups(ComdatGroups);
+  parseGroups(ComdatGroups);
+  parseSections();
+  parseSymbols();
+}
+
+// Registers this file as a claimant for each of its comdat group
+// signatures. A claim records the smallest ordinal seen per
+// signature, so many files can run this function in parallel and in
+// any order without changing which group wins.
+template <class ELFT>
+void elf::ObjectFile<ELFT>::claimGroups(ComdatGroupTable &ComdatGroups) {
+  for (const Elf_Shdr &Sec : this->ELFObj.sections())
+    if (Sec.sh_type == SHT_GROUP)
+      ComdatGroups.claim(getShtGroupSignature(Sec), this->ComdatOrdinal);
+}
+
+// Resolves comdat groups. If two comdat groups have the same
+// signature, only sections of the one in the file with the smallest
+// claim ordinal -- the first one in input order -- are kept. Every
+// file earlier in input order must have claimed its groups by the
+// time this runs; given that, many files can run this function in
+// parallel.
+template <class ELFT>
+void elf::ObjectFile<ELFT>::parseGroups(ComdatGroupTable &ComdatGroups) {
+  uint64_t Size = this->ELFObj.getNumSections();
+  Sections.resize(Size);
+  // Two groups in one file can share a signature. The first of them
+  // wins like everywhere else, which the global table cannot express
+  // because both carry the same ordinal, so track repeats locally.
+  DenseSet<StringRef> Seen;
+  unsigned I = -1;
+  for (const Elf_Shdr &Sec : this->ELFObj.sections()) {
+    ++I;
+    if (Sec.sh_type != SHT_GROUP)
+      continue;
+    Sections[I] = &InputSection<ELFT>::Discarded;
+    StringRef Signature = getShtGroupSignature(Sec);
+    if (ComdatGroups.isOwner(Signature, this->ComdatOrdinal) &&
+        Seen.insert(Signature).second)
+      continue;
+    for (uint32_t SecIndex : getShtGroupEntries(Sec)) {
+      if (SecIndex >= Size)
+        fatal("invalid section index in group");
+      Sections[SecIndex] = &InputSection<ELFT>::Discarded;
+    }
+  }
+}
+
+// Reads section and symbol tables. This reads only this file's own
+// data, so many files can run this function in parallel. parseGroups()
+// must have run for all files by the time this is called.
+template <class ELFT> void elf::ObjectFile<ELFT>::parseSections() {
+  initializeSections();
   initializeSymbols();
 }
 
@@ -186,10 +304,7 @@ template <class ELFT> static bool shouldMerge(const typename ELFT::Shdr &Sec) {
 }
 
 template <class ELFT>
-void elf::ObjectFile<ELFT>::initializeSections(
-    DenseSet<StringRef> &ComdatGroups) {
-  uint64_t Size = this->ELFObj.getNumSections();
-  Sections.resize(Size);
+void elf::ObjectFile<ELFT>::initializeSections() {
   unsigned I = -1;
   const ELFFile<ELFT> &Obj = this->ELFObj;
   for (const Elf_Shdr &Sec : Obj.sections()) {
@@ -199,14 +314,8 @@ void elf::ObjectFile<ELFT>::initializeSections(
 
     switch (Sec.sh_type) {
     case SHT_GROUP:
-      Sections[I] = &InputSection<ELFT>::Discarded;
-      if (ComdatGroups.insert(getShtGroupSignature(Sec)).second)
-        continue;
-      for (uint32_t SecIndex : getShtGroupEntries(Sec)) {
-        if (SecIndex >= Size)
-          fatal("invalid section index in group");
-        Sections[SecIndex] = &InputSection<ELFT>::Discarded;
-      }
+      // Group sections and discarded group members were already
+      // handled by parseGroups().
       break;
     case SHT_SYMTAB:
       this->Symtab = &Sec;
@@ -223,7 +332,7 @@ void elf::ObjectFile<ELFT>::initializeSections(
       // If -r is given, we do not interpret or apply relocation
       // but just copy relocation sections to output.
       if (Config->Relocatable) {
-        Sections[I] = new (IAlloc.Allocate()) InputSection<ELFT>(this, &Sec);
+        Sections[I] = make<InputSection<ELFT>>(this, &Sec);
         break;
       }
 
@@ -294,6 +403,14 @@ elf::ObjectFile<ELFT>::createInputSection(const Elf_Shdr &Sec) {
   if (Config->StripDebug && Name.startswith(".debug"))
     return &InputSection<ELFT>::Discarded;
 
+  // .addrsig is a compiler annotation listing the symbols of this file
+  // whose addresses are taken. It only drives --icf=safe, so keep a
+  // pointer to the header and drop the section from the output.
+  if (Name == ".addrsig") {
+    AddrsigSec = &Sec;
+    return &InputSection<ELFT>::Discarded;
+  }
+
   // A MIPS object file has a special sections that contain register
   // usage info, which need to be handled by the linker specially.
   if (Config->EMachine == EM_MIPS) {
@@ -310,10 +427,10 @@ elf::ObjectFile<ELFT>::createInputSection(const Elf_Shdr &Sec) {
   // We dont need special handling of .eh_frame sections if relocatable
   // output was choosen. Proccess them as usual input sections.
   if (!Config->Relocatable && Name == ".eh_frame")
-    return new (EHAlloc.Allocate()) EhInputSection<ELFT>(this, &Sec);
+    return make<EhInputSection<ELFT>>(this, &Sec);
   if (shouldMerge<ELFT>(Sec))
-    return new (MAlloc.Allocate()) MergeInputSection<ELFT>(this, &Sec);
-  return new (IAlloc.Allocate()) InputSection<ELFT>(this, &Sec);
+    return make<MergeInputSection<ELFT>>(this, &Sec);
+  return make<InputSection<ELFT>>(this, &Sec);
 }
 
 // Print the module names which reference the notified
@@ -324,13 +441,68 @@ void elf::ObjectFile<ELFT>::traceUndefined(StringRef Name) {
     outs() << getFilename(this) << ": reference to " << Name << "\n";
 }
 
+// Creates symbol bodies for local symbols. Locals are not inserted to
+// the symbol table, so this does not depend on other input files and
+// is safe to run concurrently. Slots for global symbols are left null
+// and filled in by parseSymbols().
 template <class ELFT> void elf::ObjectFile<ELFT>::initializeSymbols() {
   this->initStringTable();
   Elf_Sym_Range Syms = this->getElfSymbols(false);
   uint32_t NumSymbols = std::distance(Syms.begin(), Syms.end());
-  SymbolBodies.reserve(NumSymbols);
-  for (const Elf_Sym &Sym : Syms)
-    SymbolBodies.push_back(createSymbolBody(&Sym));
+  initializeSymbolSections(Syms);
+  SymbolBodies.resize(NumSymbols);
+  size_t I = 0;
+  for (const Elf_Sym &Sym : Syms) {
+    if (Sym.getBinding() == STB_LOCAL)
+      SymbolBodies[I] = createSymbolBody(&Sym, I);
+    ++I;
+  }
+}
+
+// Decodes the defining section of every symbol in one sweep over the
+// raw table. Reserved and extended st_shndx values are rare, so the
+// sweep is a tight loop of an index check and two loads per symbol,
+// and createSymbolBody, which runs twice over the table (locals first,
+// globals in parseSymbols), just indexes the result.
+template <class ELFT>
+void elf::ObjectFile<ELFT>::initializeSymbolSections(Elf_Sym_Range Syms) {
+  const Elf_Sym *SymTab = Syms.begin();
+  uint32_t NumSymbols = std::distance(Syms.begin(), Syms.end());
+  uint32_t NumSections = Sections.size();
+  SymSections.resize(NumSymbols);
+
+  for (uint32_t I = 0; I != NumSymbols; ++I) {
+    uint32_t Index = SymTab[I].st_shndx;
+    if (Index >= SHN_LORESERVE) {
+      if (Index == SHN_XINDEX)
+        Index = this->ELFObj.getExtendedSymbolTableIndex(
+            SymTab + I, this->Symtab, this->SymtabSHNDX);
+      else
+        Index = 0;
+    }
+    if (Index == 0) {
+      SymSections[I] = nullptr;
+      continue;
+    }
+    if (Index >= NumSections || !Sections[Index])
+      fatal("invalid section index");
+    InputSectionBase<ELFT> *S = Sections[Index];
+    if (S != &InputSectionBase<ELFT>::Discarded)
+      S = S->Repl;
+    SymSections[I] = S;
+  }
+}
+
+// Resolves global symbols against the symbol table. Which definition
+// wins depends on the order symbols are inserted, so all files run
+// this step serially in input order.
+template <class ELFT> void elf::ObjectFile<ELFT>::parseSymbols() {
+  size_t I = 0;
+  for (const Elf_Sym &Sym : this->getElfSymbols(false)) {
+    if (!SymbolBodies[I])
+      SymbolBodies[I] = createSymbolBody(&Sym, I);
+    ++I;
+  }
 }
 
 template <class ELFT>
@@ -348,13 +520,14 @@ elf::ObjectFile<ELFT>::getSection(const Elf_Sym &Sym) const {
 }
 
 template <class ELFT>
-SymbolBody *elf::ObjectFile<ELFT>::createSymbolBody(const Elf_Sym *Sym) {
+SymbolBody *elf::ObjectFile<ELFT>::createSymbolBody(const Elf_Sym *Sym,
+                                                    size_t I) {
   unsigned char Binding = Sym->getBinding();
-  InputSectionBase<ELFT> *Sec = getSection(*Sym);
+  InputSectionBase<ELFT> *Sec = SymSections[I];
   if (Binding == STB_LOCAL) {
     if (Sym->st_shndx == SHN_UNDEF)
-      return new (Alloc) Undefined(Sym->st_name, Sym->st_other, Sym->getType());
-    return new (Alloc) DefinedRegular<ELFT>(*Sym, Sec);
+      return make<Undefined>(Sym->st_name, Sym->st_other, Sym->getType());
+    return make<DefinedRegular<ELFT>>(*Sym, Sec);
   }
 
   StringRef Name = check(Sym->getName(this->StringTable));
@@ -391,24 +564,145 @@ SymbolBody *elf::ObjectFile<ELFT>::createSymbolBody(const Elf_Sym *Sym) {
 template <class ELFT> void ArchiveFile::parse() {
   File = check(Archive::create(MB), "failed to parse archive");
 
+  // If a valid index cache exists for this archive, feed the symbol
+  // table directly from the mapped cache without walking the archive's
+  // own symbol table again.
+  if (Config->ArchiveCache && readIndexCache<ELFT>())
+    return;
+
   // Read the symbol table to construct Lazy objects.
-  for (const Archive::Symbol &Sym : File->symbols())
-    Symtab<ELFT>::X->addLazyArchive(this, Sym);
+  std::vector<std::pair<StringRef, uint64_t>> Index;
+  for (const Archive::Symbol &Sym : File->symbols()) {
+    Archive::Child C =
+        check(Sym.getMember(),
+              "could not get the member for symbol " + Sym.getName());
+    Index.push_back({Sym.getName(), C.getChildOffset()});
+    Symtab<ELFT>::X->addLazyArchive(this, Sym.getName(), C.getChildOffset());
+  }
+
+  if (Config->ArchiveCache)
+    writeIndexCache(Index);
 }
 
-// Returns a buffer pointing to a member file containing a given symbol.
-MemoryBufferRef ArchiveFile::getMember(const Archive::Symbol *Sym) {
-  Archive::Child C =
-      check(Sym->getMember(),
-            "could not get the member for symbol " + Sym->getName());
+// The index cache is a sidecar file next to the archive. It is a fixed
+// header followed by one record per archive symbol and a string blob
+// the records point into:
+//
+//   char     Magic[8];     // "lldaridx"
+//   uint64_t Size, MTime;  // of the archive when the cache was written
+//   uint64_t NumSymbols;
+//   struct { uint64_t ChildOffset; uint32_t NameOff, NameLen; } [NumSymbols]
+//   char     Names[];
+//
+// Fields are in host byte order; the cache is a private per-machine
+// file, not an artifact that moves between hosts. A stale or malformed
+// cache is silently ignored and rewritten.
+static std::string getIndexCachePath(StringRef ArchivePath) {
+  return (ArchivePath + ".llindex").str();
+}
+
+namespace {
+struct IndexCacheEntry {
+  uint64_t ChildOffset;
+  uint32_t NameOff;
+  uint32_t NameLen;
+};
+}
+
+static const size_t IndexCacheHdrSize = 32;
+
+template <class ELFT> bool ArchiveFile::readIndexCache() {
+  auto MBOrErr =
+      MemoryBuffer::getFile(getIndexCachePath(MB.getBufferIdentifier()), -1,
+                            /*RequiresNullTerminator=*/false);
+  if (!MBOrErr)
+    return false;
+  std::unique_ptr<MemoryBuffer> Cache = std::move(*MBOrErr);
+  StringRef Data = Cache->getBuffer();
+
+  sys::fs::file_status Status;
+  if (sys::fs::status(MB.getBufferIdentifier(), Status))
+    return false;
+
+  if (Data.size() < IndexCacheHdrSize || !Data.startswith("lldaridx"))
+    return false;
+  auto *Hdr = reinterpret_cast<const uint64_t *>(Data.data() + 8);
+  if (Hdr[0] != Status.getSize() ||
+      Hdr[1] != Status.getLastModificationTime().toEpochTime())
+    return false;
+  uint64_t NumSymbols = Hdr[2];
+  if (Data.size() - IndexCacheHdrSize <
+      NumSymbols * sizeof(IndexCacheEntry))
+    return false;
+
+  auto *Entries = reinterpret_cast<const IndexCacheEntry *>(
+      Data.data() + IndexCacheHdrSize);
+  StringRef Names =
+      Data.substr(IndexCacheHdrSize + NumSymbols * sizeof(IndexCacheEntry));
+
+  // Validate all records before handing any of them to the symbol
+  // table so that a truncated cache does not leave behind lazy symbols
+  // pointing into a buffer we are about to discard.
+  for (uint64_t I = 0; I != NumSymbols; ++I)
+    if (uint64_t(Entries[I].NameOff) + Entries[I].NameLen > Names.size())
+      return false;
+
+  for (uint64_t I = 0; I != NumSymbols; ++I)
+    Symtab<ELFT>::X->addLazyArchive(
+        this, Names.substr(Entries[I].NameOff, Entries[I].NameLen),
+        Entries[I].ChildOffset);
+
+  // Symbol names handed to the symbol table point into the cache
+  // buffer, so keep it alive for the duration of the link.
+  IndexCache = std::move(Cache);
+  return true;
+}
+
+void ArchiveFile::writeIndexCache(
+    ArrayRef<std::pair<StringRef, uint64_t>> Syms) {
+  sys::fs::file_status Status;
+  if (sys::fs::status(MB.getBufferIdentifier(), Status))
+    return;
+
+  std::error_code EC;
+  raw_fd_ostream OS(getIndexCachePath(MB.getBufferIdentifier()), EC,
+                    sys::fs::F_None);
+  if (EC)
+    return; // An unwritable directory is not an error; just skip the cache.
+
+  OS << "lldaridx";
+  uint64_t Hdr[3] = {Status.getSize(),
+                     Status.getLastModificationTime().toEpochTime(),
+                     Syms.size()};
+  OS.write(reinterpret_cast<char *>(Hdr), sizeof(Hdr));
+
+  uint32_t NameOff = 0;
+  for (const std::pair<StringRef, uint64_t> &P : Syms) {
+    IndexCacheEntry E = {P.second, NameOff, uint32_t(P.first.size())};
+    OS.write(reinterpret_cast<char *>(&E), sizeof(E));
+    NameOff += E.NameLen;
+  }
+  for (const std::pair<StringRef, uint64_t> &P : Syms)
+    OS << P.first;
+}
 
-  if (!Seen.insert(C.getChildOffset()).second)
+// Returns a buffer pointing to a member file containing a given symbol.
+// The member is identified by its byte offset in the archive so that
+// records read back from the index cache need no Archive::Symbol.
+MemoryBufferRef ArchiveFile::getMember(uint64_t ChildOffset,
+                                       StringRef SymName) {
+  if (!Seen.insert(ChildOffset).second)
     return MemoryBufferRef();
 
+  std::error_code EC;
+  Archive::Child C(File.get(), MB.getBuffer().begin() + ChildOffset, &EC);
+  if (EC)
+    fatal(EC.message(), "could not get the member for symbol " + SymName);
+
   MemoryBufferRef Ret =
       check(C.getMemoryBufferRef(),
             "could not get the buffer for the member defining symbol " +
-                Sym->getName());
+                SymName);
 
   if (C.getParent()->isThin() && Driver->Cpio)
     Driver->Cpio->append(relativeToRoot(check(C.getFullName())),
@@ -457,6 +751,9 @@ template <class ELFT> void SharedFile<ELFT>::parseSoName() {
     case SHT_GNU_verdef:
       this->VerdefSec = &Sec;
       break;
+    case SHT_GNU_HASH:
+      this->GnuHashSec = &Sec;
+      break;
     }
   }
 
@@ -527,6 +824,20 @@ template <class ELFT> void SharedFile<ELFT>::parseRest() {
   const Elf_Versym *Versym = nullptr;
   std::vector<const Elf_Verdef *> Verdefs = parseVerdefs(Versym);
 
+  // With -lazy-dso-symbols, defined symbols stay on disk until a
+  // lookup through the DSO's .gnu.hash table hits them (see
+  // loadSymbol). Undefined symbols are still recorded because
+  // --no-undefined and shlib-undefined scanning need the full list.
+  if (Config->LazyDsoSymbols && GnuHashSec) {
+    IsLazy = true;
+    LazyVersym = Versym;
+    LazyVerdefs = std::move(Verdefs);
+    for (const Elf_Sym &Sym : this->getElfSymbols(true))
+      if (Sym.isUndefined())
+        Undefs.push_back(check(Sym.getName(this->StringTable)));
+    return;
+  }
+
   Elf_Sym_Range Syms = this->getElfSymbols(true);
   for (const Elf_Sym &Sym : Syms) {
     unsigned VersymIndex = 0;
@@ -553,6 +864,90 @@ template <class ELFT> void SharedFile<ELFT>::parseRest() {
   }
 }
 
+// The hash function used by GNU-style hash tables. The same computation
+// feeds our own .gnu.hash writer via SymbolBody::getGnuHash.
+static uint32_t hashGnu(StringRef Name) {
+  uint32_t H = 5381;
+  for (uint8_t C : Name)
+    H = (H << 5) + H + C;
+  return H;
+}
+
+// Looks Name up in this DSO's .gnu.hash table and, if the DSO defines
+// it with a visible default version, enters it into the symbol table.
+// Returns true on a hit. Unlike the dynamic loader we do not bother
+// with the bloom filter: one failed probe per remaining undefined
+// symbol is already cheap.
+template <class ELFT> bool SharedFile<ELFT>::loadSymbol(StringRef Name) {
+  typedef typename ELFT::uint uintX_t;
+  if (!IsLazy)
+    return false;
+
+  // The header is four 32-bit words followed by sizeof(uintX_t)-wide
+  // bloom filter words, the bucket array and the chain values. All of
+  // the sizes and indices below come straight from the file, so check
+  // that the arrays they describe fit inside the section and the
+  // dynamic symbol table before indexing with them.
+  uint64_t Size = GnuHashSec->sh_size;
+  if (Size < 16)
+    fatal(getFilename(this) + ": .gnu.hash is too small");
+  const uint8_t *Base = this->ELFObj.base() + GnuHashSec->sh_offset;
+  auto *Hdr = reinterpret_cast<const Elf_Word *>(Base);
+  uint32_t NBuckets = Hdr[0];
+  uint32_t SymOffset = Hdr[1];
+  uint32_t BloomSize = Hdr[2];
+  Elf_Sym_Range Syms = this->ELFObj.symbols(this->Symtab);
+  uint32_t NumSyms = Syms.end() - Syms.begin();
+  if (NBuckets == 0 || SymOffset > NumSyms)
+    fatal(getFilename(this) + ": malformed .gnu.hash header");
+  uint64_t ChainOff =
+      16 + (uint64_t)BloomSize * sizeof(uintX_t) + (uint64_t)NBuckets * 4;
+  if (ChainOff + (uint64_t)(NumSyms - SymOffset) * 4 > Size)
+    fatal(getFilename(this) + ": .gnu.hash is truncated");
+  auto *Buckets =
+      reinterpret_cast<const Elf_Word *>(Base + 16 + BloomSize * sizeof(uintX_t));
+  const Elf_Word *Chain = Buckets + NBuckets;
+
+  uint32_t H = hashGnu(Name);
+  uint32_t I = Buckets[H % NBuckets];
+  if (I < SymOffset) // Includes I == 0, an empty bucket.
+    return false;
+  if (I >= NumSyms)
+    fatal(getFilename(this) + ": invalid .gnu.hash bucket");
+
+  unsigned FirstGlobal = this->Symtab->sh_info;
+  for (;; ++I) {
+    // The chain entry for every symbol from SymOffset up is in bounds
+    // by the size check above; a walk that runs off the end of the
+    // symbol table means the file's chain-stop bit never came.
+    if (I >= NumSyms)
+      fatal(getFilename(this) + ": unterminated .gnu.hash chain");
+    uint32_t C = Chain[I - SymOffset];
+    if ((C | 1) == (H | 1)) {
+      const Elf_Sym &Sym = *(Syms.begin() + I);
+      if (!Sym.isUndefined() &&
+          check(Sym.getName(this->StringTable)) == Name) {
+        unsigned VersymIndex = 0;
+        if (LazyVersym)
+          VersymIndex = LazyVersym[I - FirstGlobal].vs_index;
+        // Ignore local symbols and non-default versions, but keep
+        // walking the chain: the default version of the same name may
+        // follow a hidden one.
+        if (!LazyVersym ||
+            (VersymIndex != VER_NDX_LOCAL && !(VersymIndex & VERSYM_HIDDEN))) {
+          const Elf_Verdef *V = VersymIndex == VER_NDX_GLOBAL
+                                    ? nullptr
+                                    : LazyVerdefs[VersymIndex];
+          elf::Symtab<ELFT>::X->addShared(this, Name, Sym, V);
+          return true;
+        }
+      }
+    }
+    if (C & 1)
+      return false;
+  }
+}
+
 static ELFKind getELFKind(MemoryBufferRef MB) {
   std::string TripleStr = getBitcodeTargetTriple(MB, Driver->Context);
   Triple TheTriple(TripleStr);
@@ -668,15 +1063,14 @@ bool BitcodeFile::shouldSkip(uint32_t Flags) {
   return false;
 }
 
-template <class ELFT>
-void BitcodeFile::parse(DenseSet<StringRef> &ComdatGroups) {
+template <class ELFT> void BitcodeFile::parse(ComdatGroupTable &ComdatGroups) {
   Obj = check(IRObjectFile::create(MB, Driver->Context));
   const Module &M = Obj->getModule();
 
   DenseSet<const Comdat *> KeptComdats;
   for (const auto &P : M.getComdatSymbolTable()) {
     StringRef N = Saver.save(P.first());
-    if (ComdatGroups.insert(N).second)
+    if (ComdatGroups.claim(N, this->ComdatOrdinal))
       KeptComdats.insert(&P.second);
   }
 
@@ -806,10 +1200,10 @@ template void ArchiveFile::parse<ELF32BE>();
 template void ArchiveFile::parse<ELF64LE>();
 template void ArchiveFile::parse<ELF64BE>();
 
-template void BitcodeFile::parse<ELF32LE>(llvm::DenseSet<StringRef> &);
-template void BitcodeFile::parse<ELF32BE>(llvm::DenseSet<StringRef> &);
-template void BitcodeFile::parse<ELF64LE>(llvm::DenseSet<StringRef> &);
-template void BitcodeFile::parse<ELF64BE>(llvm::DenseSet<StringRef> &);
+template void BitcodeFile::parse<ELF32LE>(ComdatGroupTable &);
+template void BitcodeFile::parse<ELF32BE>(ComdatGroupTable &);
+template void BitcodeFile::parse<ELF64LE>(ComdatGroupTable &);
+template void BitcodeFile::parse<ELF64BE>(ComdatGroupTable &);
 
 template void LazyObjectFile::parse<ELF32LE>();
 template void LazyObjectFile::parse<ELF32BE>();
@@ -18,19 +18,21 @@
 #include "lld/Core/LLVM.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/DebugInfo/DWARF/DWARFDebugLine.h"
 #include "llvm/IR/Comdat.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/ELF.h"
 #include "llvm/Object/IRObjectFile.h"
 #include "llvm/Support/StringSaver.h"
 
-#include <map>
+#include <mutex>
 
 namespace lld {
 namespace elf {
 
 using llvm::object::Archive;
 
+class ComdatGroupTable;
 class InputFile;
 class Lazy;
 class SymbolBody;
@@ -61,6 +63,12 @@ public:
   ELFKind EKind = ELFNoneKind;
   uint16_t EMachine = llvm::ELF::EM_NONE;
 
+  // Position of this file for comdat group resolution: of two groups
+  // with the same signature, the one whose file has the smaller
+  // ordinal wins. Assigned by the symbol table in input order before
+  // any group is claimed.
+  uint32_t ComdatOrdinal = -1;
+
 protected:
   InputFile(Kind K, MemoryBufferRef M) : MB(M), FileKind(K) {}
 
@@ -127,7 +135,21 @@ public:
   ArrayRef<SymbolBody *> getNonLocalSymbols();
 
   explicit ObjectFile(MemoryBufferRef M);
-  void parse(llvm::DenseSet<StringRef> &ComdatGroups);
+  void parse(ComdatGroupTable &ComdatGroups);
+
+  // parse() is equivalent to calling the following four functions in
+  // order. claimGroups() registers this file as a claimant for its
+  // comdat group signatures and may run concurrently with other
+  // files' claims. parseGroups() resolves group ownership; it
+  // requires every file earlier in input order to have claimed, but
+  // may then run concurrently with other files. parseSections() reads
+  // only this file's own data and may run concurrently with other
+  // files' parseSections() calls. Global symbol resolution depends on
+  // input order, so parseSymbols() must run serially.
+  void claimGroups(ComdatGroupTable &ComdatGroups);
+  void parseGroups(ComdatGroupTable &ComdatGroups);
+  void parseSections();
+  void parseSymbols();
 
   ArrayRef<InputSectionBase<ELFT> *> getSections() const { return Sections; }
   InputSectionBase<ELFT> *getSection(const Elf_Sym &Sym) const;
@@ -143,6 +165,10 @@ public:
 
   const Elf_Shdr *getSymbolTable() const { return this->Symtab; };
 
+  // A .addrsig section, if this file has one. It lists the symbols
+  // whose addresses are significant and is consumed by --icf=safe.
+  const Elf_Shdr *AddrsigSec = nullptr;
+
   void traceUndefined(StringRef Name);
 
   // Get MIPS GP0 value defined by this file. This value represents the gp value
@@ -150,17 +176,29 @@ public:
   // R_MIPS_GPREL16 / R_MIPS_GPREL32 relocations.
   uint32_t getMipsGp0() const;
 
+  // Returns the source location of the given offset in the given
+  // section as "file:line", or the empty string if this file has no
+  // usable .debug_line. For diagnostics only; never called on a clean
+  // link.
+  std::string getLineInfo(InputSectionBase<ELFT> *S, uint64_t Offset);
+
+  // Ensures .debug_line has been decoded. Thread safe and idempotent,
+  // so a diagnostic that names several files can spawn their decodes
+  // concurrently before formatting its message.
+  void decodeDwarfLine();
+
   // The number is the offset in the string table. It will be used as the
   // st_name of the symbol.
-  std::vector<std::pair<const DefinedRegular<ELFT> *, unsigned>> KeptLocalSyms;
+  std::vector<std::pair<DefinedRegular<ELFT> *, unsigned>> KeptLocalSyms;
 
 private:
-  void initializeSections(llvm::DenseSet<StringRef> &ComdatGroups);
+  void initializeSections();
   void initializeSymbols();
+  void initializeSymbolSections(Elf_Sym_Range Syms);
   InputSectionBase<ELFT> *getRelocTarget(const Elf_Shdr &Sec);
   InputSectionBase<ELFT> *createInputSection(const Elf_Shdr &Sec);
 
-  SymbolBody *createSymbolBody(const Elf_Sym *Sym);
+  SymbolBody *createSymbolBody(const Elf_Sym *Sym, size_t I);
 
   // List of all sections defined by this file.
   std::vector<InputSectionBase<ELFT> *> Sections;
@@ -168,15 +206,24 @@ private:
   // List of all symbols referenced or defined by this file.
   std::vector<SymbolBody *> SymbolBodies;
 
+  // The defining section of each symbol, indexed like SymbolBodies.
+  // Decoded from the raw symbol table in one sweep so that body
+  // creation, which walks the table twice (locals first, then globals),
+  // does not redo the per-symbol section lookup.
+  std::vector<InputSectionBase<ELFT> *> SymSections;
+
+  // The decoded .debug_line of this file, filled in lazily by
+  // decodeDwarfLine() the first time a diagnostic needs a source
+  // location.
+  void initializeDwarfLine();
+  std::unique_ptr<llvm::DWARFDebugLine> DwarfLine;
+  std::once_flag DwarfLineOnce;
+
   // MIPS .reginfo section defined by this file.
   std::unique_ptr<MipsReginfoInputSection<ELFT>> MipsReginfo;
   // MIPS .MIPS.options section defined by this file.
   std::unique_ptr<MipsOptionsInputSection<ELFT>> MipsOptions;
 
-  llvm::BumpPtrAllocator Alloc;
-  llvm::SpecificBumpPtrAllocator<InputSection<ELFT>> IAlloc;
-  llvm::SpecificBumpPtrAllocator<MergeInputSection<ELFT>> MAlloc;
-  llvm::SpecificBumpPtrAllocator<EhInputSection<ELFT>> EHAlloc;
 };
 
 // LazyObjectFile is analogous to ArchiveFile in the sense that
@@ -214,22 +261,29 @@ public:
   static bool classof(const InputFile *F) { return F->kind() == ArchiveKind; }
   template <class ELFT> void parse();
 
-  // Returns a memory buffer for a given symbol. An empty memory buffer
-  // is returned if we have already returned the same memory buffer.
-  // (So that we don't instantiate same members more than once.)
-  MemoryBufferRef getMember(const Archive::Symbol *Sym);
+  // Returns a memory buffer for the member at a given offset. An empty
+  // memory buffer is returned if we have already returned the same
+  // memory buffer. (So that we don't instantiate same members more
+  // than once.) SymName is used only for error messages.
+  MemoryBufferRef getMember(uint64_t ChildOffset, StringRef SymName);
 
 private:
+  template <class ELFT> bool readIndexCache();
+  void writeIndexCache(llvm::ArrayRef<std::pair<StringRef, uint64_t>> Syms);
+
   std::unique_ptr<Archive> File;
   llvm::DenseSet<uint64_t> Seen;
+
+  // Keeps a memory-mapped .llindex sidecar (and the symbol names
+  // pointing into it) alive for the duration of the link.
+  std::unique_ptr<MemoryBuffer> IndexCache;
 };
 
 class BitcodeFile : public InputFile {
 public:
   explicit BitcodeFile(MemoryBufferRef M);
   static bool classof(const InputFile *F) { return F->kind() == BitcodeKind; }
-  template <class ELFT>
-  void parse(llvm::DenseSet<StringRef> &ComdatGroups);
+  template <class ELFT> void parse(ComdatGroupTable &ComdatGroups);
   ArrayRef<Symbol *> getSymbols() { return Symbols; }
   static bool shouldSkip(uint32_t Flags);
   std::unique_ptr<llvm::object::IRObjectFile> Obj;
@@ -258,11 +312,19 @@ template <class ELFT> class SharedFile : public ELFFileBase<ELFT> {
   StringRef SoName;
   const Elf_Shdr *VersymSec = nullptr;
   const Elf_Shdr *VerdefSec = nullptr;
+  const Elf_Shdr *GnuHashSec = nullptr;
+
+  // Set when -lazy-dso-symbols left this file's definitions on disk.
+  // loadSymbol materializes them on demand through GnuHashSec.
+  bool IsLazy = false;
+  const Elf_Versym *LazyVersym = nullptr;
+  std::vector<const Elf_Verdef *> LazyVerdefs;
 
 public:
   StringRef getSoName() const { return SoName; }
   const Elf_Shdr *getSection(const Elf_Sym &Sym) const;
   llvm::ArrayRef<StringRef> getUndefinedSymbols() { return Undefs; }
+  bool loadSymbol(StringRef Name);
 
   static bool classof(const InputFile *F) {
     return F->kind() == Base::SharedKind;
@@ -276,15 +338,25 @@ public:
 
   struct NeededVer {
     // The string table offset of the version name in the output file.
-    size_t StrTab;
+    size_t StrTab = 0;
+
+    // The version identifier for this version name. 0 means the output
+    // does not reference this version.
+    uint16_t Index = 0;
 
-    // The version identifier for this version name.
-    uint16_t Index;
+    // vd_hash of the version definition, cached so that writing the
+    // Elf_Vernaux does not go back to the input verdef.
+    uint32_t Hash = 0;
   };
 
-  // Mapping from Elf_Verdef data structures to information about Elf_Vernaux
-  // data structures in the output file.
-  std::map<const Elf_Verdef *, NeededVer> VerdefMap;
+  // Information about the Elf_Vernaux records the output needs for this
+  // DSO's version definitions, indexed by verdef identifier (vd_ndx).
+  // Grown on demand by VersionNeedSection::addSymbol.
+  std::vector<NeededVer> NeededVers;
+
+  // The number of referenced versions, i.e. the number of Elf_Vernaux
+  // records this DSO contributes to .gnu.version_r.
+  unsigned VernauxNum = 0;
 
   // Used for --as-needed
   bool AsNeeded = false;
@@ -9,12 +9,15 @@
 
 #include "InputSection.h"
 #include "Config.h"
+#include "Counters.h"
 #include "EhFrame.h"
 #include "Error.h"
 #include "InputFiles.h"
+#include "LinkerScript.h"
 #include "OutputSections.h"
 #include "Target.h"
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Endian.h"
 
@@ -62,6 +65,26 @@ ArrayRef<uint8_t> InputSectionBase<ELFT>::getSectionData() const {
 
 template <class ELFT>
 typename ELFT::uint InputSectionBase<ELFT>::getOffset(uintX_t Offset) const {
+  // Fast path: once finalizeOffsetMap has flattened the translation,
+  // every section kind is handled by the same run lookup and the
+  // dispatch below is dead. Nearly all translations happen after
+  // layout (one per relocation and per symbol during writing), so this
+  // is the path that matters.
+  if (size_t N = OffsetMap.size()) {
+    LLD_COUNT(OffsetLookupHits);
+    const OffsetRun *Run = &OffsetMap[0];
+    if (N > 1) {
+      auto I = std::upper_bound(
+          OffsetMap.begin(), OffsetMap.end(), Offset,
+          [](uint64_t A, const OffsetRun &R) { return A < R.InputOff; });
+      Run = &I[-1];
+    }
+    if (Run->Delta == uint64_t(-1))
+      return -1; // Not in the output.
+    return Run->Delta + Offset;
+  }
+
+  LLD_COUNT(OffsetLookupMisses);
   switch (SectionKind) {
   case Regular:
     return cast<InputSection<ELFT>>(this)->OutSecOff + Offset;
@@ -83,6 +106,42 @@ typename ELFT::uint InputSectionBase<ELFT>::getOffset(uintX_t Offset) const {
   llvm_unreachable("invalid section kind");
 }
 
+// Flattens the offset translation state of this section into OffsetMap
+// so that getOffset becomes one uniform lookup instead of a dispatch
+// over section kinds. Must not be called before layout is final, i.e.
+// before OutSecOff and every piece's OutputOff have their final
+// values. MIPS .reginfo and .MIPS.options stay on the fallback path
+// because their translation is not an offset computation (it fatals on
+// interior offsets).
+template <class ELFT> void InputSectionBase<ELFT>::finalizeOffsetMap() {
+  switch (SectionKind) {
+  case Regular:
+    OffsetMap.assign(1, {0, cast<InputSection<ELFT>>(this)->OutSecOff});
+    return;
+  case EHFrame:
+    // An empty .eh_frame is translated as the identity; see getOffset.
+    if (Header->sh_size == 0) {
+      OffsetMap.assign(1, {0, 0});
+      return;
+    }
+  // fallthrough
+  case Merge: {
+    auto *S = static_cast<SplitInputSection<ELFT> *>(this);
+    OffsetMap.reserve(S->Pieces.size());
+    for (SectionPiece &Piece : S->Pieces) {
+      uint64_t Delta = -1;
+      if (Piece.Live && Piece.OutputOff != size_t(-1))
+        Delta = Piece.OutputOff - Piece.InputOff;
+      OffsetMap.push_back({Piece.InputOff, Delta});
+    }
+    return;
+  }
+  case MipsReginfo:
+  case MipsOptions:
+    return;
+  }
+}
+
 template <class ELFT> void InputSectionBase<ELFT>::uncompress() {
   typedef typename std::conditional<ELFT::Is64Bits, Elf64_Chdr,
                                     Elf32_Chdr>::type Elf_Chdr;
@@ -133,7 +192,10 @@ template <class ELFT> void InputSection<ELFT>::addThunk(SymbolBody &Body) {
 }
 
 template <class ELFT> uint64_t InputSection<ELFT>::getThunkOff() const {
-  return this->Header->sh_size;
+  // Thunks hold instructions, so keep the island aligned even after a
+  // section whose size is not a multiple of the instruction size
+  // (e.g. Thumb code).
+  return alignTo(this->Header->sh_size, 4);
 }
 
 template <class ELFT> uint64_t InputSection<ELFT>::getThunksSize() const {
@@ -291,13 +353,32 @@ template <class ELFT>
 template <class RelTy>
 void InputSection<ELFT>::relocateNonAlloc(uint8_t *Buf, ArrayRef<RelTy> Rels) {
   const unsigned Bits = sizeof(uintX_t) * 8;
+  size_t N = Rels.size();
+
+  // Decode every relocation's target offset and addend in one forward
+  // sweep first. On REL targets the addend lives in the section bytes,
+  // and interleaving those data-dependent loads with the fixup stores
+  // to the same buffer in the loop below defeats the hardware
+  // prefetcher; debug info on REL architectures carries a lot of these.
+  std::vector<uintX_t> Offsets(N);
+  std::vector<uintX_t> Addends(N);
+  size_t I = 0;
+  for (const RelTy &Rel : Rels) {
+    Offsets[I] = this->getOffset(Rel.r_offset);
+    Addends[I] = getAddend<ELFT>(Rel);
+    if (!RelTy::IsRela)
+      Addends[I] += Target->getImplicitAddend(
+          Buf + Offsets[I], Rel.getType(Config->Mips64EL));
+    ++I;
+  }
+
+  I = 0;
   for (const RelTy &Rel : Rels) {
     uint32_t Type = Rel.getType(Config->Mips64EL);
-    uintX_t Offset = this->getOffset(Rel.r_offset);
+    uintX_t Offset = Offsets[I];
     uint8_t *BufLoc = Buf + Offset;
-    uintX_t Addend = getAddend<ELFT>(Rel);
-    if (!RelTy::IsRela)
-      Addend += Target->getImplicitAddend(BufLoc, Type);
+    uintX_t Addend = Addends[I];
+    ++I;
 
     SymbolBody &Sym = this->File->getRelocTargetSym(Rel);
     if (Target->getRelExpr(Type, Sym) != R_ABS) {
@@ -329,6 +410,21 @@ void InputSectionBase<ELFT>::relocate(uint8_t *Buf, uint8_t *BufEnd) {
   }
 
   const unsigned Bits = sizeof(uintX_t) * 8;
+
+  // Relocations are applied in two passes. The first pass evaluates
+  // each relocation's expression to its final value and emits a flat
+  // structure-of-arrays record of (offset, type, value). Relaxations
+  // and other instruction rewrites are rare and are applied right away.
+  // Note that getSymVA never reads section contents, so resolving all
+  // expressions before writing anything is safe.
+  size_t N = Relocations.size();
+  std::vector<uint64_t> Offsets;
+  std::vector<uint32_t> Types;
+  std::vector<uint64_t> Vals;
+  Offsets.reserve(N);
+  Types.reserve(N);
+  Vals.reserve(N);
+
   for (const Relocation<ELFT> &Rel : Relocations) {
     uintX_t Offset = Rel.InputSec->getOffset(Rel.Offset);
     uint8_t *BufLoc = Buf + Offset;
@@ -340,37 +436,66 @@ void InputSectionBase<ELFT>::relocate(uint8_t *Buf, uint8_t *BufEnd) {
     uint64_t SymVA = SignExtend64<Bits>(
         getSymVA<ELFT>(Type, A, AddrLoc, *Rel.Sym, BufLoc, *File, Expr));
 
+    // TLS relaxation rewrites were decided during scanRelocations and
+    // recorded as opcodes, so they are applied directly instead of
+    // being re-derived from the (expression, type) pair here.
+    if (Rel.RelaxOp != TLSOP_NONE) {
+      Target->relaxTls(BufLoc, Rel.RelaxOp, SymVA);
+      continue;
+    }
+
     switch (Expr) {
     case R_RELAX_GOT_PC:
     case R_RELAX_GOT_PC_NOPIC:
       Target->relaxGot(BufLoc, SymVA);
-      break;
-    case R_RELAX_TLS_IE_TO_LE:
-      Target->relaxTlsIeToLe(BufLoc, Type, SymVA);
-      break;
-    case R_RELAX_TLS_LD_TO_LE:
-      Target->relaxTlsLdToLe(BufLoc, Type, SymVA);
-      break;
-    case R_RELAX_TLS_GD_TO_LE:
-    case R_RELAX_TLS_GD_TO_LE_NEG:
-      Target->relaxTlsGdToLe(BufLoc, Type, SymVA);
-      break;
-    case R_RELAX_TLS_GD_TO_IE:
-    case R_RELAX_TLS_GD_TO_IE_ABS:
-    case R_RELAX_TLS_GD_TO_IE_PAGE_PC:
-    case R_RELAX_TLS_GD_TO_IE_END:
-      Target->relaxTlsGdToIe(BufLoc, Type, SymVA);
-      break;
+      continue;
     case R_PPC_PLT_OPD:
       // Patch a nop (0x60000000) to a ld.
       if (BufLoc + 8 <= BufEnd && read32be(BufLoc + 4) == 0x60000000)
         write32be(BufLoc + 4, 0xe8410028); // ld %r2, 40(%r1)
       // fallthrough
     default:
-      Target->relocateOne(BufLoc, Type, SymVA);
+      Offsets.push_back(Offset);
+      Types.push_back(Type);
+      Vals.push_back(SymVA);
       break;
     }
   }
+
+  // The second pass patches the section bytes. Relocations of one type
+  // come in long runs in practice, so dispatch each maximal run with a
+  // single relocateMany call; targets provide non-virtual kernels for
+  // their hottest types.
+  for (size_t I = 0, E = Types.size(); I != E;) {
+    size_t RunEnd = I + 1;
+    while (RunEnd != E && Types[RunEnd] == Types[I])
+      ++RunEnd;
+    Target->relocateMany(Buf, Types[I], Offsets.data() + I, Vals.data() + I,
+                         RunEnd - I);
+    I = RunEnd;
+  }
+}
+
+// Copies section contents into the output buffer, skipping the store
+// for cache-line-sized runs of zero bytes. The output is a freshly
+// created file, so its pages read as zeros until first stored to;
+// skipping the stores leaves identical contents while keeping the
+// pages under long zero runs clean, so zero-initialized data emitted
+// as progbits costs neither memory bandwidth nor writeback. The zero
+// scan only reads the source, which the copy has to do anyway, and
+// compiles to the same vectorizable pattern as the copy itself.
+static void copyOrSkipZeros(uint8_t *Dst, ArrayRef<uint8_t> Data) {
+  const uint8_t *Src = Data.data();
+  size_t Size = Data.size();
+  size_t I = 0;
+  for (; I + 64 <= Size; I += 64) {
+    uint64_t W[8];
+    memcpy(W, Src + I, 64);
+    if (W[0] | W[1] | W[2] | W[3] | W[4] | W[5] | W[6] | W[7])
+      memcpy(Dst + I, Src + I, 64);
+  }
+  if (I != Size)
+    memcpy(Dst + I, Src + I, Size - I);
 }
 
 template <class ELFT> void InputSection<ELFT>::writeTo(uint8_t *Buf) {
@@ -388,9 +513,15 @@ template <class ELFT> void InputSection<ELFT>::writeTo(uint8_t *Buf) {
     return;
   }
 
-  // Copy section contents from source object file to output file.
+  // Copy section contents from source object file to output file. If a
+  // linker script installed a fill pattern under this section, the zero
+  // bytes must overwrite it, so the sparse copy is only valid when the
+  // destination still holds the file's initial zeros.
   ArrayRef<uint8_t> Data = this->getSectionData();
-  memcpy(Buf + OutSecOff, Data.data(), Data.size());
+  if (Script<ELFT>::X->getFiller(this->OutSec->getName()).empty())
+    copyOrSkipZeros(Buf + OutSecOff, Data);
+  else
+    memcpy(Buf + OutSecOff, Data.data(), Data.size());
 
   // Iterate over all relocation sections that apply to this section.
   uint8_t *BufEnd = Buf + OutSecOff + Data.size();
@@ -469,11 +600,27 @@ typename ELFT::uint EhInputSection<ELFT>::getOffset(uintX_t Offset) const {
 }
 
 static size_t findNull(ArrayRef<uint8_t> A, size_t EntSize) {
-  // Optimize the common case.
-  StringRef S((const char *)A.data(), A.size());
-  if (EntSize == 1)
-    return S.find(0);
+  // Optimize the common case: scan eight bytes at a time. A word W
+  // contains a zero byte iff (W - 0x0101..) & ~W & 0x8080.. is
+  // non-zero; this compiles to the same vectorizable pattern that
+  // libc memchr implementations use.
+  if (EntSize == 1) {
+    const uint8_t *P = A.data();
+    size_t Size = A.size();
+    size_t I = 0;
+    for (; I + 8 <= Size; I += 8) {
+      uint64_t W;
+      memcpy(&W, P + I, 8);
+      if ((W - 0x0101010101010101ULL) & ~W & 0x8080808080808080ULL)
+        break;
+    }
+    for (; I != Size; ++I)
+      if (P[I] == 0)
+        return I;
+    return StringRef::npos;
+  }
 
+  StringRef S((const char *)A.data(), A.size());
   for (unsigned I = 0, N = S.size(); I != N; I += EntSize) {
     const char *B = S.begin() + I;
     if (std::all_of(B, B + EntSize, [](char C) { return C == 0; }))
@@ -482,8 +629,13 @@ static size_t findNull(ArrayRef<uint8_t> A, size_t EntSize) {
   return StringRef::npos;
 }
 
+static uint32_t hashPiece(ArrayRef<uint8_t> Data) {
+  return llvm::HashString(StringRef((const char *)Data.data(), Data.size()));
+}
+
 // Split SHF_STRINGS section. Such section is a sequence of
-// null-terminated strings.
+// null-terminated strings. Each piece is hashed while its bytes are
+// still cache-hot so that merging never has to re-read the contents.
 static std::vector<SectionPiece> splitStrings(ArrayRef<uint8_t> Data,
                                               size_t EntSize) {
   std::vector<SectionPiece> V;
@@ -493,7 +645,8 @@ static std::vector<SectionPiece> splitStrings(ArrayRef<uint8_t> Data,
     if (End == StringRef::npos)
       fatal("string is not null terminated");
     size_t Size = End + EntSize;
-    V.emplace_back(Off, Data.slice(0, Size));
+    ArrayRef<uint8_t> Piece = Data.slice(0, Size);
+    V.emplace_back(Off, Piece, hashPiece(Piece));
     Data = Data.slice(Size);
     Off += Size;
   }
@@ -507,8 +660,10 @@ static std::vector<SectionPiece> splitNonStrings(ArrayRef<uint8_t> Data,
   std::vector<SectionPiece> V;
   size_t Size = Data.size();
   assert((Size % EntSize) == 0);
-  for (unsigned I = 0, N = Size; I != N; I += EntSize)
-    V.emplace_back(I, Data.slice(I, EntSize));
+  for (unsigned I = 0, N = Size; I != N; I += EntSize) {
+    ArrayRef<uint8_t> Piece = Data.slice(I, EntSize);
+    V.emplace_back(I, Piece, hashPiece(Piece));
+  }
   return V;
 }
 
@@ -564,33 +719,27 @@ SplitInputSection<ELFT>::getSectionPiece(uintX_t Offset) const {
 // it is not just an addition to a base output offset.
 template <class ELFT>
 typename ELFT::uint MergeInputSection<ELFT>::getOffset(uintX_t Offset) const {
-  auto It = OffsetMap.find(Offset);
-  if (It != OffsetMap.end())
-    return It->second;
-
-  // If Offset is not at beginning of a section piece, it is not in the map.
-  // In that case we need to search from the original section piece vector.
+  // Pieces are sorted by input offset, so a binary search over the
+  // piece vector is all we need. This used to go through a
+  // DenseMap with one entry per piece, which cost two words of memory
+  // per string and a hash lookup per relocation for no gain over the
+  // search that was needed for interior offsets anyway.
   const SectionPiece &Piece = *this->getSectionPiece(Offset);
   assert(Piece.Live);
   uintX_t Addend = Offset - Piece.InputOff;
   return Piece.OutputOff + Addend;
 }
 
-// Create a map from input offsets to output offsets for all section pieces.
-// It is called after finalize().
+// Compute lazily-assigned output offsets. It is called after finalize().
 template <class ELFT> void  MergeInputSection<ELFT>::finalizePieces() {
-  OffsetMap.grow(this->Pieces.size());
   for (SectionPiece &Piece : this->Pieces) {
-    if (!Piece.Live)
+    if (!Piece.Live || Piece.OutputOff != size_t(-1))
       continue;
-    if (Piece.OutputOff == size_t(-1)) {
-      // Offsets of tail-merged strings are computed lazily.
-      auto *OutSec = static_cast<MergeOutputSection<ELFT> *>(this->OutSec);
-      ArrayRef<uint8_t> D = Piece.data();
-      StringRef S((const char *)D.data(), D.size());
-      Piece.OutputOff = OutSec->getOffset(S);
-    }
-    OffsetMap[Piece.InputOff] = Piece.OutputOff;
+    // Offsets of tail-merged strings are computed lazily.
+    auto *OutSec = static_cast<MergeOutputSection<ELFT> *>(this->OutSec);
+    ArrayRef<uint8_t> D = Piece.data();
+    StringRef S((const char *)D.data(), D.size());
+    Piece.OutputOff = OutSec->getOffset(S);
   }
 }
 
@@ -16,6 +16,8 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Object/ELF.h"
+#include <atomic>
+#include <mutex>
 
 namespace lld {
 namespace elf {
@@ -28,6 +30,16 @@ template <class ELFT> class ObjectFile;
 template <class ELFT> class OutputSection;
 template <class ELFT> class OutputSectionBase;
 
+// A run of input section bytes that lands contiguously in the output
+// section. Delta is the output offset minus the input offset of the
+// run start, so translating any offset inside the run is a single
+// addition. A Delta of -1 marks a run that is not copied to the output
+// (e.g. a dropped .eh_frame record).
+struct OffsetRun {
+  uint64_t InputOff;
+  uint64_t Delta;
+};
+
 // This corresponds to a section of an input file.
 template <class ELFT> class InputSectionBase {
 protected:
@@ -55,8 +67,9 @@ public:
   OutputSectionBase<ELFT> *OutSec = nullptr;
   uint32_t Alignment;
 
-  // Used for garbage collection.
-  bool Live;
+  // Used for garbage collection. Atomic so that concurrent marking
+  // tasks can claim a section with exchange().
+  std::atomic<bool> Live;
 
   // This pointer points to the "real" instance of this instance.
   // Usually Repl == this. However, if ICF merges two sections,
@@ -79,6 +92,17 @@ public:
   // section.
   uintX_t getOffset(uintX_t Offset) const;
 
+  // Flattens this section's input-to-output offset translation into
+  // OffsetMap. Called once layout is final.
+  void finalizeOffsetMap();
+
+  // One run per contiguous range of bytes that lands contiguously in
+  // the output section: a single run based at OutSecOff for a plain
+  // section, one run per piece for a split section. Built by
+  // finalizeOffsetMap after layout; while empty, getOffset falls back
+  // to the kind-specific translation.
+  std::vector<OffsetRun> OffsetMap;
+
   ArrayRef<uint8_t> getSectionData() const;
 
   void uncompress();
@@ -93,9 +117,9 @@ template <class ELFT> InputSectionBase<ELFT> InputSectionBase<ELFT>::Discarded;
 
 // SectionPiece represents a piece of splittable section contents.
 struct SectionPiece {
-  SectionPiece(size_t Off, ArrayRef<uint8_t> Data)
-      : InputOff(Off), Data((const uint8_t *)Data.data()), Size(Data.size()),
-        Live(!Config->GcSections) {}
+  SectionPiece(size_t Off, ArrayRef<uint8_t> Data, uint32_t Hash = 0)
+      : InputOff(Off), Hash(Hash), Data((const uint8_t *)Data.data()),
+        Size(Data.size()), Live(!Config->GcSections) {}
 
   ArrayRef<uint8_t> data() { return {Data, Size}; }
   size_t size() const { return Size; }
@@ -103,6 +127,11 @@ struct SectionPiece {
   size_t InputOff;
   size_t OutputOff = -1;
 
+  // Content hash, filled in when a mergeable section is split into
+  // pieces. Merging uses it for shard selection so that piece
+  // contents are hashed only once.
+  uint32_t Hash;
+
 private:
   // We use bitfields because SplitInputSection is accessed by
   // std::upper_bound very often.
@@ -147,7 +176,11 @@ public:
   void splitIntoPieces();
 
   // Mark the piece at a given offset live. Used by GC.
-  void markLiveAt(uintX_t Offset) { LiveOffsets.insert(Offset); }
+  // May be called from several marking tasks at once.
+  void markLiveAt(uintX_t Offset) {
+    std::lock_guard<std::mutex> Lock(LiveOffsetsMutex);
+    LiveOffsets.insert(Offset);
+  }
 
   // Translate an offset in the input section to an offset
   // in the output section.
@@ -156,7 +189,7 @@ public:
   void finalizePieces();
 
 private:
-  llvm::DenseMap<uintX_t, uintX_t> OffsetMap;
+  std::mutex LiveOffsetsMutex;
   llvm::DenseSet<uintX_t> LiveOffsets;
 };
 
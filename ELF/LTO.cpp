@@ -28,6 +28,9 @@
 #include "llvm/LTO/UpdateCompilerUsed.h"
 #include "llvm/Linker/IRMover.h"
 #include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Target/TargetMachine.h"
@@ -253,9 +256,100 @@ static void internalize(GlobalValue &GV) {
   GV.setLinkage(GlobalValue::InternalLinkage);
 }
 
+// Returns the path of the cache entry holding partition I of the
+// combined module identified by Key.
+static std::string getCachePath(StringRef Key, unsigned I) {
+  SmallString<128> Path = Config->LtoCacheDir;
+  sys::path::append(Path, Key + "." + Twine(I) + ".o");
+  return Path.str();
+}
+
+// Computes the name identifying the cached codegen results for the
+// combined module: a hash of its optimized bitcode and of the
+// configuration values that affect the code we generate from it.
+static std::string computeCacheKey(Module &M) {
+  SmallString<0> Buf;
+  raw_svector_ostream OS(Buf);
+  WriteBitcodeToFile(&M, OS, /* ShouldPreserveUseListOrder */ true);
+
+  MD5 Hash;
+  Hash.update(Buf);
+  Hash.update(M.getTargetTriple());
+  Hash.update("O" + utostr(Config->LtoO) + " jobs=" + utostr(Config->LtoJobs) +
+              (Config->Pic ? " pic" : " static"));
+
+  MD5::MD5Result Res;
+  Hash.final(Res);
+  SmallString<32> Key;
+  MD5::stringifyResult(Res, Key);
+  return Key.str();
+}
+
+// Maps the object files cached for the combined module back in, if
+// every partition is present. The buffers are mmaped, so a cache hit
+// replaces codegen with a few page table entries.
+bool BitcodeCompiler::loadCachedObjects(unsigned NumThreads) {
+  std::vector<std::unique_ptr<MemoryBuffer>> MBs;
+  for (unsigned I = 0; I < NumThreads; ++I) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = MemoryBuffer::getFile(
+        getCachePath(CacheKey, I), -1, /* RequiresNullTerminator */ false);
+    if (!MBOrErr)
+      return false;
+    MBs.push_back(std::move(*MBOrErr));
+  }
+  CachedObjs = std::move(MBs);
+  return true;
+}
+
+// Stores the objects produced by codegen so that later links of the
+// same module can reuse them. Entries are written to a temporary file
+// and renamed into place so that a concurrent link never sees a
+// half-written object. Failing to populate the cache only costs the
+// next link a recompile, so it is a warning, not an error.
+void BitcodeCompiler::storeCachedObjects() {
+  if (std::error_code EC = sys::fs::create_directories(Config->LtoCacheDir)) {
+    warning("cannot create LTO cache directory " + Config->LtoCacheDir + ": " +
+            EC.message());
+    return;
+  }
+  for (unsigned I = 0, E = OwningData.size(); I != E; ++I) {
+    std::string Path = getCachePath(CacheKey, I);
+    int FD;
+    SmallString<128> Temp;
+    if (std::error_code EC =
+            sys::fs::createUniqueFile(Path + ".tmp%%%%%%", FD, Temp)) {
+      warning("cannot write LTO cache entry " + Path + ": " + EC.message());
+      return;
+    }
+    raw_fd_ostream OS(FD, /* shouldClose */ true);
+    OS << OwningData[I];
+    OS.close();
+    if (std::error_code EC = sys::fs::rename(Temp, Path)) {
+      sys::fs::remove(Temp);
+      warning("cannot write LTO cache entry " + Path + ": " + EC.message());
+      return;
+    }
+  }
+}
+
 std::vector<std::unique_ptr<InputFile>> BitcodeCompiler::runSplitCodegen(
     const std::function<std::unique_ptr<TargetMachine>()> &TMFactory) {
   unsigned NumThreads = Config->LtoJobs;
+
+  // With a cache directory, codegen results are keyed by the hash of
+  // the optimized module and reused whenever nothing feeding into them
+  // has changed, so relinks with unchanged bitcode skip codegen
+  // entirely.
+  if (!Config->LtoCacheDir.empty()) {
+    CacheKey = computeCacheKey(*Combined);
+    if (loadCachedObjects(NumThreads)) {
+      std::vector<std::unique_ptr<InputFile>> ObjFiles;
+      for (std::unique_ptr<MemoryBuffer> &MB : CachedObjs)
+        ObjFiles.push_back(createObjectFile(MB->getMemBufferRef()));
+      return ObjFiles;
+    }
+  }
+
   OwningData.resize(NumThreads);
 
   std::list<raw_svector_ostream> OSs;
@@ -267,6 +361,9 @@ std::vector<std::unique_ptr<InputFile>> BitcodeCompiler::runSplitCodegen(
 
   splitCodeGen(std::move(Combined), OSPtrs, {}, TMFactory);
 
+  if (!CacheKey.empty())
+    storeCachedObjects();
+
   std::vector<std::unique_ptr<InputFile>> ObjFiles;
   for (SmallString<0> &Obj : OwningData)
     ObjFiles.push_back(createObjectFile(
@@ -26,6 +26,7 @@
 #include "llvm/ADT/StringSet.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Linker/IRMover.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 namespace lld {
 namespace elf {
@@ -42,6 +43,8 @@ public:
 private:
   std::vector<std::unique_ptr<InputFile>> runSplitCodegen(
       const std::function<std::unique_ptr<llvm::TargetMachine>()> &TMFactory);
+  bool loadCachedObjects(unsigned NumThreads);
+  void storeCachedObjects();
 
   std::unique_ptr<llvm::Module> Combined;
   llvm::IRMover Mover;
@@ -49,6 +52,12 @@ private:
   llvm::StringSet<> InternalizedSyms;
   llvm::StringSet<> AsmUndefinedRefs;
   std::string TheTriple;
+
+  // Identity of the combined module in the on-disk codegen cache and
+  // the mmaped object files reused on a hit. Both stay empty unless
+  // --lto-cache-directory is in use.
+  std::string CacheKey;
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> CachedObjs;
 };
 }
 }
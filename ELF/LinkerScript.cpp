@@ -8,8 +8,10 @@
 //===----------------------------------------------------------------------===//
 //
 // This file contains the parser/evaluator of the linker script.
-// It does not construct an AST but consume linker script directives directly.
-// Results are written to Driver or Config object.
+// It consumes most linker script directives directly and writes the
+// results to Driver or Config object. Arithmetic expressions are the
+// exception: they are compiled to small constant-folded ScriptExpr
+// trees which are evaluated during address assignment.
 //
 //===----------------------------------------------------------------------===//
 
@@ -35,26 +37,28 @@ using namespace lld::elf;
 
 ScriptConfiguration *elf::ScriptConfig;
 
-// This is an operator-precedence parser to parse and evaluate
-// a linker script expression. For each linker script arithmetic
+// This is an operator-precedence parser to compile a linker script
+// expression to a ScriptExpr tree. For each linker script arithmetic
 // expression (e.g. ". = . + 0x1000"), a new instance of ExprParser
-// is created and ran.
+// is created and ran when the script is read; the resulting tree is
+// evaluated each time the location counter is assigned.
 namespace {
 class ExprParser : public ScriptParserBase {
 public:
-  ExprParser(std::vector<StringRef> &Tokens, uint64_t Dot)
-      : ScriptParserBase(Tokens), Dot(Dot) {}
+  ExprParser(std::vector<StringRef> &Tokens, llvm::BumpPtrAllocator &Alloc)
+      : ScriptParserBase(Tokens), Alloc(Alloc) {}
 
-  uint64_t run();
+  ScriptExpr *run();
 
 private:
-  uint64_t parsePrimary();
-  uint64_t parseTernary(uint64_t Cond);
-  uint64_t apply(StringRef Op, uint64_t L, uint64_t R);
-  uint64_t parseExpr1(uint64_t Lhs, int MinPrec);
-  uint64_t parseExpr();
-
-  uint64_t Dot;
+  ScriptExpr *makeConst(uint64_t V);
+  ScriptExpr *parsePrimary();
+  ScriptExpr *parseTernary(ScriptExpr *Cond);
+  ScriptExpr *makeBinary(StringRef Op, ScriptExpr *L, ScriptExpr *R);
+  ScriptExpr *parseExpr1(ScriptExpr *Lhs, int MinPrec);
+  ScriptExpr *parseExpr();
+
+  llvm::BumpPtrAllocator &Alloc;
 };
 }
 
@@ -74,51 +78,7 @@ static int precedence(StringRef Op) {
       .Default(-1);
 }
 
-static uint64_t evalExpr(std::vector<StringRef> &Tokens, uint64_t Dot) {
-  return ExprParser(Tokens, Dot).run();
-}
-
-uint64_t ExprParser::run() {
-  uint64_t V = parseExpr();
-  if (!atEOF() && !Error)
-    setError("stray token: " + peek());
-  return V;
-}
-
-// This is a part of the operator-precedence parser to evaluate
-// arithmetic expressions in SECTIONS command. This function evaluates an
-// integer literal, a parenthesized expression, the ALIGN function,
-// or the special variable ".".
-uint64_t ExprParser::parsePrimary() {
-  StringRef Tok = next();
-  if (Tok == ".")
-    return Dot;
-  if (Tok == "(") {
-    uint64_t V = parseExpr();
-    expect(")");
-    return V;
-  }
-  if (Tok == "ALIGN") {
-    expect("(");
-    uint64_t V = parseExpr();
-    expect(")");
-    return alignTo(Dot, V);
-  }
-  uint64_t V = 0;
-  if (Tok.getAsInteger(0, V))
-    setError("malformed number: " + Tok);
-  return V;
-}
-
-uint64_t ExprParser::parseTernary(uint64_t Cond) {
-  next();
-  uint64_t V = parseExpr();
-  expect(":");
-  uint64_t W = parseExpr();
-  return Cond ? V : W;
-}
-
-uint64_t ExprParser::apply(StringRef Op, uint64_t L, uint64_t R) {
+static uint64_t apply(StringRef Op, uint64_t L, uint64_t R) {
   if (Op == "*")
     return L * R;
   if (Op == "/") {
@@ -150,10 +110,104 @@ uint64_t ExprParser::apply(StringRef Op, uint64_t L, uint64_t R) {
   return 0;
 }
 
+// Evaluates a compiled expression with the given location counter.
+static uint64_t evalExpr(const ScriptExpr *E, uint64_t Dot) {
+  switch (E->Kind) {
+  case ScriptExpr::ConstKind:
+    return E->Value;
+  case ScriptExpr::DotKind:
+    return Dot;
+  case ScriptExpr::AlignKind:
+    return alignTo(Dot, evalExpr(E->Lhs, Dot));
+  case ScriptExpr::BinaryKind:
+    return apply(E->Op, evalExpr(E->Lhs, Dot), evalExpr(E->Rhs, Dot));
+  case ScriptExpr::TernaryKind:
+    return evalExpr(E->Cond, Dot) ? evalExpr(E->Lhs, Dot)
+                                  : evalExpr(E->Rhs, Dot);
+  }
+  llvm_unreachable("invalid expression kind");
+}
+
+ScriptExpr *ExprParser::run() {
+  ScriptExpr *E = parseExpr();
+  if (!atEOF() && !Error)
+    setError("stray token: " + peek());
+  return E;
+}
+
+ScriptExpr *ExprParser::makeConst(uint64_t V) {
+  auto *E = new (Alloc) ScriptExpr;
+  E->Kind = ScriptExpr::ConstKind;
+  E->Value = V;
+  return E;
+}
+
+// This is a part of the operator-precedence parser to compile
+// arithmetic expressions in SECTIONS command. This function compiles an
+// integer literal, a parenthesized expression, the ALIGN function,
+// or the special variable ".".
+ScriptExpr *ExprParser::parsePrimary() {
+  StringRef Tok = next();
+  if (Tok == ".") {
+    auto *E = new (Alloc) ScriptExpr;
+    E->Kind = ScriptExpr::DotKind;
+    return E;
+  }
+  if (Tok == "(") {
+    ScriptExpr *E = parseExpr();
+    expect(")");
+    return E;
+  }
+  if (Tok == "ALIGN") {
+    expect("(");
+    ScriptExpr *V = parseExpr();
+    expect(")");
+    auto *E = new (Alloc) ScriptExpr;
+    E->Kind = ScriptExpr::AlignKind;
+    E->Lhs = V;
+    return E;
+  }
+  uint64_t V = 0;
+  if (Tok.getAsInteger(0, V))
+    setError("malformed number: " + Tok);
+  return makeConst(V);
+}
+
+ScriptExpr *ExprParser::parseTernary(ScriptExpr *Cond) {
+  next();
+  ScriptExpr *V = parseExpr();
+  expect(":");
+  ScriptExpr *W = parseExpr();
+  if (Cond->Kind == ScriptExpr::ConstKind &&
+      V->Kind == ScriptExpr::ConstKind && W->Kind == ScriptExpr::ConstKind)
+    return makeConst(Cond->Value ? V->Value : W->Value);
+  auto *E = new (Alloc) ScriptExpr;
+  E->Kind = ScriptExpr::TernaryKind;
+  E->Cond = Cond;
+  E->Lhs = V;
+  E->Rhs = W;
+  return E;
+}
+
+// Creates a binary operator node, folding it to a constant right away
+// if both operands are constants. Folding also reports constant
+// division by zero, just as evaluation used to.
+ScriptExpr *ExprParser::makeBinary(StringRef Op, ScriptExpr *L,
+                                   ScriptExpr *R) {
+  if (L->Kind == ScriptExpr::ConstKind && R->Kind == ScriptExpr::ConstKind)
+    return makeConst(apply(Op, L->Value, R->Value));
+  auto *E = new (Alloc) ScriptExpr;
+  E->Kind = ScriptExpr::BinaryKind;
+  E->Op = Op;
+  E->Lhs = L;
+  E->Rhs = R;
+  return E;
+}
+
 // This is a part of the operator-precedence parser.
 // This function assumes that the remaining token stream starts
 // with an operator.
-uint64_t ExprParser::parseExpr1(uint64_t Lhs, int MinPrec) {
+ScriptExpr *ExprParser::parseExpr1(ScriptExpr *Lhs, int MinPrec) {
   while (!atEOF()) {
     // Read an operator and an expression.
     StringRef Op1 = peek();
@@ -162,12 +216,12 @@ uint64_t ExprParser::parseExpr1(uint64_t Lhs, int MinPrec) {
     if (precedence(Op1) < MinPrec)
       return Lhs;
     next();
-    uint64_t Rhs = parsePrimary();
+    ScriptExpr *Rhs = parsePrimary();
 
-    // Evaluate the remaining part of the expression first if the
+    // Compile the remaining part of the expression first if the
     // next operator has greater precedence than the previous one.
     // For example, if we have read "+" and "3", and if the next
-    // operator is "*", then we'll evaluate 3 * ... part first.
+    // operator is "*", then we'll compile 3 * ... part first.
     while (!atEOF()) {
       StringRef Op2 = peek();
       if (precedence(Op2) <= precedence(Op1))
@@ -175,20 +229,29 @@ uint64_t ExprParser::parseExpr1(uint64_t Lhs, int MinPrec) {
       Rhs = parseExpr1(Rhs, precedence(Op2));
     }
 
-    Lhs = apply(Op1, Lhs, Rhs);
+    Lhs = makeBinary(Op1, Lhs, Rhs);
   }
   return Lhs;
 }
 
-// Reads and evaluates an arithmetic expression.
-uint64_t ExprParser::parseExpr() { return parseExpr1(parsePrimary(), 0); }
+// Reads and compiles an arithmetic expression.
+ScriptExpr *ExprParser::parseExpr() { return parseExpr1(parsePrimary(), 0); }
+
+template <class ELFT> LinkerScript<ELFT>::LinkerScript() {
+  for (unsigned I = 0, E = Opt.Sections.size(); I != E; ++I)
+    SectionGlobs.add(Opt.Sections[I].SectionPattern, I);
+  for (unsigned I = 0, E = Opt.KeptSections.size(); I != E; ++I)
+    KeptGlobs.add(Opt.KeptSections[I], I);
+}
 
 template <class ELFT>
 StringRef LinkerScript<ELFT>::getOutputSection(InputSectionBase<ELFT> *S) {
-  for (SectionRule &R : Opt.Sections)
-    if (globMatch(R.SectionPattern, S->getSectionName()))
-      return R.Dest;
-  return "";
+  // The first rule in the script that matches wins; matchFirst returns
+  // the lowest matching rule index.
+  unsigned I = SectionGlobs.matchFirst(S->getSectionName());
+  if (I == (unsigned)-1)
+    return "";
+  return Opt.Sections[I].Dest;
 }
 
 template <class ELFT>
@@ -198,10 +261,7 @@ bool LinkerScript<ELFT>::isDiscarded(InputSectionBase<ELFT> *S) {
 
 template <class ELFT>
 bool LinkerScript<ELFT>::shouldKeep(InputSectionBase<ELFT> *S) {
-  for (StringRef Pat : Opt.KeptSections)
-    if (globMatch(Pat, S->getSectionName()))
-      return true;
-  return false;
+  return KeptGlobs.matches(S->getSectionName());
 }
 
 template <class ELFT>
@@ -310,6 +370,87 @@ bool elf::globMatch(StringRef S, StringRef T) {
   }
 }
 
+// Returns true if S contains a glob meta-character.
+static bool hasWildcard(StringRef S) {
+  return S.find_first_of("*?") != StringRef::npos;
+}
+
+void GlobSet::add(StringRef Pattern, unsigned Id) {
+  if (!hasWildcard(Pattern)) {
+    Exact[Pattern].push_back(Id);
+    return;
+  }
+  CompiledGlob G;
+  G.Pattern = Pattern;
+  size_t First = Pattern.find_first_of("*?");
+  size_t Last = Pattern.find_last_of("*?");
+  G.Prefix = Pattern.substr(0, First);
+  G.Suffix = Pattern.substr(Last + 1);
+  G.Id = Id;
+  if (G.Prefix.empty())
+    Unanchored.push_back(G);
+  else
+    Anchored[(unsigned char)G.Prefix[0]].push_back(G);
+}
+
+// Returns true if G matches Name. The cheap prefix and suffix checks
+// reject most candidates without entering the recursive matcher.
+bool GlobSet::matchOne(const CompiledGlob &G, StringRef Name) {
+  if (Name.size() < G.Prefix.size() + G.Suffix.size())
+    return false;
+  if (!Name.startswith(G.Prefix) || !Name.endswith(G.Suffix))
+    return false;
+  return globMatch(G.Pattern, Name);
+}
+
+bool GlobSet::matches(StringRef Name) const {
+  if (Name.empty())
+    return false;
+  if (Exact.count(Name))
+    return true;
+  for (const CompiledGlob &G : Anchored[(unsigned char)Name.front()])
+    if (matchOne(G, Name))
+      return true;
+  for (const CompiledGlob &G : Unanchored)
+    if (matchOne(G, Name))
+      return true;
+  return false;
+}
+
+void GlobSet::match(StringRef Name, std::vector<unsigned> &Ids) const {
+  if (Name.empty())
+    return;
+  size_t Begin = Ids.size();
+  auto It = Exact.find(Name);
+  if (It != Exact.end())
+    Ids.insert(Ids.end(), It->second.begin(), It->second.end());
+  for (const CompiledGlob &G : Anchored[(unsigned char)Name.front()])
+    if (matchOne(G, Name))
+      Ids.push_back(G.Id);
+  for (const CompiledGlob &G : Unanchored)
+    if (matchOne(G, Name))
+      Ids.push_back(G.Id);
+  // Restore pattern insertion order so that callers observe matches
+  // in the same order as a pattern-by-pattern scan.
+  std::sort(Ids.begin() + Begin, Ids.end());
+}
+
+unsigned GlobSet::matchFirst(StringRef Name) const {
+  unsigned Best = -1;
+  if (Name.empty())
+    return Best;
+  auto It = Exact.find(Name);
+  if (It != Exact.end())
+    Best = It->second.front();
+  for (const CompiledGlob &G : Anchored[(unsigned char)Name.front()])
+    if (G.Id < Best && matchOne(G, Name))
+      Best = G.Id;
+  for (const CompiledGlob &G : Unanchored)
+    if (G.Id < Best && matchOne(G, Name))
+      Best = G.Id;
+  return Best;
+}
+
 class elf::ScriptParser : public ScriptParserBase {
   typedef void (ScriptParser::*Handler)();
 
@@ -508,16 +649,19 @@ void ScriptParser::readSections() {
 void ScriptParser::readLocationCounterValue() {
   expect(".");
   expect("=");
-  Opt.Commands.push_back({ExprKind, {}, ""});
-  SectionsCommand &Cmd = Opt.Commands.back();
+  std::vector<StringRef> Tokens;
   while (!Error) {
     StringRef Tok = next();
     if (Tok == ";")
       break;
-    Cmd.Expr.push_back(Tok);
+    Tokens.push_back(Tok);
   }
-  if (Cmd.Expr.empty())
+  if (Tokens.empty()) {
     error("error in location counter expression");
+    return;
+  }
+  ScriptExpr *E = ExprParser(Tokens, Opt.Alloc).run();
+  Opt.Commands.push_back({ExprKind, E, ""});
 }
 
 void ScriptParser::readOutputSectionDescription() {
@@ -13,6 +13,8 @@
 #include "lld/Core/LLVM.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/MemoryBuffer.h"
 
@@ -21,6 +23,48 @@ namespace elf {
 
 bool globMatch(StringRef S, StringRef T);
 
+// A set of glob patterns compiled for matching many names against all
+// patterns at once. Exact patterns are folded into a hash map, and
+// wildcard patterns are bucketed by their leading literal character
+// and pre-split into literal prefix and suffix, so matching a name
+// runs the recursive matcher only for the few patterns that could
+// possibly match. Version scripts with hundreds of patterns are
+// matched against millions of symbols, where testing every pattern
+// for every name is a serial hotspot.
+class GlobSet {
+public:
+  // Patterns are identified by the caller-supplied Id.
+  void add(StringRef Pattern, unsigned Id);
+
+  bool matches(StringRef Name) const;
+
+  // Appends the ids of all patterns matching Name, in the order the
+  // patterns were added.
+  void match(StringRef Name, std::vector<unsigned> &Ids) const;
+
+  // Returns the lowest id of any pattern matching Name, or -1 if none
+  // does. With ids assigned in pattern order this picks the same
+  // pattern as a first-match scan.
+  unsigned matchFirst(StringRef Name) const;
+
+private:
+  struct CompiledGlob {
+    StringRef Pattern;
+    StringRef Prefix; // Literal text before the first meta character.
+    StringRef Suffix; // Literal text after the last meta character.
+    unsigned Id;
+  };
+
+  static bool matchOne(const CompiledGlob &G, StringRef Name);
+
+  llvm::StringMap<llvm::SmallVector<unsigned, 1>> Exact;
+
+  // Wildcard patterns whose first character is a literal, indexed by
+  // that character, and patterns starting with a meta character.
+  std::vector<CompiledGlob> Anchored[256];
+  std::vector<CompiledGlob> Unanchored;
+};
+
 // Parses a linker script. Calling this function updates
 // Config and ScriptConfig.
 void readLinkerScript(MemoryBufferRef MB);
@@ -44,9 +88,31 @@ struct SectionRule {
 // SectionKind is a description of output section, like ".data :..."
 enum SectionsCommandKind { ExprKind, SectionKind };
 
+// A linker script arithmetic expression compiled into a small tree.
+// Expressions are compiled once at script parse time; subtrees that
+// do not depend on the location counter are folded into constants, so
+// evaluating an assignment during address assignment visits only the
+// few nodes that actually vary.
+struct ScriptExpr {
+  enum NodeKind {
+    ConstKind,   // Integer literal or folded subtree. Uses Value.
+    DotKind,     // The location counter ".".
+    AlignKind,   // ALIGN(Lhs).
+    BinaryKind,  // Lhs Op Rhs.
+    TernaryKind, // Cond ? Lhs : Rhs.
+  };
+
+  NodeKind Kind;
+  uint64_t Value = 0;
+  StringRef Op;
+  ScriptExpr *Cond = nullptr;
+  ScriptExpr *Lhs = nullptr;
+  ScriptExpr *Rhs = nullptr;
+};
+
 struct SectionsCommand {
   SectionsCommandKind Kind;
-  std::vector<StringRef> Expr;
+  ScriptExpr *Expr;
   StringRef SectionName;
 };
 
@@ -77,6 +143,8 @@ template <class ELFT> class LinkerScript {
   typedef typename ELFT::uint uintX_t;
 
 public:
+  LinkerScript();
+
   StringRef getOutputSection(InputSectionBase<ELFT> *S);
   ArrayRef<uint8_t> getFiller(StringRef Name);
   bool isDiscarded(InputSectionBase<ELFT> *S);
@@ -88,6 +156,14 @@ private:
   // "ScriptConfig" is a bit too long, so define a short name for it.
   ScriptConfiguration &Opt = *ScriptConfig;
 
+  // The SECTIONS rule and KEEP patterns compiled for matching a name
+  // against all of them at once. Built by the constructor, which runs
+  // after every script has been parsed; getOutputSection and
+  // shouldKeep are called once per input section, possibly from many
+  // threads, so they must not mutate the matchers.
+  GlobSet SectionGlobs;
+  GlobSet KeptGlobs;
+
   int getSectionIndex(StringRef Name);
 
   uintX_t Dot;
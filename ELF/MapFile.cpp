@@ -0,0 +1,180 @@
+//===- MapFile.cpp --------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the -Map option, which maps address ranges to their
+// object files and input sections, and the --cref option, which prints a
+// table listing, for each global symbol, the file that defines it and the
+// files that refer to it.
+//
+// Both reports are computed from the finalized output section list and the
+// resolved symbol table, neither of which changes once addresses have been
+// assigned, so the Writer runs writeMapFile on a helper thread while it
+// streams section contents to the output buffer and joins it before
+// committing the buffer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "MapFile.h"
+#include "Config.h"
+#include "Error.h"
+#include "InputFiles.h"
+#include "OutputSections.h"
+#include "SymbolTable.h"
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace llvm::object;
+
+using namespace lld;
+using namespace lld::elf;
+
+static void writeOutSecLine(raw_ostream &OS, int Width, uint64_t Address,
+                            uint64_t Size, uint64_t Align, StringRef Name) {
+  OS << format_hex_no_prefix(Address, Width) << ' '
+     << format_hex_no_prefix(Size, Width) << ' '
+     << format("%5x ", (unsigned)Align)
+     << Name << '\n';
+}
+
+static void writeInSecLine(raw_ostream &OS, int Width, uint64_t Address,
+                           uint64_t Size, uint64_t Align, StringRef Name,
+                           StringRef File) {
+  OS << format_hex_no_prefix(Address, Width) << ' '
+     << format_hex_no_prefix(Size, Width) << ' '
+     << format("%5x ", (unsigned)Align)
+     << "        " << left_justify(Name, 15) << ' ' << File << '\n';
+}
+
+static void writeSymbolLine(raw_ostream &OS, int Width, uint64_t Address,
+                            uint64_t Size, StringRef Name) {
+  OS << format_hex_no_prefix(Address, Width) << ' '
+     << format_hex_no_prefix(Size, Width) << "       "
+     << "                " << Name << '\n';
+}
+
+// Maps each input section to the global symbols defined in it so that
+// the map can print symbols under the section that contains them.
+template <class ELFT>
+static DenseMap<InputSectionBase<ELFT> *,
+                SmallVector<DefinedRegular<ELFT> *, 4>>
+getSectionSyms() {
+  DenseMap<InputSectionBase<ELFT> *, SmallVector<DefinedRegular<ELFT> *, 4>>
+      Ret;
+  for (const std::unique_ptr<ObjectFile<ELFT>> &File :
+       Symtab<ELFT>::X->getObjectFiles())
+    for (SymbolBody *B : File->getNonLocalSymbols())
+      if (auto *D = dyn_cast<DefinedRegular<ELFT>>(B))
+        if (D->Section && D->Section != &InputSectionBase<ELFT>::Discarded)
+          Ret[D->Section].push_back(D);
+  return Ret;
+}
+
+// Maps each output section to its live input sections in layout order.
+// OutputSectionBase does not expose its members, so the list is rebuilt
+// from the input side and sorted by output section offset.
+template <class ELFT>
+static DenseMap<OutputSectionBase<ELFT> *,
+                std::vector<InputSection<ELFT> *>>
+getInputSections() {
+  DenseMap<OutputSectionBase<ELFT> *, std::vector<InputSection<ELFT> *>> Ret;
+  for (const std::unique_ptr<ObjectFile<ELFT>> &File :
+       Symtab<ELFT>::X->getObjectFiles())
+    for (InputSectionBase<ELFT> *B : File->getSections())
+      if (B && B != &InputSectionBase<ELFT>::Discarded && B->Repl == B)
+        if (auto *IS = dyn_cast<InputSection<ELFT>>(B))
+          if (IS->OutSec)
+            Ret[IS->OutSec].push_back(IS);
+  for (auto &P : Ret)
+    std::sort(P.second.begin(), P.second.end(),
+              [](InputSection<ELFT> *A, InputSection<ELFT> *B) {
+                return A->OutSecOff < B->OutSecOff;
+              });
+  return Ret;
+}
+
+template <class ELFT>
+static void writeMap(raw_ostream &OS,
+                     ArrayRef<OutputSectionBase<ELFT> *> OutputSections) {
+  int Width = ELFT::Is64Bits ? 16 : 8;
+
+  auto SectionSyms = getSectionSyms<ELFT>();
+  auto InputSections = getInputSections<ELFT>();
+
+  OS << left_justify("Address", Width) << ' ' << left_justify("Size", Width)
+     << " Align Out     In      File    Symbol\n";
+  for (OutputSectionBase<ELFT> *Sec : OutputSections) {
+    writeOutSecLine(OS, Width, Sec->getVA(), Sec->getSize(),
+                    Sec->getAlignment(), Sec->getName());
+    for (InputSection<ELFT> *IS : InputSections.lookup(Sec)) {
+      writeInSecLine(OS, Width, Sec->getVA() + IS->OutSecOff, IS->getSize(),
+                     IS->Alignment, IS->getSectionName(),
+                     getFilename(IS->getFile()));
+      for (DefinedRegular<ELFT> *Sym : SectionSyms.lookup(IS))
+        writeSymbolLine(OS, Width, Sym->template getVA<ELFT>(), Sym->Size,
+                        Sym->getName());
+    }
+  }
+}
+
+// Prints a cross reference table in roughly the same format as GNU ld's
+// --cref: one paragraph per global symbol, the defining file first and
+// the referring files indented under it.
+template <class ELFT> static void writeCref(raw_ostream &OS) {
+  MapVector<SymbolBody *, SmallVector<InputFile *, 4>> Map;
+  for (const std::unique_ptr<ObjectFile<ELFT>> &File :
+       Symtab<ELFT>::X->getObjectFiles())
+    for (SymbolBody *B : File->getNonLocalSymbols())
+      if (!B->isLocal() && !B->isLazy())
+        Map[B].push_back(File.get());
+
+  OS << "Cross Reference Table\n\n";
+  OS << left_justify("Symbol", 49) << ' ' << "File\n";
+  for (auto &P : Map) {
+    SymbolBody *B = P.first;
+    InputFile *Definer = B->getSourceFile<ELFT>();
+    OS << left_justify(B->getName(), 49);
+    if (Definer)
+      OS << ' ' << getFilename(Definer);
+    OS << '\n';
+    for (InputFile *Referrer : P.second)
+      if (Referrer != Definer)
+        OS << left_justify("", 49) << ' ' << getFilename(Referrer) << '\n';
+  }
+}
+
+template <class ELFT>
+void elf::writeMapFile(ArrayRef<OutputSectionBase<ELFT> *> OutputSections) {
+  // With --cref but no -Map the table goes to stdout like GNU ld.
+  if (Config->MapFile.empty()) {
+    if (Config->Cref)
+      writeCref<ELFT>(outs());
+    return;
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(Config->MapFile, EC, sys::fs::F_None);
+  if (EC) {
+    error(EC, "cannot open " + Config->MapFile);
+    return;
+  }
+  writeMap<ELFT>(OS, OutputSections);
+  if (Config->Cref) {
+    OS << '\n';
+    writeCref<ELFT>(OS);
+  }
+}
+
+template void elf::writeMapFile<ELF32LE>(ArrayRef<OutputSectionBase<ELF32LE> *>);
+template void elf::writeMapFile<ELF32BE>(ArrayRef<OutputSectionBase<ELF32BE> *>);
+template void elf::writeMapFile<ELF64LE>(ArrayRef<OutputSectionBase<ELF64LE> *>);
+template void elf::writeMapFile<ELF64BE>(ArrayRef<OutputSectionBase<ELF64BE> *>);
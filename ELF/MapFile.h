@@ -0,0 +1,29 @@
+//===- MapFile.h ------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_MAPFILE_H
+#define LLD_ELF_MAPFILE_H
+
+#include "lld/Core/LLVM.h"
+
+namespace lld {
+namespace elf {
+
+template <class ELFT> class OutputSectionBase;
+
+// Writes the -Map file and the --cref table. Both reports read only
+// finalized layout data, so the writer runs this on a helper thread
+// while it streams section contents to the output buffer.
+template <class ELFT>
+void writeMapFile(ArrayRef<OutputSectionBase<ELFT> *> OutputSections);
+
+} // namespace elf
+} // namespace lld
+
+#endif
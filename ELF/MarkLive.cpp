@@ -20,6 +20,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "ICF.h"
 #include "InputSection.h"
 #include "LinkerScript.h"
 #include "OutputSections.h"
@@ -27,6 +28,7 @@
 #include "Symbols.h"
 #include "Target.h"
 #include "Writer.h"
+#include "lld/Core/Parallel.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Object/ELF.h"
 #include <functional>
@@ -137,10 +139,15 @@ template <class ELFT> static bool isReserved(InputSectionBase<ELFT> *Sec) {
 // sections to set their "Live" bits.
 template <class ELFT> void elf::markLive() {
   SmallVector<InputSection<ELFT> *, 256> Q;
+  TaskGroup Tg;
 
-  auto Enqueue = [&](ResolvedReloc<ELFT> R) {
+  // Claims a relocation target for traversal. Returns null if the
+  // target needs no traversal or was already claimed. exchange() hands
+  // each section to exactly one caller even when several marking tasks
+  // reach it at the same time.
+  auto Claim = [](ResolvedReloc<ELFT> R) -> InputSection<ELFT> * {
     if (!R.Sec)
-      return;
+      return nullptr;
 
     // Usually, a whole section is marked as live or dead, but in mergeable
     // (splittable) sections, each piece of data has independent liveness bit.
@@ -148,10 +155,43 @@ template <class ELFT> void elf::markLive() {
     if (auto *MS = dyn_cast<MergeInputSection<ELFT>>(R.Sec))
       MS->markLiveAt(R.Offset);
 
-    if (R.Sec->Live)
-      return;
-    R.Sec->Live = true;
-    if (InputSection<ELFT> *S = dyn_cast<InputSection<ELFT>>(R.Sec))
+    if (R.Sec->Live.exchange(true))
+      return nullptr;
+
+    auto *S = dyn_cast<InputSection<ELFT>>(R.Sec);
+
+    // When ICF follows GC, seed its equivalence groups right here: the
+    // section has just been claimed by exactly one marking task and its
+    // headers are hot, so ICF does not need a second full pass over the
+    // sections to hash them. Dead sections never get this far and are
+    // never hashed at all.
+    if (S && Config->ICF != IcfLevel::None && isIcfCandidate<ELFT>(S))
+      S->GroupId = getIcfHash<ELFT>(S) | (uint64_t(1) << 63);
+    return S;
+  };
+
+  // Marking task for the threaded mode. Each task traverses from one
+  // section with a bounded local worklist; the overflow is spawned back
+  // to the pool, so idle threads steal subgraphs to mark.
+  std::function<void(InputSection<ELFT> *)> Mark = [&](InputSection<ELFT> *C) {
+    SmallVector<InputSection<ELFT> *, 64> Stack;
+    Stack.push_back(C);
+    while (!Stack.empty()) {
+      InputSection<ELFT> *Sec = Stack.pop_back_val();
+      forEachSuccessor<ELFT>(Sec, [&](ResolvedReloc<ELFT> R) {
+        InputSection<ELFT> *S = Claim(R);
+        if (!S)
+          return;
+        if (Stack.size() < 64)
+          Stack.push_back(S);
+        else
+          Tg.spawn([&Mark, S] { Mark(S); });
+      });
+    }
+  };
+
+  auto Enqueue = [&](ResolvedReloc<ELFT> R) {
+    if (InputSection<ELFT> *S = Claim(R))
       Q.push_back(S);
   };
 
@@ -190,8 +230,14 @@ template <class ELFT> void elf::markLive() {
       }
 
   // Mark all reachable sections.
-  while (!Q.empty())
-    forEachSuccessor<ELFT>(Q.pop_back_val(), Enqueue);
+  if (Config->Threads) {
+    for (InputSection<ELFT> *S : Q)
+      Tg.spawn([&Mark, S] { Mark(S); });
+    Tg.sync();
+  } else {
+    while (!Q.empty())
+      forEachSuccessor<ELFT>(Q.pop_back_val(), Enqueue);
+  }
 }
 
 template void elf::markLive<ELF32LE>();
@@ -0,0 +1,104 @@
+//===- Memory.cpp ---------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Memory.h"
+#include "Counters.h"
+#include "Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace lld;
+using namespace lld::elf;
+
+// The head of the intrusive list of all arena counters. Counters are
+// static members of SpecificAlloc instantiations; the compiler may
+// defer their initialization until first use, which can happen on a
+// worker thread, so registration takes a lock.
+static ArenaStats *Head;
+static std::mutex Mu;
+
+ArenaStats::ArenaStats(StringRef Name) : Name(Name) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  Next = Head;
+  Head = this;
+}
+
+namespace {
+struct StatRow {
+  std::string Name;
+  uint64_t Bytes;
+  uint64_t Allocs;
+};
+}
+
+// Rows recorded through recordMemoryUsage. Snapshots are taken from
+// the main thread at the end of the link, but parsing code is free to
+// record rows earlier, so additions take the same lock as the arena
+// list.
+static std::vector<StatRow> Recorded;
+
+void elf::recordMemoryUsage(StringRef Name, uint64_t Bytes, uint64_t Allocs) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  Recorded.push_back(StatRow{Name.str(), Bytes, Allocs});
+}
+
+static std::vector<StatRow> collectStats() {
+  std::vector<StatRow> V;
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    V = Recorded;
+    for (ArenaStats *S = Head; S; S = S->Next)
+      if (S->Bytes)
+        V.push_back(StatRow{S->Name.str(), S->Bytes.load(), S->Allocs.load()});
+  }
+  std::sort(V.begin(), V.end(), [](const StatRow &A, const StatRow &B) {
+    return A.Bytes > B.Bytes;
+  });
+  return V;
+}
+
+void elf::printMemoryStats() {
+  outs() << format("%12s %12s  %s\n", "bytes", "allocs", "subsystem");
+  for (const StatRow &S : collectStats())
+    outs() << format("%12llu %12llu  ", (unsigned long long)S.Bytes,
+                     (unsigned long long)S.Allocs)
+           << S.Name << "\n";
+}
+
+void elf::writeMemoryStatsJson(StringRef Path) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  if (EC) {
+    error(EC, "cannot write " + Path);
+    return;
+  }
+
+  // Subsystem names are type names and fixed strings, so they need no
+  // escaping beyond what JSON always allows.
+  std::vector<StatRow> V = collectStats();
+  OS << "[";
+  bool NeedComma = false;
+  for (size_t I = 0, E = V.size(); I != E; ++I) {
+    if (NeedComma)
+      OS << ",";
+    NeedComma = true;
+    OS << "\n{\"name\":\"" << V[I].Name << "\",\"bytes\":" << V[I].Bytes
+       << ",\"allocs\":" << V[I].Allocs << "}";
+  }
+  // Throughput counters share the array; their rows carry "count"
+  // instead of "bytes"/"allocs".
+  appendCounterStatsJson(OS, NeedComma);
+  OS << "\n]\n";
+}
@@ -0,0 +1,87 @@
+//===- Memory.h -------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the arenas that long-lived linker objects, such as
+// sections and symbol bodies, are allocated from. Almost all of them
+// are used until the very end of the link, so they are never freed
+// individually. Pooling each class in its own arena keeps objects of
+// one type densely packed instead of interleaved with unrelated data
+// in per-file allocators, and gives --stats a per-class account of
+// where the memory went.
+//
+// Object files are parsed on several threads, so every thread
+// bump-allocates from its own slab; the per-arena byte counter is the
+// only cross-thread state. The slabs are intentionally leaked: worker
+// threads outlive the link, and the objects are needed until the
+// output is written anyway.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_MEMORY_H
+#define LLD_ELF_MEMORY_H
+
+#include "lld/Core/LLVM.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/TypeName.h"
+#include <atomic>
+#include <utility>
+
+namespace lld {
+namespace elf {
+
+// A named byte and allocation counter for one arena. All counters form
+// an intrusive list that the stats reporters walk.
+struct ArenaStats {
+  ArenaStats(StringRef Name);
+  StringRef Name;
+  std::atomic<uint64_t> Bytes{0};
+  std::atomic<uint64_t> Allocs{0};
+  ArenaStats *Next = nullptr;
+};
+
+// Records the usage of a subsystem that does not allocate through
+// make<>: container footprints and per-object allocators snapshotted
+// at the end of the link. Bytes should be the peak (for bump
+// allocators and containers that only grow, the final size is the
+// peak); Allocs is the element or allocation count.
+void recordMemoryUsage(StringRef Name, uint64_t Bytes, uint64_t Allocs);
+
+// Prints bytes and allocation counts per subsystem, largest first.
+// Called at the end of the link when --stats is given.
+void printMemoryStats();
+
+// Writes the same numbers as a JSON array of
+// {"name":..., "bytes":..., "allocs":...} objects for -stats-json=.
+void writeMemoryStatsJson(StringRef Path);
+
+template <class T> struct SpecificAlloc {
+  static llvm::SpecificBumpPtrAllocator<T> &get() {
+    static LLVM_THREAD_LOCAL llvm::SpecificBumpPtrAllocator<T> *Alloc;
+    if (!Alloc)
+      Alloc = new llvm::SpecificBumpPtrAllocator<T>;
+    return *Alloc;
+  }
+  static ArenaStats Stats;
+};
+
+template <class T>
+ArenaStats SpecificAlloc<T>::Stats(llvm::getTypeName<T>());
+
+// Makes a long-lived object of type T in T's arena.
+template <typename T, typename... U> T *make(U &&... Args) {
+  SpecificAlloc<T>::Stats.Bytes.fetch_add(sizeof(T),
+                                          std::memory_order_relaxed);
+  SpecificAlloc<T>::Stats.Allocs.fetch_add(1, std::memory_order_relaxed);
+  return new (SpecificAlloc<T>::get().Allocate()) T(std::forward<U>(Args)...);
+}
+}
+}
+
+#endif
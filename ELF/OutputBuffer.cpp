@@ -0,0 +1,155 @@
+//===- OutputBuffer.cpp ---------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The output of a large link is dominated by writing the image back to
+// disk, and committing the mmap'ed buffer at the end of the link used to
+// stall for the whole accumulated dirty range. This file provides the
+// output buffer abstraction the Writer uses instead of talking to
+// llvm::FileOutputBuffer directly.
+//
+// On Linux the buffer allocates all file blocks up front with
+// posix_fallocate, prefaults the mapping with MAP_POPULATE (and asks for
+// huge pages where the kernel can provide them), and uses
+// sync_file_range to start writeback of each section's range as soon as
+// its contents are final. By the time commit() renames the file into
+// place, most pages have already been queued to the device. Like
+// FileOutputBuffer, the buffer is backed by a unique temporary file that
+// is atomically renamed to the destination on commit and removed if the
+// buffer is destroyed without committing.
+//
+//===----------------------------------------------------------------------===//
+
+#include "OutputBuffer.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+using namespace lld;
+using namespace lld::elf;
+
+namespace {
+// Portable implementation on top of llvm::FileOutputBuffer. flushRegion
+// is a no-op; all writeback happens in commit().
+class FileBuffer : public OutputBuffer {
+public:
+  FileBuffer(std::unique_ptr<FileOutputBuffer> B)
+      : OutputBuffer(B->getBufferStart(), B->getBufferSize()),
+        Impl(std::move(B)) {}
+
+  std::error_code commit() override { return Impl->commit(); }
+
+private:
+  std::unique_ptr<FileOutputBuffer> Impl;
+};
+
+#ifdef __linux__
+class MmapBuffer : public OutputBuffer {
+public:
+  MmapBuffer(uint8_t *Start, size_t Size, int FD, std::string TempPath,
+             std::string FinalPath)
+      : OutputBuffer(Start, Size), FD(FD), TempPath(std::move(TempPath)),
+        FinalPath(std::move(FinalPath)) {}
+
+  ~MmapBuffer() override {
+    // Not committed; discard the temporary file.
+    if (!Start)
+      return;
+    munmap(Start, Size);
+    close(FD);
+    sys::fs::remove(TempPath);
+  }
+
+  void flushRegion(size_t Off, size_t Len) override {
+    // Start writeback of the range and return immediately. The kernel
+    // rounds the range to page boundaries; overlapping flushes of
+    // adjacent ranges are harmless.
+    sync_file_range(FD, Off, Len, SYNC_FILE_RANGE_WRITE);
+  }
+
+  std::error_code commit() override {
+    munmap(Start, Size);
+    Start = nullptr;
+    close(FD);
+    return sys::fs::rename(TempPath, FinalPath);
+  }
+
+private:
+  int FD;
+  std::string TempPath;
+  std::string FinalPath;
+};
+
+static ErrorOr<std::unique_ptr<OutputBuffer>> createMmapBuffer(StringRef Path,
+                                                               size_t Size) {
+  int FD;
+  SmallString<128> TempPath;
+  if (std::error_code EC = sys::fs::createUniqueFile(
+          Path + ".tmp%%%%%%%", FD, TempPath,
+          sys::fs::all_read | sys::fs::all_write | sys::fs::all_exe))
+    return EC;
+
+  // Allocate all blocks now so writeback never has to extend the file.
+  // Filesystems without native fallocate support report EOPNOTSUPP; in
+  // that case just set the size and let blocks be allocated on demand.
+  int Err = posix_fallocate(FD, 0, Size);
+  if (Err == EOPNOTSUPP)
+    Err = ftruncate(FD, Size) == 0 ? 0 : errno;
+  if (Err) {
+    close(FD);
+    sys::fs::remove(TempPath);
+    return std::error_code(Err, std::generic_category());
+  }
+
+  // MAP_POPULATE prefaults the page tables so the parallel section
+  // writers do not serialize on soft page faults.
+  void *M = mmap(nullptr, Size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, FD, 0);
+  if (M == MAP_FAILED) {
+    std::error_code EC(errno, std::generic_category());
+    close(FD);
+    sys::fs::remove(TempPath);
+    return EC;
+  }
+
+  // File-backed huge pages are not available on most kernels; this is
+  // only a hint and fails silently where they are not.
+  madvise(M, Size, MADV_HUGEPAGE);
+
+  return std::unique_ptr<OutputBuffer>(
+      new MmapBuffer((uint8_t *)M, Size, FD, TempPath.str(), Path.str()));
+}
+#endif
+} // anonymous namespace
+
+ErrorOr<std::unique_ptr<OutputBuffer>> OutputBuffer::create(StringRef Path,
+                                                            size_t Size) {
+#ifdef __linux__
+  // Fall through to FileOutputBuffer if the fast path fails, e.g. when
+  // the output is on a filesystem that cannot mmap shared writable.
+  ErrorOr<std::unique_ptr<OutputBuffer>> MB = createMmapBuffer(Path, Size);
+  if (MB)
+    return MB;
+#endif
+  ErrorOr<std::unique_ptr<FileOutputBuffer>> B = FileOutputBuffer::create(
+      Path, Size, FileOutputBuffer::F_executable);
+  if (std::error_code EC = B.getError())
+    return EC;
+  return std::unique_ptr<OutputBuffer>(new FileBuffer(std::move(*B)));
+}
@@ -0,0 +1,57 @@
+//===- OutputBuffer.h -------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_OUTPUT_BUFFER_H
+#define LLD_ELF_OUTPUT_BUFFER_H
+
+#include "lld/Core/LLVM.h"
+#include "llvm/Support/ErrorOr.h"
+
+#include <memory>
+
+namespace lld {
+namespace elf {
+
+// A writable, mmap'ed view of the output file.
+//
+// The portable implementation wraps llvm::FileOutputBuffer. On Linux the
+// file is created at its final size with fallocate so writeback never has
+// to allocate blocks, the mapping is prefaulted, and flushRegion starts
+// asynchronous writeback of finished ranges while other sections are
+// still being written, so little dirty data is left by the time the
+// buffer is committed.
+class OutputBuffer {
+public:
+  static ErrorOr<std::unique_ptr<OutputBuffer>> create(StringRef Path,
+                                                       size_t Size);
+  virtual ~OutputBuffer() = default;
+
+  uint8_t *getBufferStart() const { return Start; }
+  size_t getBufferSize() const { return Size; }
+
+  // Called when a disjoint region of the buffer has received its final
+  // contents. May start asynchronous writeback of the region; never
+  // blocks. Regions may be flushed from concurrent threads.
+  virtual void flushRegion(size_t Off, size_t Len) {}
+
+  // Flushes the buffer to the final output path. The buffer contents
+  // must not be accessed after this returns.
+  virtual std::error_code commit() = 0;
+
+protected:
+  OutputBuffer(uint8_t *Start, size_t Size) : Start(Start), Size(Size) {}
+
+  uint8_t *Start;
+  size_t Size;
+};
+
+} // namespace elf
+} // namespace lld
+
+#endif
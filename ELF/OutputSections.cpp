@@ -9,11 +9,15 @@
 
 #include "OutputSections.h"
 #include "Config.h"
+#include "Counters.h"
 #include "EhFrame.h"
 #include "LinkerScript.h"
 #include "SymbolTable.h"
 #include "Target.h"
 #include "lld/Core/Parallel.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/MathExtras.h"
@@ -126,13 +130,16 @@ void GotSection<ELFT>::addMipsEntry(SymbolBody &Sym, uintX_t Addend,
   // See "Global Offset Table" in Chapter 5:
   // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf
   if (Expr == R_MIPS_GOT_LOCAL_PAGE) {
-    // At this point we do not know final symbol value so to reduce number
-    // of allocated GOT entries do the following trick. Save all output
-    // sections referenced by GOT relocations. Then later in the `finalize`
-    // method calculate number of "pages" required to cover all saved output
-    // section and allocate appropriate number of GOT entries.
-    auto *OutSec = cast<DefinedRegular<ELFT>>(&Sym)->Section->OutSec;
-    MipsOutSections.insert(OutSec);
+    // The relocation addresses a 64kb "page" of the symbol's output
+    // section rather than the symbol itself, and a page entry is shared
+    // by every relocation that lands on the same page regardless of the
+    // file it came from. At this point we do not know final symbol
+    // values, so just record the (symbol, addend) pair deduplicated by
+    // hash. Later the `finalize` method computes the exact set of
+    // referenced pages from section offsets and allocates one GOT entry
+    // per page instead of reserving entries for every possible page of
+    // the referenced output sections.
+    MipsLocalPageRefs.insert({&Sym, Addend});
     return;
   }
   if (Sym.isTls()) {
@@ -192,7 +199,7 @@ GotSection<ELFT>::getMipsLocalPageOffset(uintX_t EntryValue) {
   // See comment in the GotSection::writeTo.
   size_t NewIndex = MipsLocalGotPos.size() + 2;
   auto P = MipsLocalGotPos.insert(std::make_pair(EntryValue, NewIndex));
-  assert(!P.second || MipsLocalGotPos.size() <= MipsPageEntries);
+  assert(!P.second || MipsLocalGotPos.size() + 2 <= MipsPageEntries);
   return (uintX_t)P.first->second * sizeof(uintX_t) - MipsGPOffset;
 }
 
@@ -248,15 +255,36 @@ template <class ELFT> void GotSection<ELFT>::finalize() {
     // Take into account MIPS GOT header.
     // See comment in the GotSection::writeTo.
     MipsPageEntries += 2;
-    for (const OutputSectionBase<ELFT> *OutSec : MipsOutSections) {
-      // Calculate an upper bound of MIPS GOT entries required to store page
-      // addresses of local symbols. We assume the worst case - each 64kb
-      // page of the output section has at least one GOT relocation against it.
-      // Add 0x8000 to the section's size because the page address stored
-      // in the GOT entry is calculated as (value + 0x8000) & ~0xffff.
-      MipsPageEntries += (OutSec->getSize() + 0x8000 + 0xfffe) / 0xffff;
+    // Section offsets are known by now, so the referenced pages can be
+    // counted: entries land on the page of (offset + 0x8000) rounded
+    // down to 64kb, and distinct pages are deduplicated across all
+    // files by hash. The output section's base address is not assigned
+    // yet; adding it shifts every reference by the same amount, which
+    // can move it from its offset-page to the next one but never
+    // further, so reserving every referenced page plus its successor
+    // covers any base address.
+    llvm::DenseSet<std::pair<const OutputSectionBase<ELFT> *, uintX_t>> Pages;
+    for (const std::pair<const SymbolBody *, uintX_t> &P : MipsLocalPageRefs) {
+      auto *D = cast<DefinedRegular<ELFT>>(P.first);
+      InputSectionBase<ELFT> *Sec = D->Section;
+      uintX_t Off = Sec->getOffset(D->Value) + P.second;
+      Pages.insert({Sec->OutSec, (Off + 0x8000) >> 16});
     }
+    MipsPageEntries += Pages.size();
+    for (const std::pair<const OutputSectionBase<ELFT> *, uintX_t> &P : Pages)
+      if (!Pages.count({P.first, P.second + 1}))
+        ++MipsPageEntries;
     EntriesNum += MipsPageEntries + MipsLocal.size() + MipsGlobal.size();
+    // The GOT is addressed by 16-bit signed gp-relative offsets and gp
+    // points 0x7ff0 bytes past the GOT start, so entries past 0xfff0
+    // bytes are unreachable. Multi-GOT is not supported yet; report the
+    // overflow here as one message instead of an out-of-range error for
+    // every GOT relocation while the sections are being written.
+    if (EntriesNum * sizeof(uintX_t) > 0xfff0)
+      error("MIPS GOT requires " + Twine(EntriesNum) + " entries (" +
+            Twine(EntriesNum * sizeof(uintX_t)) + " bytes) and exceeds the " +
+            "gp-addressable range; multi-GOT is not supported, the link " +
+            "must be split");
   }
   this->Header.sh_size = EntriesNum * sizeof(uintX_t);
 }
@@ -354,12 +382,47 @@ RelocationSection<ELFT>::RelocationSection(StringRef Name, bool Sort)
 
 template <class ELFT>
 void RelocationSection<ELFT>::addReloc(const DynamicReloc<ELFT> &Reloc) {
+  // With --pack-dyn-relocs=relr, relative relocations go to .relr.dyn.
+  // .rela.plt never carries relative relocations, so this only ever
+  // diverts from .rela.dyn.
+  if (Out<ELFT>::RelrDyn && RelrSection<ELFT>::canEncode(Reloc)) {
+    Out<ELFT>::RelrDyn->addReloc(Reloc);
+    return;
+  }
   Relocs.push_back(Reloc);
 }
 
-template <class ELFT, class RelTy>
-static bool compRelocations(const RelTy &A, const RelTy &B) {
-  return A.getSymbol(Config->Mips64EL) < B.getSymbol(Config->Mips64EL);
+// Sorts emitted relocation records for -z combreloc: by symbol index
+// so the loader can batch lookups of the same symbol, then by r_offset
+// so its writes walk the address space sequentially. Most dynamic
+// relocations are relative ones with symbol index 0, which thus come
+// out fully offset-sorted and give sequential page touches at startup.
+// The original position breaks remaining ties so the non-stable
+// parallel sort emits the same bytes as a serial one.
+template <class RelTy> static void sortRelocs(RelTy *Begin, RelTy *End) {
+  struct Entry {
+    RelTy Rec;
+    size_t Idx;
+  };
+  std::vector<Entry> V;
+  V.reserve(End - Begin);
+  for (RelTy *P = Begin; P != End; ++P)
+    V.push_back({*P, V.size()});
+  auto Less = [](const Entry &A, const Entry &B) {
+    uint32_t SymA = A.Rec.getSymbol(Config->Mips64EL);
+    uint32_t SymB = B.Rec.getSymbol(Config->Mips64EL);
+    if (SymA != SymB)
+      return SymA < SymB;
+    if (A.Rec.r_offset != B.Rec.r_offset)
+      return A.Rec.r_offset < B.Rec.r_offset;
+    return A.Idx < B.Idx;
+  };
+  if (Config->Threads)
+    parallel_sort(V.begin(), V.end(), Less);
+  else
+    std::sort(V.begin(), V.end(), Less);
+  for (size_t I = 0, E = V.size(); I != E; ++I)
+    Begin[I] = V[I].Rec;
 }
 
 template <class ELFT> void RelocationSection<ELFT>::writeTo(uint8_t *Buf) {
@@ -381,12 +444,9 @@ template <class ELFT> void RelocationSection<ELFT>::writeTo(uint8_t *Buf) {
 
   if (Sort) {
     if (Config->Rela)
-      std::stable_sort((Elf_Rela *)BufBegin,
-                       (Elf_Rela *)BufBegin + Relocs.size(),
-                       compRelocations<ELFT, Elf_Rela>);
+      sortRelocs((Elf_Rela *)BufBegin, (Elf_Rela *)BufBegin + Relocs.size());
     else
-      std::stable_sort((Elf_Rel *)BufBegin, (Elf_Rel *)BufBegin + Relocs.size(),
-                       compRelocations<ELFT, Elf_Rel>);
+      sortRelocs((Elf_Rel *)BufBegin, (Elf_Rel *)BufBegin + Relocs.size());
   }
 }
 
@@ -400,6 +460,89 @@ template <class ELFT> void RelocationSection<ELFT>::finalize() {
   this->Header.sh_size = Relocs.size() * this->Header.sh_entsize;
 }
 
+// SHT_RELR and its dynamic tags are not in the 3.9 ELF headers yet.
+// These are the values from the proposal implemented by glibc and the
+// Android loader.
+enum {
+  SHT_RELR = 19,
+  DT_RELRSZ = 35,
+  DT_RELR = 36,
+  DT_RELRENT = 37,
+};
+
+template <class ELFT>
+RelrSection<ELFT>::RelrSection()
+    : OutputSectionBase<ELFT>(".relr.dyn", SHT_RELR, SHF_ALLOC) {
+  this->Header.sh_entsize = sizeof(uintX_t);
+  this->Header.sh_addralign = sizeof(uintX_t);
+}
+
+template <class ELFT>
+void RelrSection<ELFT>::addReloc(const DynamicReloc<ELFT> &Reloc) {
+  Relocs.push_back(Reloc);
+}
+
+// The packed encoding stores neither an addend nor a symbol, so it can
+// only represent a relative relocation whose value is known at link
+// time, and it can only describe word-aligned locations.
+template <class ELFT>
+bool RelrSection<ELFT>::canEncode(const DynamicReloc<ELFT> &Reloc) {
+  if (Reloc.Type != Target->RelativeRel || !Reloc.UseSymVA)
+    return false;
+  if (Reloc.OffsetInSec % sizeof(uintX_t) != 0)
+    return false;
+  if (Reloc.InputSec)
+    return Reloc.InputSec->Alignment >= sizeof(uintX_t);
+  return Reloc.OutputSec->getAlignment() >= sizeof(uintX_t);
+}
+
+template <class ELFT> void RelrSection<ELFT>::finalize() {
+  this->Header.sh_link = Out<ELFT>::DynSymTab->SectionIndex;
+
+  // Addresses have not been assigned yet, so the exact encoded size is
+  // unknown. One address word per relocation is the worst case; the
+  // writer pads whatever is left with empty bitmap words.
+  this->Header.sh_size = Relocs.size() * sizeof(uintX_t);
+}
+
+template <class ELFT> void RelrSection<ELFT>::writeTo(uint8_t *Buf) {
+  std::vector<uintX_t> Offsets;
+  Offsets.reserve(Relocs.size());
+  for (const DynamicReloc<ELFT> &Rel : Relocs)
+    Offsets.push_back(Rel.getOffset());
+  std::sort(Offsets.begin(), Offsets.end());
+
+  size_t NumWords = 0;
+  auto Write = [&](uintX_t Word) {
+    write<uintX_t, ELFT::TargetEndianness, sizeof(uintX_t)>(
+        Buf + NumWords++ * sizeof(uintX_t), Word);
+  };
+
+  // An even word starts a run by relocating the location it names.
+  // Each following odd word is a bitmap whose bits 1..N-1 relocate the
+  // next N-1 words after the last address covered, where N is the
+  // number of bits in a word.
+  const uintX_t NBits = 8 * sizeof(uintX_t) - 1;
+  for (size_t I = 0, E = Offsets.size(); I != E;) {
+    uintX_t Base = Offsets[I++];
+    Write(Base);
+    Base += sizeof(uintX_t);
+    for (;;) {
+      uintX_t Bitmap = 0;
+      for (; I != E && Offsets[I] - Base < NBits * sizeof(uintX_t); ++I)
+        Bitmap |= uintX_t(1) << ((Offsets[I] - Base) / sizeof(uintX_t) + 1);
+      if (!Bitmap)
+        break;
+      Write(Bitmap | 1);
+      Base += NBits * sizeof(uintX_t);
+    }
+  }
+
+  // Fill the worst-case sizing up with bitmaps that cover nothing.
+  while (NumWords * sizeof(uintX_t) < this->Header.sh_size)
+    Write(1);
+}
+
 template <class ELFT>
 InterpSection<ELFT>::InterpSection()
     : OutputSectionBase<ELFT>(".interp", SHT_PROGBITS, SHF_ALLOC) {
@@ -456,21 +599,13 @@ template <class ELFT> void HashTableSection<ELFT>::writeTo(uint8_t *Buf) {
   for (const std::pair<SymbolBody *, unsigned> &P :
        Out<ELFT>::DynSymTab->getSymbols()) {
     SymbolBody *Body = P.first;
-    StringRef Name = Body->getName();
     unsigned I = Body->DynsymIndex;
-    uint32_t Hash = hashSysv(Name) % NumSymbols;
+    uint32_t Hash = Body->getSysvHash() % NumSymbols;
     Chains[I] = Buckets[Hash];
     Buckets[Hash] = I;
   }
 }
 
-static uint32_t hashGnu(StringRef Name) {
-  uint32_t H = 5381;
-  for (uint8_t C : Name)
-    H = (H << 5) + H + C;
-  return H;
-}
-
 template <class ELFT>
 GnuHashTableSection<ELFT>::GnuHashTableSection()
     : OutputSectionBase<ELFT>(".gnu.hash", SHT_GNU_HASH, SHF_ALLOC) {
@@ -547,13 +682,43 @@ void GnuHashTableSection<ELFT>::writeHeader(uint8_t *&Buf) {
 template <class ELFT>
 void GnuHashTableSection<ELFT>::writeBloomFilter(uint8_t *&Buf) {
   unsigned C = sizeof(Elf_Off) * 8;
-
   auto *Masks = reinterpret_cast<Elf_Off *>(Buf);
-  for (const SymbolData &Sym : Symbols) {
-    size_t Pos = (Sym.Hash / C) & (MaskWords - 1);
-    uintX_t V = (uintX_t(1) << (Sym.Hash % C)) |
-                (uintX_t(1) << ((Sym.Hash >> Shift2) % C));
-    Masks[Pos] |= V;
+
+  // With millions of dynamic symbols the scattered single-bit ORs
+  // dominate this function. Shard the symbol list, OR each shard into
+  // a private mask vector, and merge the vectors; the merge touches
+  // each word once per shard, which is cheap next to the scattered
+  // stores it replaces. Small tables are not worth the setup.
+  const size_t NumShards = 8;
+  if (Config->Threads && Symbols.size() >= 8192) {
+    std::vector<std::vector<Elf_Off>> Shards(
+        NumShards, std::vector<Elf_Off>(MaskWords));
+    size_t Chunk = (Symbols.size() + NumShards - 1) / NumShards;
+    TaskGroup TG;
+    for (size_t S = 0; S != NumShards; ++S) {
+      TG.spawn([&, S, Chunk, C] {
+        std::vector<Elf_Off> &M = Shards[S];
+        size_t Begin = S * Chunk;
+        size_t End = std::min(Symbols.size(), Begin + Chunk);
+        for (size_t I = Begin; I < End; ++I) {
+          uint32_t H = Symbols[I].Hash;
+          size_t Pos = (H / C) & (MaskWords - 1);
+          M[Pos] |= (uintX_t(1) << (H % C)) |
+                    (uintX_t(1) << ((H >> Shift2) % C));
+        }
+      });
+    }
+    TG.sync();
+    for (const std::vector<Elf_Off> &M : Shards)
+      for (size_t I = 0; I != MaskWords; ++I)
+        Masks[I] |= M[I];
+  } else {
+    for (const SymbolData &Sym : Symbols) {
+      size_t Pos = (Sym.Hash / C) & (MaskWords - 1);
+      uintX_t V = (uintX_t(1) << (Sym.Hash % C)) |
+                  (uintX_t(1) << ((Sym.Hash >> Shift2) % C));
+      Masks[Pos] |= V;
+    }
   }
   Buf += sizeof(Elf_Off) * MaskWords;
 }
@@ -563,22 +728,28 @@ void GnuHashTableSection<ELFT>::writeHashTable(uint8_t *Buf) {
   Elf_Word *Buckets = reinterpret_cast<Elf_Word *>(Buf);
   Elf_Word *Values = Buckets + NBuckets;
 
-  int PrevBucket = -1;
-  int I = 0;
-  for (const SymbolData &Sym : Symbols) {
-    int Bucket = Sym.Hash % NBuckets;
-    assert(PrevBucket <= Bucket);
-    if (Bucket != PrevBucket) {
+  // Symbols are sorted by bucket, so each bucket's chain is one
+  // contiguous run of Values (and of .dynsym entries) -- the most
+  // cache-friendly layout the format permits. Whether an entry heads
+  // or terminates its run depends only on its immediate neighbors, so
+  // every entry can be written independently: the first entry of a run
+  // writes the bucket head, and the last one sets the terminator bit.
+  const SymbolData *Syms = Symbols.data();
+  size_t NumSymbols = Symbols.size();
+  auto WriteEntry = [=](const SymbolData &Sym) {
+    size_t I = &Sym - Syms;
+    uint32_t Bucket = Sym.Hash % NBuckets;
+    assert(I == 0 || Syms[I - 1].Hash % NBuckets <= Bucket);
+    if (I == 0 || Syms[I - 1].Hash % NBuckets != Bucket)
       Buckets[Bucket] = Sym.Body->DynsymIndex;
-      PrevBucket = Bucket;
-      if (I > 0)
-        Values[I - 1] |= 1;
-    }
-    Values[I] = Sym.Hash & ~1;
-    ++I;
-  }
-  if (I > 0)
-    Values[I - 1] |= 1;
+    uint32_t Terminate =
+        I + 1 == NumSymbols || Syms[I + 1].Hash % NBuckets != Bucket;
+    Values[I] = (Sym.Hash & ~1) | Terminate;
+  };
+  if (Config->Threads)
+    parallel_for_each(Symbols.begin(), Symbols.end(), WriteEntry, 4096);
+  else
+    std::for_each(Symbols.begin(), Symbols.end(), WriteEntry);
 }
 
 // Add symbols to this symbol hash table. Note that this function
@@ -587,27 +758,72 @@ void GnuHashTableSection<ELFT>::writeHashTable(uint8_t *Buf) {
 template <class ELFT>
 void GnuHashTableSection<ELFT>::addSymbols(
     std::vector<std::pair<SymbolBody *, size_t>> &V) {
-  auto Mid = std::stable_partition(V.begin(), V.end(),
-                                   [](std::pair<SymbolBody *, size_t> &P) {
-                                     return P.first->isUndefined();
-                                   });
-  if (Mid == V.end())
+  // The table wants undefined symbols first, followed by defined
+  // symbols grouped by hash bucket. Instead of partitioning the
+  // vector and then sorting the defined part in a second pass, we
+  // assign each symbol a single sort key and permute the vector once:
+  // undefined symbols get bucket 0 and defined symbols get their hash
+  // bucket plus one. The original index is the tie breaker, so the
+  // result is exactly the order the old stable partition plus stable
+  // sort produced, and we can hand the whole thing to the non-stable
+  // parallel_sort.
+  size_t NumDefined = std::count_if(
+      V.begin(), V.end(), [](const std::pair<SymbolBody *, size_t> &P) {
+        return !P.first->isUndefined();
+      });
+  if (NumDefined == 0)
     return;
-  for (auto I = Mid, E = V.end(); I != E; ++I) {
-    SymbolBody *B = I->first;
-    size_t StrOff = I->second;
-    Symbols.push_back({B, StrOff, hashGnu(B->getName())});
+  unsigned NBuckets = calcNBuckets(NumDefined);
+
+  // Hashing the names is the expensive part of building the sort keys
+  // and the result is cached per symbol, so do it for all defined
+  // symbols in parallel up front; the key-building loop below then
+  // only reads cached values. Each symbol is touched by exactly one
+  // task, so the caches are filled without races.
+  if (Config->Threads)
+    parallel_for_each(V.begin(), V.end(),
+                      [](std::pair<SymbolBody *, size_t> &P) {
+                        if (!P.first->isUndefined())
+                          P.first->getGnuHash();
+                      },
+                      1024);
+
+  struct Entry {
+    SymbolBody *Body;
+    size_t STName;
+    uint32_t Hash;
+    uint32_t Bucket;
+    size_t Idx;
+  };
+  std::vector<Entry> Entries;
+  Entries.reserve(V.size());
+  for (size_t I = 0, E = V.size(); I != E; ++I) {
+    SymbolBody *B = V[I].first;
+    if (B->isUndefined()) {
+      Entries.push_back({B, V[I].second, 0, 0, I});
+      continue;
+    }
+    uint32_t Hash = B->getGnuHash();
+    Entries.push_back({B, V[I].second, Hash, Hash % NBuckets + 1, I});
   }
 
-  unsigned NBuckets = calcNBuckets(Symbols.size());
-  std::stable_sort(Symbols.begin(), Symbols.end(),
-                   [&](const SymbolData &L, const SymbolData &R) {
-                     return L.Hash % NBuckets < R.Hash % NBuckets;
-                   });
+  auto Comp = [](const Entry &L, const Entry &R) {
+    if (L.Bucket != R.Bucket)
+      return L.Bucket < R.Bucket;
+    return L.Idx < R.Idx;
+  };
+  if (Config->Threads)
+    parallel_sort(Entries.begin(), Entries.end(), Comp);
+  else
+    std::sort(Entries.begin(), Entries.end(), Comp);
 
-  V.erase(Mid, V.end());
-  for (const SymbolData &Sym : Symbols)
-    V.push_back({Sym.Body, Sym.STName});
+  V.clear();
+  Symbols.reserve(NumDefined);
+  for (const Entry &E : Entries) {
+    V.push_back({E.Body, E.STName});
+    if (E.Bucket != 0)
+      Symbols.push_back({E.Body, E.STName, E.Hash});
+  }
 }
 
 // Returns the number of version definition entries. Because the first entry
@@ -659,6 +875,11 @@ template <class ELFT> void DynamicSection<ELFT>::finalize() {
     Add({IsRela ? DT_RELAENT : DT_RELENT,
          uintX_t(IsRela ? sizeof(Elf_Rela) : sizeof(Elf_Rel))});
   }
+  if (Out<ELFT>::RelrDyn && Out<ELFT>::RelrDyn->hasRelocs()) {
+    Add({DT_RELR, Out<ELFT>::RelrDyn});
+    Add({DT_RELRSZ, Out<ELFT>::RelrDyn->getSize()});
+    Add({DT_RELRENT, uintX_t(sizeof(uintX_t))});
+  }
   if (Out<ELFT>::RelaPlt && Out<ELFT>::RelaPlt->hasRelocs()) {
     Add({DT_JMPREL, Out<ELFT>::RelaPlt});
     Add({DT_PLTRELSZ, Out<ELFT>::RelaPlt->getSize()});
@@ -782,8 +1003,18 @@ template <class ELFT> void EhFrameHeader<ELFT>::writeTo(uint8_t *Buf) {
   // Sort the FDE list by their PC and uniqueify. Usually there is only
   // one FDE for a PC (i.e. function), but if ICF merges two functions
   // into one, there can be more than one FDEs pointing to the address.
-  auto Less = [](const FdeData &A, const FdeData &B) { return A.Pc < B.Pc; };
-  std::stable_sort(Fdes.begin(), Fdes.end(), Less);
+  // FDE VAs ascend in the order the FDEs were added, so breaking PC
+  // ties by VA keeps the first-added FDE for a duplicated PC just like
+  // a stable sort would, while letting us sort in parallel.
+  auto Less = [](const FdeData &A, const FdeData &B) {
+    if (A.Pc != B.Pc)
+      return A.Pc < B.Pc;
+    return A.FdeVA < B.FdeVA;
+  };
+  if (Config->Threads)
+    parallel_sort(Fdes.begin(), Fdes.end(), Less);
+  else
+    std::sort(Fdes.begin(), Fdes.end(), Less);
   auto Eq = [](const FdeData &A, const FdeData &B) { return A.Pc == B.Pc; };
   Fdes.erase(std::unique(Fdes.begin(), Fdes.end(), Eq), Fdes.end());
 
@@ -887,6 +1118,26 @@ template <class ELFT> void OutputSection<ELFT>::sortInitFini() {
     Sections.push_back(P.second);
 }
 
+// Reorders the input sections for --symbol-ordering-file. Ranked
+// sections move to the front in rank order; all other sections keep
+// their relative discovery order behind them.
+template <class ELFT>
+void OutputSection<ELFT>::sortByOrder(
+    const llvm::DenseMap<InputSectionBase<ELFT> *, int> &Order) {
+  typedef std::pair<int, InputSection<ELFT> *> Pair;
+
+  std::vector<Pair> V;
+  for (InputSection<ELFT> *S : Sections) {
+    auto It = Order.find(S);
+    V.push_back({It == Order.end() ? INT_MAX : It->second, S});
+  }
+  std::stable_sort(V.begin(), V.end(),
+                   [](const Pair &A, const Pair &B) { return A.first < B.first; });
+  Sections.clear();
+  for (Pair &P : V)
+    Sections.push_back(P.second);
+}
+
 // Returns true if S matches /Filename.?\.o$/.
 static bool isCrtBeginEnd(StringRef S, StringRef Filename) {
   if (!S.endswith(".o"))
@@ -954,13 +1205,53 @@ static void fill(uint8_t *Buf, size_t Size, ArrayRef<uint8_t> A) {
   memcpy(Buf + I, A.data(), Size - I);
 }
 
+// With --compress-debug-sections, non-allocated .debug_* sections are
+// emitted as SHF_COMPRESSED sections: an Elf_Chdr followed by a single
+// zlib stream. Debug relocations use the virtual addresses assigned to
+// the allocated sections, so this can only run once addresses are
+// known; and since compression shrinks the section, it must run before
+// file offsets are assigned.
+template <class ELFT> void OutputSection<ELFT>::maybeCompress() {
+  typedef typename std::conditional<ELFT::Is64Bits, Elf64_Chdr,
+                                    Elf32_Chdr>::type Elf_Chdr;
+
+  if (!Config->CompressDebugSections || (this->getFlags() & SHF_ALLOC) ||
+      !this->getName().startswith(".debug_") || this->getSize() == 0)
+    return;
+
+  std::vector<uint8_t> Uncompressed(this->getSize());
+  writeTo(Uncompressed.data());
+
+  StringRef Content((const char *)Uncompressed.data(), Uncompressed.size());
+  if (zlib::compress(Content, CompressedData) != zlib::StatusOK)
+    fatal("compressing section " + this->getName() + " failed");
+
+  UncompressedSize = this->getSize();
+  this->Header.sh_flags |= SHF_COMPRESSED;
+  this->Header.sh_size = sizeof(Elf_Chdr) + CompressedData.size();
+  this->updateAlignment(sizeof(uintX_t));
+}
+
 template <class ELFT> void OutputSection<ELFT>::writeTo(uint8_t *Buf) {
+  typedef typename std::conditional<ELFT::Is64Bits, Elf64_Chdr,
+                                    Elf32_Chdr>::type Elf_Chdr;
+
+  if (UncompressedSize) {
+    auto *Chdr = reinterpret_cast<Elf_Chdr *>(Buf);
+    Chdr->ch_type = ELFCOMPRESS_ZLIB;
+    Chdr->ch_size = UncompressedSize;
+    Chdr->ch_addralign = this->getAlignment();
+    memcpy(Buf + sizeof(Elf_Chdr), CompressedData.data(),
+           CompressedData.size());
+    return;
+  }
+
   ArrayRef<uint8_t> Filler = Script<ELFT>::X->getFiller(this->Name);
   if (!Filler.empty())
     fill(Buf, this->getSize(), Filler);
   if (Config->Threads) {
     parallel_for_each(Sections.begin(), Sections.end(),
-                      [=](InputSection<ELFT> *C) { C->writeTo(Buf); });
+                      [=](InputSection<ELFT> *C) { C->writeTo(Buf); }, 16);
   } else {
     for (InputSection<ELFT> *C : Sections)
       C->writeTo(Buf);
@@ -1036,6 +1327,24 @@ bool EhOutputSection<ELFT>::isFdeLive(SectionPiece &Piece,
   return Target && Target->Live;
 }
 
+// Determines liveness of every FDE record in a section. This only
+// reads the section, its relocations and Live bits of other sections,
+// so mergeFrames can run it for all sections concurrently. The result
+// is recorded in the Live bit of each piece.
+template <class ELFT>
+template <class RelTy>
+void EhOutputSection<ELFT>::scanSection(EhInputSection<ELFT> *Sec,
+                                        ArrayRef<RelTy> Rels) {
+  const endianness E = ELFT::TargetEndianness;
+  for (SectionPiece &Piece : Sec->Pieces) {
+    // The empty record is the end marker.
+    if (Piece.size() == 4)
+      return;
+    if (read32<E>(Piece.data().data() + 4) != 0)
+      Piece.Live = isFdeLive(Piece, Sec, Rels);
+  }
+}
+
 // .eh_frame is a sequence of CIE or FDE records. In general, there
 // is one CIE record per input object file which is followed by
 // a list of FDEs. This function searches an existing CIE or create a new
@@ -1064,7 +1373,8 @@ void EhOutputSection<ELFT>::addSectionAux(EhInputSection<ELFT> *Sec,
     if (!Cie)
       fatal("invalid CIE reference");
 
-    if (!isFdeLive(Piece, Sec, Rels))
+    // Liveness was computed by scanSection.
+    if (!Piece.Live)
       continue;
     Cie->FdePieces.push_back(&Piece);
     NumFdes++;
@@ -1077,23 +1387,51 @@ void EhOutputSection<ELFT>::addSection(InputSectionBase<ELFT> *C) {
   Sec->OutSec = this;
   this->updateAlignment(Sec->Alignment);
   Sections.push_back(Sec);
+}
 
-  // .eh_frame is a sequence of CIE or FDE records. This function
-  // splits it into pieces so that we can call
-  // SplitInputSection::getSectionPiece on the section.
-  Sec->split();
-  if (Sec->Pieces.empty())
-    return;
-
-  if (const Elf_Shdr *RelSec = Sec->RelocSection) {
-    ELFFile<ELFT> &Obj = Sec->getFile()->getObj();
-    if (RelSec->sh_type == SHT_RELA)
-      addSectionAux(Sec, Obj.relas(RelSec));
-    else
-      addSectionAux(Sec, Obj.rels(RelSec));
-    return;
+// Splits all registered sections into CIE/FDE records and decides
+// which FDEs survive, then merges the records in input order. Record
+// parsing and the FDE liveness checks are independent between
+// sections, so that part runs in parallel; CIE uniquing stays serial
+// to keep the output CIE order deterministic, but by then it only
+// sees a handful of records per file.
+template <class ELFT> void EhOutputSection<ELFT>::mergeFrames() {
+  auto Scan = [this](EhInputSection<ELFT> *Sec) {
+    // .eh_frame is a sequence of CIE or FDE records. Split the
+    // section into pieces so that we can call
+    // SplitInputSection::getSectionPiece on the section.
+    Sec->split();
+    if (Sec->Pieces.empty())
+      return;
+    if (const Elf_Shdr *RelSec = Sec->RelocSection) {
+      ELFFile<ELFT> &Obj = Sec->getFile()->getObj();
+      if (RelSec->sh_type == SHT_RELA)
+        scanSection(Sec, Obj.relas(RelSec));
+      else
+        scanSection(Sec, Obj.rels(RelSec));
+      return;
+    }
+    scanSection(Sec, makeArrayRef<Elf_Rela>(nullptr, nullptr));
+  };
+  if (Config->Threads)
+    parallel_for_each(Sections.begin(), Sections.end(), Scan, 1);
+  else
+    for (EhInputSection<ELFT> *Sec : Sections)
+      Scan(Sec);
+
+  for (EhInputSection<ELFT> *Sec : Sections) {
+    if (Sec->Pieces.empty())
+      continue;
+    if (const Elf_Shdr *RelSec = Sec->RelocSection) {
+      ELFFile<ELFT> &Obj = Sec->getFile()->getObj();
+      if (RelSec->sh_type == SHT_RELA)
+        addSectionAux(Sec, Obj.relas(RelSec));
+      else
+        addSectionAux(Sec, Obj.rels(RelSec));
+      continue;
+    }
+    addSectionAux(Sec, makeArrayRef<Elf_Rela>(nullptr, nullptr));
   }
-  addSectionAux(Sec, makeArrayRef<Elf_Rela>(nullptr, nullptr));
 }
 
 template <class ELFT>
@@ -1193,18 +1531,33 @@ template <class ELFT> void EhOutputSection<ELFT>::writeTo(uint8_t *Buf) {
 template <class ELFT>
 MergeOutputSection<ELFT>::MergeOutputSection(StringRef Name, uint32_t Type,
                                              uintX_t Flags, uintX_t Alignment)
-    : OutputSectionBase<ELFT>(Name, Type, Flags),
-      Builder(llvm::StringTableBuilder::RAW, Alignment) {}
+    : OutputSectionBase<ELFT>(Name, Type, Flags) {
+  for (unsigned I = 0; I != NumShards; ++I)
+    Shards.push_back(llvm::make_unique<Shard>(Alignment));
+}
 
 template <class ELFT> void MergeOutputSection<ELFT>::writeTo(uint8_t *Buf) {
-  if (shouldTailMerge()) {
-    StringRef Data = Builder.data();
-    memcpy(Buf, Data.data(), Data.size());
-    return;
-  }
-  for (const std::pair<CachedHash<StringRef>, size_t> &P : Builder.getMap()) {
-    StringRef Data = P.first.Val;
-    memcpy(Buf + P.second, Data.data(), Data.size());
+  // Shards cover disjoint ranges of the output, so they can be
+  // copied out concurrently.
+  auto CopyShard = [=](Shard *Sh) {
+    if (shouldTailMerge()) {
+      StringRef Data = Sh->Builder.data();
+      memcpy(Buf + Sh->Base, Data.data(), Data.size());
+      return;
+    }
+    for (const std::pair<CachedHash<StringRef>, size_t> &P :
+         Sh->Builder.getMap()) {
+      StringRef Data = P.first.Val;
+      memcpy(Buf + Sh->Base + P.second, Data.data(), Data.size());
+    }
+  };
+  if (Config->Threads) {
+    TaskGroup Tg;
+    for (std::unique_ptr<Shard> &Sh : Shards)
+      Tg.spawn([&CopyShard, &Sh] { CopyShard(Sh.get()); });
+  } else {
+    for (std::unique_ptr<Shard> &Sh : Shards)
+      CopyShard(Sh.get());
   }
 }
 
@@ -1212,6 +1565,14 @@ static StringRef toStringRef(ArrayRef<uint8_t> A) {
   return {(const char *)A.data(), A.size()};
 }
 
+// We do not use the default StringRef hash because it differs between
+// 32 and 64 bit hosts; shard assignment must be reproducible when
+// cross linking.
+template <class ELFT>
+unsigned MergeOutputSection<ELFT>::getShardId(StringRef Val) {
+  return llvm::HashString(Val) % NumShards;
+}
+
 template <class ELFT>
 void MergeOutputSection<ELFT>::addSection(InputSectionBase<ELFT> *C) {
   auto *Sec = cast<MergeInputSection<ELFT>>(C);
@@ -1219,21 +1580,70 @@ void MergeOutputSection<ELFT>::addSection(InputSectionBase<ELFT> *C) {
   this->updateAlignment(Sec->Alignment);
   this->Header.sh_entsize = Sec->getSectionHdr()->sh_entsize;
   Sections.push_back(Sec);
+}
 
-  bool IsString = this->Header.sh_flags & SHF_STRINGS;
-
-  for (SectionPiece &Piece : Sec->Pieces) {
-    if (!Piece.Live)
-      continue;
-    uintX_t OutputOffset = Builder.add(toStringRef(Piece.data()));
-    if (!IsString || !shouldTailMerge())
-      Piece.OutputOff = OutputOffset;
+// Deduplicates the pieces of all added sections. Each shard's builder
+// is filled on its own thread; a piece belongs to exactly one shard,
+// so the threads never touch the same piece or builder. For
+// non-tail-merged sections this also assigns final output offsets,
+// which relocation scanning relies on to detect dead pieces, so it
+// must run before scanRelocations.
+template <class ELFT> void MergeOutputSection<ELFT>::mergePieces() {
+  bool TailMerge = shouldTailMerge();
+
+  TaskGroup Tg;
+  for (unsigned I = 0; I != NumShards; ++I) {
+    Tg.spawn([=] {
+      Shard &Sh = *Shards[I];
+      uint64_t Bytes = 0;
+      for (MergeInputSection<ELFT> *Sec : Sections) {
+        for (SectionPiece &Piece : Sec->Pieces) {
+          if (!Piece.Live)
+            continue;
+          // Shard selection uses the hash computed when the section
+          // was split, so piece contents are not re-read here.
+          if (Piece.Hash % NumShards != I)
+            continue;
+          Bytes += Piece.size();
+          size_t Off = Sh.Builder.add(toStringRef(Piece.data()));
+          if (!TailMerge)
+            Piece.OutputOff = Off;
+        }
+      }
+      LLD_COUNT_N(BytesMerged, Bytes);
+      // Offsets of tail-merged strings are computed lazily in
+      // finalizePieces, so the builder can be finalized right here.
+      if (TailMerge)
+        Sh.Builder.finalize();
+    });
+  }
+  Tg.sync();
+
+  // Lay the shards out back to back. Builders pad every entry to the
+  // section alignment, so the bases stay properly aligned.
+  uintX_t Off = 0;
+  for (std::unique_ptr<Shard> &Sh : Shards) {
+    Sh->Base = Off;
+    Off += Sh->Builder.getSize();
   }
+
+  if (!TailMerge)
+    parallel_for_each(Sections.begin(), Sections.end(),
+                      [&](MergeInputSection<ELFT> *Sec) {
+                        for (SectionPiece &Piece : Sec->Pieces) {
+                          if (!Piece.Live)
+                            continue;
+                          Piece.OutputOff +=
+                              Shards[Piece.Hash % NumShards]->Base;
+                        }
+                      },
+                      1);
 }
 
 template <class ELFT>
 unsigned MergeOutputSection<ELFT>::getOffset(StringRef Val) {
-  return Builder.getOffset(Val);
+  Shard &Sh = *Shards[getShardId(Val)];
+  return Sh.Base + Sh.Builder.getOffset(Val);
 }
 
 template <class ELFT> bool MergeOutputSection<ELFT>::shouldTailMerge() const {
@@ -1241,9 +1651,8 @@ template <class ELFT> bool MergeOutputSection<ELFT>::shouldTailMerge() const {
 }
 
 template <class ELFT> void MergeOutputSection<ELFT>::finalize() {
-  if (shouldTailMerge())
-    Builder.finalize();
-  this->Header.sh_size = Builder.getSize();
+  Shard &Last = *Shards.back();
+  this->Header.sh_size = Last.Base + Last.Builder.getSize();
 }
 
 template <class ELFT> void MergeOutputSection<ELFT>::finalizePieces() {
@@ -1276,7 +1685,50 @@ unsigned StringTableSection<ELFT>::addString(StringRef S, bool HashIt) {
   return Ret;
 }
 
+// Only the static symbol string table can be tail-merged: its offsets are
+// read back through getOffset() when the symbol table is written, while
+// .shstrtab and .dynstr offsets are stored into section headers and dynamic
+// entries as they are handed out.
+template <class ELFT> void StringTableSection<ELFT>::finalize() {
+  if (Config->Optimize >= 2 && this == Out<ELFT>::StrTab)
+    tailMerge();
+  this->Header.sh_size = getSize();
+}
+
+// Rebuilds the table so that a string that is a suffix of another shares
+// the other's tail. Mangled names repeat the same suffixes across objects,
+// so this is surprisingly effective on the .strtab of debug binaries.
+template <class ELFT> void StringTableSection<ELFT>::tailMerge() {
+  Merged.reset(new StringTableBuilder(StringTableBuilder::ELF));
+  for (StringRef S : Strings)
+    Merged->add(S);
+  Merged->finalize();
+
+  // Relocate the offsets we have already handed out. Looking every string
+  // up again is pure hash queries against the now-frozen builder, so the
+  // lookups run in parallel; the map is filled serially from the results.
+  std::vector<unsigned> FinalOff(Strings.size());
+  StringRef *Base = Strings.data();
+  auto Lookup = [&](StringRef &S) { FinalOff[&S - Base] = Merged->getOffset(S); };
+  if (Config->Threads)
+    parallel_for_each(Strings.begin(), Strings.end(), Lookup, 4096);
+  else
+    std::for_each(Strings.begin(), Strings.end(), Lookup);
+
+  unsigned Off = 1;
+  OffsetMap[0] = 0;
+  for (size_t I = 0, E = Strings.size(); I != E; ++I) {
+    OffsetMap[Off] = FinalOff[I];
+    Off += Strings[I].size() + 1;
+  }
+}
+
 template <class ELFT> void StringTableSection<ELFT>::writeTo(uint8_t *Buf) {
+  if (Merged) {
+    StringRef Data = Merged->data();
+    memcpy(Buf, Data.data(), Data.size());
+    return;
+  }
   // ELF string tables start with NUL byte, so advance the pointer by one.
   ++Buf;
   for (StringRef S : Strings) {
@@ -1358,12 +1810,12 @@ template <class ELFT> void SymbolTableSection<ELFT>::finalize() {
   }
 
   if (!StrTabSec.isDynamic()) {
-    std::stable_sort(Symbols.begin(), Symbols.end(),
-                     [](const std::pair<SymbolBody *, unsigned> &L,
-                        const std::pair<SymbolBody *, unsigned> &R) {
-                       return getSymbolBinding(L.first) == STB_LOCAL &&
-                              getSymbolBinding(R.first) != STB_LOCAL;
-                     });
+    // Moving locals before globals is a binary partition, so we don't
+    // need a full sort for it.
+    std::stable_partition(Symbols.begin(), Symbols.end(),
+                          [](const std::pair<SymbolBody *, unsigned> &P) {
+                            return getSymbolBinding(P.first) == STB_LOCAL;
+                          });
     return;
   }
   if (Out<ELFT>::GnuHashTab)
@@ -1412,7 +1864,7 @@ void SymbolTableSection<ELFT>::writeLocalSymbols(uint8_t *&Buf) {
         ESym->st_shndx = OutSec->SectionIndex;
         ESym->st_value = OutSec->getVA() + Section->getOffset(Body);
       }
-      ESym->st_name = P.second;
+      ESym->st_name = StrTabSec.getOffset(P.second);
       ESym->st_size = Body.template getSize<ELFT>();
       ESym->setBindingAndType(STB_LOCAL, Body.Type);
       Buf += sizeof(*ESym);
@@ -1423,9 +1875,10 @@ void SymbolTableSection<ELFT>::writeLocalSymbols(uint8_t *&Buf) {
 template <class ELFT>
 void SymbolTableSection<ELFT>::writeGlobalSymbols(uint8_t *Buf) {
   // Write the internal symbol table contents to the output symbol table
-  // pointed by Buf.
-  auto *ESym = reinterpret_cast<Elf_Sym *>(Buf);
-  for (const std::pair<SymbolBody *, size_t> &P : Symbols) {
+  // pointed by Buf. Each symbol gets a fixed slot, so the loop is
+  // trivially parallel.
+  auto Write = [=](const std::pair<SymbolBody *, size_t> &P) {
+    auto *ESym = reinterpret_cast<Elf_Sym *>(Buf) + (&P - Symbols.data());
     SymbolBody *Body = P.first;
     size_t StrOff = P.second;
 
@@ -1434,7 +1887,7 @@ void SymbolTableSection<ELFT>::writeGlobalSymbols(uint8_t *Buf) {
 
     ESym->setBindingAndType(getSymbolBinding(Body), Type);
     ESym->st_size = Size;
-    ESym->st_name = StrOff;
+    ESym->st_name = StrTabSec.getOffset(StrOff);
     ESym->setVisibility(Body->symbol()->Visibility);
     ESym->st_value = Body->getVA<ELFT>();
 
@@ -1450,7 +1903,12 @@ void SymbolTableSection<ELFT>::writeGlobalSymbols(uint8_t *Buf) {
     if (Config->EMachine == EM_MIPS && Body->isInPlt() &&
         Body->NeedsCopyOrPltAddr)
       ESym->st_other |= STO_MIPS_PLT;
-    ++ESym;
+  };
+  if (Config->Threads) {
+    parallel_for_each(Symbols.begin(), Symbols.end(), Write);
+  } else {
+    for (const std::pair<SymbolBody *, size_t> &P : Symbols)
+      Write(P);
   }
 }
 
@@ -1581,12 +2039,20 @@ template <class ELFT> void VersionTableSection<ELFT>::finalize() {
 }
 
 template <class ELFT> void VersionTableSection<ELFT>::writeTo(uint8_t *Buf) {
+  // Every entry is an independent copy of a precomputed VersionId, so
+  // the table can be filled on the thread pool. The entries are tiny;
+  // a large grain keeps the task overhead below the copying itself.
+  ArrayRef<std::pair<SymbolBody *, size_t>> Syms =
+      Out<ELFT>::DynSymTab->getSymbols();
   auto *OutVersym = reinterpret_cast<Elf_Versym *>(Buf) + 1;
-  for (const std::pair<SymbolBody *, size_t> &P :
-       Out<ELFT>::DynSymTab->getSymbols()) {
-    OutVersym->vs_index = P.first->symbol()->VersionId;
-    ++OutVersym;
-  }
+  auto Write = [=](const std::pair<SymbolBody *, size_t> &P) {
+    OutVersym[&P - Syms.begin()].vs_index = P.first->symbol()->VersionId;
+  };
+  if (Config->Threads)
+    parallel_for_each(Syms.begin(), Syms.end(), Write, 4096);
+  else
+    for (const std::pair<SymbolBody *, size_t> &P : Syms)
+      Write(P);
 }
 
 template <class ELFT>
@@ -1610,16 +2076,27 @@ void VersionNeedSection<ELFT>::addSymbol(SharedSymbol<ELFT> *SS) {
   // If we don't already know that we need an Elf_Verneed for this DSO, prepare
   // to create one by adding it to our needed list and creating a dynstr entry
   // for the soname.
-  if (F->VerdefMap.empty())
+  if (F->VernauxNum == 0)
     Needed.push_back({F, Out<ELFT>::DynStrTab->addString(F->getSoName())});
-  typename SharedFile<ELFT>::NeededVer &NV = F->VerdefMap[SS->Verdef];
+
+  // Vernaux slots are indexed by verdef identifier so the lookup is an
+  // array access and writeTo can emit them in the DSO's own definition
+  // order without sorting.
+  unsigned VerdefIndex = SS->Verdef->vd_ndx;
+  if (F->NeededVers.size() <= VerdefIndex)
+    F->NeededVers.resize(VerdefIndex + 1);
+  typename SharedFile<ELFT>::NeededVer &NV = F->NeededVers[VerdefIndex];
+
   // If we don't already know that we need an Elf_Vernaux for this Elf_Verdef,
   // prepare to create one by allocating a version identifier and creating a
-  // dynstr entry for the version name.
+  // dynstr entry for the version name. dynstr entries are deduplicated,
+  // so DSOs that need the same version name share one string.
   if (NV.Index == 0) {
     NV.StrTab = Out<ELFT>::DynStrTab->addString(
         SS->File->getStringTable().data() + SS->Verdef->getAux()->vda_name);
     NV.Index = NextIndex++;
+    NV.Hash = SS->Verdef->vd_hash;
+    ++F->VernauxNum;
   }
   SS->symbol()->VersionId = NV.Index;
 }
@@ -1632,24 +2109,24 @@ template <class ELFT> void VersionNeedSection<ELFT>::writeTo(uint8_t *Buf) {
   for (std::pair<SharedFile<ELFT> *, size_t> &P : Needed) {
     // Create an Elf_Verneed for this DSO.
     Verneed->vn_version = 1;
-    Verneed->vn_cnt = P.first->VerdefMap.size();
+    Verneed->vn_cnt = P.first->VernauxNum;
     Verneed->vn_file = P.second;
     Verneed->vn_aux =
         reinterpret_cast<char *>(Vernaux) - reinterpret_cast<char *>(Verneed);
     Verneed->vn_next = sizeof(Elf_Verneed);
     ++Verneed;
 
-    // Create the Elf_Vernauxs for this Elf_Verneed. The loop iterates over
-    // VerdefMap, which will only contain references to needed version
-    // definitions. Each Elf_Vernaux is based on the information contained in
-    // the Elf_Verdef in the source DSO. This loop iterates over a std::map of
-    // pointers, but is deterministic because the pointers refer to Elf_Verdef
-    // data structures within a single input file.
-    for (auto &NV : P.first->VerdefMap) {
-      Vernaux->vna_hash = NV.first->vd_hash;
+    // Create the Elf_Vernauxs for this Elf_Verneed, in the order of the
+    // source DSO's version definitions. Slots for versions the output
+    // does not reference are skipped; everything an Elf_Vernaux needs
+    // was cached by addSymbol, so this writes straight from NeededVers.
+    for (const typename SharedFile<ELFT>::NeededVer &NV : P.first->NeededVers) {
+      if (NV.Index == 0)
+        continue;
+      Vernaux->vna_hash = NV.Hash;
       Vernaux->vna_flags = 0;
-      Vernaux->vna_other = NV.second.Index;
-      Vernaux->vna_name = NV.second.StrTab;
+      Vernaux->vna_other = NV.Index;
+      Vernaux->vna_name = NV.StrTab;
       Vernaux->vna_next = sizeof(Elf_Vernaux);
       ++Vernaux;
     }
@@ -1664,10 +2141,118 @@ template <class ELFT> void VersionNeedSection<ELFT>::finalize() {
   this->Header.sh_info = Needed.size();
   unsigned Size = Needed.size() * sizeof(Elf_Verneed);
   for (std::pair<SharedFile<ELFT> *, size_t> &P : Needed)
-    Size += P.first->VerdefMap.size() * sizeof(Elf_Vernaux);
+    Size += P.first->VernauxNum * sizeof(Elf_Vernaux);
   this->Header.sh_size = Size;
 }
 
+template <class ELFT>
+GdbIndexSection<ELFT>::GdbIndexSection()
+    : OutputSectionBase<ELFT>(".gdb_index", SHT_PROGBITS, 0) {}
+
+// Parses the compilation unit headers in an input .debug_info section
+// and returns one (offset in the output .debug_info, size) pair per
+// unit. A unit header starts with a 32-bit length field; 0xffffffff is
+// the DWARF64 escape and the real length follows as a 64-bit word.
+template <class ELFT>
+static std::vector<std::pair<uint64_t, uint64_t>>
+parseCuList(InputSection<ELFT> *Sec) {
+  const endianness E = ELFT::TargetEndianness;
+  std::vector<std::pair<uint64_t, uint64_t>> Ret;
+  ArrayRef<uint8_t> D = Sec->getSectionData();
+  for (uint64_t Off = 0; Off != D.size();) {
+    if (D.size() - Off < 4)
+      fatal(getFilename(Sec->getFile()) +
+            ": invalid compilation unit header");
+    uint64_t Len = read32<E>(D.data() + Off);
+    uint64_t HdrSize = 4;
+    if (Len == UINT32_MAX) {
+      if (D.size() - Off < 12)
+        fatal(getFilename(Sec->getFile()) +
+              ": invalid compilation unit header");
+      Len = read64<E>(D.data() + Off + 4);
+      HdrSize = 12;
+    }
+    if (Len > D.size() - Off - HdrSize)
+      fatal(getFilename(Sec->getFile()) +
+            ": compilation unit exceeds section size");
+    Ret.push_back({Sec->OutSecOff + Off, HdrSize + Len});
+    Off += HdrSize + Len;
+  }
+  return Ret;
+}
+
+// Collects the CU list from every live input .debug_info section. The
+// unit headers of different object files are independent, so each
+// file is parsed on the thread pool; the per-file results are then
+// concatenated in input order, which makes the index identical to the
+// one a serial scan would produce.
+template <class ELFT> void GdbIndexSection<ELFT>::readCuList() {
+  auto &Files = Symtab<ELFT>::X->getObjectFiles();
+  typedef std::vector<std::pair<uint64_t, uint64_t>> UnitVector;
+  std::vector<UnitVector> Slots(Files.size());
+  auto Parse = [&](const std::unique_ptr<ObjectFile<ELFT>> &F) {
+    UnitVector &Slot = Slots[&F - Files.data()];
+    for (InputSectionBase<ELFT> *S : F->getSections()) {
+      if (!S || S == &InputSection<ELFT>::Discarded || !S->Live)
+        continue;
+      auto *IS = dyn_cast<InputSection<ELFT>>(S);
+      if (!IS || !IS->OutSec || IS->getSectionName() != ".debug_info")
+        continue;
+      UnitVector V = parseCuList(IS);
+      Slot.insert(Slot.end(), V.begin(), V.end());
+    }
+  };
+  if (Config->Threads) {
+    parallel_for_each(Files.begin(), Files.end(), Parse, 1);
+  } else {
+    for (const std::unique_ptr<ObjectFile<ELFT>> &F : Files)
+      Parse(F);
+  }
+  for (UnitVector &Slot : Slots)
+    CuList.insert(CuList.end(), Slot.begin(), Slot.end());
+}
+
+template <class ELFT> void GdbIndexSection<ELFT>::finalize() {
+  readCuList();
+  // A six-word header followed by the CU list. The empty types CU
+  // list, address area and symbol table all collapse onto the offset
+  // of the (equally empty) constant pool.
+  this->Header.sh_size = 24 + CuList.size() * 16;
+}
+
+template <class ELFT> void GdbIndexSection<ELFT>::writeTo(uint8_t *Buf) {
+  // The index is defined to be little-endian regardless of the target.
+  write32le(Buf, 7);                          // Format version.
+  write32le(Buf + 4, 24);                     // Offset of the CU list.
+  uint32_t End = 24 + CuList.size() * 16;
+  write32le(Buf + 8, End);                    // Types CU list (empty).
+  write32le(Buf + 12, End);                   // Address area (empty).
+  write32le(Buf + 16, End);                   // Symbol table (empty).
+  write32le(Buf + 20, End);                   // Constant pool (empty).
+  Buf += 24;
+  for (std::pair<uint64_t, uint64_t> &P : CuList) {
+    write64le(Buf, P.first);
+    write64le(Buf + 8, P.second);
+    Buf += 16;
+  }
+}
+
+template <class ELFT>
+GnuDebugLinkSection<ELFT>::GnuDebugLinkSection(StringRef FileName)
+    : OutputSectionBase<ELFT>(".gnu_debuglink", SHT_PROGBITS, 0),
+      FileName(FileName) {
+  this->Header.sh_addralign = 4;
+}
+
+template <class ELFT> void GnuDebugLinkSection<ELFT>::finalize() {
+  // The file name is padded so that the CRC32 is four-byte aligned.
+  this->Header.sh_size = alignTo(FileName.size() + 1, 4) + 4;
+}
+
+template <class ELFT> void GnuDebugLinkSection<ELFT>::writeTo(uint8_t *Buf) {
+  memcpy(Buf, FileName.data(), FileName.size());
+}
+
 template <class ELFT>
 BuildIdSection<ELFT>::BuildIdSection(size_t HashSize)
     : OutputSectionBase<ELFT>(".note.gnu.build-id", SHT_NOTE, SHF_ALLOC),
@@ -1685,37 +2270,104 @@ template <class ELFT> void BuildIdSection<ELFT>::writeTo(uint8_t *Buf) {
   HashBuf = Buf + 16;
 }
 
-template <class ELFT>
-void BuildIdFnv1<ELFT>::writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) {
-  const endianness E = ELFT::TargetEndianness;
+// The build-id hash kernels depend only on the bytes being hashed and
+// on the output endianness, never on the ELF width, so they are plain
+// functions shared by all four ELFT instantiations of the build-id
+// sections. The writeBuildId methods below are thin dispatchers.
+
+static void writeHash64(uint8_t *Buf, uint64_t Hash, endianness E) {
+  if (E == support::little)
+    write64le(Buf, Hash);
+  else
+    write64be(Buf, Hash);
+}
 
-  // 64-bit FNV-1 hash
+// 64-bit FNV-1 hash
+static uint64_t fnv1Hash(ArrayRef<uint8_t> Buf,
+                         uint64_t Hash = 0xcbf29ce484222325) {
+  for (uint8_t B : Buf) {
+    Hash *= 0x100000001b3;
+    Hash ^= B;
+  }
+  return Hash;
+}
+
+static void computeFnv1(uint8_t *Out, endianness E,
+                        ArrayRef<ArrayRef<uint8_t>> Bufs) {
   uint64_t Hash = 0xcbf29ce484222325;
-  for (ArrayRef<uint8_t> Buf : Bufs) {
-    for (uint8_t B : Buf) {
-      Hash *= 0x100000001b3;
-      Hash ^= B;
-    }
+  for (ArrayRef<uint8_t> Buf : Bufs)
+    Hash = fnv1Hash(Buf, Hash);
+  writeHash64(Out, Hash, E);
+}
+
+static void computeTreeHash(uint8_t *Out, endianness E,
+                            ArrayRef<ArrayRef<uint8_t>> Bufs) {
+  const size_t ChunkSize = 1024 * 1024;
+
+  // Cut the hashed regions into fixed-size chunks. The boundaries
+  // depend only on the region sizes, and every chunk digest lands at
+  // a fixed position in the digest list, so the build-id does not
+  // depend on the number of threads.
+  struct Chunk {
+    ArrayRef<uint8_t> Data;
+    uint64_t Hash;
+  };
+  std::vector<Chunk> Chunks;
+  for (ArrayRef<uint8_t> Buf : Bufs)
+    for (size_t Off = 0, Size = Buf.size(); Off < Size; Off += ChunkSize)
+      Chunks.push_back({Buf.slice(Off, std::min(ChunkSize, Size - Off)), 0});
+
+  auto Fn = [](Chunk &C) { C.Hash = fnv1Hash(C.Data); };
+  if (Config->Threads)
+    parallel_for_each(Chunks.begin(), Chunks.end(), Fn, 1);
+  else
+    for (Chunk &C : Chunks)
+      Fn(C);
+
+  // Hash the chunk digests to get the root of the tree.
+  uint64_t Hash = 0xcbf29ce484222325;
+  for (const Chunk &C : Chunks) {
+    uint8_t Digest[8];
+    writeHash64(Digest, C.Hash, E);
+    Hash = fnv1Hash(Digest, Hash);
   }
-  write64<E>(this->HashBuf, Hash);
+  writeHash64(Out, Hash, E);
 }
 
-template <class ELFT>
-void BuildIdMd5<ELFT>::writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) {
+static void computeMd5(uint8_t *Out, ArrayRef<ArrayRef<uint8_t>> Bufs) {
   llvm::MD5 Hash;
   for (ArrayRef<uint8_t> Buf : Bufs)
     Hash.update(Buf);
   MD5::MD5Result Res;
   Hash.final(Res);
-  memcpy(this->HashBuf, Res, 16);
+  memcpy(Out, Res, 16);
 }
 
-template <class ELFT>
-void BuildIdSha1<ELFT>::writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) {
+static void computeSha1(uint8_t *Out, ArrayRef<ArrayRef<uint8_t>> Bufs) {
   llvm::SHA1 Hash;
   for (ArrayRef<uint8_t> Buf : Bufs)
     Hash.update(Buf);
-  memcpy(this->HashBuf, Hash.final().data(), 20);
+  memcpy(Out, Hash.final().data(), 20);
+}
+
+template <class ELFT>
+void BuildIdFnv1<ELFT>::writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) {
+  computeFnv1(this->HashBuf, ELFT::TargetEndianness, Bufs);
+}
+
+template <class ELFT>
+void BuildIdTree<ELFT>::writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) {
+  computeTreeHash(this->HashBuf, ELFT::TargetEndianness, Bufs);
+}
+
+template <class ELFT>
+void BuildIdMd5<ELFT>::writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) {
+  computeMd5(this->HashBuf, Bufs);
+}
+
+template <class ELFT>
+void BuildIdSha1<ELFT>::writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) {
+  computeSha1(this->HashBuf, Bufs);
 }
 
 template <class ELFT>
@@ -1812,6 +2464,11 @@ template class RelocationSection<ELF32BE>;
 template class RelocationSection<ELF64LE>;
 template class RelocationSection<ELF64BE>;
 
+template class RelrSection<ELF32LE>;
+template class RelrSection<ELF32BE>;
+template class RelrSection<ELF64LE>;
+template class RelrSection<ELF64BE>;
+
 template class InterpSection<ELF32LE>;
 template class InterpSection<ELF32BE>;
 template class InterpSection<ELF64LE>;
@@ -1882,6 +2539,16 @@ template class VersionDefinitionSection<ELF32BE>;
 template class VersionDefinitionSection<ELF64LE>;
 template class VersionDefinitionSection<ELF64BE>;
 
+template class GdbIndexSection<ELF32LE>;
+template class GdbIndexSection<ELF32BE>;
+template class GdbIndexSection<ELF64LE>;
+template class GdbIndexSection<ELF64BE>;
+
+template class GnuDebugLinkSection<ELF32LE>;
+template class GnuDebugLinkSection<ELF32BE>;
+template class GnuDebugLinkSection<ELF64LE>;
+template class GnuDebugLinkSection<ELF64BE>;
+
 template class BuildIdSection<ELF32LE>;
 template class BuildIdSection<ELF32BE>;
 template class BuildIdSection<ELF64LE>;
@@ -1902,6 +2569,11 @@ template class BuildIdSha1<ELF32BE>;
 template class BuildIdSha1<ELF64LE>;
 template class BuildIdSha1<ELF64BE>;
 
+template class BuildIdTree<ELF32LE>;
+template class BuildIdTree<ELF32BE>;
+template class BuildIdTree<ELF64LE>;
+template class BuildIdTree<ELF64BE>;
+
 template class BuildIdHexstring<ELF32LE>;
 template class BuildIdHexstring<ELF32BE>;
 template class BuildIdHexstring<ELF64LE>;
@@ -14,6 +14,7 @@
 #include "Relocations.h"
 
 #include "lld/Core/LLVM.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Object/ELF.h"
@@ -97,6 +98,9 @@ public:
   virtual void finalize() {}
   virtual void finalizePieces() {}
   virtual void assignOffsets() {}
+  virtual void maybeCompress() {}
+  virtual void
+  sortByOrder(const llvm::DenseMap<InputSectionBase<ELFT> *, int> &Order) {}
   virtual void writeTo(uint8_t *Buf) {}
   virtual ~OutputSectionBase() = default;
 
@@ -149,8 +153,12 @@ private:
   std::vector<const SymbolBody *> Entries;
   uint32_t TlsIndexOff = -1;
   uint32_t MipsPageEntries = 0;
-  // Output sections referenced by MIPS GOT relocations.
-  llvm::SmallPtrSet<const OutputSectionBase<ELFT> *, 10> MipsOutSections;
+  // (symbol, addend) pairs of page-relative MIPS GOT relocations,
+  // deduplicated by hash during the relocation scan. Page entries are
+  // shared by every relocation that lands on the same 64k page, no
+  // matter which file it came from; finalize() computes the exact set
+  // of referenced pages from section offsets.
+  llvm::DenseSet<std::pair<const SymbolBody *, uintX_t>> MipsLocalPageRefs;
   llvm::DenseMap<uintX_t, size_t> MipsLocalGotPos;
 
   // MIPS ABI requires to create unique GOT entry for each Symbol/Addend
@@ -200,6 +208,8 @@ private:
   std::vector<std::pair<const SymbolBody *, unsigned>> Entries;
 };
 
+template <class ELFT> class RelrSection;
+
 template <class ELFT> class DynamicReloc {
   typedef typename ELFT::uint uintX_t;
 
@@ -224,6 +234,8 @@ public:
   uint32_t Type;
 
 private:
+  friend class RelrSection<ELFT>;
+
   SymbolBody *Sym;
   const InputSectionBase<ELFT> *InputSec = nullptr;
   const OutputSectionBase<ELFT> *OutputSec = nullptr;
@@ -326,6 +338,45 @@ public:
   size_t getNeedNum() const { return Needed.size(); }
 };
 
+// --gdb-index. An index over .debug_info that lets gdb locate
+// compilation units without crawling all of the DWARF at startup. We
+// emit a version 7 index containing the CU list and leave the address
+// and symbol tables empty; gdb falls back to its own scan for the
+// parts that are absent but still skips the expensive CU discovery.
+template <class ELFT>
+class GdbIndexSection final : public OutputSectionBase<ELFT> {
+public:
+  GdbIndexSection();
+  void finalize() override;
+  void writeTo(uint8_t *Buf) override;
+
+private:
+  void readCuList();
+
+  // One (offset in the output .debug_info section, size) pair per
+  // compilation unit, in input order.
+  std::vector<std::pair<uint64_t, uint64_t>> CuList;
+};
+
+// --split-debug-output. Names the file the debug sections were written
+// to, so debuggers can find them. The payload is the file name,
+// NUL-terminated and padded to four bytes, followed by a CRC32 of the
+// debug file. The CRC slot is zero-filled here and patched by the
+// writer once the debug file contents are complete.
+template <class ELFT>
+class GnuDebugLinkSection final : public OutputSectionBase<ELFT> {
+public:
+  GnuDebugLinkSection(StringRef FileName);
+  void finalize() override;
+  void writeTo(uint8_t *Buf) override;
+
+  // Offset of the CRC32 field relative to the start of the section.
+  size_t getCrcOff() const { return this->getSize() - 4; }
+
+private:
+  StringRef FileName;
+};
+
 template <class ELFT>
 class RelocationSection final : public OutputSectionBase<ELFT> {
   typedef typename ELFT::Rel Elf_Rel;
@@ -347,6 +398,30 @@ private:
   std::vector<DynamicReloc<ELFT>> Relocs;
 };
 
+// .relr.dyn. With --pack-dyn-relocs=relr, relative dynamic relocations
+// are stored as SHT_RELR-style address and bitmap words instead of
+// whole Elf_Rela records. Only word-aligned relative relocations whose
+// value is known at link time can be packed; everything else stays in
+// .rela.dyn. The encoded size depends on final addresses, which are
+// not assigned when sections are sized, so the section is sized for
+// the worst case (one word per relocation) and writeTo pads the rest
+// with empty bitmap words, which loaders skip.
+template <class ELFT>
+class RelrSection final : public OutputSectionBase<ELFT> {
+  typedef typename ELFT::uint uintX_t;
+
+public:
+  RelrSection();
+  void addReloc(const DynamicReloc<ELFT> &Reloc);
+  static bool canEncode(const DynamicReloc<ELFT> &Reloc);
+  void finalize() override;
+  void writeTo(uint8_t *Buf) override;
+  bool hasRelocs() const { return !Relocs.empty(); }
+
+private:
+  std::vector<DynamicReloc<ELFT>> Relocs;
+};
+
 template <class ELFT>
 class OutputSection final : public OutputSectionBase<ELFT> {
 public:
@@ -359,10 +434,20 @@ public:
   void addSection(InputSectionBase<ELFT> *C) override;
   void sortInitFini();
   void sortCtorsDtors();
+  void
+  sortByOrder(const llvm::DenseMap<InputSectionBase<ELFT> *, int> &Order) override;
+  void maybeCompress() override;
   void writeTo(uint8_t *Buf) override;
   void finalize() override;
   void assignOffsets() override;
   std::vector<InputSection<ELFT> *> Sections;
+
+private:
+  // Filled by maybeCompress for --compress-debug-sections. When
+  // UncompressedSize is set, writeTo emits an Elf_Chdr followed by
+  // CompressedData instead of the input sections.
+  llvm::SmallVector<char, 1> CompressedData;
+  uintX_t UncompressedSize = 0;
 };
 
 template <class ELFT>
@@ -373,6 +458,7 @@ public:
   MergeOutputSection(StringRef Name, uint32_t Type, uintX_t Flags,
                      uintX_t Alignment);
   void addSection(InputSectionBase<ELFT> *S) override;
+  void mergePieces();
   void writeTo(uint8_t *Buf) override;
   unsigned getOffset(StringRef Val);
   void finalize() override;
@@ -380,7 +466,23 @@ public:
   bool shouldTailMerge() const;
 
 private:
-  llvm::StringTableBuilder Builder;
+  // Section pieces are partitioned by content hash into independent
+  // string table builders which are filled in parallel; a piece's
+  // final output offset is its shard's base plus its offset within
+  // the shard. Exact duplicates always hash to the same shard, so
+  // deduplication is complete. Tail merging only happens within one
+  // shard, which may leave a few cross-shard suffix merges on the
+  // table but keeps the shards fully independent.
+  enum { NumShards = 16 };
+  struct Shard {
+    explicit Shard(uintX_t Alignment)
+        : Builder(llvm::StringTableBuilder::RAW, Alignment) {}
+    llvm::StringTableBuilder Builder;
+    uintX_t Base = 0;
+  };
+  static unsigned getShardId(StringRef Val);
+
+  std::vector<std::unique_ptr<Shard>> Shards;
   std::vector<MergeInputSection<ELFT> *> Sections;
 };
 
@@ -405,9 +507,16 @@ public:
 
   void addSection(InputSectionBase<ELFT> *S) override;
 
+  // Called once after all input sections have been added. Splits them
+  // into CIE/FDE records and merges the records in input order.
+  void mergeFrames();
+
   size_t NumFdes = 0;
 
 private:
+  template <class RelTy>
+  void scanSection(EhInputSection<ELFT> *S, llvm::ArrayRef<RelTy> Rels);
+
   template <class RelTy>
   void addSectionAux(EhInputSection<ELFT> *S, llvm::ArrayRef<RelTy> Rels);
 
@@ -444,15 +553,32 @@ public:
   StringTableSection(StringRef Name, bool Dynamic);
   unsigned addString(StringRef S, bool HashIt = true);
   void writeTo(uint8_t *Buf) override;
-  unsigned getSize() const { return Size; }
-  void finalize() override { this->Header.sh_size = getSize(); }
+  unsigned getSize() const { return Merged ? Merged->data().size() : Size; }
+  void finalize() override;
   bool isDynamic() const { return Dynamic; }
 
+  // Maps an offset handed out by addString to the string's final location.
+  // The two differ only if finalize() tail-merged the table.
+  unsigned getOffset(unsigned Off) const {
+    if (!Merged)
+      return Off;
+    return OffsetMap.lookup(Off);
+  }
+
 private:
+  void tailMerge();
+
   const bool Dynamic;
   llvm::DenseMap<StringRef, unsigned> StringMap;
   std::vector<StringRef> Strings;
   unsigned Size = 1; // ELF string tables start with a NUL byte, so 1.
+
+  // At -O2 the symbol string table is rebuilt so that a string that is a
+  // suffix of another shares its tail ("bar" is stored inside "foobar").
+  // Merged then holds the merged image and OffsetMap the new location of
+  // every offset addString has handed out.
+  std::unique_ptr<llvm::StringTableBuilder> Merged;
+  llvm::DenseMap<unsigned, unsigned> OffsetMap;
 };
 
 template <class ELFT>
@@ -631,6 +757,15 @@ public:
   void writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) override;
 };
 
+// A tree hash: the output is cut into fixed-size chunks which are
+// hashed independently (and concurrently), and the final build-id is
+// a hash of the chunk digests.
+template <class ELFT> class BuildIdTree final : public BuildIdSection<ELFT> {
+public:
+  BuildIdTree() : BuildIdSection<ELFT>(8) {}
+  void writeBuildId(ArrayRef<ArrayRef<uint8_t>> Bufs) override;
+};
+
 template <class ELFT>
 class BuildIdHexstring final : public BuildIdSection<ELFT> {
 public:
@@ -648,6 +783,8 @@ template <class ELFT> struct Out {
   static DynamicSection<ELFT> *Dynamic;
   static EhFrameHeader<ELFT> *EhFrameHdr;
   static EhOutputSection<ELFT> *EhFrame;
+  static GdbIndexSection<ELFT> *GdbIndex;
+  static GnuDebugLinkSection<ELFT> *GnuDebugLink;
   static GnuHashTableSection<ELFT> *GnuHashTab;
   static GotPltSection<ELFT> *GotPlt;
   static GotSection<ELFT> *Got;
@@ -660,6 +797,7 @@ template <class ELFT> struct Out {
   static PltSection<ELFT> *Plt;
   static RelocationSection<ELFT> *RelaDyn;
   static RelocationSection<ELFT> *RelaPlt;
+  static RelrSection<ELFT> *RelrDyn;
   static StringTableSection<ELFT> *DynStrTab;
   static StringTableSection<ELFT> *ShStrTab;
   static StringTableSection<ELFT> *StrTab;
@@ -677,6 +815,8 @@ template <class ELFT> BuildIdSection<ELFT> *Out<ELFT>::BuildId;
 template <class ELFT> DynamicSection<ELFT> *Out<ELFT>::Dynamic;
 template <class ELFT> EhFrameHeader<ELFT> *Out<ELFT>::EhFrameHdr;
 template <class ELFT> EhOutputSection<ELFT> *Out<ELFT>::EhFrame;
+template <class ELFT> GdbIndexSection<ELFT> *Out<ELFT>::GdbIndex;
+template <class ELFT> GnuDebugLinkSection<ELFT> *Out<ELFT>::GnuDebugLink;
 template <class ELFT> GnuHashTableSection<ELFT> *Out<ELFT>::GnuHashTab;
 template <class ELFT> GotPltSection<ELFT> *Out<ELFT>::GotPlt;
 template <class ELFT> GotSection<ELFT> *Out<ELFT>::Got;
@@ -689,6 +829,7 @@ template <class ELFT> uint8_t *Out<ELFT>::OpdBuf;
 template <class ELFT> PltSection<ELFT> *Out<ELFT>::Plt;
 template <class ELFT> RelocationSection<ELFT> *Out<ELFT>::RelaDyn;
 template <class ELFT> RelocationSection<ELFT> *Out<ELFT>::RelaPlt;
+template <class ELFT> RelrSection<ELFT> *Out<ELFT>::RelrDyn;
 template <class ELFT> StringTableSection<ELFT> *Out<ELFT>::DynStrTab;
 template <class ELFT> StringTableSection<ELFT> *Out<ELFT>::ShStrTab;
 template <class ELFT> StringTableSection<ELFT> *Out<ELFT>::StrTab;
@@ -43,10 +43,12 @@
 
 #include "Relocations.h"
 #include "Config.h"
+#include "Counters.h"
 #include "OutputSections.h"
 #include "SymbolTable.h"
 #include "Target.h"
 
+#include "lld/Core/Parallel.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -96,7 +98,8 @@ handleMipsTlsRelocation(uint32_t Type, SymbolBody &Body,
       Out<ELFT>::RelaDyn->addReloc({Target->TlsModuleIndexRel, Out<ELFT>::Got,
                                     Out<ELFT>::Got->getTlsIndexOff(), false,
                                     nullptr, 0});
-    C.Relocations.push_back({Expr, Type, &C, Offset, Addend, &Body});
+    C.Relocations.push_back(
+        {Expr, Type, &C, Offset, Addend, &Body, TLSOP_NONE});
     return 1;
   }
   if (Target->isTlsGlobalDynamicRel(Type)) {
@@ -109,7 +112,8 @@ handleMipsTlsRelocation(uint32_t Type, SymbolBody &Body,
                                     Off + (uintX_t)sizeof(uintX_t), false,
                                     &Body, 0});
     }
-    C.Relocations.push_back({Expr, Type, &C, Offset, Addend, &Body});
+    C.Relocations.push_back(
+        {Expr, Type, &C, Offset, Addend, &Body, TLSOP_NONE});
     return 1;
   }
   return 0;
@@ -140,7 +144,8 @@ static unsigned handleTlsRelocation(uint32_t Type, SymbolBody &Body,
           {Target->TlsDescRel, Out<ELFT>::Got, Off, false, &Body, 0});
     }
     if (Expr != R_HINT)
-      C.Relocations.push_back({Expr, Type, &C, Offset, Addend, &Body});
+      C.Relocations.push_back(
+          {Expr, Type, &C, Offset, Addend, &Body, TLSOP_NONE});
     return 1;
   }
 
@@ -148,21 +153,24 @@ static unsigned handleTlsRelocation(uint32_t Type, SymbolBody &Body,
     // Local-Dynamic relocs can be relaxed to Local-Exec.
     if (!Config->Shared) {
       C.Relocations.push_back(
-          {R_RELAX_TLS_LD_TO_LE, Type, &C, Offset, Addend, &Body});
+          {R_RELAX_TLS_LD_TO_LE, Type, &C, Offset, Addend, &Body,
+           Target->getTlsRelaxOp(R_RELAX_TLS_LD_TO_LE, Type)});
       return 2;
     }
     if (Out<ELFT>::Got->addTlsIndex())
       Out<ELFT>::RelaDyn->addReloc({Target->TlsModuleIndexRel, Out<ELFT>::Got,
                                     Out<ELFT>::Got->getTlsIndexOff(), false,
                                     nullptr, 0});
-    C.Relocations.push_back({Expr, Type, &C, Offset, Addend, &Body});
+    C.Relocations.push_back(
+        {Expr, Type, &C, Offset, Addend, &Body, TLSOP_NONE});
     return 1;
   }
 
   // Local-Dynamic relocs can be relaxed to Local-Exec.
   if (Target->isTlsLocalDynamicRel(Type) && !Config->Shared) {
     C.Relocations.push_back(
-        {R_RELAX_TLS_LD_TO_LE, Type, &C, Offset, Addend, &Body});
+        {R_RELAX_TLS_LD_TO_LE, Type, &C, Offset, Addend, &Body,
+         Target->getTlsRelaxOp(R_RELAX_TLS_LD_TO_LE, Type)});
     return 1;
   }
 
@@ -181,16 +189,18 @@ static unsigned handleTlsRelocation(uint32_t Type, SymbolBody &Body,
                                         Off + (uintX_t)sizeof(uintX_t), false,
                                         &Body, 0});
       }
-      C.Relocations.push_back({Expr, Type, &C, Offset, Addend, &Body});
+      C.Relocations.push_back(
+          {Expr, Type, &C, Offset, Addend, &Body, TLSOP_NONE});
       return 1;
     }
 
     // Global-Dynamic relocs can be relaxed to Initial-Exec or Local-Exec
     // depending on the symbol being locally defined or not.
     if (isPreemptible(Body, Type)) {
-      C.Relocations.push_back(
-          {Target->adjustRelaxExpr(Type, nullptr, R_RELAX_TLS_GD_TO_IE), Type,
-           &C, Offset, Addend, &Body});
+      RelExpr RelaxExpr =
+          Target->adjustRelaxExpr(Type, nullptr, R_RELAX_TLS_GD_TO_IE);
+      C.Relocations.push_back({RelaxExpr, Type, &C, Offset, Addend, &Body,
+                               Target->getTlsRelaxOp(RelaxExpr, Type)});
       if (!Body.isInGot()) {
         Out<ELFT>::Got->addEntry(Body);
         Out<ELFT>::RelaDyn->addReloc({Target->TlsGotRel, Out<ELFT>::Got,
@@ -199,9 +209,10 @@ static unsigned handleTlsRelocation(uint32_t Type, SymbolBody &Body,
       }
       return Target->TlsGdRelaxSkip;
     }
-    C.Relocations.push_back(
-        {Target->adjustRelaxExpr(Type, nullptr, R_RELAX_TLS_GD_TO_LE), Type, &C,
-         Offset, Addend, &Body});
+    RelExpr RelaxExpr =
+        Target->adjustRelaxExpr(Type, nullptr, R_RELAX_TLS_GD_TO_LE);
+    C.Relocations.push_back({RelaxExpr, Type, &C, Offset, Addend, &Body,
+                             Target->getTlsRelaxOp(RelaxExpr, Type)});
     return Target->TlsGdRelaxSkip;
   }
 
@@ -210,7 +221,8 @@ static unsigned handleTlsRelocation(uint32_t Type, SymbolBody &Body,
   if (Target->isTlsInitialExecRel(Type) && !Config->Shared &&
       !isPreemptible(Body, Type)) {
     C.Relocations.push_back(
-        {R_RELAX_TLS_IE_TO_LE, Type, &C, Offset, Addend, &Body});
+        {R_RELAX_TLS_IE_TO_LE, Type, &C, Offset, Addend, &Body,
+         Target->getTlsRelaxOp(R_RELAX_TLS_IE_TO_LE, Type)});
     return 1;
   }
   return 0;
@@ -465,20 +477,34 @@ static RelExpr adjustExpr(const elf::ObjectFile<ELFT> &File, SymbolBody &Body,
   return Expr;
 }
 
+// Reads the addend a relocation record carries: the r_addend field on
+// RELA targets, the value encoded in the section bytes (plus, on MIPS,
+// the paired relocation's low half) on REL targets. This is the only
+// part of the addend computation that touches section data, so
+// scanRelocs runs it for a whole section in one forward sweep before
+// its main loop. Expression-dependent tweaks are applied separately by
+// adjustAddend.
 template <class ELFT, class RelTy>
-static typename ELFT::uint computeAddend(const elf::ObjectFile<ELFT> &File,
-                                         const uint8_t *SectionData,
-                                         const RelTy *End, const RelTy &RI,
-                                         RelExpr Expr, SymbolBody &Body) {
-  typedef typename ELFT::uint uintX_t;
-
-  uint32_t Type = RI.getType(Config->Mips64EL);
-  uintX_t Addend = getAddend<ELFT>(RI);
+static typename ELFT::uint readAddend(const elf::ObjectFile<ELFT> &File,
+                                      const uint8_t *SectionData,
+                                      const RelTy *End, const RelTy &RI,
+                                      SymbolBody &Body) {
+  typename ELFT::uint Addend = getAddend<ELFT>(RI);
   const uint8_t *BufLoc = SectionData + RI.r_offset;
   if (!RelTy::IsRela)
-    Addend += Target->getImplicitAddend(BufLoc, Type);
-  if (Config->EMachine == EM_MIPS) {
+    Addend += Target->getImplicitAddend(BufLoc, RI.getType(Config->Mips64EL));
+  if (Config->EMachine == EM_MIPS)
     Addend += findMipsPairedAddend<ELFT>(SectionData, BufLoc, Body, &RI, End);
+  return Addend;
+}
+
+template <class ELFT, class RelTy>
+static typename ELFT::uint adjustAddend(const elf::ObjectFile<ELFT> &File,
+                                        typename ELFT::uint Addend,
+                                        const RelTy &RI, RelExpr Expr,
+                                        SymbolBody &Body) {
+  uint32_t Type = RI.getType(Config->Mips64EL);
+  if (Config->EMachine == EM_MIPS) {
     if (Type == R_MIPS_LO16 && Expr == R_PC)
       // R_MIPS_LO16 expression has R_PC type iif the target is _gp_disp
       // symbol. In that case we should use the following formula for
@@ -497,6 +523,112 @@ static typename ELFT::uint computeAddend(const elf::ObjectFile<ELFT> &File,
   return Addend;
 }
 
+// Buffered side effects of scanning one section's relocations.
+// Sections are scanned on many threads at once; instead of mutating the
+// GOT, PLT and dynamic relocation sections directly, each scan appends
+// its expressed needs here. The buffers are then replayed in input
+// section order, which produces the same GOT/PLT layout and dynamic
+// relocation order as a serial scan.
+template <class ELFT> struct RelocationNeeds {
+  typedef typename ELFT::uint uintX_t;
+
+  // A buffered GOT or PLT entry request, in the order the serial scan
+  // would have issued it.
+  struct Entry {
+    SymbolBody *Body;
+    uintX_t Addend;
+    RelExpr Expr;
+    bool Preemptible;
+    bool NeedsPlt; // PLT request if true, GOT request otherwise.
+  };
+  std::vector<Entry> Entries;
+  std::vector<DynamicReloc<ELFT>> DynRelocs;
+  bool HasGotOffRel = false;
+
+  // Set when the section contains a relocation whose processing has
+  // side effects the buffers cannot represent (TLS GOT entries, copy
+  // relocations, thunks). Such sections are rescanned serially.
+  bool NeedsSerialScan = false;
+};
+
+// Creates a PLT (and GOT-PLT) entry for Body and the dynamic relocation
+// filling it. Shared by the serial scan and the deferred-needs replay.
+template <class ELFT> static void addPltEntry(SymbolBody &Body,
+                                              bool Preemptible) {
+  if (Body.isInPlt())
+    return;
+  Out<ELFT>::Plt->addEntry(Body);
+
+  uint32_t Rel;
+  if (Body.isGnuIFunc() && !Preemptible)
+    Rel = Target->IRelativeRel;
+  else
+    Rel = Target->PltRel;
+
+  Out<ELFT>::GotPlt->addEntry(Body);
+  Out<ELFT>::RelaPlt->addReloc({Rel, Out<ELFT>::GotPlt,
+                                Body.getGotPltOffset<ELFT>(), !Preemptible,
+                                &Body, 0});
+}
+
+// Creates a GOT entry for Body and, if required, the dynamic relocation
+// filling it. Shared by the serial scan and the deferred-needs replay.
+template <class ELFT>
+static void addGotEntry(SymbolBody &Body, typename ELFT::uint Addend,
+                        RelExpr Expr, bool Preemptible) {
+  if (Config->EMachine == EM_MIPS) {
+    // MIPS ABI has special rules to process GOT entries
+    // and doesn't require relocation entries for them.
+    // See "Global Offset Table" in Chapter 5 in the following document
+    // for detailed description:
+    // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf
+    Out<ELFT>::Got->addMipsEntry(Body, Addend, Expr);
+    if (Body.isTls())
+      Out<ELFT>::RelaDyn->addReloc({Target->TlsGotRel, Out<ELFT>::Got,
+                                    Body.getGotOffset<ELFT>(), !Preemptible,
+                                    &Body, 0});
+    return;
+  }
+
+  if (Body.isInGot())
+    return;
+
+  Out<ELFT>::Got->addEntry(Body);
+  if (Preemptible || (Config->Pic && !isAbsolute<ELFT>(Body))) {
+    uint32_t DynType;
+    if (Body.isTls())
+      DynType = Target->TlsGotRel;
+    else if (Preemptible)
+      DynType = Target->GotRel;
+    else
+      DynType = Target->RelativeRel;
+    Out<ELFT>::RelaDyn->addReloc({DynType, Out<ELFT>::Got,
+                                  Body.getGotOffset<ELFT>(), !Preemptible,
+                                  &Body, 0});
+  }
+}
+
+// Returns true if scanning a relocation of the given kind has side
+// effects that RelocationNeeds cannot buffer: TLS GOT entries, copy
+// relocations, PLT address redirection or thunks. Mirrors the
+// side-effect-free part of adjustExpr to decide without mutating
+// anything.
+template <class ELFT>
+static bool needsSerialScan(const elf::ObjectFile<ELFT> &File, SymbolBody &Body,
+                            RelExpr Expr, uint32_t Type, bool IsWrite) {
+  if (Body.isTls())
+    return true;
+  if (Target->needsThunk(Type, File, Body))
+    return true;
+  if (!Body.isShared())
+    return false;
+  if (Body.isGnuIFunc())
+    Expr = toPlt(Expr);
+  else if (!isPreemptible(Body, Type) && needsPlt(Expr))
+    Expr = fromPlt(Expr);
+  return !IsWrite && !isStaticLinkTimeConstant<ELFT>(Expr, Type, Body);
+}
+
 // The reason we have to do this early scan is as follows
 // * To mmap the output file, we need to know the size
 // * For that, we need to know how many dynamic relocs we will have.
@@ -510,26 +642,89 @@ static typename ELFT::uint computeAddend(const elf::ObjectFile<ELFT> &File,
 // sections. Given that it is ro, we will need an extra PT_LOAD. This
 // complicates things for the dynamic linker and means we would have to reserve
 // space for the extra PT_LOAD even if we end up not using it.
+//
+// If Needs is null, GOT, PLT and dynamic relocation sections are
+// mutated directly; otherwise all such side effects are buffered in
+// *Needs, which makes the scan safe to run concurrently for many
+// sections.
 template <class ELFT, class RelTy>
-static void scanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels) {
+static void scanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels,
+                       RelocationNeeds<ELFT> *Needs) {
   typedef typename ELFT::uint uintX_t;
 
+  LLD_COUNT_N(RelocsScanned, Rels.size());
+
   bool IsWrite = C.getSectionHdr()->sh_flags & SHF_WRITE;
 
-  auto AddDyn = [=](const DynamicReloc<ELFT> &Reloc) {
-    Out<ELFT>::RelaDyn->addReloc(Reloc);
+  // True if the output needs no dynamic linker support at all: it gets
+  // a fixed load address and links against no DSOs, so every symbol is
+  // resolved at link time and cannot be preempted.
+  bool StaticLink =
+      !Config->Pic && Symtab<ELFT>::X->getSharedFiles().empty();
+
+  auto AddDyn = [&](const DynamicReloc<ELFT> &Reloc) {
+    if (Needs)
+      Needs->DynRelocs.push_back(Reloc);
+    else
+      Out<ELFT>::RelaDyn->addReloc(Reloc);
   };
 
   const elf::ObjectFile<ELFT> &File = *C.getFile();
   ArrayRef<uint8_t> SectionData = C.getSectionData();
   const uint8_t *Buf = SectionData.begin();
+
+  // On REL targets the addends live in the section bytes. Decode them
+  // all in one forward sweep over the data up front: inline in the
+  // main loop those data-dependent loads would be interleaved with the
+  // symbol table and GOT/PLT bookkeeping below (and, for MIPS pairs,
+  // with a search over the relocation array), which makes them far
+  // less prefetch-friendly than a dedicated pass.
+  std::vector<uintX_t> Addends;
+  if (!RelTy::IsRela) {
+    Addends.reserve(Rels.size());
+    for (auto I = Rels.begin(), E = Rels.end(); I != E; ++I)
+      Addends.push_back(
+          readAddend(File, Buf, E, *I, File.getRelocTargetSym(*I)));
+  }
+
   for (auto I = Rels.begin(), E = Rels.end(); I != E; ++I) {
     const RelTy &RI = *I;
     SymbolBody &Body = File.getRelocTargetSym(RI);
     uint32_t Type = RI.getType(Config->Mips64EL);
 
     RelExpr Expr = Target->getRelExpr(Type, Body);
+
+    // In a fully static link almost every relocation is an absolute or
+    // PC-relative reference to a non-preemptible symbol and resolves to
+    // a link-time constant with no effect on the GOT, the PLT or the
+    // dynamic relocation sections. Handle that case up front instead of
+    // letting it fall through all of the bookkeeping below. Relocations
+    // against TLS or ifunc symbols and ones that may need a thunk still
+    // take the generic path.
+    if (StaticLink && (Expr == R_ABS || Expr == R_PC || Expr == R_SIZE) &&
+        !Body.isTls() && !Body.isGnuIFunc() &&
+        !Target->needsThunk(Type, File, Body)) {
+      // Skip a relocation that points to a dead piece
+      // in a mergeable section.
+      if (C.getOffset(RI.r_offset) == (uintX_t)-1)
+        continue;
+      uintX_t Addend = RelTy::IsRela ? readAddend(File, Buf, E, RI, Body)
+                                     : Addends[I - Rels.begin()];
+      C.Relocations.push_back({Expr, Type, &C, RI.r_offset,
+                               adjustAddend(File, Addend, RI, Expr, Body),
+                               &Body, TLSOP_NONE});
+      continue;
+    }
+
     bool Preemptible = isPreemptible(Body, Type);
+
+    // Must be checked before adjustExpr, which creates copy
+    // relocations and redirects symbols to PLT entries as it goes.
+    if (Needs && needsSerialScan(File, Body, Expr, Type, IsWrite)) {
+      Needs->NeedsSerialScan = true;
+      return;
+    }
+
     Expr = adjustExpr(File, Body, IsWrite, Expr, Type, Buf + RI.r_offset);
     if (HasError)
       continue;
@@ -541,10 +736,16 @@ static void scanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels) {
 
     // This relocation does not require got entry, but it is relative to got and
     // needs it to be created. Here we request for that.
-    if (Expr == R_GOTONLY_PC || Expr == R_GOTREL || Expr == R_PPC_TOC)
-      Out<ELFT>::Got->HasGotOffRel = true;
+    if (Expr == R_GOTONLY_PC || Expr == R_GOTREL || Expr == R_PPC_TOC) {
+      if (Needs)
+        Needs->HasGotOffRel = true;
+      else
+        Out<ELFT>::Got->HasGotOffRel = true;
+    }
 
-    uintX_t Addend = computeAddend(File, Buf, E, RI, Expr, Body);
+    uintX_t Addend = RelTy::IsRela ? readAddend(File, Buf, E, RI, Body)
+                                   : Addends[I - Rels.begin()];
+    Addend = adjustAddend(File, Addend, RI, Expr, Body);
 
     if (unsigned Processed = handleTlsRelocation<ELFT>(
             Type, Body, C, RI.r_offset, Addend, Expr)) {
@@ -572,8 +773,17 @@ static void scanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels) {
       // If the produced value is a constant, we just remember to write it
       // when outputting this section. We also have to do it if the format
       // uses Elf_Rel, since in that case the written value is the addend.
-      if (Constant || !RelTy::IsRela)
-        C.Relocations.push_back({Expr, Type, &C, RI.r_offset, Addend, &Body});
+      // The same goes for a relative relocation that gets packed into
+      // .relr.dyn: its encoding has no addend field, so the link-time
+      // value must be in the section data for the loader to add the
+      // base to.
+      bool Packed =
+          !Constant && Out<ELFT>::RelrDyn &&
+          RelrSection<ELFT>::canEncode(
+              {Target->RelativeRel, &C, RI.r_offset, true, &Body, Addend});
+      if (Constant || !RelTy::IsRela || Packed)
+        C.Relocations.push_back(
+            {Expr, Type, &C, RI.r_offset, Addend, &Body, TLSOP_NONE});
     } else {
       // We don't know anything about the finaly symbol. Just ask the dynamic
       // linker to handle the relocation for us.
@@ -593,15 +803,25 @@ static void scanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels) {
       // to the GOT entry and reads the GOT entry when it needs to perform
       // a dynamic relocation.
       // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf p.4-19
-      if (Config->EMachine == EM_MIPS)
-        Out<ELFT>::Got->addMipsEntry(Body, Addend, Expr);
+      if (Config->EMachine == EM_MIPS) {
+        if (Needs)
+          Needs->Entries.push_back({&Body, Addend, Expr, Preemptible, false});
+        else
+          Out<ELFT>::Got->addMipsEntry(Body, Addend, Expr);
+      }
       continue;
     }
 
-    // Some targets might require creation of thunks for relocations.
-    // Now we support only MIPS which requires LA25 thunk to call PIC
-    // code from non-PIC one.
+    // Some targets might require creation of thunks for relocations:
+    // MIPS needs LA25 thunks to call PIC code from non-PIC code, and
+    // ARM needs interworking thunks for plain branches to a function in
+    // the other instruction state. The thunk is emitted next to the
+    // destination's section and reused by every caller of the symbol.
     if (Expr == R_THUNK) {
+      if (Needs) {
+        Needs->NeedsSerialScan = true;
+        return;
+      }
       if (!Body.hasThunk()) {
         auto *Sec = cast<InputSection<ELFT>>(
             cast<DefinedRegular<ELFT>>(&Body)->Section);
@@ -615,78 +835,117 @@ static void scanRelocs(InputSectionBase<ELFT> &C, ArrayRef<RelTy> Rels) {
 
     // If a relocation needs PLT, we create a PLT and a GOT slot for the symbol.
     if (needsPlt(Expr)) {
-      if (Body.isInPlt())
-        continue;
-      Out<ELFT>::Plt->addEntry(Body);
-
-      uint32_t Rel;
-      if (Body.isGnuIFunc() && !Preemptible)
-        Rel = Target->IRelativeRel;
+      if (Needs)
+        Needs->Entries.push_back({&Body, 0, Expr, Preemptible, true});
       else
-        Rel = Target->PltRel;
-
-      Out<ELFT>::GotPlt->addEntry(Body);
-      Out<ELFT>::RelaPlt->addReloc({Rel, Out<ELFT>::GotPlt,
-                                    Body.getGotPltOffset<ELFT>(), !Preemptible,
-                                    &Body, 0});
+        addPltEntry<ELFT>(Body, Preemptible);
       continue;
     }
 
     if (refersToGotEntry(Expr)) {
-      if (Config->EMachine == EM_MIPS) {
-        // MIPS ABI has special rules to process GOT entries
-        // and doesn't require relocation entries for them.
-        // See "Global Offset Table" in Chapter 5 in the following document
-        // for detailed description:
-        // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf
-        Out<ELFT>::Got->addMipsEntry(Body, Addend, Expr);
-        if (Body.isTls())
-          AddDyn({Target->TlsGotRel, Out<ELFT>::Got, Body.getGotOffset<ELFT>(),
-                  !Preemptible, &Body, 0});
-        continue;
-      }
-
-      if (Body.isInGot())
-        continue;
-
-      Out<ELFT>::Got->addEntry(Body);
-      if (Preemptible || (Config->Pic && !isAbsolute<ELFT>(Body))) {
-        uint32_t DynType;
-        if (Body.isTls())
-          DynType = Target->TlsGotRel;
-        else if (Preemptible)
-          DynType = Target->GotRel;
-        else
-          DynType = Target->RelativeRel;
-        AddDyn({DynType, Out<ELFT>::Got, Body.getGotOffset<ELFT>(),
-                !Preemptible, &Body, 0});
-      }
+      if (Needs)
+        Needs->Entries.push_back({&Body, Addend, Expr, Preemptible, false});
+      else
+        addGotEntry<ELFT>(Body, Addend, Expr, Preemptible);
       continue;
     }
   }
 }
 
-template <class ELFT> void scanRelocations(InputSection<ELFT> &C) {
+template <class ELFT>
+static void scanRelocSection(InputSectionBase<ELFT> &S,
+                             const typename ELFT::Shdr &RelSec,
+                             RelocationNeeds<ELFT> *Needs) {
+  ELFFile<ELFT> &EObj = S.getFile()->getObj();
+  if (RelSec.sh_type == SHT_RELA)
+    scanRelocs(S, EObj.relas(&RelSec), Needs);
+  else
+    scanRelocs(S, EObj.rels(&RelSec), Needs);
+}
+
+// Scans all relocations of one input section. If Needs is non-null,
+// side effects on the GOT, PLT and dynamic relocation sections are
+// buffered there instead of applied, and any section entries that were
+// added are rolled back if the section turns out to need a serial
+// rescan.
+template <class ELFT>
+static void scanSection(InputSectionBase<ELFT> *C,
+                        RelocationNeeds<ELFT> *Needs) {
   typedef typename ELFT::Shdr Elf_Shdr;
 
+  size_t OldSize = C->Relocations.size();
+  if (auto *S = dyn_cast<InputSection<ELFT>>(C)) {
+    // Note that relocations for non-alloc sections are directly
+    // processed by InputSection::relocateNonAlloc.
+    if (S->getSectionHdr()->sh_flags & SHF_ALLOC)
+      for (const Elf_Shdr *RelSec : S->RelocSections) {
+        scanRelocSection(*C, *RelSec, Needs);
+        if (Needs && Needs->NeedsSerialScan)
+          break;
+      }
+  } else if (auto *S = dyn_cast<EhInputSection<ELFT>>(C)) {
+    if (S->RelocSection)
+      scanRelocSection(*C, *S->RelocSection, Needs);
+  }
+
+  if (Needs && Needs->NeedsSerialScan) {
+    C->Relocations.resize(OldSize);
+    Needs->Entries.clear();
+    Needs->DynRelocs.clear();
+    Needs->HasGotOffRel = false;
+  }
+}
+
+template <class ELFT> void scanRelocations(InputSection<ELFT> &C) {
   // Scan all relocations. Each relocation goes through a series
   // of tests to determine if it needs special treatment, such as
   // creating GOT, PLT, copy relocations, etc.
-  // Note that relocations for non-alloc sections are directly
-  // processed by InputSection::relocateNonAlloc.
-  if (C.getSectionHdr()->sh_flags & SHF_ALLOC)
-    for (const Elf_Shdr *RelSec : C.RelocSections)
-      scanRelocations(C, *RelSec);
+  scanSection<ELFT>(&C, nullptr);
 }
 
 template <class ELFT>
 void scanRelocations(InputSectionBase<ELFT> &S,
                      const typename ELFT::Shdr &RelSec) {
-  ELFFile<ELFT> &EObj = S.getFile()->getObj();
-  if (RelSec.sh_type == SHT_RELA)
-    scanRelocs(S, EObj.relas(&RelSec));
-  else
-    scanRelocs(S, EObj.rels(&RelSec));
+  scanRelocSection(S, RelSec, nullptr);
+}
+
+// Scans relocations of all given sections. The scan itself runs in
+// parallel with per-section needs buffers; the buffers are then
+// replayed serially in input order, so the resulting GOT, PLT and
+// dynamic relocation sections are identical to what a serial scan
+// produces. Sections whose relocations have unbufferable side effects
+// (TLS, copy relocations, thunks) are rescanned serially.
+template <class ELFT>
+void scanRelocations(ArrayRef<InputSectionBase<ELFT> *> Sections) {
+  std::vector<std::pair<InputSectionBase<ELFT> *, RelocationNeeds<ELFT>>> V(
+      Sections.size());
+  for (size_t I = 0, E = Sections.size(); I != E; ++I)
+    V[I].first = Sections[I];
+
+  parallel_for_each(V.begin(), V.end(),
+                    [](std::pair<InputSectionBase<ELFT> *,
+                                 RelocationNeeds<ELFT>> &P) {
+                      scanSection(P.first, &P.second);
+                    },
+                    16);
+
+  for (auto &P : V) {
+    RelocationNeeds<ELFT> &N = P.second;
+    if (N.NeedsSerialScan) {
+      scanSection<ELFT>(P.first, nullptr);
+      continue;
+    }
+    if (N.HasGotOffRel)
+      Out<ELFT>::Got->HasGotOffRel = true;
+    for (const DynamicReloc<ELFT> &Reloc : N.DynRelocs)
+      Out<ELFT>::RelaDyn->addReloc(Reloc);
+    for (const typename RelocationNeeds<ELFT>::Entry &E : N.Entries) {
+      if (E.NeedsPlt)
+        addPltEntry<ELFT>(*E.Body, E.Preemptible);
+      else
+        addGotEntry<ELFT>(*E.Body, E.Addend, E.Expr, E.Preemptible);
+    }
+  }
 }
 
 template void scanRelocations<ELF32LE>(InputSection<ELF32LE> &);
@@ -702,5 +961,10 @@ template void scanRelocations<ELF64LE>(InputSectionBase<ELF64LE> &,
                                        const ELF64LE::Shdr &);
 template void scanRelocations<ELF64BE>(InputSectionBase<ELF64BE> &,
                                        const ELF64BE::Shdr &);
+
+template void scanRelocations<ELF32LE>(ArrayRef<InputSectionBase<ELF32LE> *>);
+template void scanRelocations<ELF32BE>(ArrayRef<InputSectionBase<ELF32BE> *>);
+template void scanRelocations<ELF64LE>(ArrayRef<InputSectionBase<ELF64LE> *>);
+template void scanRelocations<ELF64BE>(ArrayRef<InputSectionBase<ELF64BE> *>);
 }
 }
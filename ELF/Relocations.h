@@ -62,6 +62,36 @@ enum RelExpr {
   R_TLSLD_PC
 };
 
+// A concrete TLS relaxation rewrite. scanRelocations decides which one
+// applies while it still has the relocation expression and type at
+// hand and records it in the Relocation; the write loop then applies
+// the opcode directly instead of re-deriving the decision from the
+// (expression, type) pair for every relocation. TLSOP_NONE must be
+// zero so that relocations built without an opcode get it implicitly
+// from aggregate initialization.
+enum TlsRelaxOp : uint8_t {
+  TLSOP_NONE = 0,
+  TLSOP_386_GD_TO_LE,
+  TLSOP_386_GD_TO_IE,
+  TLSOP_386_IE_TO_LE,
+  TLSOP_386_GOTIE_TO_LE,
+  TLSOP_386_LD_TO_LE,
+  TLSOP_386_LDO_TO_LE,
+  TLSOP_X64_GD_TO_LE,
+  TLSOP_X64_GD_TO_IE,
+  TLSOP_X64_IE_TO_LE,
+  TLSOP_X64_LD_TO_LE,
+  TLSOP_X64_DTPOFF32_TO_LE,
+  TLSOP_X64_DTPOFF64_TO_LE,
+  TLSOP_AARCH64_DESC_NOP,
+  TLSOP_AARCH64_DESC_TO_IE_PAGE,
+  TLSOP_AARCH64_DESC_TO_IE_LD,
+  TLSOP_AARCH64_DESC_TO_LE_MOVZ,
+  TLSOP_AARCH64_DESC_TO_LE_MOVK,
+  TLSOP_AARCH64_IE_TO_LE_MOVZ,
+  TLSOP_AARCH64_IE_TO_LE_MOVK
+};
+
 template <class ELFT> struct Relocation {
   RelExpr Expr;
   uint32_t Type;
@@ -69,12 +99,19 @@ template <class ELFT> struct Relocation {
   uint64_t Offset;
   uint64_t Addend;
   SymbolBody *Sym;
+  TlsRelaxOp RelaxOp;
 };
 
 template <class ELFT> void scanRelocations(InputSection<ELFT> &);
 
 template <class ELFT>
 void scanRelocations(InputSectionBase<ELFT> &, const typename ELFT::Shdr &);
+
+// Scans the relocations of all given sections in parallel, buffering
+// per-section GOT/PLT/dynamic-relocation needs and merging them
+// deterministically in input order.
+template <class ELFT>
+void scanRelocations(llvm::ArrayRef<InputSectionBase<ELFT> *> Sections);
 }
 }
 
@@ -16,9 +16,13 @@
 
 #include "SymbolTable.h"
 #include "Config.h"
+#include "Counters.h"
 #include "Error.h"
 #include "LinkerScript.h"
+#include "Memory.h"
 #include "Symbols.h"
+#include "lld/Core/Parallel.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/StringSaver.h"
 
@@ -50,6 +54,11 @@ template <class ELFT> static bool isCompatible(InputFile *FileP) {
 template <class ELFT>
 void SymbolTable<ELFT>::addFile(std::unique_ptr<InputFile> File) {
   InputFile *FileP = File.get();
+  // Files added directly rather than through addFiles (archive
+  // members and LTO objects) claim comdat groups only after every
+  // batch file has, so a fresh ordinal keeps the first-wins rule.
+  if (FileP->ComdatOrdinal == (uint32_t)-1)
+    FileP->ComdatOrdinal = ComdatGroups.nextOrdinal();
   if (!isCompatible<ELFT>(FileP))
     return;
 
@@ -95,6 +104,90 @@ void SymbolTable<ELFT>::addFile(std::unique_ptr<InputFile> File) {
   F->parse(ComdatGroups);
 }
 
+// Add symbols of all given files to the symbol table. This is
+// equivalent to calling addFile for each file in order, except that
+// section and symbol tables of regular object files are decoded in
+// parallel. Only comdat group resolution and symbol resolution, whose
+// results depend on input order, run serially.
+template <class ELFT>
+void SymbolTable<ELFT>::addFiles(
+    std::vector<std::unique_ptr<InputFile>> &Files) {
+  // Give every file a comdat claim ordinal equal to its input
+  // position and pull out the regular object files. The objects claim
+  // their group signatures in parallel below; because each signature
+  // records the smallest claiming ordinal, the winner is the same as
+  // under the serial first-wins rule no matter which thread gets
+  // there first.
+  std::vector<ObjectFile<ELFT> *> Objs;
+  for (std::unique_ptr<InputFile> &File : Files) {
+    InputFile *FileP = File.get();
+    FileP->ComdatOrdinal = ComdatGroups.nextOrdinal();
+    if (!isa<ObjectFile<ELFT>>(FileP))
+      continue;
+    if (!isCompatible<ELFT>(FileP)) {
+      File.reset();
+      continue;
+    }
+    if (Config->Trace)
+      llvm::outs() << getFilename(FileP) << "\n";
+    auto *F = cast<ObjectFile<ELFT>>(File.release());
+    ObjectFiles.emplace_back(F);
+    Objs.push_back(F);
+  }
+
+  // All object claims must be recorded before any non-object file is
+  // added: bitcode files resolve their comdat groups the moment they
+  // are parsed.
+  parallel_for_each(Objs.begin(), Objs.end(),
+                    [this](ObjectFile<ELFT> *F) { F->claimGroups(ComdatGroups); },
+                    1);
+
+  for (std::unique_ptr<InputFile> &File : Files)
+    if (File)
+      addFile(std::move(File));
+
+  // Resolve comdat group ownership, decode section headers, wire up
+  // relocation sections and create section and local symbol objects,
+  // scaling over all cores, and
+  // resolve global symbols serially in input order. The two phases
+  // are pipelined rather than separated by a barrier: a file's
+  // resolution needs only its own decoded sections plus the previous
+  // file's resolution, so early files resolve while later files are
+  // still being decoded. Resolution only ever runs on one thread at a
+  // time, and the input-order chain keeps its results identical to
+  // the fully serial loop.
+  // The tasks below run concurrently, so buffer their diagnostics in
+  // one sink per file and replay them in input order once the graph
+  // has run. Besides keeping the output deterministic, this reports
+  // every broken input in a single link attempt instead of stopping
+  // at the first one. (A file broken badly enough to hit fatal()
+  // still ends the link, but only after draining the sinks.) A file's
+  // parse and resolve tasks share a sink; the edge between them means
+  // it is never used from two threads at once.
+  std::vector<ErrorSink> Sinks(Objs.size());
+  TaskGraph Graph;
+  TaskGraph::TaskId Prev = 0;
+  for (size_t I = 0, E = Objs.size(); I != E; ++I) {
+    ObjectFile<ELFT> *F = Objs[I];
+    ErrorSink *S = &Sinks[I];
+    TaskGraph::TaskId Parse = Graph.addTask([this, F, S] {
+      ScopedErrorSink Scope(S);
+      F->parseGroups(ComdatGroups);
+      F->parseSections();
+    });
+    TaskGraph::TaskId Resolve = Graph.addTask([F, S] {
+      ScopedErrorSink Scope(S);
+      F->parseSymbols();
+    });
+    Graph.addEdge(Parse, Resolve);
+    if (I != 0)
+      Graph.addEdge(Prev, Resolve);
+    Prev = Resolve;
+  }
+  Graph.run();
+  reportCollectedErrors();
+}
+
 // This function is where all the optimizations of link-time
 // optimization happens. When LTO is in use, some input files are
 // not in native object file format but in the LLVM bitcode format.
@@ -190,14 +283,65 @@ static uint16_t getVersionId(Symbol *Sym, StringRef Name) {
   return 0;
 }
 
+// Maps a symbol name to the shard responsible for it. We do not use the
+// default StringRef hash because it differs between 32 and 64 bit hosts;
+// this keeps shard assignment reproducible when cross linking.
+template <class ELFT>
+typename SymbolTable<ELFT>::Shard &SymbolTable<ELFT>::getShard(StringRef Name) {
+  return Shards[llvm::HashString(Name) % NumShards];
+}
+
+ComdatGroupTable::Shard &ComdatGroupTable::getShard(StringRef Signature) {
+  return Shards[llvm::HashString(Signature) % NumShards];
+}
+
+bool ComdatGroupTable::claim(StringRef Signature, uint32_t Ordinal) {
+  Shard &Sh = getShard(Signature);
+  std::lock_guard<std::mutex> Lock(Sh.Mutex);
+  auto P = Sh.Map.insert(std::make_pair(Signature, Ordinal));
+  if (P.second)
+    return true;
+  if (Ordinal >= P.first->second)
+    return false;
+  P.first->second = Ordinal;
+  return true;
+}
+
+bool ComdatGroupTable::isOwner(StringRef Signature, uint32_t Ordinal) {
+  Shard &Sh = getShard(Signature);
+  std::lock_guard<std::mutex> Lock(Sh.Mutex);
+  auto It = Sh.Map.find(Signature);
+  return It != Sh.Map.end() && It->second == Ordinal;
+}
+
+size_t ComdatGroupTable::size() {
+  size_t N = 0;
+  for (Shard &Sh : Shards) {
+    std::lock_guard<std::mutex> Lock(Sh.Mutex);
+    N += Sh.Map.size();
+  }
+  return N;
+}
+
+size_t ComdatGroupTable::getMemorySize() {
+  size_t N = 0;
+  for (Shard &Sh : Shards) {
+    std::lock_guard<std::mutex> Lock(Sh.Mutex);
+    N += Sh.Map.getMemorySize();
+  }
+  return N;
+}
+
 // Find an existing symbol or create and insert a new one.
 template <class ELFT>
 std::pair<Symbol *, bool> SymbolTable<ELFT>::insert(StringRef Name) {
-  unsigned NumSyms = SymVector.size();
-  auto P = Symtab.insert(std::make_pair(Name, NumSyms));
-  Symbol *Sym;
+  LLD_COUNT(SymbolsResolved);
+  Shard &Sh = getShard(Name);
+  std::lock_guard<std::recursive_mutex> Lock(Sh.Mutex);
+  auto P = Sh.Map.insert(std::make_pair(Name, nullptr));
+  Symbol *Sym = P.first->second;
   if (P.second) {
-    Sym = new (Alloc) Symbol;
+    Sym = make<Symbol>();
     Sym->Binding = STB_WEAK;
     Sym->Visibility = STV_DEFAULT;
     Sym->IsUsedInRegularObj = false;
@@ -205,9 +349,9 @@ std::pair<Symbol *, bool> SymbolTable<ELFT>::insert(StringRef Name) {
     Sym->VersionId = getVersionId(Sym, Name);
     Sym->VersionedName =
         Sym->VersionId != VER_NDX_LOCAL && Sym->VersionId != VER_NDX_GLOBAL;
+    P.first->second = Sym;
+    std::lock_guard<std::mutex> VLock(SymVectorMutex);
     SymVector.push_back(Sym);
-  } else {
-    Sym = SymVector[P.first->second];
   }
   return {Sym, P.second};
 }
@@ -219,6 +363,9 @@ std::pair<Symbol *, bool>
 SymbolTable<ELFT>::insert(StringRef Name, uint8_t Type, uint8_t Visibility,
                           bool CanOmitFromDynSym, bool IsUsedInRegularObj,
                           InputFile *File) {
+  // Hold the shard lock for the whole resolution step so that
+  // attribute merging for one name is atomic.
+  std::lock_guard<std::recursive_mutex> Lock(getShard(Name).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) = insert(Name);
@@ -238,13 +385,52 @@ SymbolTable<ELFT>::insert(StringRef Name, uint8_t Type, uint8_t Visibility,
 }
 
 // Construct a string in the form of "Sym in File1 and File2".
-// Used to construct an error message.
+// Used to construct an error message. If the definitions carry DWARF
+// line information, the source locations are appended. The two files'
+// line tables decode concurrently and are cached per file, so a storm
+// of duplicate-symbol reports pays for each .debug_line once, and a
+// single report pays for the slower of the two decodes rather than
+// their sum.
 template <typename ELFT>
 std::string SymbolTable<ELFT>::conflictMsg(SymbolBody *Existing,
-                                           InputFile *NewFile) {
-  StringRef Sym = Existing->getName();
-  return demangle(Sym) + " in " + getFilename(Existing->getSourceFile<ELFT>()) +
-         " and " + getFilename(NewFile);
+                                           InputFile *NewFile,
+                                           InputSectionBase<ELFT> *NewSec,
+                                           uintX_t NewValue) {
+  ObjectFile<ELFT> *OldFile = nullptr;
+  InputSectionBase<ELFT> *OldSec = nullptr;
+  uintX_t OldValue = 0;
+  if (auto *D = dyn_cast<DefinedRegular<ELFT>>(Existing)) {
+    if (D->Section && D->Section->getFile()) {
+      OldFile = D->Section->getFile();
+      OldSec = D->Section;
+      OldValue = D->Value;
+    }
+  }
+  ObjectFile<ELFT> *NewObj = NewSec ? NewSec->getFile() : nullptr;
+
+  {
+    TaskGroup Tg;
+    if (OldFile)
+      Tg.spawn([OldFile] { OldFile->decodeDwarfLine(); });
+    if (NewObj && NewObj != OldFile)
+      Tg.spawn([NewObj] { NewObj->decodeDwarfLine(); });
+  }
+
+  std::string Msg = (demangle(Existing->getName()) + " in " +
+                     getFilename(Existing->getSourceFile<ELFT>()))
+                        .str();
+  if (OldFile) {
+    std::string Loc = OldFile->getLineInfo(OldSec, OldValue);
+    if (!Loc.empty())
+      Msg += " (" + Loc + ")";
+  }
+  Msg += " and " + getFilename(NewFile);
+  if (NewObj) {
+    std::string Loc = NewObj->getLineInfo(NewSec, NewValue);
+    if (!Loc.empty())
+      Msg += " (" + Loc + ")";
+  }
+  return Msg;
 }
 
 template <class ELFT> Symbol *SymbolTable<ELFT>::addUndefined(StringRef Name) {
@@ -257,6 +443,7 @@ Symbol *SymbolTable<ELFT>::addUndefined(StringRef Name, uint8_t Binding,
                                         uint8_t StOther, uint8_t Type,
                                         bool CanOmitFromDynSym,
                                         InputFile *File) {
+  std::lock_guard<std::recursive_mutex> Lock(getShard(Name).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) =
@@ -324,6 +511,7 @@ Symbol *SymbolTable<ELFT>::addCommon(StringRef N, uint64_t Size,
                                      uint64_t Alignment, uint8_t Binding,
                                      uint8_t StOther, uint8_t Type,
                                      InputFile *File) {
+  std::lock_guard<std::recursive_mutex> Lock(getShard(N).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) =
@@ -353,8 +541,11 @@ Symbol *SymbolTable<ELFT>::addCommon(StringRef N, uint64_t Size,
 
 template <class ELFT>
 void SymbolTable<ELFT>::reportDuplicate(SymbolBody *Existing,
-                                        InputFile *NewFile) {
-  std::string Msg = "duplicate symbol: " + conflictMsg(Existing, NewFile);
+                                        InputFile *NewFile,
+                                        InputSectionBase<ELFT> *NewSec,
+                                        uintX_t NewValue) {
+  std::string Msg =
+      "duplicate symbol: " + conflictMsg(Existing, NewFile, NewSec, NewValue);
   if (Config->AllowMultipleDefinition)
     warning(Msg);
   else
@@ -364,6 +555,7 @@ void SymbolTable<ELFT>::reportDuplicate(SymbolBody *Existing,
 template <typename ELFT>
 Symbol *SymbolTable<ELFT>::addRegular(StringRef Name, const Elf_Sym &Sym,
                                       InputSectionBase<ELFT> *Section) {
+  std::lock_guard<std::recursive_mutex> Lock(getShard(Name).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) =
@@ -374,13 +566,14 @@ Symbol *SymbolTable<ELFT>::addRegular(StringRef Name, const Elf_Sym &Sym,
   if (Cmp > 0)
     replaceBody<DefinedRegular<ELFT>>(S, Name, Sym, Section);
   else if (Cmp == 0)
-    reportDuplicate(S->body(), Section->getFile());
+    reportDuplicate(S->body(), Section->getFile(), Section, Sym.st_value);
   return S;
 }
 
 template <typename ELFT>
 Symbol *SymbolTable<ELFT>::addRegular(StringRef Name, uint8_t Binding,
                                       uint8_t StOther) {
+  std::lock_guard<std::recursive_mutex> Lock(getShard(Name).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) =
@@ -398,6 +591,7 @@ template <typename ELFT>
 Symbol *SymbolTable<ELFT>::addSynthetic(StringRef N,
                                         OutputSectionBase<ELFT> *Section,
                                         uintX_t Value) {
+  std::lock_guard<std::recursive_mutex> Lock(getShard(N).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) =
@@ -418,6 +612,7 @@ void SymbolTable<ELFT>::addShared(SharedFile<ELFT> *F, StringRef Name,
   // DSO symbols do not affect visibility in the output, so we pass STV_DEFAULT
   // as the visibility, which will leave the visibility in the symbol table
   // unchanged.
+  std::lock_guard<std::recursive_mutex> Lock(getShard(Name).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) =
@@ -437,6 +632,7 @@ template <class ELFT>
 Symbol *SymbolTable<ELFT>::addBitcode(StringRef Name, bool IsWeak,
                                       uint8_t StOther, uint8_t Type,
                                       bool CanOmitFromDynSym, BitcodeFile *F) {
+  std::lock_guard<std::recursive_mutex> Lock(getShard(Name).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) = insert(Name, Type, StOther & 3, CanOmitFromDynSym,
@@ -451,42 +647,24 @@ Symbol *SymbolTable<ELFT>::addBitcode(StringRef Name, bool IsWeak,
 }
 
 template <class ELFT> SymbolBody *SymbolTable<ELFT>::find(StringRef Name) {
-  auto It = Symtab.find(Name);
-  if (It == Symtab.end())
+  Shard &Sh = getShard(Name);
+  std::lock_guard<std::recursive_mutex> Lock(Sh.Mutex);
+  auto It = Sh.Map.find(Name);
+  if (It == Sh.Map.end())
     return nullptr;
-  return SymVector[It->second]->body();
+  return It->second->body();
 }
 
-// Returns a list of defined symbols that match with a given glob pattern.
 template <class ELFT>
-std::vector<SymbolBody *> SymbolTable<ELFT>::findAll(StringRef Pattern) {
-  // Fast-path. Fallback to find() if Pattern doesn't contain any wildcard
-  // characters.
-  if (Pattern.find_first_of("?*") == StringRef::npos) {
-    if (SymbolBody *B = find(Pattern))
-      if (!B->isUndefined())
-        return {B};
-    return {};
-  }
-
-  std::vector<SymbolBody *> Res;
-  for (auto &It : Symtab) {
-    StringRef Name = It.first.Val;
-    SymbolBody *B = SymVector[It.second]->body();
-    if (!B->isUndefined() && globMatch(Pattern, Name))
-      Res.push_back(B);
-  }
-  return Res;
-}
-
-template <class ELFT>
-void SymbolTable<ELFT>::addLazyArchive(
-    ArchiveFile *F, const llvm::object::Archive::Symbol Sym) {
+void SymbolTable<ELFT>::addLazyArchive(ArchiveFile *F, StringRef Name,
+                                       uint64_t ChildOffset) {
+  std::lock_guard<std::recursive_mutex> Lock(getShard(Name).Mutex);
   Symbol *S;
   bool WasInserted;
-  std::tie(S, WasInserted) = insert(Sym.getName());
+  std::tie(S, WasInserted) = insert(Name);
   if (WasInserted) {
-    replaceBody<LazyArchive>(S, *F, Sym, SymbolBody::UnknownType);
+    replaceBody<LazyArchive>(S, *F, Name, ChildOffset,
+                             SymbolBody::UnknownType);
     return;
   }
   if (!S->body()->isUndefined())
@@ -500,16 +678,17 @@ void SymbolTable<ELFT>::addLazyArchive(
   // this symbol as used when we added it to the symbol table, but we also need
   // to preserve its type. FIXME: Move the Type field to Symbol.
   if (S->isWeak()) {
-    replaceBody<LazyArchive>(S, *F, Sym, S->body()->Type);
+    replaceBody<LazyArchive>(S, *F, Name, ChildOffset, S->body()->Type);
     return;
   }
-  MemoryBufferRef MBRef = F->getMember(&Sym);
+  MemoryBufferRef MBRef = F->getMember(ChildOffset, Name);
   if (!MBRef.getBuffer().empty())
     addFile(createObjectFile(MBRef, F->getName()));
 }
 
 template <class ELFT>
 void SymbolTable<ELFT>::addLazyObject(StringRef Name, LazyObjectFile &Obj) {
+  std::lock_guard<std::recursive_mutex> Lock(getShard(Name).Mutex);
   Symbol *S;
   bool WasInserted;
   std::tie(S, WasInserted) = insert(Name);
@@ -530,6 +709,23 @@ void SymbolTable<ELFT>::addLazyObject(StringRef Name, LazyObjectFile &Obj) {
   }
 }
 
+// With -lazy-dso-symbols, shared files did not enter their definitions
+// into the symbol table eagerly. Resolve every symbol that is still
+// undefined against them here, probing in command line order so the
+// same DSO ends up providing a symbol as in an eager link.
+template <class ELFT> void SymbolTable<ELFT>::resolveLazyDsoSymbols() {
+  if (!Config->LazyDsoSymbols)
+    return;
+  for (Symbol *S : SymVector) {
+    SymbolBody *B = S->body();
+    if (!B->isUndefined())
+      continue;
+    for (std::unique_ptr<SharedFile<ELFT>> &F : SharedFiles)
+      if (F->loadSymbol(B->getName()))
+        break;
+  }
+}
+
 // Process undefined (-u) flags by loading lazy symbols named by those flags.
 template <class ELFT> void SymbolTable<ELFT>::scanUndefinedFlags() {
   for (StringRef S : Config->Undefined)
@@ -553,12 +749,34 @@ template <class ELFT> void SymbolTable<ELFT>::scanShlibUndefined() {
           Sym->symbol()->ExportDynamic = true;
 }
 
+static bool hasWildcard(StringRef S) {
+  return S.find_first_of("?*") != StringRef::npos;
+}
+
 // This function process the dynamic list option by marking all the symbols
 // to be exported in the dynamic table.
 template <class ELFT> void SymbolTable<ELFT>::scanDynamicList() {
+  if (Config->DynamicList.empty())
+    return;
+
+  // Usually the list contains only exact names, which we can look up
+  // directly.
+  if (std::none_of(Config->DynamicList.begin(), Config->DynamicList.end(),
+                   hasWildcard)) {
+    for (StringRef S : Config->DynamicList)
+      if (SymbolBody *B = find(S))
+        B->symbol()->ExportDynamic = true;
+    return;
+  }
+
+  // With wildcards we compile all entries into one matcher and make a
+  // single pass over the symbol table.
+  GlobSet Globs;
   for (StringRef S : Config->DynamicList)
-    if (SymbolBody *B = find(S))
-      B->symbol()->ExportDynamic = true;
+    Globs.add(S, 0);
+  for (Symbol *S : SymVector)
+    if (Globs.matches(S->body()->getName()))
+      S->ExportDynamic = true;
 }
 
 // This function processes the --version-script option by marking all global
@@ -574,28 +792,53 @@ template <class ELFT> void SymbolTable<ELFT>::scanVersionScript() {
     return;
   }
 
-  // If we have symbols version declarations, we should
-  // assign version references for each symbol.
+  if (Config->SymbolVersions.empty())
+    return;
+
+  // If we have symbols version declarations, we should assign version
+  // references for each symbol. Rather than walking the whole symbol
+  // table once per pattern, we compile all patterns into one matcher
+  // and make a single pass over the table, replaying the matches for
+  // each symbol in pattern order so that the last matching pattern
+  // wins, as before.
+  struct Pattern {
+    StringRef Name;
+    StringRef VersionName;
+    size_t VersionId;
+    bool Matched = false;
+  };
+  std::vector<Pattern> Patterns;
+  GlobSet Globs;
   size_t I = 2;
   for (Version &V : Config->SymbolVersions) {
     for (StringRef Name : V.Globals) {
-      std::vector<SymbolBody *> Syms = findAll(Name);
-      if (Syms.empty()) {
-        if (Config->NoUndefinedVersion)
-          error("version script assignment of " + V.Name + " to symbol " +
-                Name + " failed: symbol not defined");
-        continue;
-      }
-
-      for (SymbolBody *B : Syms) {
-        if (B->symbol()->VersionId != VER_NDX_GLOBAL &&
-            B->symbol()->VersionId != VER_NDX_LOCAL)
-          warning("duplicate symbol " + Name + " in version script");
-        B->symbol()->VersionId = I;
-      }
+      Globs.add(Name, Patterns.size());
+      Patterns.push_back({Name, V.Name, I, false});
     }
     ++I;
   }
+
+  std::vector<unsigned> Ids;
+  for (Symbol *S : SymVector) {
+    SymbolBody *B = S->body();
+    if (B->isUndefined())
+      continue;
+    Ids.clear();
+    Globs.match(B->getName(), Ids);
+    for (unsigned Id : Ids) {
+      Pattern &P = Patterns[Id];
+      P.Matched = true;
+      if (S->VersionId != VER_NDX_GLOBAL && S->VersionId != VER_NDX_LOCAL)
+        warning("duplicate symbol " + P.Name + " in version script");
+      S->VersionId = P.VersionId;
+    }
+  }
+
+  if (Config->NoUndefinedVersion)
+    for (Pattern &P : Patterns)
+      if (!P.Matched)
+        error("version script assignment of " + P.VersionName + " to symbol " +
+              P.Name + " failed: symbol not defined");
 }
 
 // Print the module names which define the notified
@@ -609,6 +852,48 @@ template <class ELFT> void SymbolTable<ELFT>::traceDefined() {
                  << B->getName() << "\n";
 }
 
+// Records the footprint of the symbol table's own data structures and
+// of the split-section piece vectors for --stats and -stats-json=.
+// Called once at the end of the link, when every container is at its
+// peak size; the free recordMemoryUsage must be called with an
+// explicit qualifier to not recurse.
+template <class ELFT> void SymbolTable<ELFT>::recordMemoryUsage() {
+  elf::recordMemoryUsage("symbol table arena", Alloc.getBytesAllocated(),
+                         SymVector.size());
+
+  uint64_t ShardBytes = 0;
+  uint64_t ShardSyms = 0;
+  for (Shard &S : Shards) {
+    ShardBytes += S.Map.getMemorySize();
+    ShardSyms += S.Map.size();
+  }
+  elf::recordMemoryUsage("symbol table shards", ShardBytes, ShardSyms);
+  elf::recordMemoryUsage("symbol vector",
+                         SymVector.capacity() * sizeof(Symbol *),
+                         SymVector.size());
+  elf::recordMemoryUsage("comdat groups", ComdatGroups.getMemorySize(),
+                         ComdatGroups.size());
+
+  uint64_t MergeBytes = 0;
+  uint64_t MergePieces = 0;
+  uint64_t EhBytes = 0;
+  uint64_t EhPieces = 0;
+  for (const std::unique_ptr<ObjectFile<ELFT>> &F : ObjectFiles)
+    for (InputSectionBase<ELFT> *S : F->getSections()) {
+      if (!S || S == &InputSection<ELFT>::Discarded)
+        continue;
+      if (auto *M = dyn_cast<MergeInputSection<ELFT>>(S)) {
+        MergeBytes += M->Pieces.capacity() * sizeof(SectionPiece);
+        MergePieces += M->Pieces.size();
+      } else if (auto *Eh = dyn_cast<EhInputSection<ELFT>>(S)) {
+        EhBytes += Eh->Pieces.capacity() * sizeof(SectionPiece);
+        EhPieces += Eh->Pieces.size();
+      }
+    }
+  elf::recordMemoryUsage("merge section pieces", MergeBytes, MergePieces);
+  elf::recordMemoryUsage("eh_frame pieces", EhBytes, EhPieces);
+}
+
 template class elf::SymbolTable<ELF32LE>;
 template class elf::SymbolTable<ELF32BE>;
 template class elf::SymbolTable<ELF64LE>;
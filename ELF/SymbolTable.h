@@ -14,6 +14,9 @@
 #include "LTO.h"
 #include "llvm/ADT/DenseMap.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace lld {
 namespace elf {
 class Lazy;
@@ -22,6 +25,45 @@ struct Symbol;
 
 typedef llvm::CachedHash<StringRef> SymName;
 
+// Comdat groups define "link once" sections. If two groups have the
+// same signature, only sections of the first one in input order are
+// kept. The table is sharded by signature hash like the symbol table
+// so that files parsed on different threads can claim groups in
+// parallel: each signature records the smallest claiming ordinal seen
+// so far, which makes the winner equal to the serial first-wins rule
+// no matter which thread claims first, provided every file with a
+// smaller ordinal has claimed by the time ownership is read.
+class ComdatGroupTable {
+public:
+  // Returns a claim ordinal for a file added outside the batch in
+  // SymbolTable::addFiles (archive members and LTO objects). Such
+  // files only ever claim after every batch file has, so any fresh
+  // value above the batch range preserves first-wins.
+  uint32_t nextOrdinal() { return NextOrdinal++; }
+
+  // Records Ordinal as a claimant for the given signature. Returns
+  // true if the claim owns the group, i.e. no claim with a smaller or
+  // equal ordinal was recorded before.
+  bool claim(StringRef Signature, uint32_t Ordinal);
+
+  // Returns true if Ordinal owns the group. Meaningful only once
+  // every file with a smaller ordinal has claimed.
+  bool isOwner(StringRef Signature, uint32_t Ordinal);
+
+  size_t size();
+  size_t getMemorySize();
+
+private:
+  struct Shard {
+    llvm::DenseMap<SymName, uint32_t> Map;
+    std::mutex Mutex;
+  };
+  enum { NumShards = 16 };
+  Shard Shards[NumShards];
+  Shard &getShard(StringRef Signature);
+  std::atomic<uint32_t> NextOrdinal{0};
+};
+
 // SymbolTable is a bucket of all known symbols, including defined,
 // undefined, or lazy symbols (the last one is symbols in archive
 // files whose archive members are not yet loaded).
@@ -40,6 +82,7 @@ template <class ELFT> class SymbolTable {
 
 public:
   void addFile(std::unique_ptr<InputFile> File);
+  void addFiles(std::vector<std::unique_ptr<InputFile>> &Files);
   void addCombinedLtoObject();
 
   llvm::ArrayRef<Symbol *> getSymbols() const { return SymVector; }
@@ -69,7 +112,7 @@ public:
   void addShared(SharedFile<ELFT> *F, StringRef Name, const Elf_Sym &Sym,
                  const typename ELFT::Verdef *Verdef);
 
-  void addLazyArchive(ArchiveFile *F, const llvm::object::Archive::Symbol S);
+  void addLazyArchive(ArchiveFile *F, StringRef Name, uint64_t ChildOffset);
   void addLazyObject(StringRef Name, LazyObjectFile &Obj);
   Symbol *addBitcode(StringRef Name, bool IsWeak, uint8_t StOther, uint8_t Type,
                      bool CanOmitFromDynSym, BitcodeFile *File);
@@ -78,6 +121,7 @@ public:
                     uint8_t Binding, uint8_t StOther, uint8_t Type,
                     InputFile *File);
 
+  void resolveLazyDsoSymbols();
   void scanUndefinedFlags();
   void scanShlibUndefined();
   void scanDynamicList();
@@ -87,31 +131,51 @@ public:
   SymbolBody *find(StringRef Name);
   void wrap(StringRef Name);
 
+  // Records the sizes of the symbol table's containers and the files'
+  // piece vectors for --stats and -stats-json=.
+  void recordMemoryUsage();
+
 private:
-  std::vector<SymbolBody *> findAll(StringRef Pattern);
   std::pair<Symbol *, bool> insert(StringRef Name);
   std::pair<Symbol *, bool> insert(StringRef Name, uint8_t Type,
                                    uint8_t Visibility, bool CanOmitFromDynSym,
                                    bool IsUsedInRegularObj, InputFile *File);
 
-  std::string conflictMsg(SymbolBody *Existing, InputFile *NewFile);
-  void reportDuplicate(SymbolBody *Existing, InputFile *NewFile);
+  std::string conflictMsg(SymbolBody *Existing, InputFile *NewFile,
+                          InputSectionBase<ELFT> *NewSec = nullptr,
+                          uintX_t NewValue = 0);
+  void reportDuplicate(SymbolBody *Existing, InputFile *NewFile,
+                       InputSectionBase<ELFT> *NewSec = nullptr,
+                       uintX_t NewValue = 0);
+
+  // The symbol table is sharded by symbol name hash so that files
+  // parsed on different threads can resolve symbols in parallel. A
+  // symbol's shard is a pure function of its name, so all resolution
+  // steps for one name serialize on the same shard lock. The lock is
+  // recursive because resolving an undefined symbol against a lazy
+  // one fetches an archive member, which re-enters the symbol table.
+  struct Shard {
+    llvm::DenseMap<SymName, Symbol *> Map;
+    std::recursive_mutex Mutex;
+  };
+  enum { NumShards = 16 };
+  Shard Shards[NumShards];
+  Shard &getShard(StringRef Name);
 
   // The order the global symbols are in is not defined. We can use an arbitrary
   // order, but it has to be reproducible. That is true even when cross linking.
   // The default hashing of StringRef produces different results on 32 and 64
-  // bit systems so we use a map to a vector. That is arbitrary, deterministic
-  // but a bit inefficient.
-  // FIXME: Experiment with passing in a custom hashing or sorting the symbols
-  // once symbol resolution is finished.
-  llvm::DenseMap<SymName, unsigned> Symtab;
+  // bit systems, so shard maps are never iterated to produce output; instead
+  // symbols are also appended to this vector, whose order is the insertion
+  // order. That is arbitrary and deterministic as long as files are added in
+  // a fixed order.
   std::vector<Symbol *> SymVector;
+  std::mutex SymVectorMutex;
   llvm::BumpPtrAllocator Alloc;
 
-  // Comdat groups define "link once" sections. If two comdat groups have the
-  // same name, only one of them is linked, and the other is ignored. This set
-  // is used to uniquify them.
-  llvm::DenseSet<StringRef> ComdatGroups;
+  // Uniquifies comdat groups across all input files. See the class
+  // comment for the concurrency rules.
+  ComdatGroupTable ComdatGroups;
 
   // The symbol table owns all file objects.
   std::vector<std::unique_ptr<ArchiveFile>> ArchiveFiles;
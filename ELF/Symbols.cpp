@@ -15,7 +15,9 @@
 #include "Target.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Config/config.h"
+#include "llvm/Support/Allocator.h"
 
 #ifdef HAVE_CXXABI_H
 #include <cxxabi.h>
@@ -109,6 +111,23 @@ StringRef SymbolBody::getName() const {
   return S.substr(0, S.find('@'));
 }
 
+uint64_t SymbolBody::getNameHash() const {
+  if (NameHash)
+    return NameHash;
+  uint32_t Gnu = 5381;
+  uint32_t Sysv = 0;
+  for (uint8_t C : getName()) {
+    Gnu = (Gnu << 5) + Gnu + C;
+    Sysv = (Sysv << 4) + C;
+    uint32_t G = Sysv & 0xf0000000;
+    if (G)
+      Sysv ^= G >> 24;
+    Sysv &= ~G;
+  }
+  NameHash = (uint64_t(Sysv) << 32) | Gnu;
+  return NameHash;
+}
+
 // Returns true if a symbol can be replaced at load-time by a symbol
 // with the same name defined in other ELF executable or DSO.
 bool SymbolBody::isPreemptible() const {
@@ -150,10 +169,29 @@ template <class ELFT> InputFile *SymbolBody::getSourceFile() {
 
 template <class ELFT>
 typename ELFT::uint SymbolBody::getVA(typename ELFT::uint Addend) const {
+  if (HasCachedVA)
+    return CachedVA + Addend;
   typename ELFT::uint OutVA = getSymVA<ELFT>(*this, Addend);
   return OutVA + Addend;
 }
 
+template <class ELFT> void SymbolBody::cacheVA() {
+  // A section symbol in a merge or .eh_frame section maps each addend
+  // through the piece table, so no single base address summarizes it;
+  // such symbols keep taking the slow path. For all other symbols the
+  // address is a pure function of state that no longer changes, and
+  // for plain input sections the addend enters linearly, so caching
+  // the zero-addend address is exact.
+  if (auto *D = dyn_cast<DefinedRegular<ELFT>>(this))
+    if (D->Section && D->isSection() &&
+        (isa<MergeInputSection<ELFT>>(D->Section) ||
+         isa<EhInputSection<ELFT>>(D->Section)))
+      return;
+  typename ELFT::uint Addend = 0;
+  CachedVA = getSymVA<ELFT>(*this, Addend);
+  HasCachedVA = true;
+}
+
 template <class ELFT> typename ELFT::uint SymbolBody::getGotVA() const {
   return Out<ELFT>::Got->getVA() + getGotOffset<ELFT>();
 }
@@ -230,7 +268,7 @@ std::unique_ptr<InputFile> Lazy::getFile() {
 }
 
 std::unique_ptr<InputFile> LazyArchive::getFile() {
-  MemoryBufferRef MBRef = File.getMember(&Sym);
+  MemoryBufferRef MBRef = File.getMember(ChildOffset, getName());
 
   // getMember returns an empty buffer if the member was already
   // read from the library.
@@ -247,7 +285,11 @@ std::unique_ptr<InputFile> LazyObject::getFile() {
 }
 
 // Returns the demangled C++ symbol name for Name.
-std::string elf::demangle(StringRef Name) {
+//
+// A failing link can print thousands of diagnostics, many naming the
+// same long mangled symbols, so results are memoized. Diagnostics are
+// produced from serial code, so the cache needs no locking.
+StringRef elf::demangle(StringRef Name) {
 #if !defined(HAVE_CXXABI_H)
   return Name;
 #else
@@ -262,12 +304,19 @@ std::string elf::demangle(StringRef Name) {
   if (!Name.startswith("_Z"))
     return Name;
 
-  char *Buf =
-      abi::__cxa_demangle(Name.str().c_str(), nullptr, nullptr, nullptr);
-  if (!Buf)
-    return Name;
-  std::string S(Buf);
-  free(Buf);
+  static BumpPtrAllocator Alloc;
+  static StringMap<StringRef> Cache;
+  auto It = Cache.find(Name);
+  if (It != Cache.end())
+    return It->second;
+
+  StringRef S = Name;
+  if (char *Buf =
+          abi::__cxa_demangle(Name.str().c_str(), nullptr, nullptr, nullptr)) {
+    S = StringRef(Buf).copy(Alloc);
+    free(Buf);
+  }
+  Cache.insert({Name, S});
   return S;
 #endif
 }
@@ -289,6 +338,11 @@ template uint32_t SymbolBody::template getVA<ELF32BE>(uint32_t) const;
 template uint64_t SymbolBody::template getVA<ELF64LE>(uint64_t) const;
 template uint64_t SymbolBody::template getVA<ELF64BE>(uint64_t) const;
 
+template void SymbolBody::template cacheVA<ELF32LE>();
+template void SymbolBody::template cacheVA<ELF32BE>();
+template void SymbolBody::template cacheVA<ELF64LE>();
+template void SymbolBody::template cacheVA<ELF64BE>();
+
 template uint32_t SymbolBody::template getGotVA<ELF32LE>() const;
 template uint32_t SymbolBody::template getGotVA<ELF32BE>() const;
 template uint64_t SymbolBody::template getGotVA<ELF64LE>() const;
@@ -38,8 +38,9 @@ template <class ELFT> class SharedFile;
 
 // Returns a demangled C++ symbol name. If Name is not a mangled
 // name or the system does not provide __cxa_demangle function,
-// it returns the unmodified string.
-std::string demangle(StringRef Name);
+// it returns the unmodified string. Results are memoized for the
+// lifetime of the link, so the returned string stays valid.
+StringRef demangle(StringRef Name);
 
 struct Symbol;
 
@@ -83,6 +84,15 @@ public:
     return NameOffset;
   }
 
+  // Returns a hash of the symbol name, computed on first use and then
+  // cached. Both ABI-mandated dynamic hash functions are computed in
+  // one pass over the name; the low 32 bits hold the GNU hash and the
+  // high 32 bits the SysV hash. Long mangled C++ names make repeated
+  // hashing of the same name measurable in profiles.
+  uint64_t getNameHash() const;
+  uint32_t getGnuHash() const { return getNameHash(); }
+  uint32_t getSysvHash() const { return getNameHash() >> 32; }
+
   uint8_t getVisibility() const { return StOther & 0x3; }
 
   unsigned DynsymIndex = 0;
@@ -98,6 +108,13 @@ public:
   template <class ELFT>
   typename ELFT::uint getVA(typename ELFT::uint Addend = 0) const;
 
+  // Computes this symbol's output address once and stores it, so that
+  // the getVA call for every relocation referencing the symbol reads
+  // one field instead of redoing the kind switch and section lookups.
+  // Called by the writer once the layout is final. Section symbols in
+  // split sections are left uncached; see the implementation.
+  template <class ELFT> void cacheVA();
+
   template <class ELFT> typename ELFT::uint getGotOffset() const;
   template <class ELFT> typename ELFT::uint getGotVA() const;
   template <class ELFT> typename ELFT::uint getGotPltOffset() const;
@@ -155,6 +172,15 @@ protected:
     Str Name;
     uint32_t NameOffset;
   };
+
+  // Cache for getNameHash(). Zero means not computed yet; recomputing
+  // the rare name that really hashes to zero is harmless.
+  mutable uint64_t NameHash = 0;
+
+  // Cache for getVA(), filled in by cacheVA(). The flag is needed
+  // because zero is a valid address (undefined symbols).
+  uint64_t CachedVA = 0;
+  bool HasCachedVA = false;
 };
 
 // The base class for any defined symbols.
@@ -326,12 +352,16 @@ public:
   std::unique_ptr<InputFile> getFile();
 };
 
-// LazyArchive symbols represents symbols in archive files.
+// LazyArchive symbols represents symbols in archive files. We record
+// the offset of the member defining the symbol rather than an
+// Archive::Symbol so that bodies can also be created from a cached
+// archive index without touching the archive's own symbol table.
 class LazyArchive : public Lazy {
 public:
-  LazyArchive(ArchiveFile &File, const llvm::object::Archive::Symbol S,
+  LazyArchive(ArchiveFile &File, StringRef Name, uint64_t ChildOffset,
               uint8_t Type)
-      : Lazy(LazyArchiveKind, S.getName(), Type), File(File), Sym(S) {}
+      : Lazy(LazyArchiveKind, Name, Type), File(File),
+        ChildOffset(ChildOffset) {}
 
   static bool classof(const SymbolBody *S) {
     return S->kind() == LazyArchiveKind;
@@ -341,7 +371,7 @@ public:
 
 private:
   ArchiveFile &File;
-  const llvm::object::Archive::Symbol Sym;
+  const uint64_t ChildOffset;
 };
 
 // LazyObject symbols represents symbols in object files between
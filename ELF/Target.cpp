@@ -80,13 +80,14 @@ namespace {
 class X86TargetInfo final : public TargetInfo {
 public:
   X86TargetInfo();
-  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const override;
+  RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const override;
   uint64_t getImplicitAddend(const uint8_t *Buf, uint32_t Type) const override;
   void writeGotPltHeader(uint8_t *Buf) const override;
   uint32_t getDynRel(uint32_t Type) const override;
   bool isTlsLocalDynamicRel(uint32_t Type) const override;
   bool isTlsGlobalDynamicRel(uint32_t Type) const override;
   bool isTlsInitialExecRel(uint32_t Type) const override;
+  bool isCallRel(uint32_t Type) const override;
   void writeGotPlt(uint8_t *Buf, const SymbolBody &S) const override;
   void writePltHeader(uint8_t *Buf) const override;
   void writePlt(uint8_t *Buf, uint64_t GotEntryAddr, uint64_t PltEntryAddr,
@@ -95,34 +96,33 @@ public:
 
   RelExpr adjustRelaxExpr(uint32_t Type, const uint8_t *Data,
                           RelExpr Expr) const override;
-  void relaxTlsGdToIe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  void relaxTlsGdToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  void relaxTlsIeToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  void relaxTlsLdToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
+  TlsRelaxOp getTlsRelaxOp(RelExpr Expr, uint32_t Type) const override;
+  void relaxTls(uint8_t *Loc, TlsRelaxOp Op, uint64_t Val) const override;
 };
 
 class X86_64TargetInfo final : public TargetInfo {
 public:
   X86_64TargetInfo();
-  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const override;
+  RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const override;
   uint32_t getDynRel(uint32_t Type) const override;
   bool isTlsLocalDynamicRel(uint32_t Type) const override;
   bool isTlsGlobalDynamicRel(uint32_t Type) const override;
   bool isTlsInitialExecRel(uint32_t Type) const override;
+  bool isCallRel(uint32_t Type) const override;
   void writeGotPltHeader(uint8_t *Buf) const override;
   void writeGotPlt(uint8_t *Buf, const SymbolBody &S) const override;
   void writePltHeader(uint8_t *Buf) const override;
   void writePlt(uint8_t *Buf, uint64_t GotEntryAddr, uint64_t PltEntryAddr,
                 int32_t Index, unsigned RelOff) const override;
   void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
+  void relocateMany(uint8_t *Buf, uint32_t Type, const uint64_t *Offsets,
+                    const uint64_t *Vals, size_t N) const override;
 
   RelExpr adjustRelaxExpr(uint32_t Type, const uint8_t *Data,
                           RelExpr Expr) const override;
   void relaxGot(uint8_t *Loc, uint64_t Val) const override;
-  void relaxTlsGdToIe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  void relaxTlsGdToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  void relaxTlsIeToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  void relaxTlsLdToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
+  TlsRelaxOp getTlsRelaxOp(RelExpr Expr, uint32_t Type) const override;
+  void relaxTls(uint8_t *Loc, TlsRelaxOp Op, uint64_t Val) const override;
 
 private:
   void relaxGotNoPic(uint8_t *Loc, uint64_t Val, uint8_t Op,
@@ -133,24 +133,26 @@ class PPCTargetInfo final : public TargetInfo {
 public:
   PPCTargetInfo();
   void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const override;
+  RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const override;
 };
 
 class PPC64TargetInfo final : public TargetInfo {
 public:
   PPC64TargetInfo();
-  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const override;
+  RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const override;
   void writePlt(uint8_t *Buf, uint64_t GotEntryAddr, uint64_t PltEntryAddr,
                 int32_t Index, unsigned RelOff) const override;
+  bool isCallRel(uint32_t Type) const override;
   void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
 };
 
 class AArch64TargetInfo final : public TargetInfo {
 public:
   AArch64TargetInfo();
-  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const override;
+  RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const override;
   uint32_t getDynRel(uint32_t Type) const override;
   bool isTlsInitialExecRel(uint32_t Type) const override;
+  bool isCallRel(uint32_t Type) const override;
   void writeGotPlt(uint8_t *Buf, const SymbolBody &S) const override;
   void writePltHeader(uint8_t *Buf) const override;
   void writePlt(uint8_t *Buf, uint64_t GotEntryAddr, uint64_t PltEntryAddr,
@@ -159,35 +161,38 @@ public:
   void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
   RelExpr adjustRelaxExpr(uint32_t Type, const uint8_t *Data,
                           RelExpr Expr) const override;
-  void relaxTlsGdToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  void relaxTlsGdToIe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  void relaxTlsIeToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
+  TlsRelaxOp getTlsRelaxOp(RelExpr Expr, uint32_t Type) const override;
+  void relaxTls(uint8_t *Loc, TlsRelaxOp Op, uint64_t Val) const override;
 };
 
 class AMDGPUTargetInfo final : public TargetInfo {
 public:
   AMDGPUTargetInfo() {}
   void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
-  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const override;
+  RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const override;
 };
 
 class ARMTargetInfo final : public TargetInfo {
 public:
   ARMTargetInfo();
-  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const override;
+  RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const override;
   uint32_t getDynRel(uint32_t Type) const override;
   uint64_t getImplicitAddend(const uint8_t *Buf, uint32_t Type) const override;
   void writeGotPlt(uint8_t *Buf, const SymbolBody &S) const override;
   void writePltHeader(uint8_t *Buf) const override;
   void writePlt(uint8_t *Buf, uint64_t GotEntryAddr, uint64_t PltEntryAddr,
                 int32_t Index, unsigned RelOff) const override;
+  void writeThunk(uint8_t *Buf, uint64_t S) const override;
+  bool needsThunk(uint32_t Type, const InputFile &File,
+                  const SymbolBody &S) const override;
+  bool isCallRel(uint32_t Type) const override;
   void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
 };
 
 template <class ELFT> class MipsTargetInfo final : public TargetInfo {
 public:
   MipsTargetInfo();
-  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const override;
+  RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const override;
   uint64_t getImplicitAddend(const uint8_t *Buf, uint32_t Type) const override;
   uint32_t getDynRel(uint32_t Type) const override;
   bool isTlsLocalDynamicRel(uint32_t Type) const override;
@@ -201,10 +206,11 @@ public:
                   const SymbolBody &S) const override;
   void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
   bool usesOnlyLowPageBits(uint32_t Type) const override;
+  bool isCallRel(uint32_t Type) const override;
 };
 } // anonymous namespace
 
-TargetInfo *createTarget() {
+static TargetInfo *instantiateTarget() {
   switch (Config->EMachine) {
   case EM_386:
     return new X86TargetInfo();
@@ -237,6 +243,23 @@ TargetInfo *createTarget() {
   fatal("unknown target machine");
 }
 
+TargetInfo *createTarget() {
+  TargetInfo *T = instantiateTarget();
+  T->initRelExprTable();
+  return T;
+}
+
+// Precomputes the relocation expression for every type by probing the
+// target's classification switch once. The relocation scan then
+// answers getRelExpr with an indexed load; only targets whose
+// classification depends on the symbol keep the virtual dispatch.
+void TargetInfo::initRelExprTable() {
+  if (HasSymbolDependentRelExpr)
+    return;
+  for (uint32_t I = 0; I < RelExprTableSize; ++I)
+    RelExprTable[I] = getRelExprImpl(I, nullptr);
+}
+
 TargetInfo::~TargetInfo() {}
 
 uint64_t TargetInfo::getImplicitAddend(const uint8_t *Buf,
@@ -248,6 +271,13 @@ uint64_t TargetInfo::getVAStart() const { return Config->Pic ? 0 : VAStart; }
 
 bool TargetInfo::usesOnlyLowPageBits(uint32_t Type) const { return false; }
 
+void TargetInfo::relocateMany(uint8_t *Buf, uint32_t Type,
+                              const uint64_t *Offsets, const uint64_t *Vals,
+                              size_t N) const {
+  for (size_t I = 0; I != N; ++I)
+    relocateOne(Buf + Offsets[I], Type, Vals[I]);
+}
+
 bool TargetInfo::needsThunk(uint32_t Type, const InputFile &File,
                             const SymbolBody &S) const {
   return false;
@@ -261,6 +291,8 @@ bool TargetInfo::isTlsGlobalDynamicRel(uint32_t Type) const {
   return false;
 }
 
+bool TargetInfo::isCallRel(uint32_t Type) const { return false; }
+
 RelExpr TargetInfo::adjustRelaxExpr(uint32_t Type, const uint8_t *Data,
                                     RelExpr Expr) const {
   return Expr;
@@ -270,23 +302,11 @@ void TargetInfo::relaxGot(uint8_t *Loc, uint64_t Val) const {
   llvm_unreachable("Should not have claimed to be relaxable");
 }
 
-void TargetInfo::relaxTlsGdToLe(uint8_t *Loc, uint32_t Type,
-                                uint64_t Val) const {
-  llvm_unreachable("Should not have claimed to be relaxable");
-}
-
-void TargetInfo::relaxTlsGdToIe(uint8_t *Loc, uint32_t Type,
-                                uint64_t Val) const {
-  llvm_unreachable("Should not have claimed to be relaxable");
-}
-
-void TargetInfo::relaxTlsIeToLe(uint8_t *Loc, uint32_t Type,
-                                uint64_t Val) const {
+TlsRelaxOp TargetInfo::getTlsRelaxOp(RelExpr Expr, uint32_t Type) const {
   llvm_unreachable("Should not have claimed to be relaxable");
 }
 
-void TargetInfo::relaxTlsLdToLe(uint8_t *Loc, uint32_t Type,
-                                uint64_t Val) const {
+void TargetInfo::relaxTls(uint8_t *Loc, TlsRelaxOp Op, uint64_t Val) const {
   llvm_unreachable("Should not have claimed to be relaxable");
 }
 
@@ -304,7 +324,8 @@ X86TargetInfo::X86TargetInfo() {
   TlsGdRelaxSkip = 2;
 }
 
-RelExpr X86TargetInfo::getRelExpr(uint32_t Type, const SymbolBody &S) const {
+RelExpr X86TargetInfo::getRelExprImpl(uint32_t Type,
+                                       const SymbolBody *S) const {
   switch (Type) {
   default:
     return R_ABS;
@@ -374,6 +395,10 @@ bool X86TargetInfo::isTlsInitialExecRel(uint32_t Type) const {
   return Type == R_386_TLS_IE || Type == R_386_TLS_GOTIE;
 }
 
+bool X86TargetInfo::isCallRel(uint32_t Type) const {
+  return Type == R_386_PLT32;
+}
+
 void X86TargetInfo::writePltHeader(uint8_t *Buf) const {
   // Executable files and shared object files have
   // separate procedure linkage tables.
@@ -437,49 +462,59 @@ void X86TargetInfo::relocateOne(uint8_t *Loc, uint32_t Type,
   write32le(Loc, Val);
 }
 
-void X86TargetInfo::relaxTlsGdToLe(uint8_t *Loc, uint32_t Type,
-                                   uint64_t Val) const {
-  // Convert
-  //   leal x@tlsgd(, %ebx, 1),
-  //   call __tls_get_addr@plt
-  // to
-  //   movl %gs:0,%eax
-  //   subl $x@ntpoff,%eax
-  const uint8_t Inst[] = {
-      0x65, 0xa1, 0x00, 0x00, 0x00, 0x00, // movl %gs:0, %eax
-      0x81, 0xe8, 0x00, 0x00, 0x00, 0x00  // subl 0(%ebx), %eax
-  };
-  memcpy(Loc - 3, Inst, sizeof(Inst));
-  relocateOne(Loc + 5, R_386_32, Val);
-}
-
-void X86TargetInfo::relaxTlsGdToIe(uint8_t *Loc, uint32_t Type,
-                                   uint64_t Val) const {
-  // Convert
-  //   leal x@tlsgd(, %ebx, 1),
-  //   call __tls_get_addr@plt
-  // to
-  //   movl %gs:0, %eax
-  //   addl x@gotntpoff(%ebx), %eax
-  const uint8_t Inst[] = {
-      0x65, 0xa1, 0x00, 0x00, 0x00, 0x00, // movl %gs:0, %eax
-      0x03, 0x83, 0x00, 0x00, 0x00, 0x00  // addl 0(%ebx), %eax
-  };
-  memcpy(Loc - 3, Inst, sizeof(Inst));
-  relocateOne(Loc + 5, R_386_32, Val);
+TlsRelaxOp X86TargetInfo::getTlsRelaxOp(RelExpr Expr, uint32_t Type) const {
+  switch (Expr) {
+  default:
+    return TLSOP_NONE;
+  case R_RELAX_TLS_GD_TO_LE_NEG:
+    return TLSOP_386_GD_TO_LE;
+  case R_RELAX_TLS_GD_TO_IE_END:
+    return TLSOP_386_GD_TO_IE;
+  case R_RELAX_TLS_IE_TO_LE:
+    return Type == R_386_TLS_IE ? TLSOP_386_IE_TO_LE : TLSOP_386_GOTIE_TO_LE;
+  case R_RELAX_TLS_LD_TO_LE:
+    return Type == R_386_TLS_LDO_32 ? TLSOP_386_LDO_TO_LE : TLSOP_386_LD_TO_LE;
+  }
 }
 
-// In some conditions, relocations can be optimized to avoid using GOT.
-// This function does that for Initial Exec to Local Exec case.
-void X86TargetInfo::relaxTlsIeToLe(uint8_t *Loc, uint32_t Type,
-                                   uint64_t Val) const {
-  // Ulrich's document section 6.2 says that @gotntpoff can
-  // be used with MOVL or ADDL instructions.
-  // @indntpoff is similar to @gotntpoff, but for use in
-  // position dependent code.
-  uint8_t Reg = (Loc[-1] >> 3) & 7;
-
-  if (Type == R_386_TLS_IE) {
+void X86TargetInfo::relaxTls(uint8_t *Loc, TlsRelaxOp Op, uint64_t Val) const {
+  switch (Op) {
+  case TLSOP_386_GD_TO_LE: {
+    // Convert
+    //   leal x@tlsgd(, %ebx, 1),
+    //   call __tls_get_addr@plt
+    // to
+    //   movl %gs:0,%eax
+    //   subl $x@ntpoff,%eax
+    const uint8_t Inst[] = {
+        0x65, 0xa1, 0x00, 0x00, 0x00, 0x00, // movl %gs:0, %eax
+        0x81, 0xe8, 0x00, 0x00, 0x00, 0x00  // subl 0(%ebx), %eax
+    };
+    memcpy(Loc - 3, Inst, sizeof(Inst));
+    relocateOne(Loc + 5, R_386_32, Val);
+    break;
+  }
+  case TLSOP_386_GD_TO_IE: {
+    // Convert
+    //   leal x@tlsgd(, %ebx, 1),
+    //   call __tls_get_addr@plt
+    // to
+    //   movl %gs:0, %eax
+    //   addl x@gotntpoff(%ebx), %eax
+    const uint8_t Inst[] = {
+        0x65, 0xa1, 0x00, 0x00, 0x00, 0x00, // movl %gs:0, %eax
+        0x03, 0x83, 0x00, 0x00, 0x00, 0x00  // addl 0(%ebx), %eax
+    };
+    memcpy(Loc - 3, Inst, sizeof(Inst));
+    relocateOne(Loc + 5, R_386_32, Val);
+    break;
+  }
+  // The next two cases optimize an Initial Exec access to Local Exec,
+  // avoiding the GOT. Ulrich's document section 6.2 says that
+  // @gotntpoff can be used with MOVL or ADDL instructions. @indntpoff
+  // is similar to @gotntpoff, but for use in position dependent code.
+  case TLSOP_386_IE_TO_LE: {
+    uint8_t Reg = (Loc[-1] >> 3) & 7;
     if (Loc[-1] == 0xa1) {
       // "movl foo@indntpoff,%eax" -> "movl $foo,%eax"
       // This case is different from the generic case below because
@@ -494,8 +529,11 @@ void X86TargetInfo::relaxTlsIeToLe(uint8_t *Loc, uint32_t Type,
       Loc[-2] = 0x81;
       Loc[-1] = 0xc0 | Reg;
     }
-  } else {
-    assert(Type == R_386_TLS_GOTIE);
+    relocateOne(Loc, R_386_TLS_LE, Val);
+    break;
+  }
+  case TLSOP_386_GOTIE_TO_LE: {
+    uint8_t Reg = (Loc[-1] >> 3) & 7;
     if (Loc[-2] == 0x8b) {
       // "movl foo@gottpoff(%rip),%reg" -> "movl $foo,%reg"
       Loc[-2] = 0xc7;
@@ -505,30 +543,31 @@ void X86TargetInfo::relaxTlsIeToLe(uint8_t *Loc, uint32_t Type,
       Loc[-2] = 0x8d;
       Loc[-1] = 0x80 | (Reg << 3) | Reg;
     }
+    relocateOne(Loc, R_386_TLS_LE, Val);
+    break;
   }
-  relocateOne(Loc, R_386_TLS_LE, Val);
-}
-
-void X86TargetInfo::relaxTlsLdToLe(uint8_t *Loc, uint32_t Type,
-                                   uint64_t Val) const {
-  if (Type == R_386_TLS_LDO_32) {
+  case TLSOP_386_LDO_TO_LE:
     relocateOne(Loc, R_386_TLS_LE, Val);
-    return;
+    break;
+  case TLSOP_386_LD_TO_LE: {
+    // Convert
+    //   leal foo(%reg),%eax
+    //   call ___tls_get_addr
+    // to
+    //   movl %gs:0,%eax
+    //   nop
+    //   leal 0(%esi,1),%esi
+    const uint8_t Inst[] = {
+        0x65, 0xa1, 0x00, 0x00, 0x00, 0x00, // movl %gs:0,%eax
+        0x90,                               // nop
+        0x8d, 0x74, 0x26, 0x00              // leal 0(%esi,1),%esi
+    };
+    memcpy(Loc - 2, Inst, sizeof(Inst));
+    break;
+  }
+  default:
+    llvm_unreachable("unknown TLS relaxation");
   }
-
-  // Convert
-  //   leal foo(%reg),%eax
-  //   call ___tls_get_addr
-  // to
-  //   movl %gs:0,%eax
-  //   nop
-  //   leal 0(%esi,1),%esi
-  const uint8_t Inst[] = {
-      0x65, 0xa1, 0x00, 0x00, 0x00, 0x00, // movl %gs:0,%eax
-      0x90,                               // nop
-      0x8d, 0x74, 0x26, 0x00              // leal 0(%esi,1),%esi
-  };
-  memcpy(Loc - 2, Inst, sizeof(Inst));
 }
 
 X86_64TargetInfo::X86_64TargetInfo() {
@@ -545,7 +584,8 @@ X86_64TargetInfo::X86_64TargetInfo() {
   TlsGdRelaxSkip = 2;
 }
 
-RelExpr X86_64TargetInfo::getRelExpr(uint32_t Type, const SymbolBody &S) const {
+RelExpr X86_64TargetInfo::getRelExprImpl(uint32_t Type,
+                                          const SymbolBody *S) const {
   switch (Type) {
   default:
     return R_ABS;
@@ -633,117 +673,144 @@ bool X86_64TargetInfo::isTlsLocalDynamicRel(uint32_t Type) const {
          Type == R_X86_64_TLSLD;
 }
 
-void X86_64TargetInfo::relaxTlsGdToLe(uint8_t *Loc, uint32_t Type,
-                                      uint64_t Val) const {
-  // Convert
-  //   .byte 0x66
-  //   leaq x@tlsgd(%rip), %rdi
-  //   .word 0x6666
-  //   rex64
-  //   call __tls_get_addr@plt
-  // to
-  //   mov %fs:0x0,%rax
-  //   lea x@tpoff,%rax
-  const uint8_t Inst[] = {
-      0x64, 0x48, 0x8b, 0x04, 0x25, 0x00, 0x00, 0x00, 0x00, // mov %fs:0x0,%rax
-      0x48, 0x8d, 0x80, 0x00, 0x00, 0x00, 0x00              // lea x@tpoff,%rax
-  };
-  memcpy(Loc - 4, Inst, sizeof(Inst));
-  // The original code used a pc relative relocation and so we have to
-  // compensate for the -4 in had in the addend.
-  relocateOne(Loc + 8, R_X86_64_TPOFF32, Val + 4);
-}
-
-void X86_64TargetInfo::relaxTlsGdToIe(uint8_t *Loc, uint32_t Type,
-                                      uint64_t Val) const {
-  // Convert
-  //   .byte 0x66
-  //   leaq x@tlsgd(%rip), %rdi
-  //   .word 0x6666
-  //   rex64
-  //   call __tls_get_addr@plt
-  // to
-  //   mov %fs:0x0,%rax
-  //   addq x@tpoff,%rax
-  const uint8_t Inst[] = {
-      0x64, 0x48, 0x8b, 0x04, 0x25, 0x00, 0x00, 0x00, 0x00, // mov %fs:0x0,%rax
-      0x48, 0x03, 0x05, 0x00, 0x00, 0x00, 0x00              // addq x@tpoff,%rax
-  };
-  memcpy(Loc - 4, Inst, sizeof(Inst));
-  // Both code sequences are PC relatives, but since we are moving the constant
-  // forward by 8 bytes we have to subtract the value by 8.
-  relocateOne(Loc + 8, R_X86_64_PC32, Val - 8);
-}
-
-// In some conditions, R_X86_64_GOTTPOFF relocation can be optimized to
-// R_X86_64_TPOFF32 so that it does not use GOT.
-void X86_64TargetInfo::relaxTlsIeToLe(uint8_t *Loc, uint32_t Type,
-                                      uint64_t Val) const {
-  uint8_t *Inst = Loc - 3;
-  uint8_t Reg = Loc[-1] >> 3;
-  uint8_t *RegSlot = Loc - 1;
-
-  // Note that ADD with RSP or R12 is converted to ADD instead of LEA
-  // because LEA with these registers needs 4 bytes to encode and thus
-  // wouldn't fit the space.
-
-  if (memcmp(Inst, "\x48\x03\x25", 3) == 0) {
-    // "addq foo@gottpoff(%rip),%rsp" -> "addq $foo,%rsp"
-    memcpy(Inst, "\x48\x81\xc4", 3);
-  } else if (memcmp(Inst, "\x4c\x03\x25", 3) == 0) {
-    // "addq foo@gottpoff(%rip),%r12" -> "addq $foo,%r12"
-    memcpy(Inst, "\x49\x81\xc4", 3);
-  } else if (memcmp(Inst, "\x4c\x03", 2) == 0) {
-    // "addq foo@gottpoff(%rip),%r[8-15]" -> "leaq foo(%r[8-15]),%r[8-15]"
-    memcpy(Inst, "\x4d\x8d", 2);
-    *RegSlot = 0x80 | (Reg << 3) | Reg;
-  } else if (memcmp(Inst, "\x48\x03", 2) == 0) {
-    // "addq foo@gottpoff(%rip),%reg -> "leaq foo(%reg),%reg"
-    memcpy(Inst, "\x48\x8d", 2);
-    *RegSlot = 0x80 | (Reg << 3) | Reg;
-  } else if (memcmp(Inst, "\x4c\x8b", 2) == 0) {
-    // "movq foo@gottpoff(%rip),%r[8-15]" -> "movq $foo,%r[8-15]"
-    memcpy(Inst, "\x49\xc7", 2);
-    *RegSlot = 0xc0 | Reg;
-  } else if (memcmp(Inst, "\x48\x8b", 2) == 0) {
-    // "movq foo@gottpoff(%rip),%reg" -> "movq $foo,%reg"
-    memcpy(Inst, "\x48\xc7", 2);
-    *RegSlot = 0xc0 | Reg;
-  } else {
-    fatal("R_X86_64_GOTTPOFF must be used in MOVQ or ADDQ instructions only");
+bool X86_64TargetInfo::isCallRel(uint32_t Type) const {
+  // Note that R_X86_64_PC32 is deliberately not here: compilers use it
+  // both for direct calls to local functions and to take PC-relative
+  // addresses, so it has to count as address-taking.
+  return Type == R_X86_64_PLT32;
+}
+
+TlsRelaxOp X86_64TargetInfo::getTlsRelaxOp(RelExpr Expr, uint32_t Type) const {
+  switch (Expr) {
+  default:
+    return TLSOP_NONE;
+  case R_RELAX_TLS_GD_TO_LE:
+    return TLSOP_X64_GD_TO_LE;
+  case R_RELAX_TLS_GD_TO_IE:
+    return TLSOP_X64_GD_TO_IE;
+  case R_RELAX_TLS_IE_TO_LE:
+    return TLSOP_X64_IE_TO_LE;
+  case R_RELAX_TLS_LD_TO_LE:
+    if (Type == R_X86_64_DTPOFF64)
+      return TLSOP_X64_DTPOFF64_TO_LE;
+    if (Type == R_X86_64_DTPOFF32)
+      return TLSOP_X64_DTPOFF32_TO_LE;
+    return TLSOP_X64_LD_TO_LE;
   }
+}
 
-  // The original code used a PC relative relocation.
-  // Need to compensate for the -4 it had in the addend.
-  relocateOne(Loc, R_X86_64_TPOFF32, Val + 4);
-}
-
-void X86_64TargetInfo::relaxTlsLdToLe(uint8_t *Loc, uint32_t Type,
-                                      uint64_t Val) const {
-  // Convert
-  //   leaq bar@tlsld(%rip), %rdi
-  //   callq __tls_get_addr@PLT
-  //   leaq bar@dtpoff(%rax), %rcx
-  // to
-  //   .word 0x6666
-  //   .byte 0x66
-  //   mov %fs:0,%rax
-  //   leaq bar@tpoff(%rax), %rcx
-  if (Type == R_X86_64_DTPOFF64) {
-    write64le(Loc, Val);
-    return;
+void X86_64TargetInfo::relaxTls(uint8_t *Loc, TlsRelaxOp Op,
+                                uint64_t Val) const {
+  switch (Op) {
+  case TLSOP_X64_GD_TO_LE: {
+    // Convert
+    //   .byte 0x66
+    //   leaq x@tlsgd(%rip), %rdi
+    //   .word 0x6666
+    //   rex64
+    //   call __tls_get_addr@plt
+    // to
+    //   mov %fs:0x0,%rax
+    //   lea x@tpoff,%rax
+    const uint8_t Inst[] = {
+        0x64, 0x48, 0x8b, 0x04, 0x25, 0x00, 0x00, 0x00, 0x00, // mov %fs:0,%rax
+        0x48, 0x8d, 0x80, 0x00, 0x00, 0x00, 0x00              // lea x@tpoff,%rax
+    };
+    memcpy(Loc - 4, Inst, sizeof(Inst));
+    // The original code used a pc relative relocation and so we have to
+    // compensate for the -4 in had in the addend.
+    relocateOne(Loc + 8, R_X86_64_TPOFF32, Val + 4);
+    break;
   }
-  if (Type == R_X86_64_DTPOFF32) {
-    relocateOne(Loc, R_X86_64_TPOFF32, Val);
-    return;
+  case TLSOP_X64_GD_TO_IE: {
+    // Convert
+    //   .byte 0x66
+    //   leaq x@tlsgd(%rip), %rdi
+    //   .word 0x6666
+    //   rex64
+    //   call __tls_get_addr@plt
+    // to
+    //   mov %fs:0x0,%rax
+    //   addq x@tpoff,%rax
+    const uint8_t Inst[] = {
+        0x64, 0x48, 0x8b, 0x04, 0x25, 0x00, 0x00, 0x00, 0x00, // mov %fs:0,%rax
+        0x48, 0x03, 0x05, 0x00, 0x00, 0x00, 0x00              // addq x@tpoff,%rax
+    };
+    memcpy(Loc - 4, Inst, sizeof(Inst));
+    // Both code sequences are PC relatives, but since we are moving the
+    // constant forward by 8 bytes we have to subtract the value by 8.
+    relocateOne(Loc + 8, R_X86_64_PC32, Val - 8);
+    break;
   }
+  case TLSOP_X64_IE_TO_LE: {
+    // An R_X86_64_GOTTPOFF relocation is optimized to R_X86_64_TPOFF32
+    // so that it does not use GOT.
+    uint8_t *Inst = Loc - 3;
+    uint8_t Reg = Loc[-1] >> 3;
+    uint8_t *RegSlot = Loc - 1;
+
+    // Note that ADD with RSP or R12 is converted to ADD instead of LEA
+    // because LEA with these registers needs 4 bytes to encode and thus
+    // wouldn't fit the space.
+
+    if (memcmp(Inst, "\x48\x03\x25", 3) == 0) {
+      // "addq foo@gottpoff(%rip),%rsp" -> "addq $foo,%rsp"
+      memcpy(Inst, "\x48\x81\xc4", 3);
+    } else if (memcmp(Inst, "\x4c\x03\x25", 3) == 0) {
+      // "addq foo@gottpoff(%rip),%r12" -> "addq $foo,%r12"
+      memcpy(Inst, "\x49\x81\xc4", 3);
+    } else if (memcmp(Inst, "\x4c\x03", 2) == 0) {
+      // "addq foo@gottpoff(%rip),%r[8-15]" -> "leaq foo(%r[8-15]),%r[8-15]"
+      memcpy(Inst, "\x4d\x8d", 2);
+      *RegSlot = 0x80 | (Reg << 3) | Reg;
+    } else if (memcmp(Inst, "\x48\x03", 2) == 0) {
+      // "addq foo@gottpoff(%rip),%reg -> "leaq foo(%reg),%reg"
+      memcpy(Inst, "\x48\x8d", 2);
+      *RegSlot = 0x80 | (Reg << 3) | Reg;
+    } else if (memcmp(Inst, "\x4c\x8b", 2) == 0) {
+      // "movq foo@gottpoff(%rip),%r[8-15]" -> "movq $foo,%r[8-15]"
+      memcpy(Inst, "\x49\xc7", 2);
+      *RegSlot = 0xc0 | Reg;
+    } else if (memcmp(Inst, "\x48\x8b", 2) == 0) {
+      // "movq foo@gottpoff(%rip),%reg" -> "movq $foo,%reg"
+      memcpy(Inst, "\x48\xc7", 2);
+      *RegSlot = 0xc0 | Reg;
+    } else {
+      fatal("R_X86_64_GOTTPOFF must be used in MOVQ or ADDQ instructions only");
+    }
 
-  const uint8_t Inst[] = {
-      0x66, 0x66,                                          // .word 0x6666
-      0x66,                                                // .byte 0x66
-      0x64, 0x48, 0x8b, 0x04, 0x25, 0x00, 0x00, 0x00, 0x00 // mov %fs:0,%rax
-  };
-  memcpy(Loc - 3, Inst, sizeof(Inst));
+    // The original code used a PC relative relocation.
+    // Need to compensate for the -4 it had in the addend.
+    relocateOne(Loc, R_X86_64_TPOFF32, Val + 4);
+    break;
+  }
+  case TLSOP_X64_DTPOFF64_TO_LE:
+    write64le(Loc, Val);
+    break;
+  case TLSOP_X64_DTPOFF32_TO_LE:
+    relocateOne(Loc, R_X86_64_TPOFF32, Val);
+    break;
+  case TLSOP_X64_LD_TO_LE: {
+    // Convert
+    //   leaq bar@tlsld(%rip), %rdi
+    //   callq __tls_get_addr@PLT
+    //   leaq bar@dtpoff(%rax), %rcx
+    // to
+    //   .word 0x6666
+    //   .byte 0x66
+    //   mov %fs:0,%rax
+    //   leaq bar@tpoff(%rax), %rcx
+    const uint8_t Inst[] = {
+        0x66, 0x66,                                          // .word 0x6666
+        0x66,                                                // .byte 0x66
+        0x64, 0x48, 0x8b, 0x04, 0x25, 0x00, 0x00, 0x00, 0x00 // mov %fs:0,%rax
+    };
+    memcpy(Loc - 3, Inst, sizeof(Inst));
+    break;
+  }
+  default:
+    llvm_unreachable("unknown TLS relaxation");
+  }
 }
 
 void X86_64TargetInfo::relocateOne(uint8_t *Loc, uint32_t Type,
@@ -780,6 +847,50 @@ void X86_64TargetInfo::relocateOne(uint8_t *Loc, uint32_t Type,
   }
 }
 
+void X86_64TargetInfo::relocateMany(uint8_t *Buf, uint32_t Type,
+                                    const uint64_t *Offsets,
+                                    const uint64_t *Vals, size_t N) const {
+  // Specialized kernels for the relocation types that dominate large
+  // x86-64 links. The type dispatch happens once per run and the loop
+  // bodies are simple enough to vectorize.
+  switch (Type) {
+  case R_X86_64_64:
+  case R_X86_64_DTPOFF64:
+  case R_X86_64_SIZE64:
+  case R_X86_64_PC64:
+    for (size_t I = 0; I != N; ++I)
+      write64le(Buf + Offsets[I], Vals[I]);
+    return;
+  case R_X86_64_32:
+    for (size_t I = 0; I != N; ++I) {
+      checkUInt<32>(Vals[I], Type);
+      write32le(Buf + Offsets[I], Vals[I]);
+    }
+    return;
+  case R_X86_64_32S:
+  case R_X86_64_TPOFF32:
+  case R_X86_64_GOT32:
+  case R_X86_64_GOTPCREL:
+  case R_X86_64_GOTPCRELX:
+  case R_X86_64_REX_GOTPCRELX:
+  case R_X86_64_PC32:
+  case R_X86_64_GOTTPOFF:
+  case R_X86_64_PLT32:
+  case R_X86_64_TLSGD:
+  case R_X86_64_TLSLD:
+  case R_X86_64_DTPOFF32:
+  case R_X86_64_SIZE32:
+    for (size_t I = 0; I != N; ++I) {
+      checkInt<32>(Vals[I], Type);
+      write32le(Buf + Offsets[I], Vals[I]);
+    }
+    return;
+  default:
+    for (size_t I = 0; I != N; ++I)
+      relocateOne(Buf + Offsets[I], Type, Vals[I]);
+  }
+}
+
 RelExpr X86_64TargetInfo::adjustRelaxExpr(uint32_t Type, const uint8_t *Data,
                                           RelExpr RelExpr) const {
   if (Type != R_X86_64_GOTPCRELX && Type != R_X86_64_REX_GOTPCRELX)
@@ -938,7 +1049,8 @@ void PPCTargetInfo::relocateOne(uint8_t *Loc, uint32_t Type,
   }
 }
 
-RelExpr PPCTargetInfo::getRelExpr(uint32_t Type, const SymbolBody &S) const {
+RelExpr PPCTargetInfo::getRelExprImpl(uint32_t Type,
+                                       const SymbolBody *S) const {
   return R_ABS;
 }
 
@@ -979,7 +1091,8 @@ uint64_t getPPC64TocBase() {
   return TocVA + PPC64TocOffset;
 }
 
-RelExpr PPC64TargetInfo::getRelExpr(uint32_t Type, const SymbolBody &S) const {
+RelExpr PPC64TargetInfo::getRelExprImpl(uint32_t Type,
+                                         const SymbolBody *S) const {
   switch (Type) {
   default:
     return R_ABS;
@@ -1018,6 +1131,10 @@ void PPC64TargetInfo::writePlt(uint8_t *Buf, uint64_t GotEntryAddr,
   write32be(Buf + 28, 0x4e800420);                   // bctr
 }
 
+bool PPC64TargetInfo::isCallRel(uint32_t Type) const {
+  return Type == R_PPC64_REL24;
+}
+
 static std::pair<uint32_t, uint64_t> toAddr16Rel(uint32_t Type, uint64_t Val) {
   uint64_t V = Val - PPC64TocOffset;
   switch (Type) {
@@ -1117,8 +1234,8 @@ AArch64TargetInfo::AArch64TargetInfo() {
   TcbSize = 16;
 }
 
-RelExpr AArch64TargetInfo::getRelExpr(uint32_t Type,
-                                      const SymbolBody &S) const {
+RelExpr AArch64TargetInfo::getRelExprImpl(uint32_t Type,
+                                          const SymbolBody *S) const {
   switch (Type) {
   default:
     return R_ABS;
@@ -1186,6 +1303,10 @@ bool AArch64TargetInfo::isTlsInitialExecRel(uint32_t Type) const {
          Type == R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC;
 }
 
+bool AArch64TargetInfo::isCallRel(uint32_t Type) const {
+  return Type == R_AARCH64_CALL26 || Type == R_AARCH64_JUMP26;
+}
+
 uint32_t AArch64TargetInfo::getDynRel(uint32_t Type) const {
   if (Type == R_AARCH64_ABS32 || Type == R_AARCH64_ABS64)
     return Type;
@@ -1333,86 +1454,98 @@ void AArch64TargetInfo::relocateOne(uint8_t *Loc, uint32_t Type,
   }
 }
 
-void AArch64TargetInfo::relaxTlsGdToLe(uint8_t *Loc, uint32_t Type,
-                                       uint64_t Val) const {
-  // TLSDESC Global-Dynamic relocation are in the form:
-  //   adrp    x0, :tlsdesc:v             [R_AARCH64_TLSDESC_ADR_PAGE21]
-  //   ldr     x1, [x0, #:tlsdesc_lo12:v  [R_AARCH64_TLSDESC_LD64_LO12_NC]
-  //   add     x0, x0, :tlsdesc_los:v     [_AARCH64_TLSDESC_ADD_LO12_NC]
-  //   .tlsdesccall                       [R_AARCH64_TLSDESC_CALL]
-  //   blr     x1
-  // And it can optimized to:
-  //   movz    x0, #0x0, lsl #16
-  //   movk    x0, #0x10
-  //   nop
-  //   nop
-  checkUInt<32>(Val, Type);
-
-  switch (Type) {
-  case R_AARCH64_TLSDESC_ADD_LO12_NC:
-  case R_AARCH64_TLSDESC_CALL:
-    write32le(Loc, 0xd503201f); // nop
-    return;
-  case R_AARCH64_TLSDESC_ADR_PAGE21:
-    write32le(Loc, 0xd2a00000 | (((Val >> 16) & 0xffff) << 5)); // movz
-    return;
-  case R_AARCH64_TLSDESC_LD64_LO12_NC:
-    write32le(Loc, 0xf2800000 | ((Val & 0xffff) << 5)); // movk
-    return;
+TlsRelaxOp AArch64TargetInfo::getTlsRelaxOp(RelExpr Expr,
+                                            uint32_t Type) const {
+  switch (Expr) {
   default:
-    llvm_unreachable("unsupported relocation for TLS GD to LE relaxation");
+    return TLSOP_NONE;
+  case R_RELAX_TLS_GD_TO_LE:
+    // TLSDESC Global-Dynamic relocation are in the form:
+    //   adrp    x0, :tlsdesc:v             [R_AARCH64_TLSDESC_ADR_PAGE21]
+    //   ldr     x1, [x0, #:tlsdesc_lo12:v  [R_AARCH64_TLSDESC_LD64_LO12_NC]
+    //   add     x0, x0, :tlsdesc_los:v     [_AARCH64_TLSDESC_ADD_LO12_NC]
+    //   .tlsdesccall                       [R_AARCH64_TLSDESC_CALL]
+    //   blr     x1
+    // And it can optimized to:
+    //   movz    x0, #0x0, lsl #16
+    //   movk    x0, #0x10
+    //   nop
+    //   nop
+    switch (Type) {
+    case R_AARCH64_TLSDESC_ADR_PAGE21:
+      return TLSOP_AARCH64_DESC_TO_LE_MOVZ;
+    case R_AARCH64_TLSDESC_LD64_LO12_NC:
+      return TLSOP_AARCH64_DESC_TO_LE_MOVK;
+    case R_AARCH64_TLSDESC_ADD_LO12_NC:
+    case R_AARCH64_TLSDESC_CALL:
+      return TLSOP_AARCH64_DESC_NOP;
+    default:
+      llvm_unreachable("unsupported relocation for TLS GD to LE relaxation");
+    }
+  case R_RELAX_TLS_GD_TO_IE_PAGE_PC:
+  case R_RELAX_TLS_GD_TO_IE_ABS:
+    // The same TLSDESC sequence is relaxed to Initial-Exec as:
+    //   adrp    x0, :gottprel:v
+    //   ldr     x0, [x0, :gottprel_lo12:v]
+    //   nop
+    //   nop
+    switch (Type) {
+    case R_AARCH64_TLSDESC_ADR_PAGE21:
+      return TLSOP_AARCH64_DESC_TO_IE_PAGE;
+    case R_AARCH64_TLSDESC_LD64_LO12_NC:
+      return TLSOP_AARCH64_DESC_TO_IE_LD;
+    case R_AARCH64_TLSDESC_ADD_LO12_NC:
+    case R_AARCH64_TLSDESC_CALL:
+      return TLSOP_AARCH64_DESC_NOP;
+    default:
+      llvm_unreachable("unsupported relocation for TLS GD to IE relaxation");
+    }
+  case R_RELAX_TLS_IE_TO_LE:
+    if (Type == R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21)
+      return TLSOP_AARCH64_IE_TO_LE_MOVZ;
+    if (Type == R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC)
+      return TLSOP_AARCH64_IE_TO_LE_MOVK;
+    llvm_unreachable("invalid relocation for TLS IE to LE relaxation");
   }
 }
 
-void AArch64TargetInfo::relaxTlsGdToIe(uint8_t *Loc, uint32_t Type,
-                                       uint64_t Val) const {
-  // TLSDESC Global-Dynamic relocation are in the form:
-  //   adrp    x0, :tlsdesc:v             [R_AARCH64_TLSDESC_ADR_PAGE21]
-  //   ldr     x1, [x0, #:tlsdesc_lo12:v  [R_AARCH64_TLSDESC_LD64_LO12_NC]
-  //   add     x0, x0, :tlsdesc_los:v     [_AARCH64_TLSDESC_ADD_LO12_NC]
-  //   .tlsdesccall                       [R_AARCH64_TLSDESC_CALL]
-  //   blr     x1
-  // And it can optimized to:
-  //   adrp    x0, :gottprel:v
-  //   ldr     x0, [x0, :gottprel_lo12:v]
-  //   nop
-  //   nop
-
-  switch (Type) {
-  case R_AARCH64_TLSDESC_ADD_LO12_NC:
-  case R_AARCH64_TLSDESC_CALL:
+void AArch64TargetInfo::relaxTls(uint8_t *Loc, TlsRelaxOp Op,
+                                 uint64_t Val) const {
+  switch (Op) {
+  case TLSOP_AARCH64_DESC_NOP:
     write32le(Loc, 0xd503201f); // nop
     break;
-  case R_AARCH64_TLSDESC_ADR_PAGE21:
+  case TLSOP_AARCH64_DESC_TO_LE_MOVZ:
+    checkUInt<32>(Val, R_AARCH64_TLSDESC_ADR_PAGE21);
+    write32le(Loc, 0xd2a00000 | (((Val >> 16) & 0xffff) << 5)); // movz
+    break;
+  case TLSOP_AARCH64_DESC_TO_LE_MOVK:
+    checkUInt<32>(Val, R_AARCH64_TLSDESC_LD64_LO12_NC);
+    write32le(Loc, 0xf2800000 | ((Val & 0xffff) << 5)); // movk
+    break;
+  case TLSOP_AARCH64_DESC_TO_IE_PAGE:
     write32le(Loc, 0x90000000); // adrp
     relocateOne(Loc, R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21, Val);
     break;
-  case R_AARCH64_TLSDESC_LD64_LO12_NC:
+  case TLSOP_AARCH64_DESC_TO_IE_LD:
     write32le(Loc, 0xf9400000); // ldr
     relocateOne(Loc, R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC, Val);
     break;
-  default:
-    llvm_unreachable("unsupported relocation for TLS GD to LE relaxation");
-  }
-}
-
-void AArch64TargetInfo::relaxTlsIeToLe(uint8_t *Loc, uint32_t Type,
-                                       uint64_t Val) const {
-  checkUInt<32>(Val, Type);
-
-  if (Type == R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21) {
-    // Generate MOVZ.
+  case TLSOP_AARCH64_IE_TO_LE_MOVZ: {
+    checkUInt<32>(Val, R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21);
     uint32_t RegNo = read32le(Loc) & 0x1f;
     write32le(Loc, (0xd2a00000 | RegNo) | (((Val >> 16) & 0xffff) << 5));
-    return;
+    break;
   }
-  if (Type == R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC) {
-    // Generate MOVK.
+  case TLSOP_AARCH64_IE_TO_LE_MOVK: {
+    checkUInt<32>(Val, R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC);
     uint32_t RegNo = read32le(Loc) & 0x1f;
     write32le(Loc, (0xf2800000 | RegNo) | ((Val & 0xffff) << 5));
-    return;
+    break;
+  }
+  default:
+    llvm_unreachable("unknown TLS relaxation");
   }
-  llvm_unreachable("invalid relocation for TLS IE to LE relaxation");
 }
 
 void AMDGPUTargetInfo::relocateOne(uint8_t *Loc, uint32_t Type,
@@ -1421,7 +1554,8 @@ void AMDGPUTargetInfo::relocateOne(uint8_t *Loc, uint32_t Type,
   write32le(Loc, Val);
 }
 
-RelExpr AMDGPUTargetInfo::getRelExpr(uint32_t Type, const SymbolBody &S) const {
+RelExpr AMDGPUTargetInfo::getRelExprImpl(uint32_t Type,
+                                          const SymbolBody *S) const {
   if (Type != R_AMDGPU_REL32)
     error("do not know how to handle relocation");
   return R_PC;
@@ -1438,9 +1572,11 @@ ARMTargetInfo::ARMTargetInfo() {
   TlsOffsetRel = R_ARM_TLS_DTPOFF32;
   PltEntrySize = 16;
   PltHeaderSize = 20;
+  ThunkSize = 12;
 }
 
-RelExpr ARMTargetInfo::getRelExpr(uint32_t Type, const SymbolBody &S) const {
+RelExpr ARMTargetInfo::getRelExprImpl(uint32_t Type,
+                                       const SymbolBody *S) const {
   switch (Type) {
   default:
     return R_ABS;
@@ -1517,6 +1653,61 @@ void ARMTargetInfo::writePlt(uint8_t *Buf, uint64_t GotEntryAddr,
   write32le(Buf + 12, GotEntryAddr - L1 - 8);
 }
 
+void ARMTargetInfo::writeThunk(uint8_t *Buf, uint64_t S) const {
+  if (S & 1) {
+    // The destination is a Thumb function, so the thunk is reached by
+    // ARM-state branches and must switch state:
+    //   movw ip, :lower16:S
+    //   movt ip, :upper16:S
+    //   bx   ip
+    // bx interworks because bit 0 of S is set.
+    write32le(Buf, 0xe300c000 | ((S & 0xf000) << 4) | (S & 0xfff));
+    write32le(Buf + 4,
+              0xe340c000 | (((S >> 16) & 0xf000) << 4) | ((S >> 16) & 0xfff));
+    write32le(Buf + 8, 0xe12fff1c);
+    return;
+  }
+  // The destination is an ARM function; the same sequence in Thumb
+  // encodings (movw T3, movt T1), padded with a nop to ThunkSize.
+  uint64_t Hi = S >> 16;
+  write16le(Buf, 0xf240 | ((S >> 1) & 0x0400) | ((S >> 12) & 0xf));
+  write16le(Buf + 2, 0x0c00 | ((S << 4) & 0x7000) | (S & 0xff));
+  write16le(Buf + 4, 0xf2c0 | ((Hi >> 1) & 0x0400) | ((Hi >> 12) & 0xf));
+  write16le(Buf + 6, 0x0c00 | ((Hi << 4) & 0x7000) | (Hi & 0xff));
+  write16le(Buf + 8, 0x4760); // bx ip
+  write16le(Buf + 10, 0xbf00);
+}
+
+bool ARMTargetInfo::needsThunk(uint32_t Type, const InputFile &File,
+                               const SymbolBody &S) const {
+  // Plain branch instructions have no BLX form, so unlike BL they
+  // cannot change instruction state. A branch whose destination is a
+  // function in the other state is routed through a thunk that can.
+  // Preemptible symbols are reached via their ARM-state PLT entry
+  // instead.
+  auto *D = dyn_cast<DefinedRegular<ELF32LE>>(&S);
+  if (!D || !D->Section || !S.isFunc() || S.isPreemptible())
+    return false;
+  switch (Type) {
+  case R_ARM_JUMP24:
+  case R_ARM_PC24:
+  case R_ARM_PLT32:
+    // ARM-state branch to a Thumb function.
+    return (D->Value & 1) != 0;
+  case R_ARM_THM_JUMP19:
+  case R_ARM_THM_JUMP24:
+    // Thumb-state branch to an ARM function.
+    return (D->Value & 1) == 0;
+  }
+  return false;
+}
+
+bool ARMTargetInfo::isCallRel(uint32_t Type) const {
+  return Type == R_ARM_CALL || Type == R_ARM_JUMP24 || Type == R_ARM_PC24 ||
+         Type == R_ARM_PLT32 || Type == R_ARM_THM_CALL ||
+         Type == R_ARM_THM_JUMP19 || Type == R_ARM_THM_JUMP24;
+}
+
 void ARMTargetInfo::relocateOne(uint8_t *Loc, uint32_t Type,
                                 uint64_t Val) const {
   switch (Type) {
@@ -1701,6 +1892,9 @@ uint64_t ARMTargetInfo::getImplicitAddend(const uint8_t *Buf,
 }
 
 template <class ELFT> MipsTargetInfo<ELFT>::MipsTargetInfo() {
+  // Relocations against _gp_disp and local GOT16 targets classify
+  // differently, so the per-type expression table cannot be used.
+  HasSymbolDependentRelExpr = true;
   GotPltHeaderEntriesNum = 2;
   PageSize = 65536;
   PltEntrySize = 16;
@@ -1722,8 +1916,8 @@ template <class ELFT> MipsTargetInfo<ELFT>::MipsTargetInfo() {
 }
 
 template <class ELFT>
-RelExpr MipsTargetInfo<ELFT>::getRelExpr(uint32_t Type,
-                                         const SymbolBody &S) const {
+RelExpr MipsTargetInfo<ELFT>::getRelExprImpl(uint32_t Type,
+                                             const SymbolBody *S) const {
   if (ELFT::Is64Bits)
     // See comment in the calculateMips64RelChain.
     Type &= 0xff;
@@ -1744,7 +1938,7 @@ RelExpr MipsTargetInfo<ELFT>::getRelExpr(uint32_t Type,
     // pointer into GOT. __gnu_local_gp is equal to the current value of
     // the 'gp'. Therefore any relocations against them do not require
     // dynamic relocation.
-    if (&S == ElfSym<ELFT>::MipsGpDisp)
+    if (S == ElfSym<ELFT>::MipsGpDisp)
       return R_PC;
     return R_ABS;
   case R_MIPS_PC32:
@@ -1756,7 +1950,7 @@ RelExpr MipsTargetInfo<ELFT>::getRelExpr(uint32_t Type,
   case R_MIPS_PCLO16:
     return R_PC;
   case R_MIPS_GOT16:
-    if (S.isLocal())
+    if (S->isLocal())
       return R_MIPS_GOT_LOCAL_PAGE;
   // fallthrough
   case R_MIPS_CALL16:
@@ -2031,5 +2225,10 @@ template <class ELFT>
 bool MipsTargetInfo<ELFT>::usesOnlyLowPageBits(uint32_t Type) const {
   return Type == R_MIPS_LO16 || Type == R_MIPS_GOT_OFST;
 }
+
+template <class ELFT>
+bool MipsTargetInfo<ELFT>::isCallRel(uint32_t Type) const {
+  return Type == R_MIPS_26;
+}
 }
 }
@@ -48,13 +48,46 @@ public:
   // a dynamic relocation.
   virtual bool usesOnlyLowPageBits(uint32_t Type) const;
 
+  // Returns true if a relocation type can only be produced for a
+  // function call or jump, i.e. it cannot be used to materialize the
+  // target's address. --icf=safe treats symbols that are referenced
+  // exclusively through such relocations as not address-taken. The
+  // default is pessimistic: every reference counts as taking the
+  // address, so safe ICF folds nothing on targets that do not
+  // implement this hook.
+  virtual bool isCallRel(uint32_t Type) const;
+
   virtual bool needsThunk(uint32_t Type, const InputFile &File,
                           const SymbolBody &S) const;
 
   virtual void writeThunk(uint8_t *Buf, uint64_t S) const {}
 
-  virtual RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const = 0;
+  // Classifies a relocation type into the expression the scan and
+  // apply loops work with. Almost every target classifies by type
+  // alone, so the answers are precomputed into RelExprTable once by
+  // initRelExprTable and the hottest dispatch of the relocation scan
+  // becomes one indexed load instead of a virtual switch per
+  // relocation. Targets whose classification consults the symbol
+  // (MIPS) set HasSymbolDependentRelExpr and take the virtual path.
+  RelExpr getRelExpr(uint32_t Type, const SymbolBody &S) const {
+    if (!HasSymbolDependentRelExpr && Type < RelExprTableSize)
+      return RelExprTable[Type];
+    return getRelExprImpl(Type, &S);
+  }
+
+  void initRelExprTable();
+
   virtual void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const = 0;
+
+  // Applies a run of relocations that all have the same type. Called
+  // once per run by the relocation apply loop so there is one virtual
+  // call per run rather than per relocation. Targets can override this
+  // with specialized kernels for their hottest types; the default just
+  // loops over relocateOne.
+  virtual void relocateMany(uint8_t *Buf, uint32_t Type,
+                            const uint64_t *Offsets, const uint64_t *Vals,
+                            size_t N) const;
+
   virtual ~TargetInfo();
 
   unsigned TlsGdRelaxSkip = 1;
@@ -92,10 +125,28 @@ public:
   virtual RelExpr adjustRelaxExpr(uint32_t Type, const uint8_t *Data,
                                   RelExpr Expr) const;
   virtual void relaxGot(uint8_t *Loc, uint64_t Val) const;
-  virtual void relaxTlsGdToIe(uint8_t *Loc, uint32_t Type, uint64_t Val) const;
-  virtual void relaxTlsGdToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const;
-  virtual void relaxTlsIeToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const;
-  virtual void relaxTlsLdToLe(uint8_t *Loc, uint32_t Type, uint64_t Val) const;
+
+  // Maps a TLS relaxation expression and the relocation type it was
+  // attached to onto the concrete rewrite to perform. Called once per
+  // relocation during scanRelocations; the result is stored in the
+  // Relocation and handed back to relaxTls at write time.
+  virtual TlsRelaxOp getTlsRelaxOp(RelExpr Expr, uint32_t Type) const;
+
+  // Applies a TLS relaxation opcode precomputed by getTlsRelaxOp.
+  virtual void relaxTls(uint8_t *Loc, TlsRelaxOp Op, uint64_t Val) const;
+
+protected:
+  // The symbol pointer is null while initRelExprTable probes the
+  // classification per type; only targets with HasSymbolDependentRelExpr
+  // set (which are never probed) may dereference it.
+  virtual RelExpr getRelExprImpl(uint32_t Type, const SymbolBody *S) const = 0;
+
+  // Large enough for every static relocation type we classify;
+  // AArch64 has the largest numbers (up to 0x239). Types beyond the
+  // table take the virtual path, which returns the same answer.
+  enum : unsigned { RelExprTableSize = 576 };
+  RelExpr RelExprTable[RelExprTableSize];
+  bool HasSymbolDependentRelExpr = false;
 };
 
 StringRef getRelName(uint32_t Type);
@@ -0,0 +1,88 @@
+//===- TimeTrace.cpp ------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "TimeTrace.h"
+#include "Config.h"
+#include "Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+using namespace lld;
+using namespace lld::elf;
+
+namespace {
+struct TraceEvent {
+  StringRef Name;
+  uint64_t Tid;
+  uint64_t StartUs;
+  uint64_t DurUs;
+};
+}
+
+static std::chrono::steady_clock::time_point TraceOrigin;
+static std::vector<TraceEvent> Events;
+static std::mutex EventsMutex;
+
+static uint64_t getThreadId() {
+  return std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+static uint64_t toMicroseconds(std::chrono::steady_clock::duration D) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(D).count();
+}
+
+void elf::initTimeTrace() { TraceOrigin = std::chrono::steady_clock::now(); }
+
+ScopedTimeTrace::ScopedTimeTrace(StringRef Name) : Name(Name) {
+  if (Config->TimeTraceFile.empty())
+    return;
+  Start = std::chrono::steady_clock::now();
+}
+
+ScopedTimeTrace::~ScopedTimeTrace() {
+  if (Config->TimeTraceFile.empty())
+    return;
+  TraceEvent Ev;
+  Ev.Name = Name;
+  Ev.Tid = getThreadId();
+  Ev.StartUs = toMicroseconds(Start - TraceOrigin);
+  Ev.DurUs = toMicroseconds(std::chrono::steady_clock::now() - Start);
+  std::lock_guard<std::mutex> Lock(EventsMutex);
+  Events.push_back(Ev);
+}
+
+void elf::writeTimeTrace() {
+  if (Config->TimeTraceFile.empty())
+    return;
+  std::error_code EC;
+  raw_fd_ostream OS(Config->TimeTraceFile, EC, sys::fs::F_None);
+  if (EC) {
+    error(EC, "cannot write " + Config->TimeTraceFile);
+    return;
+  }
+
+  // The chrome://tracing JSON format: one complete ("ph":"X") event
+  // per recorded scope, timestamps and durations in microseconds.
+  OS << "{\"traceEvents\":[";
+  std::lock_guard<std::mutex> Lock(EventsMutex);
+  for (size_t I = 0, E = Events.size(); I != E; ++I) {
+    const TraceEvent &Ev = Events[I];
+    if (I)
+      OS << ",";
+    OS << "\n{\"name\":\"" << Ev.Name << "\",\"ph\":\"X\",\"ts\":" << Ev.StartUs
+       << ",\"dur\":" << Ev.DurUs << ",\"pid\":0,\"tid\":" << Ev.Tid << "}";
+  }
+  OS << "\n]}\n";
+  Events.clear();
+}
@@ -0,0 +1,48 @@
+//===- TimeTrace.h ----------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// -time-trace=<file> records how long each phase of a link takes and
+// writes the result as chrome://tracing-compatible JSON. Open the file
+// with chrome://tracing or any compatible viewer to see where a slow
+// link spends its time, including events from worker threads.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_TIME_TRACE_H
+#define LLD_ELF_TIME_TRACE_H
+
+#include "lld/Core/LLVM.h"
+#include <chrono>
+
+namespace lld {
+namespace elf {
+
+// Marks the time origin of the trace. Called once at the start of the
+// link so that event timestamps are relative to it.
+void initTimeTrace();
+
+// Writes the collected events to the file given by -time-trace=.
+// A no-op if the flag is not in effect.
+void writeTimeTrace();
+
+// Records the duration of a scope as a trace event. Name must outlive
+// the trace (in practice, a string literal).
+struct ScopedTimeTrace {
+  explicit ScopedTimeTrace(StringRef Name);
+  ~ScopedTimeTrace();
+
+private:
+  StringRef Name;
+  std::chrono::steady_clock::time_point Start;
+};
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -10,17 +10,26 @@
 #include "Writer.h"
 #include "Config.h"
 #include "LinkerScript.h"
+#include "MapFile.h"
+#include "OutputBuffer.h"
 #include "OutputSections.h"
 #include "Relocations.h"
 #include "SymbolTable.h"
 #include "Target.h"
+#include "TimeTrace.h"
+#include "lld/Core/PageAdvise.h"
+#include "lld/Core/Parallel.h"
 
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
-#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/JamCRC.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <thread>
+
 using namespace llvm;
 using namespace llvm::ELF;
 using namespace llvm::object;
@@ -58,21 +67,29 @@ private:
 
   void copyLocalSymbols();
   void addReservedSymbols();
+  void sortBySymbolOrder();
   void createSections();
   void addPredefinedSections();
   bool needsGot();
 
   void createPhdrs();
   void assignAddresses();
+  void compressDebugSections();
   void assignFileOffsets();
   void setPhdrs();
   void fixHeaders();
   void fixSectionAlignments();
   void fixAbsoluteSymbols();
+  void cacheSymbolVAs();
   void openFile();
   void writeHeader();
   void writeSections();
   void writeBuildId();
+  void splitDebugSections();
+  void assignDebugFileOffsets();
+  void openDebugFile();
+  void writeDebugHeader();
+  void writeDebugLinkCrc();
   bool isDiscarded(InputSectionBase<ELFT> *IS) const;
   StringRef getOutputSectionName(InputSectionBase<ELFT> *S) const;
   bool needsInterpSection() const {
@@ -84,7 +101,13 @@ private:
 
   void addCommonSymbols(std::vector<DefinedCommon *> &Syms);
 
-  std::unique_ptr<llvm::FileOutputBuffer> Buffer;
+  std::unique_ptr<OutputBuffer> Buffer;
+
+  // --split-debug-output state: the debug sections taken out of
+  // OutputSections, their own .shstrtab, and the second output file.
+  std::unique_ptr<OutputBuffer> DebugBuffer;
+  std::unique_ptr<StringTableSection<ELFT>> DebugShStrTab;
+  std::vector<OutputSectionBase<ELFT> *> DebugSections;
 
   BumpPtrAllocator Alloc;
   std::vector<OutputSectionBase<ELFT> *> OutputSections;
@@ -99,6 +122,8 @@ private:
 
   uintX_t FileSize;
   uintX_t SectionHeaderOff;
+  uintX_t DebugFileSize;
+  uintX_t DebugSectionHeaderOff;
 };
 } // anonymous namespace
 
@@ -129,10 +154,13 @@ template <class ELFT> void elf::writeResult(SymbolTable<ELFT> *Symtab) {
   // Instantiate optional output sections if they are needed.
   std::unique_ptr<BuildIdSection<ELFT>> BuildId;
   std::unique_ptr<EhFrameHeader<ELFT>> EhFrameHdr;
+  std::unique_ptr<GdbIndexSection<ELFT>> GdbIndex;
+  std::unique_ptr<GnuDebugLinkSection<ELFT>> GnuDebugLink;
   std::unique_ptr<GnuHashTableSection<ELFT>> GnuHashTab;
   std::unique_ptr<GotPltSection<ELFT>> GotPlt;
   std::unique_ptr<HashTableSection<ELFT>> HashTab;
   std::unique_ptr<RelocationSection<ELFT>> RelaPlt;
+  std::unique_ptr<RelrSection<ELFT>> RelrDyn;
   std::unique_ptr<StringTableSection<ELFT>> StrTab;
   std::unique_ptr<SymbolTableSection<ELFT>> SymTabSec;
   std::unique_ptr<OutputSection<ELFT>> MipsRldMap;
@@ -144,12 +172,21 @@ template <class ELFT> void elf::writeResult(SymbolTable<ELFT> *Symtab) {
     BuildId.reset(new BuildIdMd5<ELFT>);
   else if (Config->BuildId == BuildIdKind::Sha1)
     BuildId.reset(new BuildIdSha1<ELFT>);
+  else if (Config->BuildId == BuildIdKind::Tree)
+    BuildId.reset(new BuildIdTree<ELFT>);
   else if (Config->BuildId == BuildIdKind::Hexstring)
     BuildId.reset(new BuildIdHexstring<ELFT>);
 
   if (Config->EhFrameHdr)
     EhFrameHdr.reset(new EhFrameHeader<ELFT>);
 
+  if (Config->GdbIndex)
+    GdbIndex.reset(new GdbIndexSection<ELFT>);
+
+  if (!Config->SplitDebugOutput.empty() && !Config->Relocatable)
+    GnuDebugLink.reset(new GnuDebugLinkSection<ELFT>(
+        sys::path::filename(Config->SplitDebugOutput)));
+
   if (Config->GnuHash)
     GnuHashTab.reset(new GnuHashTableSection<ELFT>);
   if (Config->SysvHash)
@@ -157,6 +194,8 @@ template <class ELFT> void elf::writeResult(SymbolTable<ELFT> *Symtab) {
   StringRef S = Config->Rela ? ".rela.plt" : ".rel.plt";
   GotPlt.reset(new GotPltSection<ELFT>);
   RelaPlt.reset(new RelocationSection<ELFT>(S, false /*Sort*/));
+  if (Config->PackDynRelocs)
+    RelrDyn.reset(new RelrSection<ELFT>());
   if (!Config->StripAll) {
     StrTab.reset(new StringTableSection<ELFT>(".strtab", false));
     SymTabSec.reset(new SymbolTableSection<ELFT>(*StrTab));
@@ -181,6 +220,8 @@ template <class ELFT> void elf::writeResult(SymbolTable<ELFT> *Symtab) {
   Out<ELFT>::Dynamic = &Dynamic;
   Out<ELFT>::EhFrame = &EhFrame;
   Out<ELFT>::EhFrameHdr = EhFrameHdr.get();
+  Out<ELFT>::GdbIndex = GdbIndex.get();
+  Out<ELFT>::GnuDebugLink = GnuDebugLink.get();
   Out<ELFT>::GnuHashTab = GnuHashTab.get();
   Out<ELFT>::Got = &Got;
   Out<ELFT>::GotPlt = GotPlt.get();
@@ -189,6 +230,7 @@ template <class ELFT> void elf::writeResult(SymbolTable<ELFT> *Symtab) {
   Out<ELFT>::Plt = &Plt;
   Out<ELFT>::RelaDyn = &RelaDyn;
   Out<ELFT>::RelaPlt = RelaPlt.get();
+  Out<ELFT>::RelrDyn = RelrDyn.get();
   Out<ELFT>::ShStrTab = &ShStrTab;
   Out<ELFT>::StrTab = StrTab.get();
   Out<ELFT>::SymTab = SymTabSec.get();
@@ -207,16 +249,22 @@ template <class ELFT> void elf::writeResult(SymbolTable<ELFT> *Symtab) {
 
 // The main function of the writer.
 template <class ELFT> void Writer<ELFT>::run() {
-  if (!Config->DiscardAll)
+  if (!Config->DiscardAll) {
+    ScopedTimeTrace T("copyLocalSymbols");
     copyLocalSymbols();
+  }
   addReservedSymbols();
-  createSections();
+  {
+    ScopedTimeTrace T("createSections");
+    createSections();
+  }
   if (HasError)
     return;
 
   if (Config->Relocatable) {
     assignFileOffsets();
   } else {
+    ScopedTimeTrace T("assignAddresses");
     createPhdrs();
     fixHeaders();
     if (ScriptConfig->DoLayout) {
@@ -225,20 +273,61 @@ template <class ELFT> void Writer<ELFT>::run() {
       fixSectionAlignments();
       assignAddresses();
     }
+    if (Config->CompressDebugSections)
+      compressDebugSections();
     assignFileOffsets();
     setPhdrs();
     fixAbsoluteSymbols();
+    cacheSymbolVAs();
   }
 
-  openFile();
+  if (Out<ELFT>::GnuDebugLink)
+    assignDebugFileOffsets();
+
+  {
+    ScopedTimeTrace T("openFile");
+    openFile();
+    if (Out<ELFT>::GnuDebugLink)
+      openDebugFile();
+  }
   if (HasError)
     return;
   writeHeader();
-  writeSections();
-  writeBuildId();
+  if (DebugBuffer)
+    writeDebugHeader();
+
+  // The map file and the cross reference table depend only on the final
+  // layout, which no longer changes, so they are produced on a helper
+  // thread while section contents are streamed to the output buffer.
+  std::thread MapThread;
+  if (!Config->MapFile.empty() || Config->Cref) {
+    if (Config->Threads)
+      MapThread =
+          std::thread([this] { writeMapFile<ELFT>(OutputSections); });
+    else
+      writeMapFile<ELFT>(OutputSections);
+  }
+
+  {
+    ScopedTimeTrace T("writeSections");
+    writeSections();
+  }
+  if (DebugBuffer)
+    writeDebugLinkCrc();
+  {
+    ScopedTimeTrace T("writeBuildId");
+    writeBuildId();
+  }
+  if (MapThread.joinable())
+    MapThread.join();
   if (HasError)
     return;
-  check(Buffer->commit());
+  {
+    ScopedTimeTrace T("commit");
+    if (DebugBuffer)
+      check(DebugBuffer->commit());
+    check(Buffer->commit());
+  }
 }
 
 namespace {
@@ -281,7 +370,7 @@ static void reportUndefined(SymbolTable<ELFT> &Symtab, SymbolBody *Sym) {
       return;
   }
 
-  std::string Msg = "undefined symbol: " + Sym->getName().str();
+  std::string Msg = ("undefined symbol: " + demangle(Sym->getName())).str();
   if (InputFile *File = Sym->getSourceFile<ELFT>())
     Msg += " in " + getFilename(File);
   if (Config->NoinhibitExec)
@@ -341,11 +430,18 @@ template <class ELFT> static bool includeInSymtab(const SymbolBody &B) {
 
 // Local symbols are not in the linker's symbol table. This function scans
 // each object file's symbol table to copy local symbols to the output.
+//
+// Deciding which locals to keep only reads per-symbol and per-section
+// state, so the files are filtered concurrently into their KeptLocalSyms
+// vectors. Assigning symbol table slots and string table offsets mutates
+// shared tables and runs serially afterwards, in file order, so the
+// output is identical to a serial scan.
 template <class ELFT> void Writer<ELFT>::copyLocalSymbols() {
   if (!Out<ELFT>::SymTab)
     return;
-  for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F :
-       Symtab.getObjectFiles()) {
+
+  auto &Files = Symtab.getObjectFiles();
+  auto Filter = [](const std::unique_ptr<elf::ObjectFile<ELFT>> &F) {
     const char *StrTab = F->getStringTable().data();
     for (SymbolBody *B : F->getLocalSymbols()) {
       auto *DR = dyn_cast<DefinedRegular<ELFT>>(B);
@@ -358,13 +454,76 @@ template <class ELFT> void Writer<ELFT>::copyLocalSymbols() {
       InputSectionBase<ELFT> *Sec = DR->Section;
       if (!shouldKeepInSymtab<ELFT>(Sec, SymName, *B))
         continue;
+      F->KeptLocalSyms.push_back(std::make_pair(DR, 0));
+    }
+  };
+  // One task per file: a file's locals are plenty of work, and typical
+  // links have far fewer files than parallel_for_each's chunk size.
+  if (Config->Threads) {
+    TaskGroup Tg;
+    for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F : Files)
+      Tg.spawn([&Filter, &F] { Filter(F); });
+  } else {
+    std::for_each(Files.begin(), Files.end(), Filter);
+  }
+
+  for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F : Files) {
+    const char *StrTab = F->getStringTable().data();
+    for (std::pair<DefinedRegular<ELFT> *, unsigned> &P : F->KeptLocalSyms) {
       ++Out<ELFT>::SymTab->NumLocals;
       if (Config->Relocatable)
-        B->DynsymIndex = Out<ELFT>::SymTab->NumLocals;
-      F->KeptLocalSyms.push_back(
-          std::make_pair(DR, Out<ELFT>::SymTab->StrTabSec.addString(SymName)));
+        P.first->DynsymIndex = Out<ELFT>::SymTab->NumLocals;
+      P.second = Out<ELFT>::SymTab->StrTabSec.addString(
+          StringRef(StrTab + P.first->getNameOffset()));
+    }
+  }
+}
+
+// Reorders executable input sections for --symbol-ordering-file.
+// Every input section defining a listed symbol is ranked by the
+// best-ranked name it defines, and the sections of each executable
+// output section are permuted accordingly, so hot startup functions
+// end up next to each other and share pages.
+template <class ELFT> void Writer<ELFT>::sortBySymbolOrder() {
+  if (Config->SymbolOrderingFile.empty())
+    return;
+
+  StringMap<int> SymbolRank;
+  DenseMap<InputSectionBase<ELFT> *, int> SectionRank;
+  auto AddSym = [&](SymbolBody *B, int Rank) {
+    auto *D = dyn_cast_or_null<DefinedRegular<ELFT>>(B);
+    if (!D || !D->Section)
+      return;
+    int &R = SectionRank[D->Section->Repl];
+    if (R == 0 || Rank < R)
+      R = Rank;
+  };
+
+  // Global symbols resolve through the symbol table.
+  int Rank = 0;
+  for (StringRef Name : Config->SymbolOrderingFile) {
+    ++Rank;
+    if (SymbolRank.insert({Name, Rank}).second)
+      AddSym(Symtab.find(Name), Rank);
+  }
+
+  // Listed names may also refer to local symbols, which we have to
+  // find by scanning each file's local symbol table.
+  for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F :
+       Symtab.getObjectFiles()) {
+    const char *StrTab = F->getStringTable().data();
+    for (SymbolBody *B : F->getLocalSymbols()) {
+      auto It = SymbolRank.find(StringRef(StrTab + B->getNameOffset()));
+      if (It != SymbolRank.end())
+        AddSym(B, It->second);
     }
   }
+  if (SectionRank.empty())
+    return;
+
+  for (OutputSectionBase<ELFT> *Sec : OutputSections)
+    if (Sec->getFlags() & SHF_EXECINSTR)
+      Sec->sortByOrder(SectionRank);
 }
 
 // PPC64 has a number of special SHT_PROGBITS+SHF_ALLOC+SHF_WRITE sections that
@@ -503,13 +662,10 @@ void Writer<ELFT>::addCommonSymbols(std::vector<DefinedCommon *> &Syms) {
   Out<ELFT>::Bss->setSize(Off);
 }
 
-template <class ELFT>
-StringRef Writer<ELFT>::getOutputSectionName(InputSectionBase<ELFT> *S) const {
-  StringRef Dest = Script<ELFT>::X->getOutputSection(S);
-  if (!Dest.empty())
-    return Dest;
-
-  StringRef Name = S->getSectionName();
+// Strips a -ffunction-sections/-fdata-sections style suffix, so that
+// for example ".text.foo" is placed in ".text". Only looks at the
+// name, so it is shared by all ELFT instantiations.
+static StringRef stripSectionSuffix(StringRef Name) {
   for (StringRef V : {".text.", ".rodata.", ".data.rel.ro.", ".data.", ".bss.",
                       ".init_array.", ".fini_array.", ".ctors.", ".dtors.",
                       ".tbss.", ".gcc_except_table.", ".tdata."})
@@ -518,6 +674,14 @@ StringRef Writer<ELFT>::getOutputSectionName(InputSectionBase<ELFT> *S) const {
   return Name;
 }
 
+template <class ELFT>
+StringRef Writer<ELFT>::getOutputSectionName(InputSectionBase<ELFT> *S) const {
+  StringRef Dest = Script<ELFT>::X->getOutputSection(S);
+  if (!Dest.empty())
+    return Dest;
+  return stripSectionSuffix(S->getSectionName());
+}
+
 template <class ELFT>
 void reportDiscarded(InputSectionBase<ELFT> *IS,
                      const std::unique_ptr<elf::ObjectFile<ELFT>> &File) {
@@ -574,6 +738,14 @@ template <class ELFT> class OutputSectionFactory {
 public:
   std::pair<OutputSectionBase<ELFT> *, bool> create(InputSectionBase<ELFT> *C,
                                                     StringRef OutsecName);
+  std::pair<OutputSectionBase<ELFT> *, bool>
+  create(const SectionKey<ELFT::Is64Bits> &Key, InputSectionBase<ELFT> *C);
+
+  // Computing a section's key only reads the section header and the
+  // linker script rules, so callers may do it concurrently before
+  // grouping sections in input order.
+  SectionKey<ELFT::Is64Bits> createKey(InputSectionBase<ELFT> *C,
+                                       StringRef OutsecName);
 
   OutputSectionBase<ELFT> *lookup(StringRef Name, uint32_t Type,
                                   uintX_t Flags) {
@@ -581,9 +753,6 @@ public:
   }
 
 private:
-  SectionKey<ELFT::Is64Bits> createKey(InputSectionBase<ELFT> *C,
-                                       StringRef OutsecName);
-
   SmallDenseMap<SectionKey<ELFT::Is64Bits>, OutputSectionBase<ELFT> *> Map;
 };
 }
@@ -592,7 +761,13 @@ template <class ELFT>
 std::pair<OutputSectionBase<ELFT> *, bool>
 OutputSectionFactory<ELFT>::create(InputSectionBase<ELFT> *C,
                                    StringRef OutsecName) {
-  SectionKey<ELFT::Is64Bits> Key = createKey(C, OutsecName);
+  return create(createKey(C, OutsecName), C);
+}
+
+template <class ELFT>
+std::pair<OutputSectionBase<ELFT> *, bool>
+OutputSectionFactory<ELFT>::create(const SectionKey<ELFT::Is64Bits> &Key,
+                                   InputSectionBase<ELFT> *C) {
   OutputSectionBase<ELFT> *&Sec = Map[Key];
   if (Sec)
     return {Sec, false};
@@ -728,26 +903,60 @@ template <class ELFT> void Writer<ELFT>::createSections() {
 
   // Create output sections for input object file sections.
   std::vector<OutputSectionBase<ELFT> *> RegularSections;
+  std::vector<MergeOutputSection<ELFT> *> MergeSections;
   OutputSectionFactory<ELFT> Factory;
+
+  // Classifying an input section runs the linker script pattern
+  // matching and the name-based placement rules, which dominate this
+  // loop at large section counts and have no side effects. Compute
+  // every section's output key concurrently, then group the sections
+  // into output sections in one ordered pass so that output section
+  // creation order and member order match a serial walk.
+  struct Classified {
+    InputSectionBase<ELFT> *Sec;
+    const std::unique_ptr<elf::ObjectFile<ELFT>> *File;
+    SectionKey<ELFT::Is64Bits> Key;
+    bool Discarded;
+  };
+  std::vector<Classified> Classes;
   for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F :
-       Symtab.getObjectFiles()) {
-    for (InputSectionBase<ELFT> *C : F->getSections()) {
-      if (isDiscarded(C)) {
-        reportDiscarded(C, F);
-        continue;
-      }
-      OutputSectionBase<ELFT> *Sec;
-      bool IsNew;
-      std::tie(Sec, IsNew) = Factory.create(C, getOutputSectionName(C));
-      if (IsNew) {
-        OwningSections.emplace_back(Sec);
-        OutputSections.push_back(Sec);
-        RegularSections.push_back(Sec);
-      }
-      Sec->addSection(C);
+       Symtab.getObjectFiles())
+    for (InputSectionBase<ELFT> *C : F->getSections())
+      Classes.push_back({C, &F, {}, false});
+
+  auto Classify = [&](Classified &CL) {
+    CL.Discarded = isDiscarded(CL.Sec);
+    if (!CL.Discarded)
+      CL.Key = Factory.createKey(CL.Sec, getOutputSectionName(CL.Sec));
+  };
+  if (Config->Threads)
+    parallel_for_each(Classes.begin(), Classes.end(), Classify, 1024);
+  else
+    std::for_each(Classes.begin(), Classes.end(), Classify);
+
+  for (Classified &CL : Classes) {
+    if (CL.Discarded) {
+      reportDiscarded(CL.Sec, *CL.File);
+      continue;
+    }
+    OutputSectionBase<ELFT> *Sec;
+    bool IsNew;
+    std::tie(Sec, IsNew) = Factory.create(CL.Key, CL.Sec);
+    if (IsNew) {
+      OwningSections.emplace_back(Sec);
+      OutputSections.push_back(Sec);
+      RegularSections.push_back(Sec);
+      if (isa<MergeInputSection<ELFT>>(CL.Sec))
+        MergeSections.push_back(static_cast<MergeOutputSection<ELFT> *>(Sec));
     }
+    Sec->addSection(CL.Sec);
   }
 
+  // Now that all mergeable sections are registered, deduplicate their
+  // pieces. Each section's pieces are sharded over the thread pool.
+  for (MergeOutputSection<ELFT> *Sec : MergeSections)
+    Sec->mergePieces();
+
   // If we have a .opd section (used under PPC64 for function descriptors),
   // store a pointer to it here so that we can use it later when processing
   // relocations.
@@ -786,26 +995,35 @@ template <class ELFT> void Writer<ELFT>::createSections() {
   addRelIpltSymbols();
 
   if (!Out<ELFT>::EhFrame->empty()) {
+    {
+      ScopedTimeTrace T("mergeFrames");
+      Out<ELFT>::EhFrame->mergeFrames();
+    }
     OutputSections.push_back(Out<ELFT>::EhFrame);
     Out<ELFT>::EhFrame->finalize();
   }
 
   // Scan relocations. This must be done after every symbol is declared so that
-  // we can correctly decide if a dynamic relocation is needed.
+  // we can correctly decide if a dynamic relocation is needed. The scan itself
+  // runs in parallel; each section's GOT, PLT and dynamic relocation needs are
+  // buffered and merged in input order afterwards, so the result is the same
+  // as with a serial scan.
+  std::vector<InputSectionBase<ELFT> *> SectionsToScan;
   for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F :
        Symtab.getObjectFiles()) {
     for (InputSectionBase<ELFT> *C : F->getSections()) {
       if (isDiscarded(C))
         continue;
-      if (auto *S = dyn_cast<InputSection<ELFT>>(C)) {
-        scanRelocations(*S);
-        continue;
-      }
-      if (auto *S = dyn_cast<EhInputSection<ELFT>>(C))
-        if (S->RelocSection)
-          scanRelocations(*S, *S->RelocSection);
+      if (isa<InputSection<ELFT>>(C) || isa<EhInputSection<ELFT>>(C))
+        SectionsToScan.push_back(C);
     }
   }
+  {
+    ScopedTimeTrace T("scanRelocations");
+    scanRelocations<ELFT>(SectionsToScan);
+  }
+
+  sortBySymbolOrder();
 
   for (OutputSectionBase<ELFT> *Sec : OutputSections)
     Sec->assignOffsets();
@@ -843,6 +1061,13 @@ template <class ELFT> void Writer<ELFT>::createSections() {
 
   addCommonSymbols(CommonSymbols);
 
+  // --split-debug-output takes the debug sections out before section
+  // indices are assigned, so the main image's numbering and headers do
+  // not cover them. Relocation scanning is done, so nothing in the
+  // main image depends on them any more.
+  if (Out<ELFT>::GnuDebugLink)
+    splitDebugSections();
+
   // So far we have added sections from input object files.
   // This function adds linker-created Out<ELFT>::* sections.
   addPredefinedSections();
@@ -877,6 +1102,16 @@ template <class ELFT> void Writer<ELFT>::createSections() {
   // to fix their maps from input offsets to output offsets.
   for (OutputSectionBase<ELFT> *Sec : OutputSections)
     Sec->finalizePieces();
+
+  // Every input-to-output offset assignment (OutSecOff and piece
+  // OutputOff) is final at this point. Flatten each live section's
+  // translation state so that the getOffset calls made for every
+  // relocation and symbol from here on become a uniform run lookup.
+  for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F :
+       Symtab.getObjectFiles())
+    for (InputSectionBase<ELFT> *C : F->getSections())
+      if (!isDiscarded(C) && C->OutSec)
+        C->Repl->finalizeOffsetMap();
 }
 
 template <class ELFT> bool Writer<ELFT>::needsGot() {
@@ -905,6 +1140,8 @@ template <class ELFT> void Writer<ELFT>::addPredefinedSections() {
   Add(Out<ELFT>::SymTab);
   Add(Out<ELFT>::ShStrTab);
   Add(Out<ELFT>::StrTab);
+  Add(Out<ELFT>::GdbIndex);
+  Add(Out<ELFT>::GnuDebugLink);
   if (isOutputDynamic()) {
     Add(Out<ELFT>::DynSymTab);
 
@@ -921,6 +1158,8 @@ template <class ELFT> void Writer<ELFT>::addPredefinedSections() {
     Add(Out<ELFT>::DynStrTab);
     if (Out<ELFT>::RelaDyn->hasRelocs())
       Add(Out<ELFT>::RelaDyn);
+    if (Out<ELFT>::RelrDyn && Out<ELFT>::RelrDyn->hasRelocs())
+      Add(Out<ELFT>::RelrDyn);
     Add(Out<ELFT>::MipsRldMap);
   }
 
@@ -1180,6 +1419,44 @@ static uintX_t getFileAlignment(uintX_t Off, OutputSectionBase<ELFT> *Sec) {
   return alignTo(Off, Target->PageSize, Sec->getVA());
 }
 
+// Produce the compressed form of the debug output sections. Each
+// section is an independent zlib stream, so different sections can be
+// compressed concurrently on the thread pool.
+template <class ELFT> void Writer<ELFT>::compressDebugSections() {
+  ScopedTimeTrace T("compressDebugSections");
+  if (Config->Threads) {
+    TaskGroup Tg;
+    for (OutputSectionBase<ELFT> *Sec : OutputSections)
+      Tg.spawn([Sec] { Sec->maybeCompress(); });
+    for (OutputSectionBase<ELFT> *Sec : DebugSections)
+      Tg.spawn([Sec] { Sec->maybeCompress(); });
+    Tg.sync();
+  } else {
+    for (OutputSectionBase<ELFT> *Sec : OutputSections)
+      Sec->maybeCompress();
+    for (OutputSectionBase<ELFT> *Sec : DebugSections)
+      Sec->maybeCompress();
+  }
+}
+
+// Moves the debug sections into DebugSections for --split-debug-output.
+// Only non-alloc .debug_* sections are moved; they carry no addresses,
+// so the main image's layout does not change without them.
+template <class ELFT> void Writer<ELFT>::splitDebugSections() {
+  auto NotDebug = [](OutputSectionBase<ELFT> *Sec) {
+    return (Sec->getFlags() & SHF_ALLOC) ||
+           !Sec->getName().startswith(".debug");
+  };
+  auto I = std::stable_partition(OutputSections.begin(), OutputSections.end(),
+                                 NotDebug);
+  DebugSections.assign(I, OutputSections.end());
+  OutputSections.erase(I, OutputSections.end());
+
+  // The debug file gets its own section name table.
+  DebugShStrTab.reset(new StringTableSection<ELFT>(".shstrtab", false));
+  DebugSections.push_back(DebugShStrTab.get());
+}
+
 // Assign file offsets to output sections.
 template <class ELFT> void Writer<ELFT>::assignFileOffsets() {
   uintX_t Off =
@@ -1199,6 +1476,32 @@ template <class ELFT> void Writer<ELFT>::assignFileOffsets() {
   FileSize = SectionHeaderOff + (OutputSections.size() + 1) * sizeof(Elf_Shdr);
 }
 
+// Lays out the separate debug file: an ELF header, the debug sections
+// and a section header table. The file has no program headers; it is
+// only data for debuggers.
+template <class ELFT> void Writer<ELFT>::assignDebugFileOffsets() {
+  unsigned I = 1;
+  for (OutputSectionBase<ELFT> *Sec : DebugSections) {
+    Sec->SectionIndex = I++;
+    Sec->setSHName(DebugShStrTab->addString(Sec->getName()));
+  }
+
+  // The main finalizer loop no longer sees these sections, so fix
+  // their headers here. Only the name table has anything left to do.
+  for (OutputSectionBase<ELFT> *Sec : DebugSections)
+    Sec->finalize();
+
+  uintX_t Off = sizeof(Elf_Ehdr);
+  for (OutputSectionBase<ELFT> *Sec : DebugSections) {
+    Off = alignTo(Off, Sec->getAlignment());
+    Sec->setFileOffset(Off);
+    Off += Sec->getSize();
+  }
+  DebugSectionHeaderOff = alignTo(Off, sizeof(uintX_t));
+  DebugFileSize =
+      DebugSectionHeaderOff + (DebugSections.size() + 1) * sizeof(Elf_Shdr);
+}
+
 // Finalize the program headers. We call this function after we assign
 // file offsets and VAs to all sections.
 template <class ELFT> void Writer<ELFT>::setPhdrs() {
@@ -1291,6 +1594,22 @@ template <class ELFT> void Writer<ELFT>::fixAbsoluteSymbols() {
   }
 }
 
+// Every symbol's output address is final at this point, but getVA
+// recomputes it through a kind switch and section lookups on every
+// call, and hot symbols are referenced by tens of thousands of
+// relocations. Store the address in the SymbolBody so relocation
+// application reads one field. A body reachable from several files is
+// visited more than once; recomputing the same value is just wasted
+// work, so no synchronization is needed.
+template <class ELFT> void Writer<ELFT>::cacheSymbolVAs() {
+  for (Symbol *S : Symtab.getSymbols())
+    S->body()->template cacheVA<ELFT>();
+  for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F :
+       Symtab.getObjectFiles())
+    for (SymbolBody *B : F->getSymbols())
+      B->template cacheVA<ELFT>();
+}
+
 template <class ELFT> void Writer<ELFT>::writeHeader() {
   uint8_t *Buf = Buffer->getBufferStart();
   memcpy(Buf, "\177ELF", 4);
@@ -1334,19 +1653,78 @@ template <class ELFT> void Writer<ELFT>::writeHeader() {
 }
 
 template <class ELFT> void Writer<ELFT>::openFile() {
-  ErrorOr<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
-      FileOutputBuffer::create(Config->OutputFile, FileSize,
-                               FileOutputBuffer::F_executable);
+  ErrorOr<std::unique_ptr<OutputBuffer>> BufferOrErr =
+      OutputBuffer::create(Config->OutputFile, FileSize);
   if (BufferOrErr)
     Buffer = std::move(*BufferOrErr);
   else
     error(BufferOrErr, "failed to open " + Config->OutputFile);
 }
 
+template <class ELFT> void Writer<ELFT>::openDebugFile() {
+  ErrorOr<std::unique_ptr<OutputBuffer>> BufferOrErr =
+      OutputBuffer::create(Config->SplitDebugOutput, DebugFileSize);
+  if (BufferOrErr)
+    DebugBuffer = std::move(*BufferOrErr);
+  else
+    error(BufferOrErr, "failed to open " + Config->SplitDebugOutput);
+}
+
+// Writes the ELF header and the section header table of the debug file.
+template <class ELFT> void Writer<ELFT>::writeDebugHeader() {
+  uint8_t *Buf = DebugBuffer->getBufferStart();
+  memcpy(Buf, "\177ELF", 4);
+
+  auto &FirstObj = cast<ELFFileBase<ELFT>>(*Config->FirstElf);
+
+  auto *EHdr = reinterpret_cast<Elf_Ehdr *>(Buf);
+  EHdr->e_ident[EI_CLASS] = ELFT::Is64Bits ? ELFCLASS64 : ELFCLASS32;
+  EHdr->e_ident[EI_DATA] = getELFEncoding<ELFT>();
+  EHdr->e_ident[EI_VERSION] = EV_CURRENT;
+  EHdr->e_ident[EI_OSABI] = FirstObj.getOSABI();
+  EHdr->e_type = getELFType();
+  EHdr->e_machine = FirstObj.EMachine;
+  EHdr->e_version = EV_CURRENT;
+  EHdr->e_shoff = DebugSectionHeaderOff;
+  EHdr->e_ehsize = sizeof(Elf_Ehdr);
+  EHdr->e_shentsize = sizeof(Elf_Shdr);
+  EHdr->e_shnum = DebugSections.size() + 1;
+  EHdr->e_shstrndx = DebugShStrTab->SectionIndex;
+
+  auto *SHdrs = reinterpret_cast<Elf_Shdr *>(Buf + EHdr->e_shoff);
+  for (OutputSectionBase<ELFT> *Sec : DebugSections)
+    Sec->writeHeaderTo(++SHdrs);
+}
+
+// The CRC32 in .gnu_debuglink covers the entire debug file, so it can
+// only be filled in once the debug file has all of its contents. The
+// field uses the standard CRC32 polynomial; JamCRC is the same without
+// the final bit inversion.
+template <class ELFT> void Writer<ELFT>::writeDebugLinkCrc() {
+  JamCRC Crc;
+  Crc.update(ArrayRef<char>(
+      reinterpret_cast<const char *>(DebugBuffer->getBufferStart()),
+      DebugFileSize));
+
+  GnuDebugLinkSection<ELFT> *Sec = Out<ELFT>::GnuDebugLink;
+  support::endian::write32<ELFT::TargetEndianness>(
+      Buffer->getBufferStart() + Sec->getFileOff() + Sec->getCrcOff(),
+      ~Crc.getCRC());
+}
+
 // Write section contents to a mmap'ed file.
 template <class ELFT> void Writer<ELFT>::writeSections() {
   uint8_t *Buf = Buffer->getBufferStart();
 
+  // The copy loops below read every live input section. Parsing and
+  // relocation scanning touched mostly headers and relocation records,
+  // so on a cold cache the content pages are still on disk; start
+  // readahead on all input files now so they stream in ahead of the
+  // writers instead of faulting one page at a time.
+  for (const std::unique_ptr<elf::ObjectFile<ELFT>> &F :
+       Symtab.getObjectFiles())
+    adviseBuffer(F->MB, PageAdvice::WillNeed);
+
   // PPC64 needs to process relocations in the .opd section before processing
   // relocations in code-containing sections.
   if (OutputSectionBase<ELFT> *Sec = Out<ELFT>::Opd) {
@@ -1354,9 +1732,48 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
     Sec->writeTo(Buf + Sec->getFileOff());
   }
 
-  for (OutputSectionBase<ELFT> *Sec : OutputSections)
-    if (Sec != Out<ELFT>::Opd)
-      Sec->writeTo(Buf + Sec->getFileOff());
+  // .eh_frame_hdr is a search table over the FDE list that writing
+  // .eh_frame populates, so it has to be written after all other
+  // sections and cannot join the task group below.
+  OutputSectionBase<ELFT> *EhFrameHdr = Out<ELFT>::EhFrameHdr;
+
+  // Each section occupies a disjoint range of the output buffer, so
+  // they can all be written concurrently. Big sections additionally
+  // parallelize internally over their input sections or shards. Once a
+  // section has its final contents, writeback of its file range is
+  // started so the disk catches up while other sections are still being
+  // produced instead of absorbing everything at commit time.
+  auto Write = [=](OutputSectionBase<ELFT> *Sec) {
+    Sec->writeTo(Buf + Sec->getFileOff());
+    if (Sec->getType() != SHT_NOBITS)
+      Buffer->flushRegion(Sec->getFileOff(), Sec->getSize());
+  };
+
+  // The debug file's sections occupy ranges of their own buffer, so
+  // with --split-debug-output they join the same task group and their
+  // I/O overlaps with writing the main image.
+  auto WriteDebug = [this](OutputSectionBase<ELFT> *Sec) {
+    Sec->writeTo(DebugBuffer->getBufferStart() + Sec->getFileOff());
+    DebugBuffer->flushRegion(Sec->getFileOff(), Sec->getSize());
+  };
+
+  if (Config->Threads) {
+    TaskGroup Tg;
+    for (OutputSectionBase<ELFT> *Sec : OutputSections)
+      if (Sec != Out<ELFT>::Opd && Sec != EhFrameHdr)
+        Tg.spawn([=] { Write(Sec); });
+    for (OutputSectionBase<ELFT> *Sec : DebugSections)
+      Tg.spawn([=] { WriteDebug(Sec); });
+  } else {
+    for (OutputSectionBase<ELFT> *Sec : OutputSections)
+      if (Sec != Out<ELFT>::Opd && Sec != EhFrameHdr)
+        Write(Sec);
+    for (OutputSectionBase<ELFT> *Sec : DebugSections)
+      WriteDebug(Sec);
+  }
+
+  if (EhFrameHdr)
+    Write(EhFrameHdr);
 }
 
 template <class ELFT> void Writer<ELFT>::writeBuildId() {
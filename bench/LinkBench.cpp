@@ -0,0 +1,341 @@
+//===- bench/LinkBench.cpp - Synthetic ELF link benchmark -----------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief End-to-end link benchmark on a synthesized workload, so
+/// regressions can be measured without a checked-in corpus. It
+/// generates N relocatable ELF objects with M text sections of K
+/// symbols each, R relocations per section (alternating local and
+/// cross-object targets), and optionally a mergeable string section
+/// with a configurable duplication ratio, then links them through
+/// elf::link and reports the median wall time.
+///
+/// The objects are synthesized in memory but staged to a temporary
+/// directory, since the ELF driver only accepts file paths. Timing
+/// covers the link alone, not the generation or staging.
+///
+//===----------------------------------------------------------------------===//
+
+#include "lld/Driver/Driver.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::ELF;
+
+namespace {
+
+cl::opt<unsigned> numObjects("objects", cl::desc("Number of object files"),
+                             cl::init(16));
+cl::opt<unsigned> numSections("sections",
+                              cl::desc("Text sections per object"),
+                              cl::init(8));
+cl::opt<unsigned> numSymbols("symbols",
+                             cl::desc("Defined symbols per section"),
+                             cl::init(64));
+cl::opt<unsigned> numRelocs("relocs", cl::desc("Relocations per section"),
+                            cl::init(32));
+cl::opt<unsigned> numStrings(
+    "strings", cl::desc("Mergeable strings per object (0 disables)"),
+    cl::init(0));
+cl::opt<unsigned> stringDup(
+    "string-dup",
+    cl::desc("How many copies of each unique mergeable string exist "
+             "across all objects"),
+    cl::init(4));
+cl::opt<unsigned> numIterations("iterations",
+                                cl::desc("Timed links (median reported)"),
+                                cl::init(3));
+cl::opt<bool> keepFiles("keep",
+                        cl::desc("Keep the staged objects and output"),
+                        cl::init(false));
+
+const unsigned symbolSize = 16;
+
+std::string symbolName(unsigned obj, unsigned sect, unsigned sym) {
+  return ("sym_" + Twine(obj) + "_" + Twine(sect) + "_" + Twine(sym)).str();
+}
+
+void append(std::string &out, const void *data, size_t size) {
+  out.append(reinterpret_cast<const char *>(data), size);
+}
+
+void padTo8(std::string &out) {
+  while (out.size() % 8)
+    out.push_back('\0');
+}
+
+/// Synthesizes one relocatable ELF64 x86_64 object. Structs are
+/// emitted in host byte order, which assumes a little-endian host; the
+/// benchmark is not meant to run anywhere else.
+std::string makeObject(unsigned objIndex) {
+  const unsigned M = numSections;
+  const unsigned K = numSymbols;
+  const unsigned R = numRelocs;
+  const bool haveRelocs = R != 0;
+  const bool haveStrings = numStrings != 0;
+  // Cross-object relocations target the next object, wrapping around.
+  const unsigned nextObj =
+      numObjects > 1 ? (objIndex + 1) % numObjects : objIndex;
+
+  // Section indexes.
+  const unsigned firstText = 1;
+  const unsigned firstRela = firstText + M;
+  const unsigned strSecIndex = haveRelocs ? firstRela + M : firstRela;
+  const unsigned symtabIndex = haveStrings ? strSecIndex + 1 : strSecIndex;
+  const unsigned strtabIndex = symtabIndex + 1;
+  const unsigned shstrtabIndex = strtabIndex + 1;
+  const unsigned sectionCount = shstrtabIndex + 1;
+
+  // Build the symbol table: the null symbol, every defined symbol, then
+  // any referenced symbols defined by the next object.
+  std::string strtab("\0", 1);
+  auto addName = [&](const std::string &name) -> uint32_t {
+    uint32_t offset = strtab.size();
+    strtab += name;
+    strtab += '\0';
+    return offset;
+  };
+
+  std::vector<Elf64_Sym> symbols(1);
+  memset(&symbols[0], 0, sizeof(Elf64_Sym));
+  for (unsigned m = 0; m < M; ++m) {
+    for (unsigned k = 0; k < K; ++k) {
+      Elf64_Sym sym;
+      memset(&sym, 0, sizeof(sym));
+      sym.st_name = addName(symbolName(objIndex, m, k));
+      sym.setBindingAndType(STB_GLOBAL, STT_FUNC);
+      sym.st_shndx = firstText + m;
+      sym.st_value = k * symbolSize;
+      sym.st_size = symbolSize;
+      symbols.push_back(sym);
+    }
+  }
+  auto definedIndex = [&](unsigned m, unsigned k) -> uint32_t {
+    return 1 + m * K + k;
+  };
+  std::map<std::string, uint32_t> externIndexes;
+  auto externIndex = [&](const std::string &name) -> uint32_t {
+    auto inserted = externIndexes.insert(
+        std::make_pair(name, (uint32_t)symbols.size()));
+    if (inserted.second) {
+      Elf64_Sym sym;
+      memset(&sym, 0, sizeof(sym));
+      sym.st_name = addName(name);
+      sym.setBindingAndType(STB_GLOBAL, STT_NOTYPE);
+      sym.st_shndx = SHN_UNDEF;
+      symbols.push_back(sym);
+    }
+    return inserted.first->second;
+  };
+
+  // Relocations: alternate between a local symbol and one defined by
+  // the next object, at distinct offsets inside the section.
+  std::vector<std::vector<Elf64_Rela>> relas(M);
+  for (unsigned m = 0; haveRelocs && m < M; ++m) {
+    for (unsigned r = 0; r < R; ++r) {
+      Elf64_Rela rela;
+      rela.r_offset = (r * symbolSize + 8) % (K * symbolSize);
+      uint32_t symIndex;
+      if (r % 2 == 0 || nextObj == objIndex)
+        symIndex = definedIndex(m, r % K);
+      else
+        symIndex = externIndex(symbolName(nextObj, m, r % K));
+      rela.setSymbolAndType(symIndex, R_X86_64_64);
+      rela.r_addend = 0;
+      relas[m].push_back(rela);
+    }
+  }
+
+  // Mergeable strings, duplicated across objects per -string-dup.
+  std::string mergeStrings;
+  if (haveStrings) {
+    unsigned total = numStrings * numObjects;
+    unsigned pool = std::max(1u, total / std::max(1u, stringDup.getValue()));
+    for (unsigned i = 0; i < numStrings; ++i) {
+      unsigned value = (objIndex * numStrings + i) % pool;
+      mergeStrings += ("merge_string_" + Twine(value)).str();
+      mergeStrings += '\0';
+    }
+  }
+
+  // Section names are all assigned up front because .shstrtab names
+  // itself, so its content must be complete before it is placed.
+  std::string shstrtab("\0", 1);
+  auto addSecName = [&](const std::string &name) -> uint32_t {
+    uint32_t offset = shstrtab.size();
+    shstrtab += name;
+    shstrtab += '\0';
+    return offset;
+  };
+  std::vector<uint32_t> textNames(M), relaNames(haveRelocs ? M : 0);
+  for (unsigned m = 0; m < M; ++m)
+    textNames[m] = addSecName((".text." + Twine(m)).str());
+  for (unsigned m = 0; haveRelocs && m < M; ++m)
+    relaNames[m] = addSecName((".rela.text." + Twine(m)).str());
+  uint32_t strSecName = haveStrings ? addSecName(".rodata.str1.1") : 0;
+  uint32_t symtabName = addSecName(".symtab");
+  uint32_t strtabName = addSecName(".strtab");
+  uint32_t shstrtabName = addSecName(".shstrtab");
+
+  // Emit: header, section contents, then the section header table.
+  std::string out;
+  Elf64_Ehdr ehdr;
+  memset(&ehdr, 0, sizeof(ehdr));
+  memcpy(ehdr.e_ident, ElfMagic, 4);
+  ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+  ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+  ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+  ehdr.e_type = ET_REL;
+  ehdr.e_machine = EM_X86_64;
+  ehdr.e_version = EV_CURRENT;
+  ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+  ehdr.e_shentsize = sizeof(Elf64_Shdr);
+  ehdr.e_shnum = sectionCount;
+  ehdr.e_shstrndx = shstrtabIndex;
+  append(out, &ehdr, sizeof(ehdr));
+
+  std::vector<Elf64_Shdr> shdrs(sectionCount);
+  memset(shdrs.data(), 0, sectionCount * sizeof(Elf64_Shdr));
+  auto placeSection = [&](unsigned index, uint32_t name, uint32_t type,
+                          uint64_t flags, const std::string &content,
+                          uint32_t link, uint32_t info, uint64_t align,
+                          uint64_t entsize) {
+    padTo8(out);
+    Elf64_Shdr &shdr = shdrs[index];
+    shdr.sh_name = name;
+    shdr.sh_type = type;
+    shdr.sh_flags = flags;
+    shdr.sh_offset = out.size();
+    shdr.sh_size = content.size();
+    shdr.sh_link = link;
+    shdr.sh_info = info;
+    shdr.sh_addralign = align;
+    shdr.sh_entsize = entsize;
+    out += content;
+  };
+
+  std::string textContent(K * symbolSize, '\x90'); // NOPs.
+  for (unsigned m = 0; m < M; ++m)
+    placeSection(firstText + m, textNames[m], SHT_PROGBITS,
+                 SHF_ALLOC | SHF_EXECINSTR, textContent, 0, 0, 16, 0);
+  for (unsigned m = 0; haveRelocs && m < M; ++m) {
+    std::string content(reinterpret_cast<const char *>(relas[m].data()),
+                        relas[m].size() * sizeof(Elf64_Rela));
+    placeSection(firstRela + m, relaNames[m], SHT_RELA, 0, content,
+                 symtabIndex, firstText + m, 8, sizeof(Elf64_Rela));
+  }
+  if (haveStrings)
+    placeSection(strSecIndex, strSecName, SHT_PROGBITS,
+                 SHF_ALLOC | SHF_MERGE | SHF_STRINGS, mergeStrings, 0, 0, 1,
+                 1);
+  std::string symContent(reinterpret_cast<const char *>(symbols.data()),
+                         symbols.size() * sizeof(Elf64_Sym));
+  // sh_info: index of the first non-local symbol; only the null symbol
+  // is local here.
+  placeSection(symtabIndex, symtabName, SHT_SYMTAB, 0, symContent,
+               strtabIndex, 1, 8, sizeof(Elf64_Sym));
+  placeSection(strtabIndex, strtabName, SHT_STRTAB, 0, strtab, 0, 0, 1, 0);
+  placeSection(shstrtabIndex, shstrtabName, SHT_STRTAB, 0, shstrtab, 0, 0, 1,
+               0);
+
+  padTo8(out);
+  reinterpret_cast<Elf64_Ehdr *>(&out[0])->e_shoff = out.size();
+  append(out, shdrs.data(), sectionCount * sizeof(Elf64_Shdr));
+  return out;
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  cl::ParseCommandLineOptions(argc, argv, "lld synthetic link benchmark\n");
+
+  SmallString<128> dir;
+  if (std::error_code ec =
+          sys::fs::createUniqueDirectory("lld-link-bench", dir)) {
+    errs() << "cannot create temporary directory: " << ec.message() << "\n";
+    return 1;
+  }
+
+  std::vector<std::string> objPaths;
+  uint64_t totalBytes = 0;
+  for (unsigned i = 0; i < numObjects; ++i) {
+    std::string object = makeObject(i);
+    totalBytes += object.size();
+    SmallString<128> path(dir);
+    sys::path::append(path, ("obj" + Twine(i) + ".o").str());
+    std::error_code ec;
+    raw_fd_ostream os(path, ec, sys::fs::F_None);
+    if (ec) {
+      errs() << "cannot write " << path << ": " << ec.message() << "\n";
+      return 1;
+    }
+    os << object;
+    objPaths.push_back(path.str());
+  }
+
+  SmallString<128> outPath(dir);
+  sys::path::append(outPath, "a.out");
+  std::vector<const char *> args;
+  args.push_back("ld.lld");
+  args.push_back("-e");
+  std::string entry = symbolName(0, 0, 0);
+  args.push_back(entry.c_str());
+  args.push_back("-o");
+  args.push_back(outPath.c_str());
+  for (const std::string &path : objPaths)
+    args.push_back(path.c_str());
+
+  outs() << llvm::format(
+      "workload: %u objects x %u sections x %u symbols x %u relocs"
+      ", %u strings/object (%llu KiB of input)\n",
+      (unsigned)numObjects, (unsigned)numSections, (unsigned)numSymbols,
+      (unsigned)numRelocs, (unsigned)numStrings,
+      (unsigned long long)(totalBytes / 1024));
+
+  std::vector<double> millis;
+  bool ok = true;
+  for (unsigned i = 0; i < numIterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    ok = lld::elf::link(args);
+    auto end = std::chrono::steady_clock::now();
+    if (!ok)
+      break;
+    millis.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  if (ok) {
+    std::sort(millis.begin(), millis.end());
+    outs() << llvm::format("elf::link %39.3f ms   (median of %u)\n",
+                           millis[millis.size() / 2],
+                           (unsigned)numIterations);
+  } else {
+    errs() << "link failed\n";
+  }
+
+  if (!keepFiles) {
+    for (const std::string &path : objPaths)
+      sys::fs::remove(path);
+    sys::fs::remove(outPath);
+    sys::fs::remove(dir);
+  }
+  return ok ? 0 : 1;
+}
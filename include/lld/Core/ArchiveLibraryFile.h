@@ -11,6 +11,7 @@
 #define LLD_CORE_ARCHIVE_LIBRARY_FILE_H
 
 #include "lld/Core/File.h"
+#include "lld/Core/Parallel.h"
 #include <set>
 
 namespace lld {
@@ -34,6 +35,14 @@ public:
   /// specified name and return the File object for that member, or nullptr.
   virtual File *find(StringRef name) = 0;
 
+  /// Instantiate in the background the member that would satisfy
+  /// \p symbolName, so that a later find() for the same name does not
+  /// have to parse it on the calling thread. Whether the member
+  /// actually joins the link is still decided by find(); preloading a
+  /// member that turns out to be unneeded has no effect. The default
+  /// implementation does nothing.
+  virtual void preload(TaskGroup &group, StringRef symbolName) {}
+
   virtual std::error_code
   parseAllMembers(std::vector<std::unique_ptr<File>> &result) = 0;
 
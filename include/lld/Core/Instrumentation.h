@@ -16,6 +16,7 @@
 #define LLD_CORE_INSTRUMENTATION_H
 
 #include "llvm/Support/Compiler.h"
+#include <cstdint>
 #include <utility>
 
 #ifdef LLD_HAS_VTUNE
@@ -101,25 +102,78 @@ public:
   }
 };
 #else
+/// Built-in backend used when no VTune is available. Tasks are
+/// recorded into per-thread buffers and written out as
+/// chrome://tracing JSON at process exit when the LLD_TRACE
+/// environment variable names an output file. When the variable is
+/// unset, a task costs one predicted branch, so the annotations can
+/// stay on in production builds.
+namespace trace {
+/// \brief Returns true if LLD_TRACE is set.
+bool enabled();
+
+/// \brief Microseconds since the trace epoch.
+uint64_t now();
+
+/// \brief Records a completed task. \p name must outlive the process
+///   trace dump; in practice it is a string literal.
+void record(const char *name, uint64_t startUs, uint64_t durUs);
+} // end namespace trace.
+
 class Domain {
 public:
   Domain(const char *name) {}
 };
 
 class StringHandle {
+  const char *_name;
+
 public:
-  StringHandle(const char *name) {}
+  StringHandle(const char *name) : _name(name) {}
+
+  const char *name() const { return _name; }
 };
 
 class ScopedTask {
+  const char *_name;
+  uint64_t _start = 0;
+
+  ScopedTask(const ScopedTask &) = delete;
+  ScopedTask &operator=(const ScopedTask &) = delete;
+
 public:
-  ScopedTask(const Domain &d, const StringHandle &s) {}
-  void end() {}
+  ScopedTask(const Domain &d, const StringHandle &s)
+      : _name(trace::enabled() ? s.name() : nullptr) {
+    if (_name)
+      _start = trace::now();
+  }
+
+  ScopedTask(ScopedTask &&other) : _name(nullptr) {
+    *this = std::move(other);
+  }
+
+  ScopedTask &operator=(ScopedTask &&other) {
+    _name = other._name;
+    _start = other._start;
+    other._name = nullptr;
+    return *this;
+  }
+
+  void end() {
+    if (_name)
+      trace::record(_name, _start, trace::now() - _start);
+    _name = nullptr;
+  }
+
+  ~ScopedTask() { end(); }
 };
 
 class Marker {
 public:
-  Marker(const Domain &d, const StringHandle &s) {}
+  Marker(const Domain &d, const StringHandle &s) {
+    if (trace::enabled())
+      trace::record(s.name(), trace::now(), 0);
+  }
 };
 #endif
 
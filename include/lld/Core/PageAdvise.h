@@ -0,0 +1,69 @@
+//===- lld/Core/PageAdvise.h - Paging hints for mmapped inputs --*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Input files are mmapped, so with a cold cache the first touch
+/// of every page is a synchronous fault. These helpers let readers and
+/// writers tell the kernel what they are about to do with a buffer, so
+/// readahead runs ahead of the parse or copy instead of one fault at a
+/// time.
+///
+/// All of this is advisory. On platforms without madvise the calls
+/// compile to nothing, and addresses are rounded to page boundaries as
+/// the kernel requires. Note there is deliberately no "done with this
+/// range" advice: MemoryBuffer backs small files with heap memory
+/// rather than a mapping, the two cases cannot be told apart through
+/// MemoryBufferRef, and MADV_DONTNEED destroys the contents of
+/// anonymous memory.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_CORE_PAGE_ADVISE_H
+#define LLD_CORE_PAGE_ADVISE_H
+
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace lld {
+
+enum class PageAdvice {
+  WillNeed,  ///< The range is needed soon; start readahead now.
+  Sequential ///< The range will be read front to back; read ahead
+             ///< aggressively and reclaim behind the reader.
+};
+
+/// Hints to the kernel how the given range is about to be accessed.
+inline void advisePages(const void *Data, size_t Size, PageAdvice Advice) {
+#ifdef __linux__
+  uintptr_t PageMask = (uintptr_t)sysconf(_SC_PAGESIZE) - 1;
+  uintptr_t Begin = (uintptr_t)Data & ~PageMask;
+  uintptr_t End = (uintptr_t)Data + Size;
+  if (End <= Begin)
+    return;
+  int A = Advice == PageAdvice::WillNeed ? MADV_WILLNEED : MADV_SEQUENTIAL;
+  madvise((void *)Begin, End - Begin, A);
+#else
+  (void)Data;
+  (void)Size;
+  (void)Advice;
+#endif
+}
+
+inline void adviseBuffer(llvm::MemoryBufferRef MB, PageAdvice Advice) {
+  advisePages(MB.getBufferStart(), MB.getBufferSize(), Advice);
+}
+
+} // end namespace lld
+
+#endif // LLD_CORE_PAGE_ADVISE_H
@@ -6,6 +6,22 @@
 // License. See LICENSE.TXT for details.
 //
 //===----------------------------------------------------------------------===//
+//
+// Determinism contract: the algorithms in this header give the same
+// result at any thread count, including one. parallel_for_each and
+// parallel_transform apply a function to fixed elements (and write to
+// fixed output slots), so as long as the function itself does not
+// depend on element processing order, neither does the outcome.
+// parallel_transform_reduce combines partial results in a fixed tree
+// order, parallel_sort produces the ordering of std::sort, and
+// parallel_sort_by_key is stable. Only the raw task primitives
+// (TaskGroup, TaskGraph, Channel) expose scheduling order; code that
+// needs reproducible output must not let results depend on the order
+// unrelated tasks finish in. Linker output is expected to be
+// byte-identical with and without threads, and any divergence is a
+// bug.
+//
+//===----------------------------------------------------------------------===//
 
 #ifndef LLD_CORE_PARALLEL_H
 #define LLD_CORE_PARALLEL_H
@@ -18,14 +34,20 @@
 #include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
-#include <stack>
+#include <vector>
 
 #if defined(_MSC_VER) && LLVM_ENABLE_THREADS
 #include <concrt.h>
 #include <ppl.h>
 #endif
 
+#if defined(__linux__) && LLVM_ENABLE_THREADS
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace lld {
 /// \brief Allows one or more threads to wait on a potentially unknown number of
 ///   events.
@@ -34,8 +56,14 @@ namespace lld {
 /// All calls to sync() will block while the count is not 0.
 ///
 /// Calling dec() on a Latch with a count of 0 has undefined behaivor.
+///
+/// The count is a plain atomic, so inc() and dec() are a single atomic
+/// operation each; the mutex and condition variable are touched only
+/// by the final dec() and by a sync() that has to park. Per-task
+/// overhead therefore stays constant no matter how short the tasks
+/// are.
 class Latch {
-  uint32_t _count;
+  std::atomic<uint32_t> _count;
   mutable std::mutex _condMut;
   mutable std::condition_variable _cond;
 
@@ -43,22 +71,32 @@ public:
   explicit Latch(uint32_t count = 0) : _count(count) {}
   ~Latch() { sync(); }
 
-  void inc() {
-    std::unique_lock<std::mutex> lock(_condMut);
-    ++_count;
-  }
+  void inc() { _count.fetch_add(1, std::memory_order_relaxed); }
 
   void dec() {
-    std::unique_lock<std::mutex> lock(_condMut);
-    if (--_count == 0)
+    // The release pairs with the acquire in poll() so that everything
+    // the finishing task wrote is visible to whoever observes zero.
+    if (_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      // Taking the mutex before notifying closes the window in which
+      // a waiter has seen a non-zero count but has not yet parked.
+      std::unique_lock<std::mutex> lock(_condMut);
+      lock.unlock();
       _cond.notify_all();
+    }
   }
 
   void sync() const {
+    // Spin briefly; the last few tasks usually finish within the spin
+    // window and then no thread pays for a sleep/wakeup cycle.
+    for (int i = 0; i < 1024; ++i)
+      if (poll())
+        return;
     std::unique_lock<std::mutex> lock(_condMut);
-    _cond.wait(lock, [&] {
-      return _count == 0;
-    });
+    _cond.wait(lock, [&] { return poll(); });
+  }
+
+  bool poll() const {
+    return _count.load(std::memory_order_acquire) == 0;
   }
 };
 
@@ -70,6 +108,13 @@ class Executor {
 public:
   virtual ~Executor() = default;
   virtual void add(std::function<void()> func) = 0;
+
+  /// \brief Run one queued task on the calling thread, if any is ready.
+  ///
+  /// Returns false if no task was available. This lets a thread that is
+  /// waiting on a nested TaskGroup keep making progress instead of
+  /// blocking, which would deadlock the pool if every thread did it.
+  virtual bool runOne() { return false; }
 };
 
 #if !defined(LLVM_ENABLE_THREADS) || LLVM_ENABLE_THREADS == 0
@@ -111,24 +156,45 @@ inline Executor *getDefaultExecutor() {
   return &exec;
 }
 #else
+/// \brief Number of threads the default executor starts. The executor is
+///   created lazily on first use, so the count can be overridden with
+///   setExecutorThreadCount until the first parallel operation runs.
+inline unsigned &executorThreadCount() {
+  static unsigned _count = std::thread::hardware_concurrency();
+  return _count;
+}
+
+/// \brief Whether workers are pinned to CPUs. Like the thread count,
+///   read once when the pool starts.
+inline bool &executorPinThreads() {
+  static bool _pin = false;
+  return _pin;
+}
+
 /// \brief An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
+///   with one task deque per worker.
+///
+/// A worker pushes and pops tasks at the back of its own deque, so a
+/// task's children run on the spawning thread in LIFO order while their
+/// data is still warm in cache. A worker that runs dry steals from the
+/// front of a victim's deque, taking the oldest task, which for
+/// divide-and-conquer spawns like parallel_sort is the largest subtree.
+/// The per-deque mutexes are contended only during steals, so
+/// fine-grained spawns no longer serialize on one shared lock.
 class ThreadPoolExecutor : public Executor {
+  struct Deque {
+    std::mutex _mutex;
+    std::deque<std::function<void()>> _tasks;
+  };
+
 public:
-  explicit ThreadPoolExecutor(unsigned threadCount =
-                                  std::thread::hardware_concurrency())
-      : _stop(false), _done(threadCount) {
-    // Spawn all but one of the threads in another thread as spawning threads
-    // can take a while.
-    std::thread([&, threadCount] {
-      for (std::size_t i = 1; i < threadCount; ++i) {
-        std::thread([=] {
-          work();
-        }).detach();
-      }
-      work();
-    }).detach();
-  }
+  /// Workers are not started here. Each is spawned on demand, when a
+  /// task is queued while every running worker is busy, so a link that
+  /// spawns only a handful of tasks starts only a handful of threads
+  /// and one that never goes parallel starts none.
+  explicit ThreadPoolExecutor(unsigned threadCount = executorThreadCount())
+      : _stop(false), _numTasks(0), _nextDeque(0), _numThreads(0),
+        _numSleeping(0), _maxThreads(threadCount), _deques(threadCount) {}
 
   ~ThreadPoolExecutor() override {
     std::unique_lock<std::mutex> lock(_mutex);
@@ -139,33 +205,136 @@ public:
   }
 
   void add(std::function<void()> f) override {
-    std::unique_lock<std::mutex> lock(_mutex);
-    _workStack.push(f);
-    lock.unlock();
+    // Push to the calling worker's own deque. Tasks submitted from
+    // outside the pool are distributed round-robin.
+    unsigned index = currentIndex();
+    if (index == ~0u)
+      index = _nextDeque++ % _deques.size();
+    Deque &deque = _deques[index];
+    {
+      std::lock_guard<std::mutex> lock(deque._mutex);
+      deque._tasks.push_back(std::move(f));
+    }
+    {
+      // Update the counter under _mutex so that a worker cannot check
+      // it and go to sleep between the update and the notify below.
+      std::lock_guard<std::mutex> lock(_mutex);
+      ++_numTasks;
+    }
     _cond.notify_one();
+    growIfStarved();
+  }
+
+  bool runOne() override {
+    std::function<void()> task;
+    if (!pop(task))
+      return false;
+    task();
+    return true;
   }
 
 private:
-  void work() {
+  /// Start another worker if a task is waiting while no worker is
+  /// idle, up to the configured maximum. Racing callers are resolved
+  /// by the compare-exchange on the thread count; starting one worker
+  /// too many (a worker was about to sleep but had not yet counted
+  /// itself idle) is harmless since the count is still bounded.
+  void growIfStarved() {
+    unsigned count = _numThreads.load(std::memory_order_relaxed);
+    while (count < _maxThreads &&
+           _numSleeping.load(std::memory_order_relaxed) == 0 &&
+           _numTasks.load(std::memory_order_relaxed) != 0) {
+      if (_numThreads.compare_exchange_weak(count, count + 1)) {
+        _done.inc();
+        std::thread([this, count] { work(count); }).detach();
+        return;
+      }
+    }
+  }
+
+  /// Index of the deque owned by the calling thread, or ~0u if the
+  /// caller is not a pool worker.
+  static unsigned &currentIndex() {
+    static thread_local unsigned _index = ~0u;
+    return _index;
+  }
+
+  bool popBack(Deque &deque, std::function<void()> &task) {
+    std::lock_guard<std::mutex> lock(deque._mutex);
+    if (deque._tasks.empty())
+      return false;
+    task = std::move(deque._tasks.back());
+    deque._tasks.pop_back();
+    --_numTasks;
+    return true;
+  }
+
+  bool popFront(Deque &deque, std::function<void()> &task) {
+    std::lock_guard<std::mutex> lock(deque._mutex);
+    if (deque._tasks.empty())
+      return false;
+    task = std::move(deque._tasks.front());
+    deque._tasks.pop_front();
+    --_numTasks;
+    return true;
+  }
+
+  /// Take a task from the caller's own deque, or failing that steal
+  /// one from another deque.
+  bool pop(std::function<void()> &task) {
+    unsigned self = currentIndex();
+    if (self != ~0u && popBack(_deques[self], task))
+      return true;
+    unsigned n = _deques.size();
+    unsigned start = (self == ~0u) ? 0 : self + 1;
+    for (unsigned i = 0; i != n; ++i)
+      if (popFront(_deques[(start + i) % n], task))
+        return true;
+    return false;
+  }
+
+  void work(unsigned index) {
+    currentIndex() = index;
+    // Pinning worker i to CPU i stops the scheduler from migrating
+    // workers between sockets, so the pages a worker first touches
+    // (and its deque) stay on the node it keeps running on. Only
+    // implemented where the affinity API is available.
+#if defined(__linux__)
+    if (executorPinThreads()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(index % std::thread::hardware_concurrency(), &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
     while (true) {
+      std::function<void()> task;
+      if (pop(task)) {
+        task();
+        continue;
+      }
       std::unique_lock<std::mutex> lock(_mutex);
+      ++_numSleeping;
       _cond.wait(lock, [&] {
-        return _stop || !_workStack.empty();
+        return _stop || _numTasks.load(std::memory_order_relaxed) != 0;
       });
+      --_numSleeping;
       if (_stop)
         break;
-      auto task = _workStack.top();
-      _workStack.pop();
-      lock.unlock();
-      task();
     }
     _done.dec();
   }
 
   std::atomic<bool> _stop;
-  std::stack<std::function<void()>> _workStack;
+  std::atomic<int> _numTasks;
+  std::atomic<unsigned> _nextDeque;
+  std::atomic<unsigned> _numThreads;
+  std::atomic<unsigned> _numSleeping;
+  unsigned _maxThreads;
+  std::vector<Deque> _deques;
   std::mutex _mutex;
   std::condition_variable _cond;
+  // Counts started workers only; incremented as each is spawned.
   Latch _done;
 };
 
@@ -177,12 +346,40 @@ inline Executor *getDefaultExecutor() {
 
 }  // namespace internal
 
+/// \brief Sets how many worker threads the process-wide executor starts.
+///
+/// Must be called before the first parallel operation; the pool is
+/// created lazily on first use and later calls have no effect. A no-op
+/// for executors that do not own their threads.
+#if defined(LLVM_ENABLE_THREADS) && LLVM_ENABLE_THREADS != 0 &&                \
+    !defined(_MSC_VER)
+inline void setExecutorThreadCount(unsigned count) {
+  internal::executorThreadCount() = count;
+}
+
+/// \brief Requests that worker threads be pinned one-per-CPU.
+///
+/// Pinning avoids cross-socket migration on multi-node machines at the
+/// cost of sharing CPUs poorly with other processes, so it is off by
+/// default. Must be called before the first parallel operation, like
+/// setExecutorThreadCount. A no-op on platforms without an affinity
+/// API and for executors that do not own their threads.
+inline void setExecutorPinThreads(bool pin) {
+  internal::executorPinThreads() = pin;
+}
+#else
+inline void setExecutorThreadCount(unsigned) {}
+inline void setExecutorPinThreads(bool) {}
+#endif
+
 /// \brief Allows launching a number of tasks and waiting for them to finish
 ///   either explicitly via sync() or implicitly on destruction.
 class TaskGroup {
   Latch _latch;
 
 public:
+  ~TaskGroup() { sync(); }
+
   void spawn(std::function<void()> f) {
     _latch.inc();
     internal::getDefaultExecutor()->add([&, f] {
@@ -191,7 +388,216 @@ public:
     });
   }
 
-  void sync() const { _latch.sync(); }
+  void sync() const {
+    // sync() may run on a pool thread when TaskGroups are nested, so
+    // drain queued tasks while waiting. We block on the latch only once
+    // the queue is empty; the remaining tasks are then running on other
+    // threads, which can always drain their own spawned work, so at
+    // least one thread makes progress.
+    while (!_latch.poll())
+      if (!internal::getDefaultExecutor()->runOne())
+        break;
+    _latch.sync();
+  }
+};
+
+/// \brief A set of tasks with declared dependencies, run on the
+///   default executor.
+///
+/// addTask registers a closure and returns its id; addEdge(from, to)
+/// declares that \p to may only start after \p from has finished.
+/// run() schedules all ready tasks, makes each completing task release
+/// its successors, and returns when the whole graph has executed.
+/// Unlike a sequence of TaskGroup barriers, independent chains
+/// pipeline: a successor starts the moment its own predecessors are
+/// done, not when the entire preceding phase is. The graph must be
+/// acyclic, and all edges must be added before run().
+class TaskGraph {
+  struct Node {
+    std::function<void()> _func;
+    std::vector<size_t> _successors;
+    std::atomic<unsigned> _pending;
+  };
+
+public:
+  typedef size_t TaskId;
+
+  TaskId addTask(std::function<void()> f) {
+    _nodes.emplace_back();
+    _nodes.back()._func = std::move(f);
+    _nodes.back()._pending = 0;
+    return _nodes.size() - 1;
+  }
+
+  void addEdge(TaskId from, TaskId to) {
+    _nodes[from]._successors.push_back(to);
+    ++_nodes[to]._pending;
+  }
+
+  void run() {
+    TaskGroup tg;
+    for (size_t i = 0, e = _nodes.size(); i != e; ++i)
+      if (_nodes[i]._pending == 0)
+        schedule(tg, i);
+    // ~TaskGroup waits for the tasks, including successors they spawn.
+  }
+
+private:
+  void schedule(TaskGroup &tg, size_t i) {
+    tg.spawn([&tg, this, i] {
+      Node &n = _nodes[i];
+      n._func();
+      // The atomic decrement orders the successor after everything
+      // its predecessors wrote; the last finishing predecessor
+      // releases the task.
+      for (size_t s : n._successors)
+        if (--_nodes[s]._pending == 0)
+          schedule(tg, s);
+    });
+  }
+
+  // A deque so that growth does not require Node (and its atomic)
+  // to be movable.
+  std::deque<Node> _nodes;
+};
+
+/// \brief A fixed-capacity multi-producer/multi-consumer channel.
+///
+/// push() blocks while the channel is full and pop() blocks while it
+/// is empty, so a chain of stages connected by channels gets
+/// backpressure for free: a fast producer fills the ring and then
+/// runs at the consumer's pace instead of buffering the whole stream.
+/// close() marks the end of the stream; items already queued can
+/// still be popped, after which pop() returns false. Like Latch,
+/// parking uses a mutex and condition variables, which the fast path
+/// touches only when the ring really is full or empty. T must be
+/// default constructible.
+template <class T> class Channel {
+public:
+  explicit Channel(size_t capacity) : _buffer(capacity) {}
+
+  /// \brief Enqueues an item, blocking while the channel is full.
+  /// Must not be called after close().
+  void push(T item) {
+    std::unique_lock<std::mutex> lock(_mutex);
+#if !defined(LLVM_ENABLE_THREADS) || LLVM_ENABLE_THREADS == 0
+    // With no worker threads, pipeline stages run back to back on one
+    // thread and nothing ever drains a full ring, so blocking here
+    // would deadlock. Grow instead; the bound only matters when
+    // stages actually overlap.
+    if (_size == _buffer.size()) {
+      std::vector<T> bigger(_buffer.size() * 2);
+      for (size_t i = 0; i != _size; ++i)
+        bigger[i] = std::move(_buffer[(_head + i) % _buffer.size()]);
+      _buffer.swap(bigger);
+      _head = 0;
+    }
+#endif
+    _notFull.wait(lock, [&] { return _size != _buffer.size(); });
+    _buffer[(_head + _size) % _buffer.size()] = std::move(item);
+    ++_size;
+    lock.unlock();
+    _notEmpty.notify_one();
+  }
+
+  /// \brief Dequeues an item, blocking while the channel is empty.
+  /// Returns false once the channel is closed and drained.
+  bool pop(T &item) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _notEmpty.wait(lock, [&] { return _size != 0 || _closed; });
+    if (_size == 0)
+      return false;
+    item = std::move(_buffer[_head]);
+    _head = (_head + 1) % _buffer.size();
+    --_size;
+    lock.unlock();
+    _notFull.notify_one();
+    return true;
+  }
+
+  /// \brief Marks the end of the stream and wakes blocked consumers.
+  void close() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _closed = true;
+    lock.unlock();
+    _notEmpty.notify_all();
+  }
+
+private:
+  std::vector<T> _buffer;
+  size_t _head = 0;
+  size_t _size = 0;
+  bool _closed = false;
+  std::mutex _mutex;
+  std::condition_variable _notFull;
+  std::condition_variable _notEmpty;
+};
+
+/// \brief Wires a chain of producer/consumer stages with bounded
+///   channels between them.
+///
+/// addStage appends a stage run by \p workers parallel tasks. A stage
+/// receives its input and output channels as pointers; the first
+/// stage's input and the last stage's output are null. run() spawns
+/// every worker on the default executor and returns when all stages
+/// have finished. A stage's output channel is closed when the last of
+/// its workers returns, which lets the next stage drain the channel
+/// and observe end of stream.
+///
+/// A worker occupies an executor thread for its whole run, including
+/// while it blocks on a channel, so the total number of workers in a
+/// pipeline must not exceed the executor's thread count or the
+/// pipeline can deadlock.
+template <class T> class Pipeline {
+  struct Stage {
+    std::function<void(Channel<T> *in, Channel<T> *out)> _func;
+    unsigned _workers;
+  };
+
+public:
+  /// \p capacity bounds each channel between adjacent stages.
+  explicit Pipeline(size_t capacity = 16) : _capacity(capacity) {}
+
+  void addStage(std::function<void(Channel<T> *in, Channel<T> *out)> f,
+                unsigned workers = 1) {
+    Stage s;
+    s._func = std::move(f);
+    s._workers = workers;
+    _stages.push_back(std::move(s));
+  }
+
+  void run() {
+    size_t numStages = _stages.size();
+    if (numStages == 0)
+      return;
+    std::deque<Channel<T>> channels;
+    for (size_t i = 0; i + 1 < numStages; ++i)
+      channels.emplace_back(_capacity);
+    // Number of workers of each stage still running; the last one out
+    // closes the stage's output channel.
+    std::deque<std::atomic<unsigned>> running;
+    for (size_t i = 0; i != numStages; ++i)
+      running.emplace_back(_stages[i]._workers);
+
+    TaskGroup tg;
+    for (size_t i = 0; i != numStages; ++i) {
+      Channel<T> *in = i == 0 ? nullptr : &channels[i - 1];
+      Channel<T> *out = i + 1 == numStages ? nullptr : &channels[i];
+      std::atomic<unsigned> *left = &running[i];
+      Stage *stage = &_stages[i];
+      for (unsigned w = 0; w != stage->_workers; ++w)
+        tg.spawn([stage, in, out, left] {
+          stage->_func(in, out);
+          if (out && --*left == 0)
+            out->close();
+        });
+    }
+    // ~TaskGroup waits for every worker.
+  }
+
+private:
+  size_t _capacity;
+  std::vector<Stage> _stages;
 };
 
 #if !defined(LLVM_ENABLE_THREADS) || LLVM_ENABLE_THREADS == 0
@@ -259,6 +665,12 @@ void parallel_sort(
     RandomAccessIterator start, RandomAccessIterator end,
     const Comp &comp = std::less<
         typename std::iterator_traits<RandomAccessIterator>::value_type>()) {
+  // Small ranges sort inline without touching the executor, so they
+  // do not start the worker pool.
+  if (std::distance(start, end) < detail::minParallelSize) {
+    std::sort(start, end, comp);
+    return;
+  }
   TaskGroup tg;
   detail::parallel_quick_sort(start, end, comp, tg,
                               llvm::Log2_64(std::distance(start, end)) + 1);
@@ -269,29 +681,293 @@ template <class T> void parallel_sort(T *start, T *end) {
   parallel_sort(start, end, std::less<T>());
 }
 
+#if !defined(LLVM_ENABLE_THREADS) || LLVM_ENABLE_THREADS == 0
+template <class RandomAccessIterator, class KeyFn>
+void parallel_sort_by_key(RandomAccessIterator start, RandomAccessIterator end,
+                          KeyFn key) {
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type T;
+  std::stable_sort(start, end,
+                   [&](const T &a, const T &b) { return key(a) < key(b); });
+}
+#elif defined(_MSC_VER)
+// ConcRT ships a parallel radix sort keyed by a projection.
+template <class RandomAccessIterator, class KeyFn>
+void parallel_sort_by_key(RandomAccessIterator start, RandomAccessIterator end,
+                          KeyFn key) {
+  concurrency::parallel_radixsort(start, end, key);
+}
+#else
+namespace detail {
+/// \brief One stable counting-sort pass over byte \p shift of the key.
+///
+/// Elements are moved from src to dst. Slices count their bytes in
+/// parallel, a serial prefix sum over the small count table assigns
+/// each slice its output positions, and the slices then scatter in
+/// parallel into disjoint regions. Summing byte-major and slice-minor
+/// keeps the pass stable, so the overall LSD sort is stable too.
+template <class SrcIt, class DstIt, class KeyFn>
+void radix_pass(SrcIt src, size_t n, DstIt dst, KeyFn &key, unsigned shift,
+                size_t numSlices) {
+  std::vector<size_t> counts(numSlices * 256, 0);
+  {
+    TaskGroup tg;
+    for (size_t s = 0; s != numSlices; ++s)
+      tg.spawn([&, s] {
+        size_t *c = &counts[s * 256];
+        size_t e = n * (s + 1) / numSlices;
+        for (size_t i = n * s / numSlices; i != e; ++i)
+          ++c[(key(src[i]) >> shift) & 0xff];
+      });
+  }
+  size_t total = 0;
+  for (unsigned b = 0; b != 256; ++b)
+    for (size_t s = 0; s != numSlices; ++s) {
+      size_t c = counts[s * 256 + b];
+      counts[s * 256 + b] = total;
+      total += c;
+    }
+  {
+    TaskGroup tg;
+    for (size_t s = 0; s != numSlices; ++s)
+      tg.spawn([&, s] {
+        size_t *off = &counts[s * 256];
+        size_t e = n * (s + 1) / numSlices;
+        for (size_t i = n * s / numSlices; i != e; ++i)
+          dst[off[(key(src[i]) >> shift) & 0xff]++] = std::move(src[i]);
+      });
+  }
+}
+} // namespace detail
+
+/// \brief Stable parallel sort by an unsigned integer key.
+///
+/// \p key is applied to each element and the range is sorted by the
+/// resulting value with an LSD radix sort, so the run time does not
+/// depend on the key distribution; duplicate-heavy inputs, which make
+/// comparison sorts degrade, cost the same as unique keys. Bytes that
+/// are identical across all keys are skipped entirely, so
+/// low-cardinality keys need only a pass or two. Equal keys keep
+/// their relative order.
+template <class RandomAccessIterator, class KeyFn>
+void parallel_sort_by_key(RandomAccessIterator start, RandomAccessIterator end,
+                          KeyFn key) {
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type T;
+  typedef decltype(key(*start)) K;
+  size_t n = std::distance(start, end);
+  if (n < (size_t)detail::minParallelSize) {
+    std::stable_sort(start, end,
+                     [&](const T &a, const T &b) { return key(a) < key(b); });
+    return;
+  }
+
+  // A byte position where all keys agree needs no pass. OR and AND
+  // aggregates differ in exactly the bit positions where keys differ.
+  K orKeys = 0, andKeys = ~K(0);
+  for (RandomAccessIterator i = start; i != end; ++i) {
+    K k = key(*i);
+    orKeys |= k;
+    andKeys &= k;
+  }
+
+  std::vector<T> buf(n);
+  size_t numSlices = std::min<size_t>(1 + n / detail::minParallelSize, 64);
+  bool flipped = false;
+  for (unsigned shift = 0; shift != 8 * sizeof(K); shift += 8) {
+    if (((orKeys >> shift) & 0xff) == ((andKeys >> shift) & 0xff))
+      continue;
+    if (!flipped)
+      detail::radix_pass(start, n, buf.begin(), key, shift, numSlices);
+    else
+      detail::radix_pass(buf.begin(), n, start, key, shift, numSlices);
+    flipped = !flipped;
+  }
+  if (flipped) {
+    TaskGroup tg;
+    for (size_t s = 0; s != numSlices; ++s)
+      tg.spawn([&, s] {
+        size_t e = n * (s + 1) / numSlices;
+        for (size_t i = n * s / numSlices; i != e; ++i)
+          start[i] = std::move(buf[i]);
+      });
+  }
+}
+#endif
+
 #if !defined(LLVM_ENABLE_THREADS) || LLVM_ENABLE_THREADS == 0
 template <class Iterator, class Func>
-void parallel_for_each(Iterator begin, Iterator end, Func func) {
+void parallel_for_each(Iterator begin, Iterator end, Func func,
+                       ptrdiff_t grain) {
   std::for_each(begin, end, func);
 }
 #elif defined(_MSC_VER)
-// Use ppl parallel_for_each on Windows.
+// Use ppl parallel_for_each on Windows. ConcRT does its own chunking,
+// so the grain size is only a hint we do not need to forward.
 template <class Iterator, class Func>
-void parallel_for_each(Iterator begin, Iterator end, Func func) {
+void parallel_for_each(Iterator begin, Iterator end, Func func,
+                       ptrdiff_t grain) {
   concurrency::parallel_for_each(begin, end, func);
 }
 #else
+namespace detail {
+/// \brief Recursively splits [begin, end) in half until blocks are at
+/// most \p grain elements long, then applies func sequentially.
+///
+/// Each split spawns the right half and keeps the left, so
+/// decomposition is steal-driven: a spawned block is divided further
+/// only when a worker actually picks it up, and a range that nobody
+/// steals is run by the spawning thread without being cut into more
+/// tasks than there are idle workers.
+template <class Iterator, class Func>
+void parallel_for_each_split(Iterator begin, Iterator end, Func &func,
+                             TaskGroup &tg, ptrdiff_t grain) {
+  while (std::distance(begin, end) > grain) {
+    Iterator mid = begin + std::distance(begin, end) / 2;
+    tg.spawn([=, &func, &tg] {
+      parallel_for_each_split(mid, end, func, tg, grain);
+    });
+    end = mid;
+  }
+  std::for_each(begin, end, func);
+}
+} // namespace detail
+
+/// \brief Applies func to each element in [begin, end) in parallel.
+///
+/// \p grain is the largest number of elements one task processes
+/// sequentially. Pass a small grain when each element is expensive
+/// (writing out a section, parsing a file) and a large one for cheap
+/// per-element work, where task overhead would otherwise dominate.
+template <class Iterator, class Func>
+void parallel_for_each(Iterator begin, Iterator end, Func func,
+                       ptrdiff_t grain) {
+  // A range that fits in one block runs inline without touching the
+  // executor, so it does not start the worker pool.
+  if (std::distance(begin, end) <= grain) {
+    std::for_each(begin, end, func);
+    return;
+  }
+  TaskGroup tg;
+  detail::parallel_for_each_split(begin, end, func, tg, grain);
+}
+#endif
+
 template <class Iterator, class Func>
 void parallel_for_each(Iterator begin, Iterator end, Func func) {
+  parallel_for_each(begin, end, func, 1024);
+}
+
+#if !defined(LLVM_ENABLE_THREADS) || LLVM_ENABLE_THREADS == 0
+template <class Iterator, class OutIterator, class Func>
+void parallel_transform(Iterator begin, Iterator end, OutIterator out,
+                        Func func, ptrdiff_t grain) {
+  std::transform(begin, end, out, func);
+}
+
+template <class Iterator, class T, class Transform, class Combine>
+T parallel_transform_reduce(Iterator begin, Iterator end, T identity,
+                            Transform transform, Combine combine,
+                            ptrdiff_t grain) {
+  T result = std::move(identity);
+  for (; begin != end; ++begin)
+    result = combine(std::move(result), transform(*begin));
+  return result;
+}
+#else
+namespace detail {
+/// \brief Like parallel_for_each_split, but each block writes its
+/// results to the matching offset of the output range.
+template <class Iterator, class OutIterator, class Func>
+void parallel_transform_split(Iterator begin, Iterator end, OutIterator out,
+                              Func &func, TaskGroup &tg, ptrdiff_t grain) {
+  while (std::distance(begin, end) > grain) {
+    Iterator mid = begin + std::distance(begin, end) / 2;
+    OutIterator outMid = out + std::distance(begin, mid);
+    tg.spawn([=, &func, &tg] {
+      parallel_transform_split(mid, end, outMid, func, tg, grain);
+    });
+    end = mid;
+  }
+  std::transform(begin, end, out, func);
+}
+
+/// \brief Recursively halves the range, reducing the two halves on
+/// their own tasks and combining left before right.
+///
+/// The split points depend only on the length of the range, never on
+/// which worker finishes first, so the shape of the combine tree (and
+/// with it the result, for any associative combine) is the same on
+/// every run and at every thread count.
+template <class Iterator, class T, class Transform, class Combine>
+T parallel_transform_reduce_split(Iterator begin, Iterator end, T identity,
+                                  Transform &transform, Combine &combine,
+                                  ptrdiff_t grain) {
+  if (std::distance(begin, end) <= grain) {
+    T result = identity;
+    for (Iterator i = begin; i != end; ++i)
+      result = combine(std::move(result), transform(*i));
+    return result;
+  }
+  Iterator mid = begin + std::distance(begin, end) / 2;
+  T right = identity;
   TaskGroup tg;
-  ptrdiff_t taskSize = 1024;
-  while (taskSize <= std::distance(begin, end)) {
-    tg.spawn([=, &func] { std::for_each(begin, begin + taskSize, func); });
-    begin += taskSize;
+  tg.spawn([&] {
+    right = parallel_transform_reduce_split(mid, end, identity, transform,
+                                            combine, grain);
+  });
+  T left =
+      parallel_transform_reduce_split(begin, mid, identity, transform, combine,
+                                      grain);
+  tg.sync();
+  return combine(std::move(left), std::move(right));
+}
+} // namespace detail
+
+/// \brief Applies func to each element in [begin, end) in parallel,
+/// writing the result of element i to out + i.
+///
+/// The output range must be preallocated and out must be a random
+/// access iterator; blocks write disjoint slices, so no
+/// synchronization on the output is needed.
+template <class Iterator, class OutIterator, class Func>
+void parallel_transform(Iterator begin, Iterator end, OutIterator out,
+                        Func func, ptrdiff_t grain) {
+  if (std::distance(begin, end) <= grain) {
+    std::transform(begin, end, out, func);
+    return;
   }
-  std::for_each(begin, end, func);
+  TaskGroup tg;
+  detail::parallel_transform_split(begin, end, out, func, tg, grain);
+}
+
+/// \brief Maps each element through \p transform and folds the results
+/// with \p combine, starting from \p identity.
+///
+/// \p combine must be associative; it is applied in a fixed tree order
+/// determined by the range length alone, so the result is
+/// deterministic across runs and thread counts. Within a block of up
+/// to \p grain elements the fold is a plain left-to-right loop, so the
+/// per-element cost is a call, not a task.
+template <class Iterator, class T, class Transform, class Combine>
+T parallel_transform_reduce(Iterator begin, Iterator end, T identity,
+                            Transform transform, Combine combine,
+                            ptrdiff_t grain) {
+  return detail::parallel_transform_reduce_split(begin, end, identity,
+                                                 transform, combine, grain);
 }
 #endif
+
+template <class Iterator, class OutIterator, class Func>
+void parallel_transform(Iterator begin, Iterator end, OutIterator out,
+                        Func func) {
+  parallel_transform(begin, end, out, func, 1024);
+}
+
+template <class Iterator, class T, class Transform, class Combine>
+T parallel_transform_reduce(Iterator begin, Iterator end, T identity,
+                            Transform transform, Combine combine) {
+  return parallel_transform_reduce(begin, end, identity, transform, combine,
+                                   1024);
+}
 } // end namespace lld
 
 #endif // LLD_CORE_PARALLEL_H
@@ -31,11 +31,29 @@ class SimpleFile;
 /// new Atoms to the graph using the File's addAtom() method.
 class Pass {
 public:
+  /// Parts of the merged file a pass may touch. The PassManager
+  /// overlaps two passes only if neither writes a resource the other
+  /// reads or writes, so a pass opts in to running concurrently by
+  /// narrowing its declared sets; the default claims everything,
+  /// which serializes the pass against all others.
+  enum Resources : unsigned {
+    resourceAtomList   = 1U << 0, ///< adds or removes atoms
+    resourceReferences = 1U << 1, ///< adds or retargets references
+    resourceOrdinals   = 1U << 2, ///< reassigns atom ordinals
+    resourceAll        = ~0U
+  };
+
   virtual ~Pass() { }
 
   /// Do the actual work of the Pass.
   virtual llvm::Error perform(SimpleFile &mergedFile) = 0;
 
+  /// Resources this pass inspects.
+  virtual unsigned readSet() const { return resourceAll; }
+
+  /// Resources this pass mutates.
+  virtual unsigned writeSet() const { return resourceAll; }
+
 protected:
   // Only subclassess can be instantiated.
   Pass() { }
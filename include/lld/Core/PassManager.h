@@ -11,9 +11,11 @@
 #define LLD_CORE_PASS_MANAGER_H
 
 #include "lld/Core/LLVM.h"
+#include "lld/Core/Parallel.h"
 #include "lld/Core/Pass.h"
 #include "llvm/Support/Error.h"
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace lld {
@@ -22,10 +24,11 @@ class Pass;
 
 /// \brief Owns and runs a collection of passes.
 ///
-/// This class is currently just a container for passes and a way to run them.
-///
-/// In the future this should handle timing pass runs, running parallel passes,
-/// and validate/satisfy pass dependencies.
+/// Passes run as a dependency graph derived from their declared
+/// read/write sets (see Pass::readSet()): a pass waits on every
+/// earlier pass it conflicts with and runs concurrently with the
+/// rest. Since the default sets claim all resources, passes execute
+/// in the order added unless they narrow their declarations.
 class PassManager {
 public:
   void add(std::unique_ptr<Pass> pass) {
@@ -33,13 +36,46 @@ public:
   }
 
   llvm::Error runOnFile(SimpleFile &file) {
-    for (std::unique_ptr<Pass> &pass : _passes)
-      if (llvm::Error EC = pass->perform(file))
-        return EC;
-    return llvm::Error();
+    std::mutex errorMutex;
+    llvm::Error firstError = llvm::Error::success();
+    bool failed = false;
+
+    TaskGraph graph;
+    std::vector<TaskGraph::TaskId> ids;
+    for (std::unique_ptr<Pass> &pass : _passes) {
+      Pass *p = pass.get();
+      ids.push_back(graph.addTask([&, p] {
+        // Match the serial early-exit: once a pass has failed, later
+        // passes become no-ops.
+        {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (failed)
+            return;
+        }
+        if (llvm::Error EC = p->perform(file)) {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (failed)
+            llvm::consumeError(std::move(EC));
+          else
+            firstError = std::move(EC);
+          failed = true;
+        }
+      }));
+      for (size_t i = 0, e = ids.size() - 1; i != e; ++i)
+        if (conflict(*_passes[i], *p))
+          graph.addEdge(ids[i], ids.back());
+    }
+    graph.run();
+    return firstError;
   }
 
 private:
+  /// Two passes conflict unless both only read what the other touches.
+  static bool conflict(const Pass &a, const Pass &b) {
+    return (a.writeSet() & (b.readSet() | b.writeSet())) ||
+           (b.writeSet() & a.readSet());
+  }
+
   /// \brief Passes in the order they should run.
   std::vector<std::unique_ptr<Pass>> _passes;
 };
@@ -18,6 +18,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/Support/ErrorOr.h"
+#include <mutex>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -71,6 +72,14 @@ private:
 
   void markLive(const Atom *atom);
 
+  // Visited set for the live-mark, sharded by pointer hash with one
+  // mutex per shard so several markLive() traversals can run at once.
+  struct LiveShard {
+    std::mutex _mutex;
+    llvm::DenseSet<const Atom *> _set;
+  };
+  static const size_t _numLiveShards = 16;
+
   class MergedFile : public SimpleFile {
   public:
     MergedFile() : SimpleFile("<linker-internal>", kindResolverMergedObject) {}
@@ -81,6 +90,7 @@ private:
   SymbolTable _symbolTable;
   std::vector<OwningAtomPtr<Atom>>     _atoms;
   std::set<const Atom *>        _deadStripRoots;
+  LiveShard                     _liveShards[_numLiveShards];
   llvm::DenseSet<const Atom *>  _liveAtoms;
   llvm::DenseSet<const Atom *>  _deadAtoms;
   std::unique_ptr<MergedFile>   _result;
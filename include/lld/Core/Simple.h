@@ -22,10 +22,9 @@
 #include "lld/Core/Reference.h"
 #include "lld/Core/SharedLibraryAtom.h"
 #include "lld/Core/UndefinedAtom.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
-#include "llvm/ADT/ilist.h"
-#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
 #include <algorithm>
@@ -60,6 +59,13 @@ public:
     _absolute.push_back(OwningAtomPtr<AbsoluteAtom>(&a));
   }
 
+  /// Reserve room for \p n more DefinedAtoms. Readers that know how
+  /// many atoms a batch will produce can call this up front instead of
+  /// growing the vector one addAtom() at a time.
+  void reserveDefinedAtoms(size_t n) {
+    _defined.reserve(_defined.size() + n);
+  }
+
   void addAtom(const Atom &atom) {
     if (auto *p = dyn_cast<DefinedAtom>(&atom)) {
       addAtom(const_cast<DefinedAtom &>(*p));
@@ -111,18 +117,15 @@ private:
   AtomVector<AbsoluteAtom> _absolute;
 };
 
+/// A compact reference record. SimpleDefinedAtom stores these by value in
+/// a contiguous array, so iterating an atom's references walks packed
+/// records instead of chasing individually allocated list nodes.
 class SimpleReference : public Reference {
 public:
   SimpleReference(Reference::KindNamespace ns, Reference::KindArch arch,
                   Reference::KindValue value, uint64_t off, const Atom *t,
                   Reference::Addend a)
-      : Reference(ns, arch, value), _target(t), _offsetInAtom(off), _addend(a),
-        _next(nullptr), _prev(nullptr) {
-  }
-  SimpleReference()
-      : Reference(Reference::KindNamespace::all, Reference::KindArch::all, 0),
-        _target(nullptr), _offsetInAtom(0), _addend(0), _next(nullptr),
-        _prev(nullptr) {
+      : Reference(ns, arch, value), _target(t), _offsetInAtom(off), _addend(a) {
   }
 
   uint64_t offsetInAtom() const override { return _offsetInAtom; }
@@ -135,76 +138,19 @@ public:
   Addend addend() const override { return _addend; }
   void setAddend(Addend a) override { _addend = a; }
   void setTarget(const Atom *newAtom) override { _target = newAtom; }
-  SimpleReference *getNext() const { return _next; }
-  SimpleReference *getPrev() const { return _prev; }
-  void setNext(SimpleReference *n) { _next = n; }
-  void setPrev(SimpleReference *p) { _prev = p; }
 
 private:
   const Atom *_target;
   uint64_t _offsetInAtom;
   Addend _addend;
-  SimpleReference *_next;
-  SimpleReference *_prev;
-};
-
-} // end namespace lld
-
-// ilist will lazily create a sentinal (so end() can return a node past the
-// end of the list). We need this trait so that the sentinal is allocated
-// via the BumpPtrAllocator.
-namespace llvm {
-
-template<>
-struct ilist_sentinel_traits<lld::SimpleReference> {
-
-  ilist_sentinel_traits() : _allocator(nullptr) { }
-
-  void setAllocator(llvm::BumpPtrAllocator *alloc) {
-    _allocator = alloc;
-  }
-
-  lld::SimpleReference *createSentinel() const {
-    return new (*_allocator) lld::SimpleReference();
-  }
-
-  static void destroySentinel(lld::SimpleReference*) {}
-
-  static lld::SimpleReference *provideInitialHead() { return nullptr; }
-
-  lld::SimpleReference *ensureHead(lld::SimpleReference *&head) const {
-    if (!head) {
-      head = createSentinel();
-      noteHead(head, head);
-      ilist_traits<lld::SimpleReference>::setNext(head, nullptr);
-      return head;
-    }
-    return ilist_traits<lld::SimpleReference>::getPrev(head);
-  }
-
-  void noteHead(lld::SimpleReference *newHead,
-                lld::SimpleReference *sentinel) const {
-    ilist_traits<lld::SimpleReference>::setPrev(newHead, sentinel);
-  }
-
-private:
-  mutable llvm::BumpPtrAllocator *_allocator;
 };
 
-} // end namespace llvm
-
-namespace lld {
-
 class SimpleDefinedAtom : public DefinedAtom {
 public:
   explicit SimpleDefinedAtom(const File &f)
-    : _file(f), _ordinal(f.getNextAtomOrdinalAndIncrement()) {
-    _references.setAllocator(&f.allocator());
-  }
+    : _file(f), _ordinal(f.getNextAtomOrdinalAndIncrement()) {}
 
-  ~SimpleDefinedAtom() override {
-    _references.clearAndLeakNodesUnsafely();
-  }
+  ~SimpleDefinedAtom() override = default;
 
   const File &file() const override { return _file; }
 
@@ -232,12 +178,12 @@ public:
   }
 
   DefinedAtom::reference_iterator begin() const override {
-    const void *it = reinterpret_cast<const void *>(&*_references.begin());
+    const void *it = reinterpret_cast<const void *>(_references.begin());
     return reference_iterator(*this, it);
   }
 
   DefinedAtom::reference_iterator end() const override {
-    const void *it = reinterpret_cast<const void *>(&*_references.end());
+    const void *it = reinterpret_cast<const void *>(_references.end());
     return reference_iterator(*this, it);
   }
 
@@ -247,8 +193,21 @@ public:
 
   void incrementIterator(const void *&it) const override {
     const SimpleReference* node = reinterpret_cast<const SimpleReference*>(it);
-    const SimpleReference* next = node->getNext();
-    it = reinterpret_cast<const void*>(next);
+    it = reinterpret_cast<const void*>(node + 1);
+  }
+
+  /// The packed reference records of this atom. Note that addReference()
+  /// may grow (and therefore move) the array; do not hold pointers or
+  /// iterators into it across a call that adds references to this atom.
+  llvm::ArrayRef<SimpleReference> references() const { return _references; }
+
+  size_t referenceCount() const { return _references.size(); }
+
+  /// Reserve room for \p n more references. Readers that know how many
+  /// fixups a batch will produce can call this up front instead of
+  /// growing the array one addReference() at a time.
+  void reserveReferences(size_t n) {
+    _references.reserve(_references.size() + n);
   }
 
   void addReference(Reference::KindNamespace ns,
@@ -256,45 +215,36 @@ public:
                     Reference::KindValue kindValue, uint64_t off,
                     const Atom *target, Reference::Addend a) override {
     assert(target && "trying to create reference to nothing");
-    auto node = new (_file.allocator())
-        SimpleReference(ns, arch, kindValue, off, target, a);
-    _references.push_back(node);
+    _references.push_back(SimpleReference(ns, arch, kindValue, off, target, a));
+  }
+
+  /// Append a pre-built batch of references in one call.
+  void addReferences(llvm::ArrayRef<SimpleReference> refs) {
+    _references.append(refs.begin(), refs.end());
   }
 
   /// Sort references in a canonical order (by offset, then by kind).
   void sortReferences() const {
-    // Cannot sort a linked  list, so move elements into a temporary vector,
-    // sort the vector, then reconstruct the list.
-    llvm::SmallVector<SimpleReference *, 16> elements;
-    for (SimpleReference &node : _references) {
-      elements.push_back(&node);
-    }
-    std::sort(elements.begin(), elements.end(),
-        [] (const SimpleReference *lhs, const SimpleReference *rhs) -> bool {
-          uint64_t lhsOffset = lhs->offsetInAtom();
-          uint64_t rhsOffset = rhs->offsetInAtom();
+    std::sort(_references.begin(), _references.end(),
+        [] (const SimpleReference &lhs, const SimpleReference &rhs) -> bool {
+          uint64_t lhsOffset = lhs.offsetInAtom();
+          uint64_t rhsOffset = rhs.offsetInAtom();
           if (rhsOffset != lhsOffset)
             return (lhsOffset < rhsOffset);
-          if (rhs->kindNamespace() != lhs->kindNamespace())
-            return (lhs->kindNamespace() < rhs->kindNamespace());
-          if (rhs->kindArch() != lhs->kindArch())
-            return (lhs->kindArch() < rhs->kindArch());
-          return (lhs->kindValue() < rhs->kindValue());
+          if (rhs.kindNamespace() != lhs.kindNamespace())
+            return (lhs.kindNamespace() < rhs.kindNamespace());
+          if (rhs.kindArch() != lhs.kindArch())
+            return (lhs.kindArch() < rhs.kindArch());
+          return (lhs.kindValue() < rhs.kindValue());
         });
-    _references.clearAndLeakNodesUnsafely();
-    for (SimpleReference *node : elements) {
-      _references.push_back(node);
-    }
   }
 
   void setOrdinal(uint64_t ord) { _ordinal = ord; }
 
 private:
-  typedef llvm::ilist<SimpleReference> RefList;
-
   const File &_file;
   uint64_t _ordinal;
-  mutable RefList _references;
+  mutable llvm::SmallVector<SimpleReference, 4> _references;
 };
 
 class SimpleUndefinedAtom : public UndefinedAtom {
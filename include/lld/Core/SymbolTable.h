@@ -15,6 +15,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include <cstring>
 #include <map>
+#include <mutex>
 #include <vector>
 
 namespace lld {
@@ -32,6 +33,12 @@ class UndefinedAtom;
 /// All atoms coalescable by-name or by-content should be added.
 /// The method replacement() can be used to find the replacement atom
 /// if an atom has been coalesced away.
+///
+/// The name table is sharded by name hash with one mutex per shard, so
+/// atoms may be added from multiple threads. Whether two conflicting
+/// atoms resolve the same way regardless of thread schedule is up to
+/// the caller: adds for the same name race only on their shard's lock,
+/// and the winner depends on arrival order.
 class SymbolTable {
 public:
   /// @brief add atom to symbol table
@@ -93,11 +100,20 @@ private:
   };
   typedef llvm::DenseSet<const DefinedAtom*, AtomMappingInfo> AtomContentSet;
 
+  struct NameShard {
+    std::mutex _mutex;
+    NameToAtom _table;
+  };
+  static const size_t _numNameShards = 16;
+
   bool addByName(const Atom &);
   bool addByContent(const DefinedAtom &);
+  NameShard &shardForName(StringRef name);
 
+  std::mutex _replacedMutex;
   AtomToAtom _replacedAtoms;
-  NameToAtom _nameTable;
+  NameShard _nameShards[_numNameShards];
+  std::mutex _contentMutex;
   AtomContentSet _contentTable;
 };
 
@@ -27,6 +27,22 @@ namespace mach_o {
 bool link(llvm::ArrayRef<const char *> Args,
           llvm::raw_ostream &Diag = llvm::errs());
 }
+
+/// Performs one link in-process, emulating the gnu, darwin, or windows
+/// linker based on args[0] or an explicit -flavor option, like the lld
+/// tool does. This is the entry point for build systems that want to run
+/// the linker repeatedly from one process and keep caches warm across
+/// links instead of paying process startup per output binary.
+///
+/// Reentrancy contract: the darwin flavor keeps all per-link state in a
+/// MachOLinkingContext, so darwin links may run concurrently on separate
+/// threads. The gnu and windows flavors keep per-link state in globals;
+/// their entry points serialize on an internal lock, so concurrent calls
+/// are safe but run one at a time. Those two flavors also report fatal
+/// errors by exiting the process, so embedders that need to survive
+/// hard link errors should still isolate such links in a child process.
+bool link(llvm::ArrayRef<const char *> args,
+          llvm::raw_ostream &diag = llvm::errs());
 }
 
 #endif
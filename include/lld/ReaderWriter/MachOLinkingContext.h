@@ -409,8 +409,10 @@ public:
 
   llvm::Error handleLoadedFile(File &file) override;
 
-  bool customAtomOrderer(const DefinedAtom *left, const DefinedAtom *right,
-                         bool &leftBeforeRight) const;
+  /// Sets \p ordinal to the position of the atom's name in the -order_file
+  /// lists (honoring any object-file prefix filters) and returns true, or
+  /// returns false if the atom is not listed.
+  bool orderOrdinalForAtom(const DefinedAtom *atom, unsigned &ordinal) const;
 
   /// Return the 'flat namespace' file. This is the file that supplies
   /// atoms for otherwise undefined symbols when the -flat_namespace or
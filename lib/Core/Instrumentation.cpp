@@ -0,0 +1,153 @@
+//===- lib/Core/Instrumentation.cpp ---------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Built-in backend for the instrumentation API.
+///
+/// Active when lld is built without VTune support. Set the LLD_TRACE
+/// environment variable to a file name to collect every ScopedTask and
+/// Marker into per-thread ring buffers; the result is written to that
+/// file as chrome://tracing JSON when the process exits.
+///
+//===----------------------------------------------------------------------===//
+
+#include "lld/Core/Instrumentation.h"
+
+#ifndef LLD_HAS_VTUNE
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace lld;
+
+namespace {
+struct Event {
+  const char *_name;
+  uint64_t _startUs;
+  uint64_t _durUs;
+};
+
+/// \brief A fixed-capacity event ring owned by one thread.
+///
+/// Appends touch only the owning thread's state, so recording never
+/// takes a lock. A thread that records more events than the ring holds
+/// overwrites its oldest entries; a bounded trace of a pathological run
+/// is more useful than an unbounded one that distorts it.
+struct EventRing {
+  static const size_t capacity = 1 << 16;
+
+  void push(const Event &event) {
+    if (_events.size() < capacity) {
+      _events.push_back(event);
+    } else {
+      _events[_next] = event;
+      _wrapped = true;
+    }
+    _next = (_next + 1) % capacity;
+  }
+
+  std::vector<Event> _events;
+  size_t _next = 0;
+  bool _wrapped = false;
+  uint64_t _tid = 0;
+};
+
+struct TraceState {
+  TraceState()
+      : _outputPath(std::getenv("LLD_TRACE")),
+        _origin(std::chrono::steady_clock::now()) {}
+
+  ~TraceState() { dump(); }
+
+  void dump();
+
+  std::mutex _mutex;
+  std::vector<EventRing *> _rings;
+  const char *_outputPath;
+  std::chrono::steady_clock::time_point _origin;
+};
+
+TraceState &getState() {
+  static TraceState state;
+  return state;
+}
+
+EventRing &getRing() {
+  static thread_local EventRing *ring = nullptr;
+  if (!ring) {
+    // Rings are leaked on purpose: pool threads are detached, so there
+    // is no point at which a ring is provably no longer appended to,
+    // and the dump at exit still needs its contents.
+    ring = new EventRing;
+    ring->_tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+    TraceState &state = getState();
+    std::lock_guard<std::mutex> lock(state._mutex);
+    state._rings.push_back(ring);
+  }
+  return *ring;
+}
+
+void TraceState::dump() {
+  if (!_outputPath)
+    return;
+  std::error_code ec;
+  llvm::raw_fd_ostream os(_outputPath, ec, llvm::sys::fs::F_None);
+  if (ec)
+    return;
+
+  // One complete ("ph":"X") event per task, microsecond timestamps,
+  // one tid per recording thread. Detached workers can still be
+  // appending while this runs; every Event field is a single aligned
+  // word, so a racing slot reads as a mix of two records, never as a
+  // torn pointer.
+  os << "{\"traceEvents\":[";
+  bool first = true;
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (EventRing *ring : _rings) {
+    size_t size = ring->_events.size();
+    size_t begin = ring->_wrapped ? ring->_next : 0;
+    for (size_t i = 0; i != size; ++i) {
+      const Event &event = ring->_events[(begin + i) % size];
+      os << (first ? "\n" : ",\n");
+      first = false;
+      os << "{\"name\":\"" << event._name << "\",\"ph\":\"X\",\"ts\":"
+         << event._startUs << ",\"dur\":" << event._durUs
+         << ",\"pid\":0,\"tid\":" << ring->_tid << "}";
+    }
+  }
+  os << "\n]}\n";
+}
+} // end anonymous namespace.
+
+bool trace::enabled() {
+  static bool on = std::getenv("LLD_TRACE") != nullptr;
+  return on;
+}
+
+uint64_t trace::now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - getState()._origin)
+      .count();
+}
+
+void trace::record(const char *name, uint64_t startUs, uint64_t durUs) {
+  Event event;
+  event._name = name;
+  event._startUs = startUs;
+  event._durUs = durUs;
+  getRing().push(event);
+}
+
+#endif // !LLD_HAS_VTUNE
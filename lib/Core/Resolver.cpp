@@ -13,6 +13,7 @@
 #include "lld/Core/Instrumentation.h"
 #include "lld/Core/LLVM.h"
 #include "lld/Core/LinkingContext.h"
+#include "lld/Core/Parallel.h"
 #include "lld/Core/Resolver.h"
 #include "lld/Core/SharedLibraryFile.h"
 #include "lld/Core/SymbolTable.h"
@@ -74,11 +75,30 @@ llvm::Expected<bool> Resolver::forEachUndefines(File &file,
 
 llvm::Expected<bool> Resolver::handleArchiveFile(File &file) {
   ArchiveLibraryFile *archiveFile = cast<ArchiveLibraryFile>(&file);
+  // Kick off parsing of every member that may satisfy a pending
+  // undefined symbol before walking the undefines serially below.
+  // The serial loop still decides, one undefine at a time, which
+  // members actually join the link, so the speculative parses cannot
+  // change the result; they only move the parsing work off the
+  // resolver thread and run it in parallel.
+  TaskGroup group;
+  size_t numPreloaded = 0;
+  auto preloadNewUndefines = [&] {
+    for (; numPreloaded < _undefines.size(); ++numPreloaded)
+      if (!_undefines[numPreloaded].empty())
+        archiveFile->preload(group, _undefines[numPreloaded]);
+  };
+  preloadNewUndefines();
   return forEachUndefines(file,
                           [&](StringRef undefName) -> llvm::Expected<bool> {
     if (File *member = archiveFile->find(undefName)) {
       member->setOrdinal(_ctx.getNextOrdinalAndIncrement());
-      return handleFile(*member);
+      auto undefAddedOrError = handleFile(*member);
+      // A member that joins the link usually brings new undefined
+      // symbols with it. Queue the members that could satisfy them
+      // right away, so they parse while the walk continues.
+      preloadNewUndefines();
+      return undefAddedOrError;
     }
     return false;
   });
@@ -316,20 +336,33 @@ void Resolver::updateReferences() {
   }
 }
 
-// For dead code stripping, recursively mark atoms "live"
-void Resolver::markLive(const Atom *atom) {
-  // Mark the atom is live. If it's already marked live, then stop recursion.
-  auto exists = _liveAtoms.insert(atom);
-  if (!exists.second)
-    return;
+// For dead code stripping, mark atoms reachable from \p root "live".
+// Several markLive() traversals may run concurrently, one per root;
+// the sharded visited set ensures exactly one of them expands any
+// given atom's references, so the closure is computed once no matter
+// how the roots' subgraphs overlap.
+void Resolver::markLive(const Atom *root) {
+  SmallVector<const Atom *, 256> worklist;
+  worklist.push_back(root);
+  while (!worklist.empty()) {
+    const Atom *atom = worklist.pop_back_val();
+
+    // Mark the atom live. If it's already marked, another traversal
+    // owns it and its references; don't expand it again.
+    LiveShard &shard = _liveShards[llvm::DenseMapInfo<const Atom *>::
+                                       getHashValue(atom) % _numLiveShards];
+    {
+      std::lock_guard<std::mutex> lock(shard._mutex);
+      if (!shard._set.insert(atom).second)
+        continue;
+    }
 
-  // Mark all atoms it references as live
-  if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(atom)) {
-    for (const Reference *ref : *defAtom)
-      markLive(ref->target());
-    for (auto &p : llvm::make_range(_reverseRef.equal_range(defAtom))) {
-      const Atom *target = p.second;
-      markLive(target);
+    // Queue all atoms it references.
+    if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(atom)) {
+      for (const Reference *ref : *defAtom)
+        worklist.push_back(ref->target());
+      for (auto &p : llvm::make_range(_reverseRef.equal_range(defAtom)))
+        worklist.push_back(p.second);
     }
   }
 }
@@ -376,9 +409,21 @@ void Resolver::deadStripOptimize() {
     _deadStripRoots.insert(symAtom);
   }
 
-  // mark all roots as live, and recursively all atoms they reference
-  for (const Atom *dsrAtom : _deadStripRoots)
-    markLive(dsrAtom);
+  // Mark all roots as live, and recursively all atoms they reference.
+  // Each root's closure is traversed as its own task; roots whose
+  // subgraphs overlap share the visited set, so no atom is expanded
+  // twice. The resulting live set is the same whatever the schedule.
+  {
+    TaskGroup tg;
+    for (const Atom *dsrAtom : _deadStripRoots)
+      tg.spawn([this, dsrAtom] { markLive(dsrAtom); });
+  }
+
+  // Collapse the shards into _liveAtoms, which the sweep below and
+  // checkUndefines() consult.
+  for (LiveShard &shard : _liveShards)
+    for (const Atom *atom : shard._set)
+      _liveAtoms.insert(atom);
 
   // now remove all non-live atoms from _atoms
   _atoms.erase(std::remove_if(_atoms.begin(), _atoms.end(),
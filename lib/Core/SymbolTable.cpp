@@ -112,13 +112,22 @@ static MergeResolution mergeSelect(DefinedAtom::Merge first,
   return mergeCases[first][second];
 }
 
+SymbolTable::NameShard &SymbolTable::shardForName(StringRef name) {
+  return _nameShards[StringRefMappingInfo::getHashValue(name) % _numNameShards];
+}
+
 bool SymbolTable::addByName(const Atom &newAtom) {
   StringRef name = newAtom.name();
   assert(!name.empty());
-  const Atom *existing = findByName(name);
+  // Hold the shard lock across lookup, conflict resolution and update,
+  // so that two concurrent adds for the same name see each other.
+  NameShard &shard = shardForName(name);
+  std::lock_guard<std::mutex> lock(shard._mutex);
+  NameToAtom::iterator pos = shard._table.find(name);
+  const Atom *existing = (pos == shard._table.end()) ? nullptr : pos->second;
   if (existing == nullptr) {
     // Name is not in symbol table yet, add it associate with this atom.
-    _nameTable[name] = &newAtom;
+    shard._table[name] = &newAtom;
     return true;
   }
 
@@ -201,12 +210,12 @@ bool SymbolTable::addByName(const Atom &newAtom) {
 
   if (useNew) {
     // Update name table to use new atom.
-    _nameTable[name] = &newAtom;
+    shard._table[name] = &newAtom;
     // Add existing atom to replacement table.
-    _replacedAtoms[existing] = &newAtom;
+    addReplacement(existing, &newAtom);
   } else {
     // New atom is not being used.  Add it to replacement table.
-    _replacedAtoms[&newAtom] = existing;
+    addReplacement(&newAtom, existing);
   }
   return false;
 }
@@ -247,6 +256,7 @@ bool SymbolTable::AtomMappingInfo::isEqual(const DefinedAtom * const l,
 }
 
 bool SymbolTable::addByContent(const DefinedAtom &newAtom) {
+  std::lock_guard<std::mutex> lock(_contentMutex);
   AtomContentSet::iterator pos = _contentTable.find(&newAtom);
   if (pos == _contentTable.end()) {
     _contentTable.insert(&newAtom);
@@ -254,13 +264,15 @@ bool SymbolTable::addByContent(const DefinedAtom &newAtom) {
   }
   const Atom* existing = *pos;
   // New atom is not being used.  Add it to replacement table.
-  _replacedAtoms[&newAtom] = existing;
+  addReplacement(&newAtom, existing);
   return false;
 }
 
 const Atom *SymbolTable::findByName(StringRef sym) {
-  NameToAtom::iterator pos = _nameTable.find(sym);
-  if (pos == _nameTable.end())
+  NameShard &shard = shardForName(sym);
+  std::lock_guard<std::mutex> lock(shard._mutex);
+  NameToAtom::iterator pos = shard._table.find(sym);
+  if (pos == shard._table.end())
     return nullptr;
   return pos->second;
 }
@@ -273,45 +285,63 @@ bool SymbolTable::isDefined(StringRef sym) {
 
 void SymbolTable::addReplacement(const Atom *replaced,
                                  const Atom *replacement) {
+  std::lock_guard<std::mutex> lock(_replacedMutex);
   _replacedAtoms[replaced] = replacement;
 }
 
 const Atom *SymbolTable::replacement(const Atom *atom) {
   // Find the replacement for a given atom. Atoms in _replacedAtoms
   // may be chained, so find the last one.
-  for (;;) {
-    AtomToAtom::iterator pos = _replacedAtoms.find(atom);
-    if (pos == _replacedAtoms.end())
-      return atom;
-    atom = pos->second;
+  std::lock_guard<std::mutex> lock(_replacedMutex);
+  const Atom *root = atom;
+  AtomToAtom::iterator pos;
+  while ((pos = _replacedAtoms.find(root)) != _replacedAtoms.end())
+    root = pos->second;
+  // Compress the path: point every atom on the chain directly at the
+  // final atom, so looking up any of them again is a single hop. The
+  // resolver queries the same coalesced atoms once per reference, and
+  // chains several links long are common with weak symbols.
+  while (atom != root) {
+    AtomToAtom::iterator p = _replacedAtoms.find(atom);
+    const Atom *next = p->second;
+    p->second = root;
+    atom = next;
   }
+  return root;
 }
 
 bool SymbolTable::isCoalescedAway(const Atom *atom) {
+  std::lock_guard<std::mutex> lock(_replacedMutex);
   return _replacedAtoms.count(atom) > 0;
 }
 
 std::vector<const UndefinedAtom *> SymbolTable::undefines() {
   std::vector<const UndefinedAtom *> ret;
-  for (auto it : _nameTable) {
-    const Atom *atom = it.second;
-    assert(atom != nullptr);
-    if (const auto *undef = dyn_cast<const UndefinedAtom>(atom))
-      if (_replacedAtoms.count(undef) == 0)
-        ret.push_back(undef);
+  for (NameShard &shard : _nameShards) {
+    std::lock_guard<std::mutex> lock(shard._mutex);
+    for (auto it : shard._table) {
+      const Atom *atom = it.second;
+      assert(atom != nullptr);
+      if (const auto *undef = dyn_cast<const UndefinedAtom>(atom))
+        if (!isCoalescedAway(undef))
+          ret.push_back(undef);
+    }
   }
   return ret;
 }
 
 std::vector<StringRef> SymbolTable::tentativeDefinitions() {
   std::vector<StringRef> ret;
-  for (auto entry : _nameTable) {
-    const Atom *atom = entry.second;
-    StringRef name   = entry.first;
-    assert(atom != nullptr);
-    if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(atom))
-      if (defAtom->merge() == DefinedAtom::mergeAsTentative)
-        ret.push_back(name);
+  for (NameShard &shard : _nameShards) {
+    std::lock_guard<std::mutex> lock(shard._mutex);
+    for (auto entry : shard._table) {
+      const Atom *atom = entry.second;
+      StringRef name   = entry.first;
+      assert(atom != nullptr);
+      if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(atom))
+        if (defAtom->merge() == DefinedAtom::mergeAsTentative)
+          ret.push_back(name);
+    }
   }
   return ret;
 }
@@ -16,6 +16,7 @@
 #include "lld/Core/ArchiveLibraryFile.h"
 #include "lld/Core/File.h"
 #include "lld/Core/Instrumentation.h"
+#include "lld/Core/Parallel.h"
 #include "lld/Core/PassManager.h"
 #include "lld/Core/Resolver.h"
 #include "lld/Core/SharedLibraryFile.h"
@@ -1146,9 +1147,17 @@ bool link(llvm::ArrayRef<const char *> args, raw_ostream &diagnostics) {
   if (ctx.getNodes().empty())
     return false;
 
-  for (std::unique_ptr<Node> &ie : ctx.getNodes())
-    if (FileNode *node = dyn_cast<FileNode>(ie.get()))
-      node->getFile()->parse();
+  // Parse all input files on the executor rather than one after another.
+  // File::parse() runs under the file's parse mutex and caches its
+  // result, so a file the resolver asks about before its task finishes
+  // simply blocks on that file, and any parse error is re-reported at
+  // the same place it would have been before.
+  {
+    TaskGroup tg;
+    for (std::unique_ptr<Node> &ie : ctx.getNodes())
+      if (FileNode *node = dyn_cast<FileNode>(ie.get()))
+        tg.spawn([node] { node->getFile()->parse(); });
+  }
 
   std::vector<std::unique_ptr<File>> internalFiles;
   ctx.createInternalFiles(internalFiles);
@@ -0,0 +1,106 @@
+//===- lib/Driver/UniversalDriver.cpp -------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// lld::link() is the in-process entry point for build systems that want to
+// run the linker without spawning a process per output binary. It emulates
+// the gnu, darwin, or windows linker based on args[0] or an explicit
+// -flavor option, exactly like the lld tool does.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Driver/Driver.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/Path.h"
+#include <vector>
+
+using namespace lld;
+using namespace llvm;
+using namespace llvm::sys;
+
+namespace {
+enum Flavor {
+  Invalid,
+  Gnu,     // -flavor gnu
+  WinLink, // -flavor link
+  Darwin,  // -flavor darwin
+};
+}
+
+static Flavor getFlavor(StringRef s) {
+  return StringSwitch<Flavor>(s)
+      .Case("ld", Gnu)
+      .Case("ld.lld", Gnu)
+      .Case("gnu", Gnu)
+      .Case("link", WinLink)
+      .Case("darwin", Darwin)
+      .Default(Invalid);
+}
+
+static Flavor parseProgname(StringRef progname) {
+#if __APPLE__
+  // Use Darwin driver for "ld" on Darwin.
+  if (progname == "ld")
+    return Darwin;
+#endif
+
+#if LLVM_ON_UNIX
+  // Use GNU driver for "ld" on other Unix-like system.
+  if (progname == "ld")
+    return Gnu;
+#endif
+
+  // Progname may be something like "lld-gnu". Parse it.
+  SmallVector<StringRef, 3> v;
+  progname.split(v, "-");
+  for (StringRef s : v)
+    if (Flavor f = getFlavor(s))
+      return f;
+  return Invalid;
+}
+
+static Flavor parseFlavor(std::vector<const char *> &v, raw_ostream &diag) {
+  // Parse -flavor option.
+  if (v.size() > 1 && v[1] == StringRef("-flavor")) {
+    if (v.size() <= 2) {
+      diag << "missing arg value for '-flavor'\n";
+      return Invalid;
+    }
+    Flavor f = getFlavor(v[2]);
+    if (f == Invalid) {
+      diag << "Unknown flavor: " << v[2] << "\n";
+      return Invalid;
+    }
+    v.erase(v.begin() + 1, v.begin() + 3);
+    return f;
+  }
+
+  // Deduct the flavor from argv[0].
+  StringRef arg0 = path::filename(v[0]);
+  if (arg0.endswith_lower(".exe"))
+    arg0 = arg0.drop_back(4);
+  return parseProgname(arg0);
+}
+
+bool lld::link(ArrayRef<const char *> args, raw_ostream &diag) {
+  std::vector<const char *> v(args.begin(), args.end());
+  switch (parseFlavor(v, diag)) {
+  case Gnu:
+    return elf::link(v, diag);
+  case WinLink:
+    return coff::link(v);
+  case Darwin:
+    return mach_o::link(v, diag);
+  default:
+    diag << "-flavor option is missing. Available flavors are "
+            "gnu, darwin or link.\n";
+    return false;
+  }
+}
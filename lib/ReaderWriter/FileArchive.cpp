@@ -16,11 +16,20 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Object/Error.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
+#include <cstdlib>
+#include <future>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -62,9 +71,18 @@ public:
       return nullptr;
     _membersInstantiated.insert(memberStart);
 
+    // If the member was preloaded, pick up the parsed file instead of
+    // parsing it here.
     std::unique_ptr<File> result;
-    if (instantiateMember(ci, result))
+    auto preloaded = _preloaded.find(memberStart);
+    if (preloaded != _preloaded.end()) {
+      result = preloaded->second.get();
+      _preloaded.erase(preloaded);
+      if (!result)
+        return nullptr;
+    } else if (instantiateMember(ci, result)) {
       return nullptr;
+    }
 
     File *file = result.get();
     _filesReturned.push_back(std::move(result));
@@ -73,6 +91,35 @@ public:
     return file;
   }
 
+  /// \brief Parse the member that would satisfy \p name on a worker
+  /// thread. find() and preload() run only on the resolver thread, so
+  /// the maps need no lock; the spawned task communicates its result
+  /// solely through the promise.
+  void preload(TaskGroup &group, StringRef name) override {
+    auto member = _symbolMemberMap.find(name);
+    if (member == _symbolMemberMap.end())
+      return;
+    Archive::child_iterator ci = member->second;
+    if (ci->getError())
+      return;
+    ErrorOr<StringRef> buf = (*ci)->getBuffer();
+    if (!buf)
+      return;
+    const char *memberStart = buf->data();
+    if (_membersInstantiated.count(memberStart))
+      return;
+    if (_preloaded.find(memberStart) != _preloaded.end())
+      return;
+
+    auto promise = std::make_shared<std::promise<std::unique_ptr<File>>>();
+    _preloaded[memberStart] = promise->get_future();
+    group.spawn([this, ci, promise] {
+      std::unique_ptr<File> result;
+      instantiateMember(ci, result);
+      promise->set_value(std::move(result));
+    });
+  }
+
   /// \brief parse each member
   std::error_code
   parseAllMembers(std::vector<std::unique_ptr<File>> &result) override {
@@ -161,6 +208,47 @@ private:
     DEBUG_WITH_TYPE("FileArchive", llvm::dbgs()
                                        << "Table of contents for archive '"
                                        << _archive->getFileName() << "':\n");
+    // If LLD_ARCHIVE_INDEX_DIR names a writable directory, the table
+    // of contents is cached there between links. An entry is keyed by
+    // the archive's absolute path and validated against its size and
+    // modification time, so a stale entry is simply rebuilt. The cache
+    // is best-effort throughout: any problem with it just means the ar
+    // symbol table is parsed as before.
+    const char *cacheDir = std::getenv("LLD_ARCHIVE_INDEX_DIR");
+    SmallString<128> archivePath(_archive->getFileName());
+    std::string cacheFile;
+    uint64_t archiveSize = 0;
+    uint64_t archiveMTime = 0;
+    if (cacheDir) {
+      llvm::sys::fs::file_status status;
+      if (!llvm::sys::fs::make_absolute(archivePath) &&
+          !llvm::sys::fs::status(archivePath, status)) {
+        archiveSize = status.getSize();
+        archiveMTime = status.getLastModificationTime().toEpochTime();
+        SmallString<128> path(cacheDir);
+        llvm::sys::path::append(
+            path, llvm::utohexstr(llvm::hash_value(StringRef(archivePath))) +
+                      ".toc");
+        cacheFile = path.str();
+      }
+    }
+    if (!cacheFile.empty() &&
+        readCachedTableOfContents(cacheFile, archivePath, archiveSize,
+                                  archiveMTime))
+      return std::error_code();
+
+    // When writing a cache entry, members are referred to by their
+    // position in the archive, so number them first.
+    llvm::DenseMap<const char *, uint32_t> memberIndexes;
+    if (!cacheFile.empty()) {
+      uint32_t index = 0;
+      for (auto mf = _archive->child_begin(), me = _archive->child_end();
+           mf != me; ++mf, ++index)
+        if (ErrorOr<StringRef> buf = (*mf)->getBuffer())
+          memberIndexes[buf->data()] = index;
+    }
+
+    std::vector<std::pair<StringRef, uint32_t>> tocEntries;
     for (const Archive::Symbol &sym : _archive->symbols()) {
       StringRef name = sym.getName();
       ErrorOr<Archive::child_iterator> memberOrErr = sym.getMember();
@@ -173,18 +261,143 @@ private:
                                           (*member)->getBuffer()->data())
                           << "'" << name << "'\n");
       _symbolMemberMap.insert(std::make_pair(name, member));
+      if (!cacheFile.empty())
+        if (ErrorOr<StringRef> buf = (*member)->getBuffer()) {
+          auto index = memberIndexes.find(buf->data());
+          if (index != memberIndexes.end())
+            tocEntries.push_back(std::make_pair(name, index->second));
+        }
     }
+    if (!cacheFile.empty())
+      writeCachedTableOfContents(cacheFile, archivePath, archiveSize,
+                                 archiveMTime, tocEntries);
     return std::error_code();
   }
 
+  // On-disk table-of-contents cache layout (all fields little-endian):
+  // magic, version, archive size, archive mtime, archive path, and one
+  // (member index, symbol name) record per ar symbol table entry.
+  static const uint32_t indexMagic = 0x41444C4C; // "LLDA"
+  static const uint32_t indexVersion = 1;
+
+  static uint32_t read32(const char *&p) {
+    uint32_t v = llvm::support::endian::read32le(p);
+    p += 4;
+    return v;
+  }
+
+  static uint64_t read64(const char *&p) {
+    uint64_t v = llvm::support::endian::read64le(p);
+    p += 8;
+    return v;
+  }
+
+  bool readCachedTableOfContents(StringRef cacheFile, StringRef archivePath,
+                                 uint64_t archiveSize, uint64_t archiveMTime) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+        MemoryBuffer::getFile(cacheFile);
+    if (!mbOrErr)
+      return false;
+    std::unique_ptr<MemoryBuffer> mb = std::move(mbOrErr.get());
+    const char *p = mb->getBufferStart();
+    const char *end = mb->getBufferEnd();
+    auto avail = [&](uint64_t n) { return (uint64_t)(end - p) >= n; };
+
+    if (!avail(32))
+      return false;
+    if (read32(p) != indexMagic || read32(p) != indexVersion)
+      return false;
+    if (read64(p) != archiveSize || read64(p) != archiveMTime)
+      return false;
+    uint64_t pathLen = read64(p);
+    // The path guards against two archives hashing to the same cache
+    // file name.
+    if (!avail(pathLen) || StringRef(p, pathLen) != archivePath)
+      return false;
+    p += pathLen;
+    if (!avail(8))
+      return false;
+    uint64_t numSymbols = read64(p);
+
+    // Walking the members does not touch the ar symbol table, which is
+    // the part the cache exists to skip.
+    std::vector<Archive::child_iterator> members;
+    for (auto mf = _archive->child_begin(), me = _archive->child_end();
+         mf != me; ++mf)
+      members.push_back(mf);
+
+    for (uint64_t i = 0; i != numSymbols; ++i) {
+      if (!avail(8)) {
+        _symbolMemberMap.clear();
+        return false;
+      }
+      uint32_t memberIndex = read32(p);
+      uint32_t nameLen = read32(p);
+      if (!avail(nameLen) || memberIndex >= members.size()) {
+        _symbolMemberMap.clear();
+        return false;
+      }
+      // Symbol names point into the cache buffer, which stays mapped
+      // for the life of this file.
+      _symbolMemberMap.insert(
+          std::make_pair(StringRef(p, nameLen), members[memberIndex]));
+      p += nameLen;
+    }
+    _tocCacheBuffer = std::move(mb);
+    return true;
+  }
+
+  void writeCachedTableOfContents(
+      StringRef cacheFile, StringRef archivePath, uint64_t archiveSize,
+      uint64_t archiveMTime,
+      const std::vector<std::pair<StringRef, uint32_t>> &tocEntries) const {
+    // Write to a temporary file and rename, so concurrent links racing
+    // on the same archive see either the old entry or the new one.
+    std::string tmpPath = (cacheFile + ".tmp").str();
+    std::error_code ec;
+    llvm::raw_fd_ostream os(tmpPath, ec, llvm::sys::fs::F_None);
+    if (ec)
+      return;
+    auto write32 = [&](uint32_t v) {
+      char b[4];
+      llvm::support::endian::write32le(b, v);
+      os.write(b, 4);
+    };
+    auto write64 = [&](uint64_t v) {
+      char b[8];
+      llvm::support::endian::write64le(b, v);
+      os.write(b, 8);
+    };
+    write32(indexMagic);
+    write32(indexVersion);
+    write64(archiveSize);
+    write64(archiveMTime);
+    write64(archivePath.size());
+    os << archivePath;
+    write64(tocEntries.size());
+    for (const auto &entry : tocEntries) {
+      write32(entry.second);
+      write32(entry.first.size());
+      os << entry.first;
+    }
+    os.close();
+    if (os.has_error()) {
+      llvm::sys::fs::remove(tmpPath);
+      return;
+    }
+    llvm::sys::fs::rename(tmpPath, cacheFile);
+  }
+
   typedef std::unordered_map<StringRef, Archive::child_iterator> MemberMap;
   typedef std::set<const char *> InstantiatedSet;
 
   std::shared_ptr<MemoryBuffer> _mb;
   const Registry &_registry;
   std::unique_ptr<Archive> _archive;
+  std::unique_ptr<MemoryBuffer> _tocCacheBuffer;
   MemberMap _symbolMemberMap;
   InstantiatedSet _membersInstantiated;
+  std::map<const char *, std::future<std::unique_ptr<File>>> _preloaded;
   bool _logLoading;
   std::vector<std::unique_ptr<MemoryBuffer>> _memberBuffers;
   std::vector<std::unique_ptr<File>> _filesReturned;
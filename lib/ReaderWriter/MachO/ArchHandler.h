@@ -18,6 +18,7 @@
 #include "lld/Core/Reference.h"
 #include "lld/Core/Simple.h"
 #include "lld/ReaderWriter/MachOLinkingContext.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Triple.h"
 
 namespace lld {
@@ -117,14 +118,19 @@ public:
 
   /// Prototype for a helper function.  Given a sectionIndex and address,
   /// finds the atom and offset with that atom of that address.
-  typedef std::function<llvm::Error (uint32_t sectionIndex, uint64_t addr,
-                        const lld::Atom **, Reference::Addend *)>
-                        FindAtomBySectionAndAddress;
+  ///
+  /// The helper-function types below are non-owning function_refs rather
+  /// than std::functions: callers always pass lambdas that outlive the
+  /// call, and these helpers are invoked once per relocation or fixup,
+  /// where copying a std::function per atom is measurable.
+  typedef llvm::function_ref<llvm::Error (uint32_t sectionIndex, uint64_t addr,
+                             const lld::Atom **, Reference::Addend *)>
+                             FindAtomBySectionAndAddress;
 
   /// Prototype for a helper function.  Given a symbolIndex, finds the atom
   /// representing that symbol.
-  typedef std::function<llvm::Error (uint32_t symbolIndex,
-                        const lld::Atom **)> FindAtomBySymbolIndex;
+  typedef llvm::function_ref<llvm::Error (uint32_t symbolIndex,
+                             const lld::Atom **)> FindAtomBySymbolIndex;
 
   /// Analyzes a relocation from a .o file and returns the info
   /// (kind, target, addend) needed to instantiate a Reference.
@@ -159,15 +165,17 @@ public:
 
   /// Prototype for a helper function.  Given an atom, finds the symbol table
   /// index for it in the output file.
-  typedef std::function<uint32_t (const Atom &atom)> FindSymbolIndexForAtom;
+  typedef llvm::function_ref<uint32_t (const Atom &atom)>
+                             FindSymbolIndexForAtom;
 
   /// Prototype for a helper function.  Given an atom, finds the index
   /// of the section that will contain the atom.
-  typedef std::function<uint32_t (const Atom &atom)> FindSectionIndexForAtom;
+  typedef llvm::function_ref<uint32_t (const Atom &atom)>
+                             FindSectionIndexForAtom;
 
   /// Prototype for a helper function.  Given an atom, finds the address
   /// assigned to it in the output file.
-  typedef std::function<uint64_t (const Atom &atom)> FindAddressForAtom;
+  typedef llvm::function_ref<uint64_t (const Atom &atom)> FindAddressForAtom;
 
   /// Some architectures require local symbols on anonymous atoms.
   virtual bool needsLocalSymbolInRelocatableFile(const DefinedAtom *atom) {
@@ -1017,6 +1017,7 @@ void ArchHandler_arm::generateAtomContent(const DefinedAtom &atom,
             atomContentBuffer.begin());
   // Apply fix-ups.
   bool thumbMode = false;
+  uint64_t atomAddress = findAddress(atom);
   for (const Reference *ref : atom) {
     uint32_t offset = ref->offsetInAtom();
     const Atom *target = ref->target();
@@ -1026,7 +1027,6 @@ void ArchHandler_arm::generateAtomContent(const DefinedAtom &atom,
       targetAddress = findAddress(*target);
       targetIsThumb = isThumbFunction(*defTarg);
     }
-    uint64_t atomAddress = findAddress(atom);
     uint64_t fixupAddress = atomAddress + offset;
     if (relocatable) {
       applyFixupRelocatable(*ref, &atomContentBuffer[offset], fixupAddress,
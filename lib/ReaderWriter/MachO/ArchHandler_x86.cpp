@@ -420,13 +420,13 @@ void ArchHandler_x86::generateAtomContent(const DefinedAtom &atom,
   std::copy(atom.rawContent().begin(), atom.rawContent().end(),
             atomContentBuffer.begin());
   // Apply fix-ups.
+  uint64_t atomAddress = findAddress(atom);
   for (const Reference *ref : atom) {
     uint32_t offset = ref->offsetInAtom();
     const Atom *target = ref->target();
     uint64_t targetAddress = 0;
     if (isa<DefinedAtom>(target))
       targetAddress = findAddress(*target);
-    uint64_t atomAddress = findAddress(atom);
     uint64_t fixupAddress = atomAddress + offset;
     if (relocatable) {
       applyFixupRelocatable(*ref, &atomContentBuffer[offset],
@@ -17,7 +17,6 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include <cstdint>
-#include <string>
 
 namespace lld {
 
@@ -133,7 +132,11 @@ public:
   ArrayRef<uint8_t> rawContent() const override { return ArrayRef<uint8_t>(); }
 
 private:
-  const std::string _name;
+  // Not a std::string: the creating file copies the name into its
+  // allocator when needed (see MachOFile::addTentativeDefAtom), the
+  // same lifetime contract every other atom's name uses. Big links
+  // make enough of these that a heap string per atom shows up.
+  const StringRef _name;
   const Scope _scope;
   const uint64_t _size;
   const DefinedAtom::Alignment _align;
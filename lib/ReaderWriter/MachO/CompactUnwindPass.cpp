@@ -20,6 +20,7 @@
 #include "lld/Core/DefinedAtom.h"
 #include "lld/Core/File.h"
 #include "lld/Core/LLVM.h"
+#include "lld/Core/Parallel.h"
 #include "lld/Core/Reference.h"
 #include "lld/Core/Simple.h"
 #include "llvm/ADT/DenseMap.h"
@@ -452,24 +453,32 @@ private:
       const std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
       const std::vector<const Atom *> &personalities,
       const std::map<const Atom *, const Atom *> &dwarfFrames) {
-    std::vector<CompactUnwindEntry> unwindInfos;
-
     DEBUG(llvm::dbgs() << "  Creating __unwind_info entries\n");
     // The final order in the __unwind_info section must be derived from the
     // order of typeCode atoms, since that's how they'll be put into the object
     // file eventually (yuck!).
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      if (atom->contentType() != DefinedAtom::typeCode)
-        continue;
-
-      unwindInfos.push_back(finalizeUnwindInfoEntryForAtom(
-          atom, unwindLocs, personalities, dwarfFrames));
-
-      DEBUG(llvm::dbgs() << "    Entry for " << atom->name()
+    std::vector<const DefinedAtom *> functions;
+    for (const DefinedAtom *atom : mergedFile.defined())
+      if (atom->contentType() == DefinedAtom::typeCode)
+        functions.push_back(atom);
+
+    // Each entry is finalized independently from the read-only maps
+    // built above, and each iteration writes only its own slot, so the
+    // per-function work can be spread across threads while the output
+    // order stays that of the serial walk.
+    std::vector<CompactUnwindEntry> unwindInfos(functions.size());
+    parallel_for_each(functions.begin(), functions.end(),
+                      [&](const DefinedAtom *const &function) {
+      size_t idx = &function - functions.data();
+      unwindInfos[idx] = finalizeUnwindInfoEntryForAtom(
+          function, unwindLocs, personalities, dwarfFrames);
+    }, 64);
+
+    DEBUG(for (const CompactUnwindEntry &entry : unwindInfos)
+            llvm::dbgs() << "    Entry for " << entry.rangeStart->name()
                          << ", final encoding="
-                         << llvm::format("0x%08x", unwindInfos.back().encoding)
+                         << llvm::format("0x%08x", entry.encoding)
                          << '\n');
-    }
 
     return unwindInfos;
   }
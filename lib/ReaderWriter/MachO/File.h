@@ -16,6 +16,8 @@
 #include "lld/Core/Simple.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include <mutex>
 #include <unordered_map>
 
 namespace lld {
@@ -130,6 +132,15 @@ public:
     _undefAtoms[name] = atom;
   }
 
+  /// Reserve room for \p count more atoms in 'inSection' (and in the
+  /// file's defined-atom list) ahead of a batch of addDefinedAtom()
+  /// calls for that section.
+  void reserveAtomsForSection(const Section *inSection, size_t count) {
+    auto &vec = _sectionAtoms[inSection];
+    vec.reserve(vec.size() + count);
+    reserveDefinedAtoms(count);
+  }
+
   /// Search this file for an the atom from 'section' that covers
   /// 'offsetInSect'.  Returns nullptr is no atom found.
   MachODefinedAtom *findAtomCoveringAddress(const Section &section,
@@ -267,6 +278,60 @@ private:
   normalized::FileFlags        _flags = llvm::MachO::MH_SUBSECTIONS_VIA_SYMBOLS;
 };
 
+/// Process-lifetime cache of dylib export tables. A resident process
+/// that performs many links (such as a build daemon driving lld as a
+/// library) re-parses the same SDK dylibs on every invocation, and that
+/// parse is pure overhead: a dylib's export list is immutable for as
+/// long as the file on disk is unchanged. Entries are validated by file
+/// size and modification time and shared across linking contexts; they
+/// are never evicted since the set of dylibs a process links against is
+/// small.
+class DylibExportCache {
+public:
+  struct Entry {
+    std::string installName;
+    uint32_t currentVersion = 0;
+    uint32_t compatVersion = 0;
+    /// Exported symbol names paired with their weak-definition flag.
+    std::vector<std::pair<std::string, bool>> exports;
+    std::vector<std::string> reExportedDylibs;
+    uint64_t size = 0;
+    uint64_t mtime = 0;
+  };
+
+  static DylibExportCache &instance() {
+    static DylibExportCache cache;
+    return cache;
+  }
+
+  /// Returns the cached entry for \p path, or nullptr if none is cached
+  /// or the file on disk no longer matches \p size and \p mtime. The
+  /// returned entry is immutable; holding the shared_ptr keeps its
+  /// strings valid even if the entry is later replaced.
+  std::shared_ptr<const Entry> lookup(StringRef path, uint64_t size,
+                                      uint64_t mtime) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto pos = _entries.find(path);
+    if (pos == _entries.end())
+      return nullptr;
+    if (pos->second->size != size || pos->second->mtime != mtime)
+      return nullptr;
+    return pos->second;
+  }
+
+  void add(StringRef path, uint64_t size, uint64_t mtime, Entry entry) {
+    entry.size = size;
+    entry.mtime = mtime;
+    auto shared = std::make_shared<const Entry>(std::move(entry));
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries[path] = std::move(shared);
+  }
+
+private:
+  std::mutex _mutex;
+  llvm::StringMap<std::shared_ptr<const Entry>> _entries;
+};
+
 class MachODylibFile : public SharedLibraryFile {
 public:
   MachODylibFile(std::unique_ptr<MemoryBuffer> mb, MachOLinkingContext *ctx)
@@ -316,6 +381,25 @@ public:
   StringRef getDSOName() const override { return _installName; }
 
   std::error_code doParse() override {
+    // Successive links in a resident process mostly see the same SDK
+    // dylibs; serve their export tables from the process-lifetime cache
+    // when the file on disk is unchanged instead of re-parsing the
+    // binary.
+    uint64_t mtime = 0;
+    bool haveStat = false;
+    llvm::sys::fs::file_status stat;
+    if (!llvm::sys::fs::status(path(), stat)) {
+      mtime = stat.getLastModificationTime().toEpochTime();
+      haveStat = true;
+    }
+    if (haveStat) {
+      if (auto entry = DylibExportCache::instance().lookup(
+                                     path(), _mb->getBufferSize(), mtime)) {
+        populate(*entry);
+        _cacheEntry = std::move(entry);
+        return std::error_code();
+      }
+    }
     // Convert binary file to normalized mach-o.
     auto normFile = normalized::readBinary(_mb, _ctx->arch());
     if (auto ec = normFile.takeError())
@@ -323,10 +407,42 @@ public:
     // Convert normalized mach-o to atoms.
     if (auto ec = normalized::normalizedDylibToAtoms(this, **normFile, false))
       return llvm::errorToErrorCode(std::move(ec));
+    if (haveStat)
+      DylibExportCache::instance().add(path(), _mb->getBufferSize(), mtime,
+                                       makeCacheEntry());
     return std::error_code();
   }
 
 private:
+  /// Fills in this file from a cache entry. The entry (kept alive by
+  /// _cacheEntry) owns the strings, so nothing needs copying into this
+  /// file's allocator.
+  void populate(const DylibExportCache::Entry &entry) {
+    setInstallName(entry.installName);
+    setCurrentVersion(entry.currentVersion);
+    setCompatVersion(entry.compatVersion);
+    for (const auto &exp : entry.exports)
+      addExportedSymbol(exp.first, exp.second, false);
+    for (const std::string &dep : entry.reExportedDylibs)
+      addReExportedDylib(dep);
+  }
+
+  /// Snapshots this file's export table for the cache, copying every
+  /// string out of this file's allocator.
+  DylibExportCache::Entry makeCacheEntry() const {
+    DylibExportCache::Entry entry;
+    entry.installName = _installName.str();
+    entry.currentVersion = _currentVersion;
+    entry.compatVersion = _compatVersion;
+    entry.exports.reserve(_nameToAtom.size());
+    for (const auto &exp : _nameToAtom)
+      entry.exports.push_back(std::make_pair(exp.first.str(),
+                                             exp.second.weakDef));
+    for (const ReExportedDylib &dep : _reExportedDylibs)
+      entry.reExportedDylibs.push_back(dep.path.str());
+    return entry;
+  }
+
   OwningAtomPtr<SharedLibraryAtom> exports(StringRef name,
                                    StringRef installName) const {
     // First, check if requested symbol is directly implemented by this dylib.
@@ -378,6 +494,9 @@ private:
   uint32_t                                   _compatVersion;
   std::vector<ReExportedDylib>               _reExportedDylibs;
   mutable std::unordered_map<StringRef, AtomAndFlags> _nameToAtom;
+  // Keeps the strings this file references alive when it was populated
+  // from the export cache.
+  std::shared_ptr<const DylibExportCache::Entry> _cacheEntry;
 };
 
 } // end namespace mach_o
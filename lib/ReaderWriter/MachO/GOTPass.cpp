@@ -91,34 +91,34 @@ private:
 ///
 class GOTPass : public Pass {
 public:
-  GOTPass(const MachOLinkingContext &context)
+  GOTPass(const MachOLinkingContext &context,
+          std::shared_ptr<ReferenceWorklists> worklists)
       : _ctx(context), _archHandler(_ctx.archHandler()),
-        _file(*_ctx.make_file<MachOFile>("<mach-o GOT Pass>")) {
+        _file(*_ctx.make_file<MachOFile>("<mach-o GOT Pass>")),
+        _worklists(std::move(worklists)) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
 private:
   llvm::Error perform(SimpleFile &mergedFile) override {
-    // Scan all references in all atoms.
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        // Look at instructions accessing the GOT.
-        bool canBypassGOT;
-        if (!_archHandler.isGOTAccess(*ref, canBypassGOT))
-          continue;
-        const Atom *target = ref->target();
-        assert(target != nullptr);
-
-        if (!shouldReplaceTargetWithGOTAtom(target, canBypassGOT)) {
-          // Update reference kind to reflect that target is a direct accesss.
-          _archHandler.updateReferenceToGOT(ref, false);
-        } else {
-          // Replace the target with a reference to a GOT entry.
-          const DefinedAtom *gotEntry = makeGOTEntry(target);
-          const_cast<Reference *>(ref)->setTarget(gotEntry);
-          // Update reference kind to reflect that target is now a GOT entry.
-          _archHandler.updateReferenceToGOT(ref, true);
-        }
+    // Walk the instructions accessing the GOT, found by the shared
+    // classification sweep.
+    _worklists->scanOnce(mergedFile, _archHandler);
+    for (auto &use : _worklists->gotAccesses()) {
+      const Reference *ref = use.first;
+      bool canBypassGOT = use.second;
+      const Atom *target = ref->target();
+      assert(target != nullptr);
+
+      if (!shouldReplaceTargetWithGOTAtom(target, canBypassGOT)) {
+        // Update reference kind to reflect that target is a direct accesss.
+        _archHandler.updateReferenceToGOT(ref, false);
+      } else {
+        // Replace the target with a reference to a GOT entry.
+        const DefinedAtom *gotEntry = makeGOTEntry(target);
+        const_cast<Reference *>(ref)->setTarget(gotEntry);
+        // Update reference kind to reflect that target is now a GOT entry.
+        _archHandler.updateReferenceToGOT(ref, true);
       }
     }
 
@@ -172,12 +172,14 @@ private:
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler                             &_archHandler;
   MachOFile                                       &_file;
+  std::shared_ptr<ReferenceWorklists>              _worklists;
   llvm::DenseMap<const Atom*, const GOTEntryAtom*> _targetToGOT;
 };
 
-void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx) {
+void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx,
+                std::shared_ptr<ReferenceWorklists> worklists) {
   assert(ctx.needsGOTPass());
-  pm.add(llvm::make_unique<GOTPass>(ctx));
+  pm.add(llvm::make_unique<GOTPass>(ctx, std::move(worklists)));
 }
 
 } // end namesapce mach_o
@@ -16,6 +16,7 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Debug.h"
 #include <algorithm>
+#include <limits>
 #include <set>
 #include <utility>
 
@@ -27,8 +28,7 @@ namespace lld {
 namespace mach_o {
 
 static bool compareAtoms(const LayoutPass::SortKey &,
-                         const LayoutPass::SortKey &,
-                         LayoutPass::SortOverride customSorter);
+                         const LayoutPass::SortKey &);
 
 #ifndef NDEBUG
 // Return "reason (leftval, rightval)"
@@ -40,12 +40,11 @@ static std::string formatReason(StringRef reason, int leftVal, int rightVal) {
 // Less-than relationship of two atoms must be transitive, which is, if a < b
 // and b < c, a < c must be true. This function checks the transitivity by
 // checking the sort results.
-static void checkTransitivity(std::vector<LayoutPass::SortKey> &vec,
-                              LayoutPass::SortOverride customSorter) {
+static void checkTransitivity(std::vector<LayoutPass::SortKey> &vec) {
   for (auto i = vec.begin(), e = vec.end(); (i + 1) != e; ++i) {
     for (auto j = i + 1; j != e; ++j) {
-      assert(compareAtoms(*i, *j, customSorter));
-      assert(!compareAtoms(*j, *i, customSorter));
+      assert(compareAtoms(*i, *j));
+      assert(!compareAtoms(*j, *i));
     }
   }
 }
@@ -170,12 +169,11 @@ void LayoutPass::checkFollowonChain(const File::AtomRange<DefinedAtom> &range) {
 /// a) Sorts atoms by their ordinal overrides (layout-after/ingroup)
 /// b) Sorts atoms by their permissions
 /// c) Sorts atoms by their content
-/// d) Sorts atoms by custom sorter
+/// d) Sorts atoms by their -order_file position
 /// e) Sorts atoms on how they appear using File Ordinality
 /// f) Sorts atoms on how they appear within the File
 static bool compareAtomsSub(const LayoutPass::SortKey &lc,
                             const LayoutPass::SortKey &rc,
-                            LayoutPass::SortOverride customSorter,
                             std::string &reason) {
   const DefinedAtom *left = lc._atom.get();
   const DefinedAtom *right = rc._atom.get();
@@ -195,50 +193,43 @@ static bool compareAtomsSub(const LayoutPass::SortKey &lc,
     return lc._override < rc._override;
   }
 
-  // Sort same permissions together.
-  DefinedAtom::ContentPermissions leftPerms = leftRoot->permissions();
-  DefinedAtom::ContentPermissions rightPerms = rightRoot->permissions();
+  // The remaining criteria are the root's attributes, cached as plain
+  // integers in the sort key when it was built.
 
-  if (leftPerms != rightPerms) {
+  // Sort same permissions together.
+  if (lc._perms != rc._perms) {
     DEBUG(reason =
-              formatReason("contentPerms", (int)leftPerms, (int)rightPerms));
-    return leftPerms < rightPerms;
+              formatReason("contentPerms", (int)lc._perms, (int)rc._perms));
+    return lc._perms < rc._perms;
   }
 
   // Sort same content types together.
-  DefinedAtom::ContentType leftType = leftRoot->contentType();
-  DefinedAtom::ContentType rightType = rightRoot->contentType();
-
-  if (leftType != rightType) {
-    DEBUG(reason = formatReason("contentType", (int)leftType, (int)rightType));
-    return leftType < rightType;
+  if (lc._type != rc._type) {
+    DEBUG(reason = formatReason("contentType", (int)lc._type, (int)rc._type));
+    return lc._type < rc._type;
   }
 
-  // Use custom sorter if supplied.
-  if (customSorter) {
-    bool leftBeforeRight;
-    if (customSorter(leftRoot, rightRoot, leftBeforeRight))
-      return leftBeforeRight;
+  // Sort atoms listed in an order file ahead of those not listed, in
+  // the order they were listed. Unlisted atoms share the same sentinel
+  // value and fall through to the criteria below.
+  if (lc._orderOverride != rc._orderOverride) {
+    DEBUG(reason = formatReason("order file", (int)lc._orderOverride,
+                                (int)rc._orderOverride));
+    return lc._orderOverride < rc._orderOverride;
   }
 
   // Sort by .o order.
-  const File *leftFile = &leftRoot->file();
-  const File *rightFile = &rightRoot->file();
-
-  if (leftFile != rightFile) {
-    DEBUG(reason = formatReason(".o order", (int)leftFile->ordinal(),
-                                (int)rightFile->ordinal()));
-    return leftFile->ordinal() < rightFile->ordinal();
+  if (lc._fileOrdinal != rc._fileOrdinal) {
+    DEBUG(reason = formatReason(".o order", (int)lc._fileOrdinal,
+                                (int)rc._fileOrdinal));
+    return lc._fileOrdinal < rc._fileOrdinal;
   }
 
   // Sort by atom order with .o file.
-  uint64_t leftOrdinal = leftRoot->ordinal();
-  uint64_t rightOrdinal = rightRoot->ordinal();
-
-  if (leftOrdinal != rightOrdinal) {
-    DEBUG(reason = formatReason("ordinal", (int)leftRoot->ordinal(),
-                                (int)rightRoot->ordinal()));
-    return leftOrdinal < rightOrdinal;
+  if (lc._rootOrdinal != rc._rootOrdinal) {
+    DEBUG(reason = formatReason("ordinal", (int)lc._rootOrdinal,
+                                (int)rc._rootOrdinal));
+    return lc._rootOrdinal < rc._rootOrdinal;
   }
 
   llvm::errs() << "Unordered: <" << left->name() << "> <"
@@ -247,10 +238,9 @@ static bool compareAtomsSub(const LayoutPass::SortKey &lc,
 }
 
 static bool compareAtoms(const LayoutPass::SortKey &lc,
-                         const LayoutPass::SortKey &rc,
-                         LayoutPass::SortOverride customSorter) {
+                         const LayoutPass::SortKey &rc) {
   std::string reason;
-  bool result = compareAtomsSub(lc, rc, customSorter, reason);
+  bool result = compareAtomsSub(lc, rc, reason);
   DEBUG({
     StringRef comp = result ? "<" : ">=";
     llvm::dbgs() << "Layout: '" << lc._atom.get()->name()
@@ -269,7 +259,7 @@ const DefinedAtom *LayoutPass::findAtomFollowedBy(
     const DefinedAtom *targetAtom) {
   // Start from the beginning of the chain and follow the chain until
   // we find the targetChain.
-  const DefinedAtom *atom = _followOnRoots[targetAtom];
+  const DefinedAtom *atom = findRoot(targetAtom);
   while (true) {
     const DefinedAtom *prevAtom = atom;
     AtomToAtomT::iterator targetFollowOnAtomsIter = _followOnNexts.find(atom);
@@ -287,7 +277,7 @@ const DefinedAtom *LayoutPass::findAtomFollowedBy(
 // atom and the targetAtom (specified by layout-after) need to be of size zero
 // in this case. Otherwise the desired layout is impossible.
 bool LayoutPass::checkAllPrevAtomsZeroSize(const DefinedAtom *targetAtom) {
-  const DefinedAtom *atom = _followOnRoots[targetAtom];
+  const DefinedAtom *atom = findRoot(targetAtom);
   while (true) {
     if (atom == targetAtom)
       return true;
@@ -302,18 +292,27 @@ bool LayoutPass::checkAllPrevAtomsZeroSize(const DefinedAtom *targetAtom) {
   }
 }
 
-// Set the root of all atoms in targetAtom's chain to the given root.
-void LayoutPass::setChainRoot(const DefinedAtom *targetAtom,
-                              const DefinedAtom *root) {
-  // Walk through the followon chain and override each node's root.
+// Find the root of the chain the given atom belongs to. While the
+// follow-on table is being built, _followOnRoots is a union-find parent
+// forest: merging two chains just re-parents one chain head under the
+// other instead of rewriting every member's entry, and this find
+// compresses the path it walked so later lookups are near-constant.
+const DefinedAtom *LayoutPass::findRoot(const DefinedAtom *atom) {
+  const DefinedAtom *root = atom;
   while (true) {
-    _followOnRoots[targetAtom] = root;
-    AtomToAtomT::iterator targetFollowOnAtomsIter =
-        _followOnNexts.find(targetAtom);
-    if (targetFollowOnAtomsIter == _followOnNexts.end())
-      return;
-    targetAtom = targetFollowOnAtomsIter->second;
+    AtomToAtomT::iterator parentIter = _followOnRoots.find(root);
+    assert(parentIter != _followOnRoots.end());
+    if (parentIter->second == root)
+      break;
+    root = parentIter->second;
   }
+  // Point every atom on the walked path directly at the root.
+  while (atom != root) {
+    AtomToAtomT::iterator parentIter = _followOnRoots.find(atom);
+    atom = parentIter->second;
+    parentIter->second = root;
+  }
+  return root;
 }
 
 /// This pass builds the followon tables described by two DenseMaps
@@ -350,26 +349,21 @@ void LayoutPass::buildFollowOnTable(const File::AtomRange<DefinedAtom> &range) {
       if (_followOnRoots.count(ai) == 0)
         _followOnRoots[ai] = ai;
 
-      auto iter = _followOnRoots.find(targetAtom);
-      if (iter == _followOnRoots.end()) {
+      if (_followOnRoots.find(targetAtom) == _followOnRoots.end()) {
         // If the targetAtom is not a root of any chain, let's make the root of
         // the targetAtom to the root of the current chain.
 
-        // The expression m[i] = m[j] where m is a DenseMap and i != j is not
-        // safe. m[j] returns a reference, which would be invalidated when a
-        // rehashing occurs. If rehashing occurs to make room for m[i], m[j]
-        // becomes invalid, and that invalid reference would be used as the RHS
-        // value of the expression.
-        // Copy the value to workaround.
-        const DefinedAtom *tmp = _followOnRoots[ai];
-        _followOnRoots[targetAtom] = tmp;
+        // The root is copied to a local first: findRoot() returns before
+        // the insertion below can rehash the map.
+        const DefinedAtom *root = findRoot(ai);
+        _followOnRoots[targetAtom] = root;
         continue;
       }
-      if (iter->second == targetAtom) {
+      if (findRoot(targetAtom) == targetAtom) {
         // If the targetAtom is the root of a chain, the chain becomes part of
-        // the current chain. Rewrite the subchain's root to the current
-        // chain's root.
-        setChainRoot(targetAtom, _followOnRoots[ai]);
+        // the current chain. Re-parent the subchain's head under the current
+        // chain's root; members resolve through it on their next find.
+        _followOnRoots[targetAtom] = findRoot(ai);
         continue;
       }
       // The targetAtom is already a part of a chain. If the current atom is
@@ -383,16 +377,23 @@ void LayoutPass::buildFollowOnTable(const File::AtomRange<DefinedAtom> &range) {
       if (currentAtomSize == 0) {
         const DefinedAtom *targetPrevAtom = findAtomFollowedBy(targetAtom);
         _followOnNexts[targetPrevAtom] = ai;
-        const DefinedAtom *tmp = _followOnRoots[targetPrevAtom];
-        _followOnRoots[ai] = tmp;
+        const DefinedAtom *root = findRoot(targetPrevAtom);
+        _followOnRoots[ai] = root;
         continue;
       }
       if (!checkAllPrevAtomsZeroSize(targetAtom))
         break;
-      _followOnNexts[ai] = _followOnRoots[targetAtom];
-      setChainRoot(_followOnRoots[targetAtom], _followOnRoots[ai]);
+      const DefinedAtom *targetRoot = findRoot(targetAtom);
+      _followOnNexts[ai] = targetRoot;
+      _followOnRoots[targetRoot] = findRoot(ai);
     }
   }
+
+  // Flatten the union-find forest so that every entry maps directly to
+  // its chain's head; everything after this reads the map as exact
+  // roots.
+  for (auto &entry : _followOnRoots)
+    entry.second = findRoot(entry.first);
 }
 
 /// Build an ordinal override map by traversing the followon chain, and
@@ -427,7 +428,13 @@ LayoutPass::decorate(File::AtomRange<DefinedAtom> &atomRange) const {
     auto oi = _ordinalOverrideMap.find(atom.get());
     const auto *root = (ri == _followOnRoots.end()) ? atom.get() : ri->second;
     uint64_t override = (oi == _ordinalOverrideMap.end()) ? 0 : oi->second;
-    ret.push_back(SortKey(std::move(atom), root, override));
+    // Look up the root's explicit -order_file position once, here,
+    // rather than on every comparison in the sort.
+    uint64_t orderOverride = std::numeric_limits<uint64_t>::max();
+    unsigned explicitOrdinal;
+    if (_customSorter && _customSorter(root, explicitOrdinal))
+      orderOverride = explicitOrdinal;
+    ret.push_back(SortKey(std::move(atom), root, override, orderOverride));
   }
   return ret;
 }
@@ -463,9 +470,9 @@ llvm::Error LayoutPass::perform(SimpleFile &mergedFile) {
   std::vector<LayoutPass::SortKey> vec = decorate(atomRange);
   parallel_sort(vec.begin(), vec.end(),
       [&](const LayoutPass::SortKey &l, const LayoutPass::SortKey &r) -> bool {
-        return compareAtoms(l, r, _customSorter);
+        return compareAtoms(l, r);
       });
-  DEBUG(checkTransitivity(vec, _customSorter));
+  DEBUG(checkTransitivity(vec));
   undecorate(atomRange, vec);
 
   DEBUG({
@@ -479,9 +486,8 @@ llvm::Error LayoutPass::perform(SimpleFile &mergedFile) {
 
 void addLayoutPass(PassManager &pm, const MachOLinkingContext &ctx) {
   pm.add(llvm::make_unique<LayoutPass>(
-      ctx.registry(), [&](const DefinedAtom * left, const DefinedAtom * right,
-                          bool & leftBeforeRight) ->bool {
-    return ctx.customAtomOrderer(left, right, leftBeforeRight);
+      ctx.registry(), [&](const DefinedAtom *atom, unsigned &ordinal) -> bool {
+    return ctx.orderOrdinalForAtom(atom, ordinal);
   }));
 }
 
@@ -34,16 +34,32 @@ class LayoutPass : public Pass {
 public:
   struct SortKey {
     SortKey(OwningAtomPtr<DefinedAtom> &&atom,
-            const DefinedAtom *root, uint64_t override)
-    : _atom(std::move(atom)), _root(root), _override(override) {}
+            const DefinedAtom *root, uint64_t override, uint64_t orderOverride)
+    : _atom(std::move(atom)), _root(root), _override(override),
+      _orderOverride(orderOverride),
+      _perms(root->permissions()), _type(root->contentType()),
+      _fileOrdinal(root->file().ordinal()), _rootOrdinal(root->ordinal()) {}
     OwningAtomPtr<DefinedAtom> _atom;
     const DefinedAtom *_root;
     uint64_t _override;
+    // The root's explicit -order_file position, or UINT64_MAX if the
+    // root is not listed, so ordered atoms sort to the front.
+    uint64_t _orderOverride;
+    // The root's sort-relevant attributes, cached so the comparator
+    // works on plain integers instead of virtual atom accessors.
+    uint32_t _perms;
+    uint32_t _type;
+    uint64_t _fileOrdinal;
+    uint64_t _rootOrdinal;
 
     // Note, these are only here to appease MSVC bots which didn't like
     // the same methods being implemented/deleted in OwningAtomPtr.
     SortKey(SortKey &&key) : _atom(std::move(key._atom)), _root(key._root),
-                             _override(key._override) {
+                             _override(key._override),
+                             _orderOverride(key._orderOverride),
+                             _perms(key._perms),
+                             _type(key._type), _fileOrdinal(key._fileOrdinal),
+                             _rootOrdinal(key._rootOrdinal) {
       key._root = nullptr;
     }
 
@@ -52,6 +68,11 @@ public:
       _root = key._root;
       key._root = nullptr;
       _override = key._override;
+      _orderOverride = key._orderOverride;
+      _perms = key._perms;
+      _type = key._type;
+      _fileOrdinal = key._fileOrdinal;
+      _rootOrdinal = key._rootOrdinal;
       return *this;
     }
 
@@ -60,8 +81,12 @@ public:
     void operator=(const SortKey&) = delete;
   };
 
-  typedef std::function<bool (const DefinedAtom *left, const DefinedAtom *right,
-                              bool &leftBeforeRight)> SortOverride;
+  /// Returns an atom's explicit position from -order_file style options
+  /// in \p ordinal, or returns false if the atom has no explicit
+  /// position. Consulted once per atom while building sort keys rather
+  /// than per comparison.
+  typedef std::function<bool (const DefinedAtom *atom,
+                              unsigned &ordinal)> SortOverride;
 
   LayoutPass(const Registry &registry, SortOverride sorter);
 
@@ -94,6 +119,10 @@ private:
   // A map to be used to sort atoms. It's a map from an atom to its root of
   // follow-on chain. A root atom is mapped to itself. If an atom is not in
   // _followOnNexts, the atom is not in this map, and vice versa.
+  // While buildFollowOnTable() runs this is a union-find parent forest:
+  // entries may point at intermediate atoms rather than the chain head,
+  // and findRoot() resolves (and compresses) them. The table is
+  // flattened to exact roots before anything else reads it.
   AtomToAtomT _followOnRoots;
 
   AtomToOrdinalT _ordinalOverrideMap;
@@ -102,7 +131,7 @@ private:
   const DefinedAtom *findAtomFollowedBy(const DefinedAtom *targetAtom);
   bool checkAllPrevAtomsZeroSize(const DefinedAtom *targetAtom);
 
-  void setChainRoot(const DefinedAtom *targetAtom, const DefinedAtom *root);
+  const DefinedAtom *findRoot(const DefinedAtom *atom);
 
   std::vector<SortKey> decorate(File::AtomRange<DefinedAtom> &atomRange) const;
 
@@ -646,12 +646,16 @@ void MachOLinkingContext::addPasses(PassManager &pm) {
     mach_o::addStubsPass(pm, *this);
   if (needsCompactUnwindPass())
     mach_o::addCompactUnwindPass(pm, *this);
+  // The GOT, TLV, and shim passes share one classification sweep over
+  // the merged file instead of each scanning every reference.
+  auto worklists = std::make_shared<mach_o::ReferenceWorklists>();
   if (needsGOTPass())
-    mach_o::addGOTPass(pm, *this);
+    mach_o::addGOTPass(pm, *this, worklists);
   if (needsTLVPass())
-    mach_o::addTLVPass(pm, *this);
+    mach_o::addTLVPass(pm, *this, worklists);
   if (needsShimPass())
-    mach_o::addShimPass(pm, *this); // Shim pass must run after stubs pass.
+    // Shim pass must run after stubs pass.
+    mach_o::addShimPass(pm, *this, std::move(worklists));
 }
 
 Writer &MachOLinkingContext::writer() const {
@@ -975,44 +979,22 @@ MachOLinkingContext::findOrderOrdinal(const std::vector<OrderFileNode> &nodes,
   return false;
 }
 
-bool MachOLinkingContext::customAtomOrderer(const DefinedAtom *left,
-                                            const DefinedAtom *right,
-                                            bool &leftBeforeRight) const {
-  // No custom sorting if no order file entries.
+bool MachOLinkingContext::orderOrdinalForAtom(const DefinedAtom *atom,
+                                              unsigned &ordinal) const {
   if (!_orderFileEntries)
     return false;
 
   // Order files can only order named atoms.
-  StringRef leftName = left->name();
-  StringRef rightName = right->name();
-  if (leftName.empty() || rightName.empty())
+  StringRef name = atom->name();
+  if (name.empty())
     return false;
 
-  // If neither is in order file list, no custom sorter.
-  auto leftPos = _orderFiles.find(leftName);
-  auto rightPos = _orderFiles.find(rightName);
-  bool leftIsOrdered = (leftPos != _orderFiles.end());
-  bool rightIsOrdered = (rightPos != _orderFiles.end());
-  if (!leftIsOrdered && !rightIsOrdered)
+  auto pos = _orderFiles.find(name);
+  if (pos == _orderFiles.end())
     return false;
 
   // There could be multiple symbols with same name but different file prefixes.
-  unsigned leftOrder;
-  unsigned rightOrder;
-  bool foundLeft =
-      leftIsOrdered && findOrderOrdinal(leftPos->getValue(), left, leftOrder);
-  bool foundRight = rightIsOrdered &&
-                    findOrderOrdinal(rightPos->getValue(), right, rightOrder);
-  if (!foundLeft && !foundRight)
-    return false;
-
-  // If only one is in order file list, ordered one goes first.
-  if (foundLeft != foundRight)
-    leftBeforeRight = foundLeft;
-  else
-    leftBeforeRight = (leftOrder < rightOrder);
-
-  return true;
+  return findOrderOrdinal(pos->getValue(), atom, ordinal);
 }
 
 static bool isLibrary(const std::unique_ptr<Node> &elem) {
@@ -14,6 +14,10 @@
 ///
 /// The normalized view easily converts to and from YAML using YAML I/O.
 ///
+/// The normalized view also converts to and from a compact binary snapshot
+/// using the writeSnapshot() and readSnapshot() functions, which carries the
+/// same information as the YAML encoding but loads much faster.
+///
 /// The normalized view converts to and from binary mach-o object files using
 /// the writeBinary() and readBinary() functions.
 ///
@@ -306,6 +310,18 @@ readYaml(std::unique_ptr<MemoryBuffer> &mb);
 /// Writes a yaml encoded mach-o files given an in-memory normalized view.
 std::error_code writeYaml(const NormalizedFile &file, raw_ostream &out);
 
+/// Parses a compact binary snapshot to produce an in-memory normalized
+/// view. The returned file owns copies of everything it references, so
+/// the buffer may be released after this returns.
+llvm::Expected<std::unique_ptr<NormalizedFile>>
+readSnapshot(std::unique_ptr<MemoryBuffer> &mb);
+
+/// Writes a compact binary snapshot of an in-memory normalized view.
+/// Snapshots carry the same information as the yaml encoding but load
+/// in one linear pass, so they suit machine-produced caches of
+/// normalized files.
+std::error_code writeSnapshot(const NormalizedFile &file, raw_ostream &out);
+
 llvm::Error
 normalizedObjectToAtoms(MachOFile *file,
                         const NormalizedFile &normalizedFile,
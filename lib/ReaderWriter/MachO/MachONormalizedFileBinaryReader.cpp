@@ -26,6 +26,8 @@
 #include "MachONormalizedFileBinaryUtils.h"
 #include "lld/Core/Error.h"
 #include "lld/Core/LLVM.h"
+#include "lld/Core/PageAdvise.h"
+#include "lld/Core/Parallel.h"
 #include "lld/Core/SharedLibraryFile.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
@@ -202,6 +204,10 @@ bool sliceFromFatFile(MemoryBufferRef mb, MachOLinkingContext::Arch arch,
 llvm::Expected<std::unique_ptr<NormalizedFile>>
 readBinary(std::unique_ptr<MemoryBuffer> &mb,
            const MachOLinkingContext::Arch arch) {
+  // The whole file is about to be walked; start readahead so cold
+  // pages stream in ahead of the parse.
+  adviseBuffer(mb->getMemBufferRef(), PageAdvice::WillNeed);
+
   // Make empty NormalizedFile.
   std::unique_ptr<NormalizedFile> f(new NormalizedFile());
 
@@ -253,6 +259,13 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
   f->fileType = HeaderFileType(smh->filetype);
   f->flags = smh->flags;
 
+  // Object files are decoded in full. For dylibs (and dylib stubs)
+  // only the tables their consumer actually reads -- exported symbols,
+  // install name, dependent dylibs -- are materialized; relocations,
+  // local symbols and data-in-code would just bloat the normalized
+  // view of a large SDK dylib that is only linked against.
+  const bool isObject = (f->fileType == MH_OBJECT);
+
 
   // Pre-scan load commands looking for indirect symbol table.
   uint32_t indirectSymbolTableOffset = 0;
@@ -272,6 +285,14 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
     return std::move(ec);
 
   // Walk load commands looking for segments/sections and the symbol table.
+  // Relocation lists are only located during the walk; they are decoded
+  // afterwards, all sections in parallel.
+  struct RelocLoc {
+    size_t sectionIndex;
+    uint32_t reloff;
+    uint32_t nreloc;
+  };
+  std::vector<RelocLoc> relocLocs;
   const data_in_code_entry *dataInCode = nullptr;
   const dyld_info_command *dyldInfo = nullptr;
   uint32_t dataInCodeSize = 0;
@@ -303,19 +324,22 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
           const uint8_t *content =
             (const uint8_t *)start + read32(&sect->offset, isBig);
           size_t contentSize = read64(&sect->size, isBig);
-          // Note: this assign() is copying the content bytes.  Ideally,
-          // we can use a custom allocator for vector to avoid the copy.
+          // The content is a zero-copy view into the mapped input.
           section.content = llvm::makeArrayRef(content, contentSize);
-          appendRelocations(section.relocations, mb->getBuffer(), isBig,
-                            read32(&sect->reloff, isBig),
-                            read32(&sect->nreloc, isBig));
-          if (section.type == S_NON_LAZY_SYMBOL_POINTERS) {
-            appendIndirectSymbols(section.indirectSymbols, mb->getBuffer(),
-                                  isBig,
-                                  indirectSymbolTableOffset,
-                                  indirectSymbolTableCount,
-                                  read32(&sect->reserved1, isBig),
-                                  contentSize/4);
+          if (isObject) {
+            RelocLoc loc;
+            loc.sectionIndex = f->sections.size();
+            loc.reloff = read32(&sect->reloff, isBig);
+            loc.nreloc = read32(&sect->nreloc, isBig);
+            relocLocs.push_back(loc);
+            if (section.type == S_NON_LAZY_SYMBOL_POINTERS) {
+              appendIndirectSymbols(section.indirectSymbols, mb->getBuffer(),
+                                    isBig,
+                                    indirectSymbolTableOffset,
+                                    indirectSymbolTableCount,
+                                    read32(&sect->reserved1, isBig),
+                                    contentSize/4);
+            }
           }
           f->sections.push_back(section);
         }
@@ -347,17 +371,20 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
           const uint8_t *content =
             (const uint8_t *)start + read32(&sect->offset, isBig);
           size_t contentSize = read32(&sect->size, isBig);
-          // Note: this assign() is copying the content bytes.  Ideally,
-          // we can use a custom allocator for vector to avoid the copy.
+          // The content is a zero-copy view into the mapped input.
           section.content = llvm::makeArrayRef(content, contentSize);
-          appendRelocations(section.relocations, mb->getBuffer(), isBig,
-                            read32(&sect->reloff, isBig),
-                            read32(&sect->nreloc, isBig));
-          if (section.type == S_NON_LAZY_SYMBOL_POINTERS) {
-            appendIndirectSymbols(
-                section.indirectSymbols, mb->getBuffer(), isBig,
-                indirectSymbolTableOffset, indirectSymbolTableCount,
-                read32(&sect->reserved1, isBig), contentSize / 4);
+          if (isObject) {
+            RelocLoc loc;
+            loc.sectionIndex = f->sections.size();
+            loc.reloff = read32(&sect->reloff, isBig);
+            loc.nreloc = read32(&sect->nreloc, isBig);
+            relocLocs.push_back(loc);
+            if (section.type == S_NON_LAZY_SYMBOL_POINTERS) {
+              appendIndirectSymbols(
+                  section.indirectSymbols, mb->getBuffer(), isBig,
+                  indirectSymbolTableOffset, indirectSymbolTableCount,
+                  read32(&sect->reserved1, isBig), contentSize / 4);
+            }
           }
           f->sections.push_back(section);
         }
@@ -399,7 +426,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
             f->undefinedSymbols.push_back(sout);
           else if (sin->n_type & N_EXT)
             f->globalSymbols.push_back(sout);
-          else
+          else if (isObject)
             f->localSymbols.push_back(sout);
         }
       } else {
@@ -429,7 +456,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
             f->undefinedSymbols.push_back(sout);
           else if (sout.scope == (SymbolScope)N_EXT)
             f->globalSymbols.push_back(sout);
-          else
+          else if (isObject)
             f->localSymbols.push_back(sout);
         }
       }
@@ -487,7 +514,18 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
   if (ec)
     return std::move(ec);
 
-  if (dataInCode) {
+  // Unpack each section's relocation list into its preallocated array.
+  // Sections decode independently, so they all run in parallel; the
+  // huge __eh_frame and __compact_unwind lists of some object files
+  // would otherwise dominate the read. Errors leave the list empty,
+  // exactly as the inline calls did.
+  parallel_for_each(relocLocs.begin(), relocLocs.end(), [&](RelocLoc &loc) {
+    Relocations &relocs = f->sections[loc.sectionIndex].relocations;
+    relocs.reserve(loc.nreloc);
+    appendRelocations(relocs, mb->getBuffer(), isBig, loc.reloff, loc.nreloc);
+  }, 1);
+
+  if (dataInCode && isObject) {
     // Convert on-disk data_in_code_entry array to DataInCode vector.
     for (unsigned i=0; i < dataInCodeSize/sizeof(data_in_code_entry); ++i) {
       DataInCode entry;
@@ -25,10 +25,12 @@
 #include "MachONormalizedFileBinaryUtils.h"
 #include "lld/Core/Error.h"
 #include "lld/Core/LLVM.h"
+#include "lld/Core/Parallel.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Debug.h"
@@ -40,6 +42,7 @@
 #include "llvm/Support/MachO.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <functional>
 #include <list>
 #include <map>
@@ -158,9 +161,10 @@ private:
   void        computeFunctionStartsSize();
   void        computeDataInCodeSize();
   void        computeSymbolTableSizes();
+  void        buildSymbolStringPool();
   void        buildSectionRelocations();
   void        appendSymbols(const std::vector<Symbol> &symbols,
-                                      uint32_t &symOffset, uint32_t &strOffset);
+                                      uint32_t &symOffset);
   uint32_t    indirectSymbolIndex(const Section &sect, uint32_t &index);
   uint32_t    indirectSymbolElementSize(const Section &sect);
 
@@ -243,6 +247,9 @@ private:
   ByteBuffer            _lazyBindingInfo;
   ByteBuffer            _weakBindingInfo;
   ByteBuffer            _exportTrie;
+  // Deduplicated symbol string pool and each name's offset in it.
+  std::vector<char>         _stringPool;
+  llvm::StringMap<uint32_t> _stringPoolOffsets;
 };
 
 size_t headerAndLoadCommandsSize(const NormalizedFile &file) {
@@ -1021,17 +1028,18 @@ llvm::Error MachOFileLayout::writeLoadCommands() {
 }
 
 void MachOFileLayout::writeSectionContent() {
-  for (const Section &s : _file.sections) {
+  // Every section was assigned its own file offset when the layout was
+  // computed, so each copy targets a disjoint slice of the buffer.
+  parallel_for_each(_file.sections.begin(), _file.sections.end(),
+                    [this](const Section &s) {
     // Copy all section content to output buffer.
     if (isZeroFillSection(s.type))
-      continue;
+      return;
     if (s.content.empty())
-      continue;
-    uint32_t offset = _sectInfo[&s].fileOffset;
-    uint8_t *p = &_buffer[offset];
-    memcpy(p, &s.content[0], s.content.size());
-    p += s.content.size();
-  }
+      return;
+    uint32_t offset = _sectInfo.find(&s)->second.fileOffset;
+    memcpy(&_buffer[offset], &s.content[0], s.content.size());
+  }, 1);
 }
 
 void MachOFileLayout::writeRelocations() {
@@ -1047,11 +1055,11 @@ void MachOFileLayout::writeRelocations() {
 }
 
 void MachOFileLayout::appendSymbols(const std::vector<Symbol> &symbols,
-                                   uint32_t &symOffset, uint32_t &strOffset) {
+                                   uint32_t &symOffset) {
   for (const Symbol &sym : symbols) {
     if (_is64) {
       nlist_64* nb = reinterpret_cast<nlist_64*>(&_buffer[symOffset]);
-      nb->n_strx = strOffset - _startOfSymbolStrings;
+      nb->n_strx = _stringPoolOffsets.lookup(sym.name);
       nb->n_type = sym.type | sym.scope;
       nb->n_sect = sym.sect;
       nb->n_desc = sym.desc;
@@ -1061,7 +1069,7 @@ void MachOFileLayout::appendSymbols(const std::vector<Symbol> &symbols,
       symOffset += sizeof(nlist_64);
     } else {
       nlist* nb = reinterpret_cast<nlist*>(&_buffer[symOffset]);
-      nb->n_strx = strOffset - _startOfSymbolStrings;
+      nb->n_strx = _stringPoolOffsets.lookup(sym.name);
       nb->n_type = sym.type | sym.scope;
       nb->n_sect = sym.sect;
       nb->n_desc = sym.desc;
@@ -1070,9 +1078,6 @@ void MachOFileLayout::appendSymbols(const std::vector<Symbol> &symbols,
         swapStruct(*nb);
       symOffset += sizeof(nlist);
     }
-    memcpy(&_buffer[strOffset], sym.name.begin(), sym.name.size());
-    strOffset += sym.name.size();
-    _buffer[strOffset++] ='\0'; // Strings in table have nul terminator.
   }
 }
 
@@ -1098,13 +1103,14 @@ void MachOFileLayout::writeDataInCodeInfo() {
 }
 
 void MachOFileLayout::writeSymbolTable() {
-  // Write symbol table and symbol strings in parallel.
   uint32_t symOffset = _startOfSymbols;
-  uint32_t strOffset = _startOfSymbolStrings;
-  _buffer[strOffset++] = '\0'; // Reserve n_strx offset of zero to mean no name.
-  appendSymbols(_file.localSymbols, symOffset, strOffset);
-  appendSymbols(_file.globalSymbols, symOffset, strOffset);
-  appendSymbols(_file.undefinedSymbols, symOffset, strOffset);
+  appendSymbols(_file.localSymbols, symOffset);
+  appendSymbols(_file.globalSymbols, symOffset);
+  appendSymbols(_file.undefinedSymbols, symOffset);
+  // The deduplicated string pool was built alongside the sizes; it is
+  // copied as one block.
+  memcpy(&_buffer[_startOfSymbolStrings], _stringPool.data(),
+         _stringPool.size());
   // Write indirect symbol table array.
   uint32_t *indirects = reinterpret_cast<uint32_t*>
                                             (&_buffer[_startOfIndirectSymbols]);
@@ -1153,13 +1159,20 @@ void MachOFileLayout::writeExportInfo() {
 }
 
 void MachOFileLayout::buildLinkEditInfo() {
-  buildRebaseInfo();
-  buildBindInfo();
-  buildLazyBindInfo();
-  buildExportTrie();
-  computeSymbolTableSizes();
-  computeFunctionStartsSize();
-  computeDataInCodeSize();
+  // Each LINKEDIT component encodes into its own buffer or size field
+  // from the normalized file alone, so they can be built concurrently.
+  // Their file ranges are assigned afterwards, once all sizes are
+  // known.
+  TaskGroup tg;
+  tg.spawn([this] { buildRebaseInfo(); });
+  tg.spawn([this] { buildBindInfo(); });
+  tg.spawn([this] { buildLazyBindInfo(); });
+  tg.spawn([this] { buildExportTrie(); });
+  tg.spawn([this] {
+    computeSymbolTableSizes();
+    computeFunctionStartsSize();
+    computeDataInCodeSize();
+  });
 }
 
 void MachOFileLayout::buildSectionRelocations() {
@@ -1167,40 +1180,124 @@ void MachOFileLayout::buildSectionRelocations() {
 }
 
 void MachOFileLayout::buildRebaseInfo() {
-  // TODO: compress rebasing info.
-  for (const RebaseLocation& entry : _file.rebasingInfo) {
-    _rebaseInfo.append_byte(REBASE_OPCODE_SET_TYPE_IMM | entry.kind);
-    _rebaseInfo.append_byte(REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
-                            | entry.segIndex);
-    _rebaseInfo.append_uleb128(entry.segOffset);
-    _rebaseInfo.append_uleb128(REBASE_OPCODE_DO_REBASE_IMM_TIMES | 1);
+  // Sort the entries by address so that runs of adjacent pointers can be
+  // folded into one DO_REBASE_*_TIMES opcode and the type and segment
+  // state only needs to be re-set when it actually changes.
+  std::vector<RebaseLocation> entries(_file.rebasingInfo.begin(),
+                                      _file.rebasingInfo.end());
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const RebaseLocation &lhs, const RebaseLocation &rhs) {
+    if (lhs.segIndex != rhs.segIndex)
+      return lhs.segIndex < rhs.segIndex;
+    return lhs.segOffset < rhs.segOffset;
+  });
+  const uint64_t pointerSize = _is64 ? 8 : 4;
+  uint8_t  lastType = 0;
+  int      lastSegIndex = -1;
+  uint64_t nextSegOffset = 0;
+  for (size_t i = 0, e = entries.size(); i != e; ) {
+    const RebaseLocation &entry = entries[i];
+    if (entry.kind != lastType) {
+      _rebaseInfo.append_byte(REBASE_OPCODE_SET_TYPE_IMM | entry.kind);
+      lastType = entry.kind;
+    }
+    if (entry.segIndex != lastSegIndex) {
+      _rebaseInfo.append_byte(REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
+                              | entry.segIndex);
+      _rebaseInfo.append_uleb128(entry.segOffset);
+      lastSegIndex = entry.segIndex;
+    } else if (entry.segOffset != nextSegOffset) {
+      assert(entry.segOffset > nextSegOffset && "entries not sorted");
+      _rebaseInfo.append_byte(REBASE_OPCODE_ADD_ADDR_ULEB);
+      _rebaseInfo.append_uleb128(entry.segOffset - nextSegOffset);
+    }
+    // Count how many following entries continue this run of adjacent
+    // same-typed pointers.
+    size_t   count = 1;
+    uint64_t runOffset = entry.segOffset + pointerSize;
+    while (i + count != e) {
+      const RebaseLocation &next = entries[i + count];
+      if (next.kind != lastType || next.segIndex != lastSegIndex ||
+          next.segOffset != runOffset)
+        break;
+      runOffset += pointerSize;
+      ++count;
+    }
+    if (count <= 0xF) {
+      _rebaseInfo.append_byte(REBASE_OPCODE_DO_REBASE_IMM_TIMES | count);
+    } else {
+      _rebaseInfo.append_byte(REBASE_OPCODE_DO_REBASE_ULEB_TIMES);
+      _rebaseInfo.append_uleb128(count);
+    }
+    nextSegOffset = runOffset;
+    i += count;
   }
   _rebaseInfo.append_byte(REBASE_OPCODE_DONE);
   _rebaseInfo.align(_is64 ? 8 : 4);
 }
 
 void MachOFileLayout::buildBindInfo() {
-  // TODO: compress bind info.
-  uint64_t lastAddend = 0;
-  for (const BindLocation& entry : _file.bindingInfo) {
-    _bindingInfo.append_byte(BIND_OPCODE_SET_TYPE_IMM | entry.kind);
-    _bindingInfo.append_byte(BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
-                            | entry.segIndex);
-    _bindingInfo.append_uleb128(entry.segOffset);
-    if (entry.ordinal > 0)
-      _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_ORDINAL_IMM |
-                               (entry.ordinal & 0xF));
-    else
-      _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_SPECIAL_IMM |
-                               (entry.ordinal & 0xF));
-    _bindingInfo.append_byte(BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM);
-    _bindingInfo.append_string(entry.symbolName);
+  // Sort the entries by address so that the type, dylib ordinal, symbol
+  // name, and addend state only needs to be re-set when it changes, and
+  // gaps between binds become small ADD_ADDR_ULEB deltas. DO_BIND
+  // implicitly advances the address by a pointer, so a run of adjacent
+  // binds of the same symbol costs one byte per extra bind.
+  std::vector<BindLocation> entries(_file.bindingInfo.begin(),
+                                    _file.bindingInfo.end());
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const BindLocation &lhs, const BindLocation &rhs) {
+    if (lhs.segIndex != rhs.segIndex)
+      return lhs.segIndex < rhs.segIndex;
+    return lhs.segOffset < rhs.segOffset;
+  });
+  const uint64_t pointerSize = _is64 ? 8 : 4;
+  uint8_t   lastType = 0;
+  int       lastSegIndex = -1;
+  uint64_t  nextSegOffset = 0;
+  bool      ordinalSet = false;
+  int       lastOrdinal = 0;
+  StringRef lastSymbolName;
+  uint64_t  lastAddend = 0;
+  for (const BindLocation& entry : entries) {
+    if (entry.kind != lastType) {
+      _bindingInfo.append_byte(BIND_OPCODE_SET_TYPE_IMM | entry.kind);
+      lastType = entry.kind;
+    }
+    if (!ordinalSet || entry.ordinal != lastOrdinal) {
+      if (entry.ordinal > BIND_IMMEDIATE_MASK) {
+        _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB);
+        _bindingInfo.append_uleb128(entry.ordinal);
+      } else if (entry.ordinal > 0)
+        _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_ORDINAL_IMM |
+                                 entry.ordinal);
+      else
+        _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_SPECIAL_IMM |
+                                 (entry.ordinal & 0xF));
+      ordinalSet = true;
+      lastOrdinal = entry.ordinal;
+    }
+    if (entry.symbolName != lastSymbolName) {
+      _bindingInfo.append_byte(BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM);
+      _bindingInfo.append_string(entry.symbolName);
+      lastSymbolName = entry.symbolName;
+    }
     if (entry.addend != lastAddend) {
       _bindingInfo.append_byte(BIND_OPCODE_SET_ADDEND_SLEB);
       _bindingInfo.append_sleb128(entry.addend);
       lastAddend = entry.addend;
     }
+    if (entry.segIndex != lastSegIndex) {
+      _bindingInfo.append_byte(BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
+                              | entry.segIndex);
+      _bindingInfo.append_uleb128(entry.segOffset);
+      lastSegIndex = entry.segIndex;
+    } else if (entry.segOffset != nextSegOffset) {
+      assert(entry.segOffset > nextSegOffset && "entries not sorted");
+      _bindingInfo.append_byte(BIND_OPCODE_ADD_ADDR_ULEB);
+      _bindingInfo.append_uleb128(entry.segOffset - nextSegOffset);
+    }
     _bindingInfo.append_byte(BIND_OPCODE_DO_BIND);
+    nextSegOffset = entry.segOffset + pointerSize;
   }
   _bindingInfo.append_byte(BIND_OPCODE_DONE);
   _bindingInfo.align(_is64 ? 8 : 4);
@@ -1411,22 +1508,64 @@ void MachOFileLayout::buildExportTrie() {
   _exportTrie.align(_is64 ? 8 : 4);
 }
 
+/// Mach-O does not require one string per symbol in the string pool:
+/// n_strx values may alias freely. Mangled C++ and Swift names repeat
+/// heavily across the local/global/undefined ranges, so build a
+/// deduplicated pool: identical names share one copy, and a name equal
+/// to the tail of another shares the longer name's ending (including
+/// its nul terminator).
+void MachOFileLayout::buildSymbolStringPool() {
+  // Collect the unique names.
+  std::vector<StringRef> names;
+  auto addNames = [&](const std::vector<Symbol> &symbols) {
+    for (const Symbol &sym : symbols)
+      if (_stringPoolOffsets.insert(std::make_pair(sym.name, 0)).second)
+        names.push_back(sym.name);
+  };
+  addNames(_file.localSymbols);
+  addNames(_file.globalSymbols);
+  addNames(_file.undefinedSymbols);
+
+  // Sort so that a name which is the tail of another directly follows
+  // it: compare from the last character backwards, longer names first
+  // on ties.
+  std::sort(names.begin(), names.end(), [](StringRef lhs, StringRef rhs) {
+    size_t li = lhs.size(), ri = rhs.size();
+    while (li && ri) {
+      char lc = lhs[--li];
+      char rc = rhs[--ri];
+      if (lc != rc)
+        return lc < rc;
+    }
+    return li > ri;
+  });
+
+  _stringPool.push_back('\0'); // Reserve n_strx of zero to mean no name.
+  StringRef prevName;
+  uint32_t prevOffset = 0;
+  for (StringRef name : names) {
+    uint32_t offset;
+    if (name.size() <= prevName.size() && prevName.endswith(name)) {
+      offset = prevOffset + (prevName.size() - name.size());
+    } else {
+      offset = _stringPool.size();
+      _stringPool.insert(_stringPool.end(), name.begin(), name.end());
+      _stringPool.push_back('\0');
+      prevName = name;
+      prevOffset = offset;
+    }
+    _stringPoolOffsets[name] = offset;
+  }
+}
+
 void MachOFileLayout::computeSymbolTableSizes() {
   // MachO symbol tables have three ranges: locals, globals, and undefines
   const size_t nlistSize = (_is64 ? sizeof(nlist_64) : sizeof(nlist));
   _symbolTableSize = nlistSize * (_file.localSymbols.size()
                                 + _file.globalSymbols.size()
                                 + _file.undefinedSymbols.size());
-  _symbolStringPoolSize = 1; // Always reserve 1-byte for the empty string.
-  for (const Symbol &sym : _file.localSymbols) {
-    _symbolStringPoolSize += (sym.name.size()+1);
-  }
-  for (const Symbol &sym : _file.globalSymbols) {
-    _symbolStringPoolSize += (sym.name.size()+1);
-  }
-  for (const Symbol &sym : _file.undefinedSymbols) {
-    _symbolStringPoolSize += (sym.name.size()+1);
-  }
+  buildSymbolStringPool();
+  _symbolStringPoolSize = _stringPool.size();
   _symbolTableLocalsStartIndex = 0;
   _symbolTableGlobalsStartIndex = _file.localSymbols.size();
   _symbolTableUndefinesStartIndex = _symbolTableGlobalsStartIndex
@@ -1447,21 +1586,21 @@ void MachOFileLayout::computeDataInCodeSize() {
 }
 
 void MachOFileLayout::writeLinkEditContent() {
+  // Every component was assigned its own range of the output buffer in
+  // the constructor, so the copies can run concurrently.
+  TaskGroup tg;
   if (_file.fileType == llvm::MachO::MH_OBJECT) {
-    writeRelocations();
-    writeFunctionStartsInfo();
-    writeDataInCodeInfo();
-    writeSymbolTable();
+    tg.spawn([this] { writeRelocations(); });
   } else {
-    writeRebaseInfo();
-    writeBindingInfo();
-    writeLazyBindingInfo();
+    tg.spawn([this] { writeRebaseInfo(); });
+    tg.spawn([this] { writeBindingInfo(); });
+    tg.spawn([this] { writeLazyBindingInfo(); });
     // TODO: add weak binding info
-    writeExportInfo();
-    writeFunctionStartsInfo();
-    writeDataInCodeInfo();
-    writeSymbolTable();
+    tg.spawn([this] { writeExportInfo(); });
   }
+  tg.spawn([this] { writeFunctionStartsInfo(); });
+  tg.spawn([this] { writeDataInCodeInfo(); });
+  tg.spawn([this] { writeSymbolTable(); });
 }
 
 llvm::Error MachOFileLayout::writeBinary(StringRef path) {
@@ -1482,8 +1621,13 @@ llvm::Error MachOFileLayout::writeBinary(StringRef path) {
   writeMachHeader();
   if (auto ec = writeLoadCommands())
     return ec;
-  writeSectionContent();
-  writeLinkEditContent();
+  // Section content and the LINKEDIT components occupy disjoint,
+  // precomputed ranges of the buffer, so the two writes can overlap.
+  {
+    TaskGroup tg;
+    tg.spawn([this] { writeSectionContent(); });
+    tg.spawn([this] { writeLinkEditContent(); });
+  }
   fob->commit();
 
   return llvm::Error();
@@ -25,6 +25,7 @@
 #include "MachONormalizedFileBinaryUtils.h"
 #include "lld/Core/Error.h"
 #include "lld/Core/LLVM.h"
+#include "lld/Core/Parallel.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Casting.h"
@@ -653,12 +654,19 @@ void Util::copySectionContent(NormalizedFile &file) {
     return pos->second;
   };
 
+  // Map each atom to its section's address once. The lookup runs for
+  // every section-relative fixup, so scanning all sections per query
+  // would be quadratic in atom count.
+  AtomToAddress atomToSectionAddress;
+  for (const SectionInfo *sectInfo : _sectionInfos)
+    for (const AtomInfo &atomInfo : sectInfo->atomsAndOffsets)
+      atomToSectionAddress[atomInfo.atom] = sectInfo->address;
+
   auto sectionAddrForAtom = [&] (const Atom &atom) -> uint64_t {
-    for (const SectionInfo *sectInfo : _sectionInfos)
-      for (const AtomInfo &atomInfo : sectInfo->atomsAndOffsets)
-        if (atomInfo.atom == &atom)
-          return sectInfo->address;
-    llvm_unreachable("atom not assigned to section");
+    auto pos = atomToSectionAddress.find(&atom);
+    assert(pos != atomToSectionAddress.end() &&
+           "atom not assigned to section");
+    return pos->second;
   };
 
   for (SectionInfo *si : _sectionInfos) {
@@ -675,18 +683,22 @@ void Util::copySectionContent(NormalizedFile &file) {
       sectionContent = llvm::MutableArrayRef<uint8_t>(sectContent, si->size);
       normSect->content = sectionContent;
     }
-    for (AtomInfo &ai : si->atomsAndOffsets) {
+    // Atom offsets were assigned when the section was laid out, so each
+    // atom writes a disjoint slice of the buffer and the copies and
+    // fixups can run concurrently. The address maps are only read here.
+    parallel_for_each(si->atomsAndOffsets.begin(), si->atomsAndOffsets.end(),
+                      [&](AtomInfo &ai) {
       if (!ai.atom->size()) {
         assert(ai.atom->begin() == ai.atom->end() &&
                "Cannot have references without content");
-        continue;
+        return;
       }
       auto atomContent = sectionContent.slice(ai.offsetInSection,
                                               ai.atom->size());
       _archHandler.generateAtomContent(*ai.atom, r, addrForAtom,
                                        sectionAddrForAtom, _ctx.baseAddress(),
                                        atomContent);
-    }
+    }, 64);
   }
 }
 
@@ -0,0 +1,472 @@
+//===- lib/ReaderWriter/MachO/MachONormalizedFileSnapshot.cpp -------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+///
+/// \file A compact binary snapshot encoding of the normalized mach-o
+/// view. Snapshots carry the same information as the YAML encoding but
+/// load with one linear, allocation-light pass instead of a YAML parse,
+/// so they suit uses where the encoded form is machine-produced and
+/// machine-consumed, such as caches of already-normalized files.
+///
+///                  +------------+         +----------+
+///                  | normalized |   <->   | snapshot |
+///                  +------------+         +----------+
+
+#include "MachONormalizedFile.h"
+#include "lld/Core/Error.h"
+#include "lld/Core/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstring>
+#include <system_error>
+
+using namespace llvm;
+using namespace lld::mach_o::normalized;
+
+namespace {
+
+enum : uint32_t {
+  /// 'LLDN' in little-endian, so a snapshot file starts "NDLL".
+  snapshotMagic   = 0x4C4C444E,
+  snapshotVersion = 1
+};
+
+/// Streams fixed-width little-endian scalars and length-prefixed
+/// strings and byte runs to a raw_ostream. Counts and lengths are
+/// ULEB128 encoded since most of them are small.
+class SnapshotWriter {
+public:
+  SnapshotWriter(raw_ostream &out) : _out(out) {}
+
+  void writeByte(uint8_t value) { _out << char(value); }
+
+  void writeU16(uint16_t value) {
+    uint8_t buf[2];
+    support::endian::write16le(buf, value);
+    _out.write(reinterpret_cast<const char *>(buf), sizeof(buf));
+  }
+
+  void writeU32(uint32_t value) {
+    uint8_t buf[4];
+    support::endian::write32le(buf, value);
+    _out.write(reinterpret_cast<const char *>(buf), sizeof(buf));
+  }
+
+  void writeU64(uint64_t value) {
+    uint8_t buf[8];
+    support::endian::write64le(buf, value);
+    _out.write(reinterpret_cast<const char *>(buf), sizeof(buf));
+  }
+
+  void writeCount(uint64_t value) {
+    do {
+      uint8_t byte = value & 0x7F;
+      value >>= 7;
+      if (value != 0)
+        byte |= 0x80;
+      writeByte(byte);
+    } while (value != 0);
+  }
+
+  void writeString(StringRef str) {
+    writeCount(str.size());
+    _out << str;
+  }
+
+  void writeBytes(ArrayRef<uint8_t> bytes) {
+    writeCount(bytes.size());
+    _out.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+  }
+
+private:
+  raw_ostream &_out;
+};
+
+/// Cursor over a snapshot buffer. Any out-of-bounds read marks the
+/// reader malformed and makes all further reads return zeros, so
+/// callers only need to check malformed() once at the end. Strings and
+/// byte runs are copied into the normalized file's own allocator, so
+/// the returned file does not reference the snapshot buffer.
+class SnapshotReader {
+public:
+  SnapshotReader(const MemoryBuffer &mb, NormalizedFile &file)
+      : _p(reinterpret_cast<const uint8_t *>(mb.getBufferStart())),
+        _end(reinterpret_cast<const uint8_t *>(mb.getBufferEnd())),
+        _file(file) {}
+
+  bool malformed() const { return _malformed; }
+  bool atEnd() const { return _p == _end; }
+
+  uint8_t readByte() {
+    if (!ensure(1))
+      return 0;
+    return *_p++;
+  }
+
+  uint16_t readU16() {
+    if (!ensure(2))
+      return 0;
+    uint16_t value = support::endian::read16le(_p);
+    _p += 2;
+    return value;
+  }
+
+  uint32_t readU32() {
+    if (!ensure(4))
+      return 0;
+    uint32_t value = support::endian::read32le(_p);
+    _p += 4;
+    return value;
+  }
+
+  uint64_t readU64() {
+    if (!ensure(8))
+      return 0;
+    uint64_t value = support::endian::read64le(_p);
+    _p += 8;
+    return value;
+  }
+
+  uint64_t readCount() {
+    uint64_t result = 0;
+    unsigned shift = 0;
+    while (true) {
+      if (!ensure(1) || shift > 63)
+        return 0;
+      uint8_t byte = *_p++;
+      result |= uint64_t(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+        return result;
+      shift += 7;
+    }
+  }
+
+  /// Reads an element count about to drive a container resize. A count
+  /// larger than the number of bytes left cannot be valid (every
+  /// element occupies at least one byte), so treat it as a malformed
+  /// snapshot rather than letting a corrupt count drive a huge
+  /// allocation.
+  uint64_t readItemCount() {
+    uint64_t count = readCount();
+    if (!ensure(count))
+      return 0;
+    return count;
+  }
+
+  StringRef readString() {
+    uint64_t size = readCount();
+    if (!ensure(size))
+      return StringRef();
+    StringRef str(reinterpret_cast<const char *>(_p), size);
+    _p += size;
+    return str.copy(_file.ownedAllocations);
+  }
+
+  ArrayRef<uint8_t> readBytes() {
+    uint64_t size = readCount();
+    if (!ensure(size))
+      return ArrayRef<uint8_t>();
+    const uint8_t *start = _p;
+    _p += size;
+    if (size == 0)
+      return ArrayRef<uint8_t>();
+    uint8_t *copy = _file.ownedAllocations.Allocate<uint8_t>(size);
+    memcpy(copy, start, size);
+    return ArrayRef<uint8_t>(copy, size);
+  }
+
+private:
+  bool ensure(uint64_t size) {
+    if (_malformed || uint64_t(_end - _p) < size) {
+      _malformed = true;
+      _p = _end;
+      return false;
+    }
+    return true;
+  }
+
+  const uint8_t  *_p;
+  const uint8_t  *_end;
+  NormalizedFile &_file;
+  bool            _malformed = false;
+};
+
+void writeSymbols(SnapshotWriter &w, const std::vector<Symbol> &symbols) {
+  w.writeCount(symbols.size());
+  for (const Symbol &sym : symbols) {
+    w.writeString(sym.name);
+    w.writeByte(sym.type);
+    w.writeByte(sym.scope);
+    w.writeByte(sym.sect);
+    w.writeU16(sym.desc);
+    w.writeU64(sym.value);
+  }
+}
+
+void readSymbols(SnapshotReader &r, std::vector<Symbol> &symbols) {
+  symbols.resize(r.readItemCount());
+  for (Symbol &sym : symbols) {
+    sym.name = r.readString();
+    sym.type = static_cast<NListType>(r.readByte());
+    sym.scope = r.readByte();
+    sym.sect = r.readByte();
+    sym.desc = r.readU16();
+    sym.value = r.readU64();
+  }
+}
+
+void writeBindLocations(SnapshotWriter &w,
+                        const std::vector<BindLocation> &binds) {
+  w.writeCount(binds.size());
+  for (const BindLocation &bind : binds) {
+    w.writeU32(bind.segOffset);
+    w.writeByte(bind.segIndex);
+    w.writeByte(bind.kind);
+    w.writeByte(bind.canBeNull);
+    w.writeU32(static_cast<uint32_t>(bind.ordinal));
+    w.writeString(bind.symbolName);
+    w.writeU64(bind.addend);
+  }
+}
+
+void readBindLocations(SnapshotReader &r, std::vector<BindLocation> &binds) {
+  binds.resize(r.readItemCount());
+  for (BindLocation &bind : binds) {
+    bind.segOffset = r.readU32();
+    bind.segIndex = r.readByte();
+    bind.kind = static_cast<BindType>(r.readByte());
+    bind.canBeNull = r.readByte();
+    bind.ordinal = static_cast<int32_t>(r.readU32());
+    bind.symbolName = r.readString();
+    bind.addend = r.readU64();
+  }
+}
+
+} // namespace
+
+namespace lld {
+namespace mach_o {
+namespace normalized {
+
+std::error_code writeSnapshot(const NormalizedFile &file, raw_ostream &out) {
+  SnapshotWriter w(out);
+  w.writeU32(snapshotMagic);
+  w.writeU32(snapshotVersion);
+  w.writeU32(file.arch);
+  w.writeU32(file.fileType);
+  w.writeU32(file.flags);
+
+  w.writeCount(file.segments.size());
+  for (const Segment &seg : file.segments) {
+    w.writeString(seg.name);
+    w.writeU64(seg.address);
+    w.writeU64(seg.size);
+    w.writeU32(seg.init_access);
+    w.writeU32(seg.max_access);
+  }
+
+  w.writeCount(file.sections.size());
+  for (const Section &sect : file.sections) {
+    w.writeString(sect.segmentName);
+    w.writeString(sect.sectionName);
+    w.writeU32(sect.type);
+    w.writeU32(sect.attributes);
+    w.writeU16(sect.alignment);
+    w.writeU64(sect.address);
+    w.writeBytes(sect.content);
+    w.writeCount(sect.relocations.size());
+    for (const Relocation &reloc : sect.relocations) {
+      w.writeU32(reloc.offset);
+      w.writeByte(reloc.scattered);
+      w.writeByte(reloc.type);
+      w.writeByte(reloc.length);
+      w.writeByte(reloc.pcRel);
+      w.writeByte(reloc.isExtern);
+      w.writeU32(reloc.value);
+      w.writeU32(reloc.symbol);
+    }
+    w.writeCount(sect.indirectSymbols.size());
+    for (uint32_t sym : sect.indirectSymbols)
+      w.writeU32(sym);
+  }
+
+  writeSymbols(w, file.localSymbols);
+  writeSymbols(w, file.globalSymbols);
+  writeSymbols(w, file.undefinedSymbols);
+
+  w.writeCount(file.dependentDylibs.size());
+  for (const DependentDylib &dep : file.dependentDylibs) {
+    w.writeString(dep.path);
+    w.writeU32(dep.kind);
+    w.writeU32(dep.compatVersion);
+    w.writeU32(dep.currentVersion);
+  }
+
+  w.writeString(file.installName);
+  w.writeU32(file.compatVersion);
+  w.writeU32(file.currentVersion);
+  w.writeByte(file.hasUUID);
+  w.writeByte(file.hasMinVersionLoadCommand);
+  w.writeByte(file.generateDataInCodeLoadCommand);
+  w.writeCount(file.rpaths.size());
+  for (StringRef rpath : file.rpaths)
+    w.writeString(rpath);
+  w.writeU64(file.entryAddress);
+  w.writeU64(file.stackSize);
+  w.writeU32(static_cast<uint32_t>(file.os));
+  w.writeU64(file.sourceVersion);
+  w.writeU32(file.minOSverson);
+  w.writeU32(file.sdkVersion);
+  w.writeU32(file.minOSVersionKind);
+
+  w.writeU32(file.pageSize);
+  w.writeCount(file.rebasingInfo.size());
+  for (const RebaseLocation &rebase : file.rebasingInfo) {
+    w.writeU32(rebase.segOffset);
+    w.writeByte(rebase.segIndex);
+    w.writeByte(rebase.kind);
+  }
+  writeBindLocations(w, file.bindingInfo);
+  writeBindLocations(w, file.weakBindingInfo);
+  writeBindLocations(w, file.lazyBindingInfo);
+  w.writeCount(file.exportInfo.size());
+  for (const Export &exp : file.exportInfo) {
+    w.writeString(exp.name);
+    w.writeU64(exp.offset);
+    w.writeU32(exp.kind);
+    w.writeU32(exp.flags);
+    w.writeU32(exp.otherOffset);
+    w.writeString(exp.otherName);
+  }
+  w.writeBytes(file.functionStarts);
+  w.writeCount(file.dataInCode.size());
+  for (const DataInCode &entry : file.dataInCode) {
+    w.writeU32(entry.offset);
+    w.writeU16(entry.length);
+    w.writeByte(entry.kind);
+  }
+
+  return std::error_code();
+}
+
+llvm::Expected<std::unique_ptr<NormalizedFile>>
+readSnapshot(std::unique_ptr<MemoryBuffer> &mb) {
+  std::unique_ptr<NormalizedFile> f(new NormalizedFile());
+  NormalizedFile &file = *f;
+  SnapshotReader r(*mb, file);
+
+  if (r.readU32() != snapshotMagic)
+    return llvm::make_error<GenericError>("Not a normalized mach-o snapshot");
+  if (r.readU32() != snapshotVersion)
+    return llvm::make_error<GenericError>("Unsupported snapshot version");
+  file.arch = static_cast<MachOLinkingContext::Arch>(r.readU32());
+  file.fileType = static_cast<HeaderFileType>(r.readU32());
+  file.flags = r.readU32();
+
+  file.segments.resize(r.readItemCount());
+  for (Segment &seg : file.segments) {
+    seg.name = r.readString();
+    seg.address = r.readU64();
+    seg.size = r.readU64();
+    seg.init_access = r.readU32();
+    seg.max_access = r.readU32();
+  }
+
+  file.sections.resize(r.readItemCount());
+  for (Section &sect : file.sections) {
+    sect.segmentName = r.readString();
+    sect.sectionName = r.readString();
+    sect.type = static_cast<SectionType>(r.readU32());
+    sect.attributes = r.readU32();
+    sect.alignment = r.readU16();
+    sect.address = r.readU64();
+    sect.content = r.readBytes();
+    sect.relocations.resize(r.readItemCount());
+    for (Relocation &reloc : sect.relocations) {
+      reloc.offset = r.readU32();
+      reloc.scattered = r.readByte();
+      reloc.type = static_cast<RelocationInfoType>(r.readByte());
+      reloc.length = r.readByte();
+      reloc.pcRel = r.readByte();
+      reloc.isExtern = r.readByte();
+      reloc.value = r.readU32();
+      reloc.symbol = r.readU32();
+    }
+    sect.indirectSymbols.resize(r.readItemCount());
+    for (uint32_t &sym : sect.indirectSymbols)
+      sym = r.readU32();
+  }
+
+  readSymbols(r, file.localSymbols);
+  readSymbols(r, file.globalSymbols);
+  readSymbols(r, file.undefinedSymbols);
+
+  file.dependentDylibs.resize(r.readItemCount());
+  for (DependentDylib &dep : file.dependentDylibs) {
+    dep.path = r.readString();
+    dep.kind = static_cast<LoadCommandType>(r.readU32());
+    dep.compatVersion = r.readU32();
+    dep.currentVersion = r.readU32();
+  }
+
+  file.installName = r.readString();
+  file.compatVersion = r.readU32();
+  file.currentVersion = r.readU32();
+  file.hasUUID = r.readByte();
+  file.hasMinVersionLoadCommand = r.readByte();
+  file.generateDataInCodeLoadCommand = r.readByte();
+  file.rpaths.resize(r.readItemCount());
+  for (StringRef &rpath : file.rpaths)
+    rpath = r.readString();
+  file.entryAddress = r.readU64();
+  file.stackSize = r.readU64();
+  file.os = static_cast<MachOLinkingContext::OS>(r.readU32());
+  file.sourceVersion = r.readU64();
+  file.minOSverson = r.readU32();
+  file.sdkVersion = r.readU32();
+  file.minOSVersionKind = static_cast<LoadCommandType>(r.readU32());
+
+  file.pageSize = r.readU32();
+  file.rebasingInfo.resize(r.readItemCount());
+  for (RebaseLocation &rebase : file.rebasingInfo) {
+    rebase.segOffset = r.readU32();
+    rebase.segIndex = r.readByte();
+    rebase.kind = static_cast<RebaseType>(r.readByte());
+  }
+  readBindLocations(r, file.bindingInfo);
+  readBindLocations(r, file.weakBindingInfo);
+  readBindLocations(r, file.lazyBindingInfo);
+  file.exportInfo.resize(r.readItemCount());
+  for (Export &exp : file.exportInfo) {
+    exp.name = r.readString();
+    exp.offset = r.readU64();
+    exp.kind = static_cast<ExportSymbolKind>(r.readU32());
+    exp.flags = r.readU32();
+    exp.otherOffset = r.readU32();
+    exp.otherName = r.readString();
+  }
+  ArrayRef<uint8_t> starts = r.readBytes();
+  file.functionStarts.assign(starts.begin(), starts.end());
+  file.dataInCode.resize(r.readItemCount());
+  for (DataInCode &entry : file.dataInCode) {
+    entry.offset = r.readU32();
+    entry.length = r.readU16();
+    entry.kind = static_cast<DataRegionType>(r.readByte());
+  }
+
+  if (r.malformed() || !r.atEnd())
+    return llvm::make_error<GenericError>("Malformed snapshot file");
+  return std::move(f);
+}
+
+} // namespace normalized
+} // namespace mach_o
+} // namespace lld
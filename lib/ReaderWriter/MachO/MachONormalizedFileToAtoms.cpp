@@ -27,6 +27,7 @@
 #include "MachONormalizedFileBinaryUtils.h"
 #include "lld/Core/Error.h"
 #include "lld/Core/LLVM.h"
+#include "lld/Core/Parallel.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MachO.h"
@@ -220,16 +221,16 @@ Atom::Scope atomScope(uint8_t scope) {
   llvm_unreachable("unknown scope value!");
 }
 
-void appendSymbolsInSection(const std::vector<Symbol> &inSymbols,
-                            uint32_t sectionIndex,
-                            SmallVector<const Symbol *, 64> &outSyms) {
+void bucketSymbolsBySection(const std::vector<Symbol> &inSymbols,
+                            std::vector<SmallVector<const Symbol *, 64>>
+                                                                     &buckets) {
   for (const Symbol &sym : inSymbols) {
     // Only look at definition symbols.
     if ((sym.type & N_TYPE) != N_SECT)
       continue;
-    if (sym.sect != sectionIndex)
+    if (sym.sect < 1 || sym.sect > buckets.size())
       continue;
-    outSyms.push_back(&sym);
+    buckets[sym.sect - 1].push_back(&sym);
   }
 }
 
@@ -269,25 +270,10 @@ void atomFromSymbol(DefinedAtom::ContentType atomType, const Section &section,
   }
 }
 
-llvm::Error processSymboledSection(DefinedAtom::ContentType atomType,
-                                   const Section &section,
-                                   const NormalizedFile &normalizedFile,
-                                   MachOFile &file, bool scatterable,
-                                   bool copyRefs) {
-  // Find section's index.
-  uint32_t sectIndex = 1;
-  for (auto &sect : normalizedFile.sections) {
-    if (&sect == &section)
-      break;
-    ++sectIndex;
-  }
-
-  // Find all symbols in this section.
-  SmallVector<const Symbol *, 64> symbols;
-  appendSymbolsInSection(normalizedFile.globalSymbols, sectIndex, symbols);
-  appendSymbolsInSection(normalizedFile.localSymbols,  sectIndex, symbols);
-
-  // Sort symbols.
+/// Sorts one section's symbols the way atomization walks them. This only
+/// reads the normalized file, so it is safe to run for many sections in
+/// parallel.
+void sortSymbolsInSection(SmallVectorImpl<const Symbol *> &symbols) {
   std::sort(symbols.begin(), symbols.end(),
             [](const Symbol *lhs, const Symbol *rhs) -> bool {
               if (lhs == rhs)
@@ -311,7 +297,13 @@ llvm::Error processSymboledSection(DefinedAtom::ContentType atomType,
               // If same address and scope, sort by name.
               return lhs->name < rhs->name;
             });
+}
 
+llvm::Error processSymboledSection(DefinedAtom::ContentType atomType,
+                                   const Section &section, MachOFile &file,
+                                   bool scatterable, bool copyRefs,
+                                   const SmallVectorImpl<const Symbol *>
+                                                                     &symbols) {
   // Debug logging of symbols.
   //for (const Symbol *sym : symbols)
   //  llvm::errs() << "  sym: "
@@ -322,6 +314,10 @@ llvm::Error processSymboledSection(DefinedAtom::ContentType atomType,
   if (symbols.empty() && section.content.empty())
     return llvm::Error();
 
+  // Each symbol produces at most one atom, plus possibly one anonymous
+  // atom for content before the first symbol.
+  file.reserveAtomsForSection(&section, symbols.size() + 1);
+
   if (symbols.empty()) {
     // Section has no symbols, put all content in one anoymous atom.
     atomFromSymbol(atomType, section, file, section.address, StringRef(),
@@ -379,7 +375,9 @@ llvm::Error processSection(DefinedAtom::ContentType atomType,
                            bool customSectionName,
                            const NormalizedFile &normalizedFile,
                            MachOFile &file, bool scatterable,
-                           bool copyRefs) {
+                           bool copyRefs,
+                           const SmallVectorImpl<const Symbol *>
+                                                              &sortedSymbols) {
   const bool is64 = MachOLinkingContext::is64Bit(normalizedFile.arch);
   const bool isBig = MachOLinkingContext::isBigEndian(normalizedFile.arch);
 
@@ -402,9 +400,32 @@ llvm::Error processSection(DefinedAtom::ContentType atomType,
 
   if (atomizeModel == atomizeAtSymbols) {
     // Break section up into atoms each with a fixed size.
-    return processSymboledSection(atomType, section, normalizedFile, file,
-                                  scatterable, copyRefs);
+    return processSymboledSection(atomType, section, file, scatterable,
+                                  copyRefs, sortedSymbols);
   } else {
+    // The fixed-size atomize models yield a known atom count; reserve
+    // the atom vectors so large sections don't grow them one
+    // push_back at a time.
+    unsigned int fixedSize = 0;
+    switch (atomizeModel) {
+    case atomizeFixedSize:
+      fixedSize = sizeMultiple;
+      break;
+    case atomizePointerSize:
+      fixedSize = is64 ? 8 : 4;
+      break;
+    case atomizeCU:
+      fixedSize = is64 ? 32 : 20;
+      break;
+    case atomizeCFString:
+      fixedSize = is64 ? 32 : 16;
+      break;
+    default:
+      break;
+    }
+    if (fixedSize)
+      file.reserveAtomsForSection(&section, section.content.size() / fixedSize);
+
     unsigned int size;
     for (unsigned int offset = 0, e = section.content.size(); offset != e;) {
       switch (atomizeModel) {
@@ -888,19 +909,24 @@ static llvm::Error processFDE(const NormalizedFile &normalizedFile,
   if (atom->begin() != atom->end())
     atom->sortReferences();
 
-  DefinedAtom::reference_iterator CurrentRef = atom->begin();
+  // The references the compiler emitted are walked by index, not by
+  // iterator: the packed reference array may grow (and move) as the missing
+  // ones are added below, and references added while walking must not be
+  // visited.
+  size_t RefCount = atom->referenceCount();
+  size_t CurrentRefIndex = 0;
 
   // This helper returns the reference (if one exists) at the offset we are
-  // currently processing.  It automatically increments the ref iterator if we
+  // currently processing.  It automatically increments the ref index if we
   // do return a ref, and throws an error if we pass over a ref without
   // comsuming it.
-  auto currentRefGetter = [&CurrentRef,
+  auto currentRefGetter = [&CurrentRefIndex, RefCount,
                            &atom](uint64_t Offset)->const Reference* {
     // If there are no more refs found, then we are done.
-    if (CurrentRef == atom->end())
+    if (CurrentRefIndex == RefCount)
       return nullptr;
 
-    const Reference *Ref = *CurrentRef;
+    const Reference *Ref = &atom->references()[CurrentRefIndex];
 
     // If we haven't reached the offset for this reference, then return that
     // we don't yet have a reference to process.
@@ -909,7 +935,7 @@ static llvm::Error processFDE(const NormalizedFile &normalizedFile,
 
     // If the offset is equal, then we want to process this ref.
     if (Offset == Ref->offsetInAtom()) {
-      ++CurrentRef;
+      ++CurrentRefIndex;
       return Ref;
     }
 
@@ -1133,6 +1159,24 @@ normalizedObjectToAtoms(MachOFile *file,
                     << file->path() << "\n");
   bool scatterable = ((normalizedFile.flags & MH_SUBSECTIONS_VIA_SYMBOLS) != 0);
 
+  // Distribute the symbol table into per-section symbol lists in a single
+  // pass, then sort each section's list, in parallel. Scanning the whole
+  // symbol table once per section would make a file with many sections
+  // quadratic in its symbol count. The scan and the sorts are the
+  // expensive part of atomizing a symboled section and only read the
+  // normalized file. Atom creation itself stays serial below: atoms share
+  // the file's bump allocator, and the layout pass orders atoms by the
+  // ordinals they are assigned at creation, so they must be made in
+  // section order for the output to be reproducible.
+  std::vector<SmallVector<const Symbol *, 64>> sortedSymbols(
+                                                normalizedFile.sections.size());
+  bucketSymbolsBySection(normalizedFile.globalSymbols, sortedSymbols);
+  bucketSymbolsBySection(normalizedFile.localSymbols,  sortedSymbols);
+  parallel_for_each(sortedSymbols.begin(), sortedSymbols.end(),
+                    [](SmallVector<const Symbol *, 64> &symbols) {
+    sortSymbolsInSection(symbols);
+  }, 1);
+
   // Create atoms from each section.
   for (auto &sect : normalizedFile.sections) {
     DEBUG(llvm::dbgs() << "Creating atoms: "; sect.dump());
@@ -1154,7 +1198,9 @@ normalizedObjectToAtoms(MachOFile *file,
     DefinedAtom::ContentType atomType = atomTypeFromSection(sect,
                                                             customSectionName);
     if (auto ec =  processSection(atomType, sect, customSectionName,
-                                  normalizedFile, *file, scatterable, copyRefs))
+                                  normalizedFile, *file, scatterable, copyRefs,
+                                  sortedSymbols[&sect -
+                                                normalizedFile.sections.data()]))
       return ec;
   }
   // Create atoms from undefined symbols.
@@ -1244,10 +1290,12 @@ normalizedObjectToAtoms(MachOFile *file,
   file->setMinVersion(normalizedFile.minOSverson);
   file->setMinVersionLoadCommandKind(normalizedFile.minOSVersionKind);
 
-  // Sort references in each atom to their canonical order.
-  for (const DefinedAtom* defAtom : file->defined()) {
+  // Sort references in each atom to their canonical order. Each atom
+  // only reorders its own reference list, so the atoms are independent.
+  parallel_for_each(file->defined().begin(), file->defined().end(),
+                    [](const DefinedAtom *defAtom) {
     reinterpret_cast<const SimpleDefinedAtom*>(defAtom)->sortReferences();
-  }
+  }, 64);
   return llvm::Error();
 }
 
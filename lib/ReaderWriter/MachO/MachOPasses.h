@@ -10,19 +10,86 @@
 #ifndef LLD_READER_WRITER_MACHO_PASSES_H
 #define LLD_READER_WRITER_MACHO_PASSES_H
 
+#include "ArchHandler.h"
 #include "lld/Core/PassManager.h"
 #include "lld/ReaderWriter/MachOLinkingContext.h"
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace lld {
 namespace mach_o {
 
+/// Shared single-sweep reference classifier for the GOT, TLV, and shim
+/// passes. Each of those passes used to walk every reference of every
+/// atom in the merged file looking only for its own kinds. When more
+/// than one of them is enabled, one sweep buckets the references for
+/// all of them: the first pass of the group to run scans the file once
+/// and the later passes just consume their bucket.
+///
+/// The stubs pass cannot share the sweep: the compact-unwind pass runs
+/// between it and the GOT pass, deletes the per-function compact-unwind
+/// atoms, and creates references (e.g. to personality functions) that
+/// the GOT pass must see. After the group's first pass runs, the
+/// buckets stay valid because no later pass deletes atoms, and the GOT
+/// and TLV passes only retarget references in their own bucket and
+/// rewrite them to kinds no predicate here matches.
+class ReferenceWorklists {
+public:
+  /// A matched reference paired with the defined atom that holds it.
+  typedef std::pair<const DefinedAtom *, const Reference *> AtomAndRef;
+
+  /// Buckets every reference in \p mergedFile on the first call; later
+  /// calls from the other passes sharing this object are no-ops.
+  void scanOnce(SimpleFile &mergedFile, ArchHandler &archHandler) {
+    if (_scanned)
+      return;
+    _scanned = true;
+    for (const DefinedAtom *atom : mergedFile.defined()) {
+      for (const Reference *ref : *atom) {
+        bool canBypassGOT;
+        if (archHandler.isGOTAccess(*ref, canBypassGOT))
+          _gotAccesses.push_back(std::make_pair(ref, canBypassGOT));
+        // isTLVAccess() asserts the reference is in the mach-o kind
+        // namespace, so pre-filter the layout and other generic kinds.
+        else if (ref->kindNamespace() == Reference::KindNamespace::mach_o &&
+                 archHandler.isTLVAccess(*ref))
+          _tlvAccesses.push_back(std::make_pair(atom, ref));
+        else if (archHandler.isNonCallBranch(*ref))
+          _nonCallBranches.push_back(std::make_pair(atom, ref));
+      }
+    }
+  }
+
+  /// GOT-accessing references with the canBypassGOT flag each matched
+  /// with.
+  const std::vector<std::pair<const Reference *, bool>> &gotAccesses() const {
+    return _gotAccesses;
+  }
+
+  const std::vector<AtomAndRef> &tlvAccesses() const { return _tlvAccesses; }
+
+  const std::vector<AtomAndRef> &nonCallBranches() const {
+    return _nonCallBranches;
+  }
+
+private:
+  bool _scanned = false;
+  std::vector<std::pair<const Reference *, bool>> _gotAccesses;
+  std::vector<AtomAndRef> _tlvAccesses;
+  std::vector<AtomAndRef> _nonCallBranches;
+};
+
 void addLayoutPass(PassManager &pm, const MachOLinkingContext &ctx);
 void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx);
+void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx,
+                std::shared_ptr<ReferenceWorklists> worklists);
+void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx,
+                std::shared_ptr<ReferenceWorklists> worklists);
 void addCompactUnwindPass(PassManager &pm, const MachOLinkingContext &ctx);
 void addObjCPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addShimPass(PassManager &pm, const MachOLinkingContext &ctx);
+void addShimPass(PassManager &pm, const MachOLinkingContext &ctx,
+                 std::shared_ptr<ReferenceWorklists> worklists);
 
 } // namespace mach_o
 } // namespace lld
@@ -40,28 +40,29 @@ namespace mach_o {
 
 class ShimPass : public Pass {
 public:
-  ShimPass(const MachOLinkingContext &context)
+  ShimPass(const MachOLinkingContext &context,
+           std::shared_ptr<ReferenceWorklists> worklists)
       : _ctx(context), _archHandler(_ctx.archHandler()),
         _stubInfo(_archHandler.stubInfo()),
-        _file(*_ctx.make_file<MachOFile>("<mach-o shim pass>")) {
+        _file(*_ctx.make_file<MachOFile>("<mach-o shim pass>")),
+        _worklists(std::move(worklists)) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
   llvm::Error perform(SimpleFile &mergedFile) override {
-    // Scan all references in all atoms.
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        // Look at non-call branches.
-        if (!_archHandler.isNonCallBranch(*ref))
-          continue;
-        const Atom *target = ref->target();
-        assert(target != nullptr);
-        if (const lld::DefinedAtom *daTarget = dyn_cast<DefinedAtom>(target)) {
-          bool atomIsThumb = _archHandler.isThumbFunction(*atom);
-          bool targetIsThumb = _archHandler.isThumbFunction(*daTarget);
-          if (atomIsThumb != targetIsThumb)
-            updateBranchToUseShim(atomIsThumb, *daTarget, ref);
-        }
+    // Walk the non-call branches found by the shared classification
+    // sweep.
+    _worklists->scanOnce(mergedFile, _archHandler);
+    for (auto &use : _worklists->nonCallBranches()) {
+      const DefinedAtom *atom = use.first;
+      const Reference *ref = use.second;
+      const Atom *target = ref->target();
+      assert(target != nullptr);
+      if (const lld::DefinedAtom *daTarget = dyn_cast<DefinedAtom>(target)) {
+        bool atomIsThumb = _archHandler.isThumbFunction(*atom);
+        bool targetIsThumb = _archHandler.isThumbFunction(*daTarget);
+        if (atomIsThumb != targetIsThumb)
+          updateBranchToUseShim(atomIsThumb, *daTarget, ref);
       }
     }
     // Exit early if no shims needed.
@@ -116,13 +117,15 @@ private:
   mach_o::ArchHandler                            &_archHandler;
   const ArchHandler::StubInfo                    &_stubInfo;
   MachOFile                                      &_file;
+  std::shared_ptr<ReferenceWorklists>             _worklists;
   llvm::DenseMap<const Atom*, const DefinedAtom*> _targetToShim;
 };
 
 
 
-void addShimPass(PassManager &pm, const MachOLinkingContext &ctx) {
-  pm.add(llvm::make_unique<ShimPass>(ctx));
+void addShimPass(PassManager &pm, const MachOLinkingContext &ctx,
+                 std::shared_ptr<ReferenceWorklists> worklists) {
+  pm.add(llvm::make_unique<ShimPass>(ctx, std::move(worklists)));
 }
 
 } // end namespace mach_o
@@ -65,9 +65,11 @@ private:
 
 class TLVPass : public Pass {
 public:
-  TLVPass(const MachOLinkingContext &context)
+  TLVPass(const MachOLinkingContext &context,
+          std::shared_ptr<ReferenceWorklists> worklists)
       : _ctx(context), _archHandler(_ctx.archHandler()),
-        _file(*_ctx.make_file<MachOFile>("<mach-o TLV pass>")) {
+        _file(*_ctx.make_file<MachOFile>("<mach-o TLV pass>")),
+        _worklists(std::move(worklists)) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
@@ -75,24 +77,22 @@ private:
   llvm::Error perform(SimpleFile &mergedFile) override {
     bool allowTLV = _ctx.minOS("10.7", "1.0");
 
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        if (!_archHandler.isTLVAccess(*ref))
-          continue;
-
-        if (!allowTLV)
-          return llvm::make_error<GenericError>(
-            "targeted OS version does not support use of thread local "
-            "variables in " + atom->name() + " for architecture " +
-            _ctx.archName());
-
-        const Atom *target = ref->target();
-        assert(target != nullptr);
-
-        const DefinedAtom *tlvpEntry = makeTLVPEntry(target);
-        const_cast<Reference*>(ref)->setTarget(tlvpEntry);
-        _archHandler.updateReferenceToTLV(ref);
-      }
+    _worklists->scanOnce(mergedFile, _archHandler);
+    for (auto &use : _worklists->tlvAccesses()) {
+      const DefinedAtom *atom = use.first;
+      const Reference *ref = use.second;
+      if (!allowTLV)
+        return llvm::make_error<GenericError>(
+          "targeted OS version does not support use of thread local "
+          "variables in " + atom->name() + " for architecture " +
+          _ctx.archName());
+
+      const Atom *target = ref->target();
+      assert(target != nullptr);
+
+      const DefinedAtom *tlvpEntry = makeTLVPEntry(target);
+      const_cast<Reference*>(ref)->setTarget(tlvpEntry);
+      _archHandler.updateReferenceToTLV(ref);
     }
 
     std::vector<const TLVPEntryAtom*> entries;
@@ -129,12 +129,14 @@ private:
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler &_archHandler;
   MachOFile           &_file;
+  std::shared_ptr<ReferenceWorklists> _worklists;
   llvm::DenseMap<const Atom*, const TLVPEntryAtom*> _targetToTLVP;
 };
 
-void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx) {
+void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx,
+                std::shared_ptr<ReferenceWorklists> worklists) {
   assert(ctx.needsTLVPass());
-  pm.add(llvm::make_unique<TLVPass>(ctx));
+  pm.add(llvm::make_unique<TLVPass>(ctx, std::move(worklists)));
 }
 
 } // end namesapce mach_o
@@ -0,0 +1,27 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %S/Inputs/archive.s -o %t2.o
+# RUN: rm -f %t.a %t.a.llindex
+# RUN: llvm-ar rcs %t.a %t2.o
+
+## The first link writes the sidecar index; the second one links from it.
+## Both must produce the same symbols.
+# RUN: ld.lld --archive-cache %t.o %t.a -o %t1.out
+# RUN: ls %t.a.llindex
+# RUN: ld.lld --archive-cache %t.o %t.a -o %t2.out
+# RUN: llvm-nm %t1.out | FileCheck %s
+# RUN: llvm-nm %t2.out | FileCheck %s
+
+## A stale cache (archive rewritten after the cache) is ignored.
+# RUN: llvm-ar rcs %t.a %t2.o
+# RUN: ld.lld --archive-cache %t.o %t.a -o %t3.out
+# RUN: llvm-nm %t3.out | FileCheck %s
+
+## Nothing here. The undefined reference to end fetches the member
+## that also defines _start.
+
+.quad end
+
+# CHECK: T _start
+# CHECK: T end
@@ -0,0 +1,45 @@
+// RUN: llvm-mc -filetype=obj -triple=armv7a-none-linux-gnueabi %s -o %t
+// RUN: ld.lld %t -o %t2
+// RUN: llvm-objdump -d -triple=armv7a-none-linux-gnueabi %t2 | FileCheck -check-prefix=ARM %s
+// RUN: llvm-objdump -d -triple=thumbv7a-none-linux-gnueabi %t2 | FileCheck -check-prefix=THUMB %s
+// REQUIRES: arm
+
+// Plain branches cannot change instruction state, so a B to a function
+// in the other state goes via a state-changing thunk. The thunk is
+// placed after the destination's section: an ARM-state thunk next to a
+// Thumb callee and a Thumb-state thunk next to an ARM callee.
+
+ .syntax unified
+ .section .arm_caller, "ax", %progbits
+ .arm
+ .globl _start
+ .type _start,%function
+_start:
+ b thumb_func
+ bx lr
+
+ .section .thumb_callee, "ax", %progbits
+ .thumb
+ .globl thumb_func
+ .type thumb_func,%function
+thumb_func:
+ b.w arm_func
+
+ .section .arm_callee, "ax", %progbits
+ .arm
+ .globl arm_func
+ .type arm_func,%function
+arm_func:
+ bx lr
+
+// The ARM-to-Thumb thunk after the Thumb callee's section.
+// ARM: Disassembly of section .thumb_callee:
+// ARM: movw r12,
+// ARM-NEXT: movt r12,
+// ARM-NEXT: bx r12
+
+// The Thumb-to-ARM thunk after the ARM callee's section.
+// THUMB: Disassembly of section .arm_callee:
+// THUMB: movw r12,
+// THUMB-NEXT: movt r12,
+// THUMB-NEXT: bx r12
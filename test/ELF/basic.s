@@ -217,3 +217,7 @@ _start:
 
 # RUN: not ld.lld %t --lto-jobs=0 2>&1 | FileCheck --check-prefix=NOTHREADS %s
 # NOTHREADS: number of threads must be > 0
+
+# RUN: not ld.lld %t --threads=0 2>&1 | FileCheck --check-prefix=NOTHREADS %s
+# RUN: ld.lld %t --threads=1 -o %t.thr1
+# RUN: ld.lld %t --threads=2 -o %t.thr2
@@ -0,0 +1,33 @@
+# REQUIRES: zlib
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld --compress-debug-sections=zlib %t.o -o %t
+# RUN: llvm-readobj -sections %t | FileCheck %s
+
+# CHECK:      Name: .debug_info
+# CHECK-NEXT: Type: SHT_PROGBITS
+# CHECK-NEXT: Flags [
+# CHECK-NEXT:   SHF_COMPRESSED (0x800)
+# CHECK-NEXT: ]
+
+## Without the flag the section stays uncompressed.
+# RUN: ld.lld %t.o -o %t2
+# RUN: llvm-readobj -sections %t2 | FileCheck --check-prefix=PLAIN %s
+
+# PLAIN:      Name: .debug_info
+# PLAIN-NEXT: Type: SHT_PROGBITS
+# PLAIN-NEXT: Flags [
+# PLAIN-NEXT: ]
+
+# RUN: not ld.lld --compress-debug-sections=zstd %t.o -o %t3 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: unknown --compress-debug-sections value: zstd
+
+.globl _start
+_start:
+  ret
+
+.section .debug_info,"",@progbits
+.long .debug_info
+.asciz "some debug info to give the compressor something to chew on"
+.asciz "some debug info to give the compressor something to chew on"
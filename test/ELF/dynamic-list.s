@@ -91,7 +91,12 @@
 # CHECK2-NEXT:     Other: 0
 # CHECK2-NEXT:     Section: .text (0x4)
 # CHECK2-NEXT:   }
-# CHECK2-NEXT: ] 
+# CHECK2-NEXT: ]
+
+## A wildcard pattern exports every matching defined symbol.
+# RUN: echo "{ foo*; };" > %t.list
+# RUN: ld.lld --dynamic-list %t.list %t %t2.so -o %t.exe
+# RUN: llvm-readobj -dyn-symbols %t.exe | FileCheck -check-prefix=CHECK2 %s
 
 .globl foo1
 foo1:
@@ -0,0 +1,27 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## The first -incremental link writes the output and records a
+## fingerprint next to it.
+# RUN: rm -f %t %t.incremental
+# RUN: ld.lld -incremental %t.o -o %t
+# RUN: llvm-readobj -file-headers %t | FileCheck %s
+# RUN: ls %t.incremental
+
+## If nothing changed, a relink is skipped entirely. Scribble over the
+## output to observe that it is not rewritten.
+# RUN: echo SKIPPED > %t
+# RUN: ld.lld -incremental %t.o -o %t
+# RUN: FileCheck -check-prefix=SKIP %s < %t
+# SKIP: SKIPPED
+
+## Changing the command line (or any input) triggers a real relink.
+# RUN: ld.lld -incremental --gc-sections %t.o -o %t
+# RUN: llvm-readobj -file-headers %t | FileCheck %s
+
+# CHECK: Type: Executable
+
+.globl _start
+_start:
+  ret
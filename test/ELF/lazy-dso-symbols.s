@@ -0,0 +1,17 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %p/Inputs/shared.s -o %t1.o
+# RUN: ld.lld -shared --hash-style=gnu %t1.o -o %t1.so
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t2.o
+
+## Symbols referenced by the executable are found through the DSO's
+## .gnu.hash table and resolve exactly as in an eager link.
+# RUN: ld.lld -lazy-dso-symbols %t2.o %t1.so -o %t
+# RUN: llvm-readobj -dyn-symbols %t | FileCheck %s
+
+# CHECK: Name: bar@
+# CHECK-NOT: Name: bar2@
+
+.globl _start
+_start:
+  callq bar@PLT
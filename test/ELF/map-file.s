@@ -0,0 +1,23 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t -Map %t.map
+# RUN: FileCheck %s < %t.map
+
+# CHECK: Address{{.*}}Size{{.*}}Align Out     In      File    Symbol
+# CHECK: .text
+# CHECK: .text {{.*}}map-file.s.tmp.o
+# CHECK: _start
+# CHECK: .comment
+
+## --cref appends a cross reference table to the map file.
+# RUN: ld.lld %t.o -o %t --cref -Map=%t.map
+# RUN: FileCheck --check-prefix=CREF %s < %t.map
+
+# CREF: Cross Reference Table
+# CREF: Symbol {{.*}}File
+# CREF: _start {{.*}}map-file.s.tmp.o
+
+.global _start
+_start:
+  nop
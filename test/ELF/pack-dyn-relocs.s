@@ -0,0 +1,21 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld -shared --pack-dyn-relocs=relr %t.o -o %t.so
+# RUN: llvm-readobj -sections -relocations %t.so | FileCheck %s
+
+## The relative relocations for the pointers below move from .rela.dyn
+## into the packed .relr.dyn section.
+# CHECK: Name: .relr.dyn
+# CHECK: Relocations [
+# CHECK-NOT: R_X86_64_RELATIVE
+
+# RUN: not ld.lld -shared --pack-dyn-relocs=bogus %t.o -o %t2.so 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: unknown --pack-dyn-relocs format: bogus
+
+.data
+foo:
+.quad foo
+.quad foo
+.quad foo
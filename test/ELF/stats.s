@@ -0,0 +1,13 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t --stats | FileCheck %s
+
+# Each line is the number of bytes an arena handed out, followed by the
+# class it holds.
+# CHECK-DAG: {{[0-9]+}} lld::elf::Symbol
+# CHECK-DAG: {{[0-9]+}} lld::elf::InputSection<
+
+.global _start
+_start:
+  ret
@@ -0,0 +1,43 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: echo "zed" > %t.order
+# RUN: echo "bar" >> %t.order
+# RUN: ld.lld --symbol-ordering-file %t.order %t.o -o %t
+# RUN: llvm-nm -n %t | FileCheck %s
+
+## Listed sections come first in file order; unlisted ones keep their
+## input order after them.
+# CHECK:      T zed
+# CHECK-NEXT: T bar
+# CHECK-NEXT: T foo
+# CHECK-NEXT: T _start
+
+## Without the flag everything stays in input order.
+# RUN: ld.lld %t.o -o %t2
+# RUN: llvm-nm -n %t2 | FileCheck --check-prefix=PLAIN %s
+
+# PLAIN:      T foo
+# PLAIN-NEXT: T bar
+# PLAIN-NEXT: T zed
+# PLAIN-NEXT: T _start
+
+.section .text.foo,"ax",@progbits
+.globl foo
+foo:
+  ret
+
+.section .text.bar,"ax",@progbits
+.globl bar
+bar:
+  ret
+
+.section .text.zed,"ax",@progbits
+.globl zed
+zed:
+  ret
+
+.section .text._start,"ax",@progbits
+.globl _start
+_start:
+  ret
@@ -0,0 +1,13 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t -time-trace=%t.json
+# RUN: FileCheck %s < %t.json
+
+# CHECK: {"traceEvents":[
+# CHECK-DAG: "name":"createSections"
+# CHECK-DAG: "name":"writeSections"
+
+.globl _start
+_start:
+  ret
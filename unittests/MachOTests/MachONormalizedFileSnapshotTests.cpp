@@ -0,0 +1,250 @@
+//===- lld/unittest/MachOTests/MachONormalizedFileSnapshotTests.cpp -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "../../lib/ReaderWriter/MachO/MachONormalizedFile.h"
+#include "lld/ReaderWriter/MachOLinkingContext.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MachO.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+
+using llvm::StringRef;
+using llvm::MemoryBuffer;
+using lld::mach_o::normalized::NormalizedFile;
+using lld::mach_o::normalized::Symbol;
+using lld::mach_o::normalized::Section;
+using lld::mach_o::normalized::Segment;
+using lld::mach_o::normalized::Relocation;
+using lld::mach_o::normalized::DependentDylib;
+using lld::mach_o::normalized::RebaseLocation;
+using lld::mach_o::normalized::BindLocation;
+using lld::mach_o::normalized::Export;
+
+static void toSnapshot(const NormalizedFile &f, std::string &out) {
+  llvm::raw_string_ostream ostr(out);
+  std::error_code ec = lld::mach_o::normalized::writeSnapshot(f, ostr);
+  EXPECT_TRUE(!ec);
+}
+
+static std::unique_ptr<NormalizedFile> fromSnapshot(StringRef str) {
+  std::unique_ptr<MemoryBuffer> mb(MemoryBuffer::getMemBuffer(str));
+  llvm::Expected<std::unique_ptr<NormalizedFile>> r =
+                                    lld::mach_o::normalized::readSnapshot(mb);
+  EXPECT_FALSE(!r);
+  return std::move(*r);
+}
+
+TEST(NormalizedSnapshot, empty) {
+  NormalizedFile f;
+  f.arch = lld::MachOLinkingContext::arch_x86_64;
+  f.fileType = llvm::MachO::MH_OBJECT;
+  f.flags = llvm::MachO::MH_SUBSECTIONS_VIA_SYMBOLS;
+  std::string intermediate;
+  toSnapshot(f, intermediate);
+  std::unique_ptr<NormalizedFile> f2 = fromSnapshot(intermediate);
+  EXPECT_EQ(f2->arch, lld::MachOLinkingContext::arch_x86_64);
+  EXPECT_EQ(f2->fileType, llvm::MachO::MH_OBJECT);
+  EXPECT_EQ((int)(f2->flags), llvm::MachO::MH_SUBSECTIONS_VIA_SYMBOLS);
+  EXPECT_TRUE(f2->sections.empty());
+  EXPECT_TRUE(f2->localSymbols.empty());
+  EXPECT_TRUE(f2->globalSymbols.empty());
+  EXPECT_TRUE(f2->undefinedSymbols.empty());
+}
+
+TEST(NormalizedSnapshot, objectFile) {
+  NormalizedFile f;
+  f.arch = lld::MachOLinkingContext::arch_x86;
+  f.fileType = llvm::MachO::MH_OBJECT;
+
+  Section sect;
+  sect.segmentName = "__TEXT";
+  sect.sectionName = "__text";
+  sect.type = llvm::MachO::S_REGULAR;
+  sect.attributes = llvm::MachO::S_ATTR_PURE_INSTRUCTIONS;
+  sect.alignment = 4;
+  sect.address = 0x100;
+  static const uint8_t contentBytes[] = { 0x55, 0x89, 0xE5, 0xC3 };
+  sect.content = llvm::makeArrayRef(contentBytes);
+  Relocation reloc;
+  reloc.offset = 1;
+  reloc.pcRel = true;
+  reloc.isExtern = true;
+  reloc.type = llvm::MachO::GENERIC_RELOC_VANILLA;
+  reloc.length = 2;
+  reloc.symbol = 1;
+  sect.relocations.push_back(reloc);
+  sect.indirectSymbols.push_back(7);
+  f.sections.push_back(sect);
+
+  Symbol local;
+  local.name = "_func";
+  local.type = llvm::MachO::N_SECT;
+  local.sect = 1;
+  local.value = 0x100;
+  f.localSymbols.push_back(local);
+  Symbol undef;
+  undef.name = "_printf";
+  undef.type = llvm::MachO::N_UNDF;
+  f.undefinedSymbols.push_back(undef);
+
+  std::string intermediate;
+  toSnapshot(f, intermediate);
+  std::unique_ptr<NormalizedFile> f2 = fromSnapshot(intermediate);
+
+  EXPECT_EQ(f2->arch, lld::MachOLinkingContext::arch_x86);
+  ASSERT_EQ(f2->sections.size(), 1UL);
+  const Section &sect2 = f2->sections[0];
+  EXPECT_TRUE(sect2.segmentName.equals("__TEXT"));
+  EXPECT_TRUE(sect2.sectionName.equals("__text"));
+  EXPECT_EQ(sect2.type, llvm::MachO::S_REGULAR);
+  EXPECT_EQ((uint32_t)sect2.attributes,
+            (uint32_t)llvm::MachO::S_ATTR_PURE_INSTRUCTIONS);
+  EXPECT_EQ((uint16_t)sect2.alignment, 4U);
+  EXPECT_EQ(sect2.address, 0x100ULL);
+  ASSERT_EQ(sect2.content.size(), 4UL);
+  EXPECT_EQ(sect2.content[0], 0x55);
+  EXPECT_EQ(sect2.content[3], 0xC3);
+  ASSERT_EQ(sect2.relocations.size(), 1UL);
+  const Relocation &reloc2 = sect2.relocations[0];
+  EXPECT_EQ(reloc2.offset, 1U);
+  EXPECT_TRUE(reloc2.pcRel);
+  EXPECT_TRUE(reloc2.isExtern);
+  EXPECT_EQ(reloc2.type, llvm::MachO::GENERIC_RELOC_VANILLA);
+  EXPECT_EQ(reloc2.length, 2);
+  EXPECT_EQ(reloc2.symbol, 1U);
+  ASSERT_EQ(sect2.indirectSymbols.size(), 1UL);
+  EXPECT_EQ(sect2.indirectSymbols[0], 7U);
+
+  ASSERT_EQ(f2->localSymbols.size(), 1UL);
+  EXPECT_TRUE(f2->localSymbols[0].name.equals("_func"));
+  EXPECT_EQ(f2->localSymbols[0].type, llvm::MachO::N_SECT);
+  EXPECT_EQ(f2->localSymbols[0].sect, 1);
+  EXPECT_EQ(f2->localSymbols[0].value, 0x100ULL);
+  ASSERT_EQ(f2->undefinedSymbols.size(), 1UL);
+  EXPECT_TRUE(f2->undefinedSymbols[0].name.equals("_printf"));
+}
+
+TEST(NormalizedSnapshot, finalImage) {
+  NormalizedFile f;
+  f.arch = lld::MachOLinkingContext::arch_x86_64;
+  f.fileType = llvm::MachO::MH_EXECUTE;
+  f.installName = "/usr/lib/libfoo.dylib";
+  f.compatVersion = 0x10000;
+  f.currentVersion = 0x20000;
+  f.hasUUID = true;
+  f.rpaths.push_back("@loader_path/../Frameworks");
+  f.entryAddress = 0x1000;
+  f.os = lld::MachOLinkingContext::OS::macOSX;
+  f.pageSize = 0x1000;
+
+  Segment seg;
+  seg.name = "__DATA";
+  seg.address = 0x2000;
+  seg.size = 0x1000;
+  seg.init_access = 3;
+  seg.max_access = 7;
+  f.segments.push_back(seg);
+
+  DependentDylib dep;
+  dep.path = "/usr/lib/libSystem.B.dylib";
+  dep.kind = llvm::MachO::LC_LOAD_DYLIB;
+  f.dependentDylibs.push_back(dep);
+
+  RebaseLocation rebase;
+  rebase.segOffset = 0x10;
+  rebase.segIndex = 1;
+  rebase.kind = llvm::MachO::REBASE_TYPE_POINTER;
+  f.rebasingInfo.push_back(rebase);
+
+  BindLocation bind;
+  bind.segOffset = 0x18;
+  bind.segIndex = 1;
+  bind.kind = llvm::MachO::BIND_TYPE_POINTER;
+  bind.canBeNull = false;
+  bind.ordinal = 1;
+  bind.symbolName = "_malloc";
+  bind.addend = 8;
+  f.bindingInfo.push_back(bind);
+
+  Export exp;
+  exp.name = "_main";
+  exp.offset = 0x1000;
+  exp.kind = llvm::MachO::EXPORT_SYMBOL_FLAGS_KIND_REGULAR;
+  f.exportInfo.push_back(exp);
+
+  std::string intermediate;
+  toSnapshot(f, intermediate);
+  std::unique_ptr<NormalizedFile> f2 = fromSnapshot(intermediate);
+
+  EXPECT_EQ(f2->fileType, llvm::MachO::MH_EXECUTE);
+  EXPECT_TRUE(f2->installName.equals("/usr/lib/libfoo.dylib"));
+  EXPECT_EQ((uint32_t)f2->compatVersion, 0x10000U);
+  EXPECT_EQ((uint32_t)f2->currentVersion, 0x20000U);
+  EXPECT_TRUE(f2->hasUUID);
+  ASSERT_EQ(f2->rpaths.size(), 1UL);
+  EXPECT_TRUE(f2->rpaths[0].equals("@loader_path/../Frameworks"));
+  EXPECT_EQ(f2->entryAddress, 0x1000ULL);
+  EXPECT_EQ(f2->os, lld::MachOLinkingContext::OS::macOSX);
+  EXPECT_EQ((uint32_t)f2->pageSize, 0x1000U);
+
+  ASSERT_EQ(f2->segments.size(), 1UL);
+  EXPECT_TRUE(f2->segments[0].name.equals("__DATA"));
+  EXPECT_EQ(f2->segments[0].address, 0x2000ULL);
+  EXPECT_EQ((uint32_t)f2->segments[0].init_access, 3U);
+  EXPECT_EQ((uint32_t)f2->segments[0].max_access, 7U);
+
+  ASSERT_EQ(f2->dependentDylibs.size(), 1UL);
+  EXPECT_TRUE(f2->dependentDylibs[0].path.equals("/usr/lib/libSystem.B.dylib"));
+  EXPECT_EQ(f2->dependentDylibs[0].kind, llvm::MachO::LC_LOAD_DYLIB);
+
+  ASSERT_EQ(f2->rebasingInfo.size(), 1UL);
+  EXPECT_EQ(f2->rebasingInfo[0].segOffset, 0x10U);
+  EXPECT_EQ(f2->rebasingInfo[0].segIndex, 1);
+  EXPECT_EQ(f2->rebasingInfo[0].kind, llvm::MachO::REBASE_TYPE_POINTER);
+
+  ASSERT_EQ(f2->bindingInfo.size(), 1UL);
+  EXPECT_EQ(f2->bindingInfo[0].segOffset, 0x18U);
+  EXPECT_EQ(f2->bindingInfo[0].ordinal, 1);
+  EXPECT_TRUE(f2->bindingInfo[0].symbolName.equals("_malloc"));
+  EXPECT_EQ(f2->bindingInfo[0].addend, 8ULL);
+
+  ASSERT_EQ(f2->exportInfo.size(), 1UL);
+  EXPECT_TRUE(f2->exportInfo[0].name.equals("_main"));
+  EXPECT_EQ(f2->exportInfo[0].offset, 0x1000ULL);
+}
+
+TEST(NormalizedSnapshot, rejectsMalformed) {
+  // Wrong magic.
+  std::unique_ptr<MemoryBuffer> mb(MemoryBuffer::getMemBuffer("not a snap"));
+  llvm::Expected<std::unique_ptr<NormalizedFile>> r =
+                                    lld::mach_o::normalized::readSnapshot(mb);
+  EXPECT_TRUE(!r);
+  llvm::consumeError(r.takeError());
+
+  // Truncated in the middle of the payload.
+  NormalizedFile f;
+  f.arch = lld::MachOLinkingContext::arch_x86_64;
+  Symbol sym;
+  sym.name = "_truncated";
+  f.globalSymbols.push_back(sym);
+  std::string intermediate;
+  toSnapshot(f, intermediate);
+  std::unique_ptr<MemoryBuffer> mb2(MemoryBuffer::getMemBuffer(
+                     StringRef(intermediate).drop_back(intermediate.size()/2)));
+  llvm::Expected<std::unique_ptr<NormalizedFile>> r2 =
+                                   lld::mach_o::normalized::readSnapshot(mb2);
+  EXPECT_TRUE(!r2);
+  llvm::consumeError(r2.takeError());
+}